@@ -12,10 +12,13 @@
 #ifndef _PSVR2_H_
 #define _PSVR2_H_
 
+#include <linux/atomic.h>
 #include <linux/kref.h>
 #include <linux/mutex.h>
 #include <linux/usb.h>
 
+#include "psvr2_protocol.h"
+
 #define PSVR2_VENDOR_ID		0x054c
 #define PSVR2_PRODUCT_ID	0x0cde
 
@@ -83,6 +86,7 @@
 #define PSVR2_CAM_MODE1_XFER_SIZE	819456
 #define PSVR2_CAM_MODE1_WIDTH		1280
 #define PSVR2_CAM_MODE1_HEIGHT		640
+#define PSVR2_CAM_FRAME_SIZE	(PSVR2_CAM_MODE1_WIDTH * PSVR2_CAM_MODE1_HEIGHT)
 
 /*
  * IMU scaling (raw __s16 -> physical units), from the Monado driver.
@@ -96,11 +100,73 @@
 #define PSVR2_IMU_FULL_SCALE		32767
 #define PSVR2_IMU_INVALID		((__s16)0x8000)	/* FIFO sentinel */
 #define PSVR2_IMU_FREQ_HZ		2000
+#define PSVR2_IMU_PERIOD_NS		(NSEC_PER_SEC / PSVR2_IMU_FREQ_HZ)
 
 /* IPD dial range in millimetres (from the status header). */
 #define PSVR2_IPD_MIN_MM	59
 #define PSVR2_IPD_MAX_MM	72
 
+/*
+ * Low-power policy while the headset is not worn: after the proximity sensor
+ * has read "removed" for the (sysfs-tunable) delay, the gaze stream and cameras
+ * are paused and IIO delivery is decimated to 2000 / 20 = 100 Hz.
+ */
+#define PSVR2_LOWPOWER_DELAY_MS		60000
+#define PSVR2_LOWPOWER_DELAY_MAX_MS	3600000
+#define PSVR2_LOWPOWER_IMU_DIV		20
+
+/*
+ * Stall watchdog: checked every PERIOD, a watched stream silent for longer than
+ * STALL (debugfs-tunable) enters staged recovery.
+ */
+#define PSVR2_WATCHDOG_PERIOD_MS	250
+#define PSVR2_WATCHDOG_STALL_MS		2000
+
+/* Data streams, for per-stream bookkeeping (watchdog, stats). */
+enum psvr2_stream {
+	PSVR2_STREAM_STATUS,
+	PSVR2_STREAM_SLAM,
+	PSVR2_STREAM_GAZE,
+	PSVR2_STREAM_CAMERA,
+	PSVR2_STREAM_COUNT,
+};
+
+/*
+ * Per-stream statistics (debugfs psvr2/<index>/stats/<stream>). Embedded in each stream
+ * context so the read() path can account dequeue latency for as long as a
+ * reader holds the context, even past disconnect. Histograms are log2 over
+ * microseconds: bucket 0 counts 0, bucket k counts [2^(k-1), 2^k), and the last
+ * bucket also takes everything larger.
+ */
+#define PSVR2_STATS_HIST_BUCKETS	24
+
+enum psvr2_stats_err {
+	PSVR2_STATS_ERR_EPROTO,
+	PSVR2_STATS_ERR_EILSEQ,
+	PSVR2_STATS_ERR_ETIME,
+	PSVR2_STATS_ERR_EPIPE,
+	PSVR2_STATS_ERR_EOVERFLOW,
+	PSVR2_STATS_ERR_EREMOTEIO,
+	PSVR2_STATS_ERR_UNLINK,		/* -ENOENT / -ECONNRESET / -ESHUTDOWN */
+	PSVR2_STATS_ERR_OTHER,
+	PSVR2_STATS_NUM_ERRS,
+};
+
+struct psvr2_stream_stats {
+	atomic64_t	urbs;			/* completed successfully */
+	atomic64_t	bytes;
+	atomic64_t	records;		/* parsed and delivered */
+	atomic64_t	fifo_overflows;
+	atomic64_t	resubmit_failures;
+	atomic64_t	urb_errors[PSVR2_STATS_NUM_ERRS];
+	atomic64_t	read_latency_us[PSVR2_STATS_HIST_BUCKETS];
+	atomic64_t	device_gap_us[PSVR2_STATS_HIST_BUCKETS];
+
+	/* Gap tracking; only touched by the stream's own completion. */
+	bool		have_device_ts;
+	u32		last_device_ts_us;
+};
+
 struct psvr2_imu;
 struct psvr2_input;
 struct psvr2_status;
@@ -108,6 +174,9 @@ struct psvr2_slam;
 struct psvr2_camera;
 struct psvr2_gaze;
 struct psvr2_aux;
+struct psvr2_power;
+struct psvr2_watchdog;
+struct psvr2_stats;
 
 /* Number of auxiliary drain interfaces (LED detector, relocalizer, VD). */
 #define PSVR2_AUX_COUNT		3
@@ -121,8 +190,10 @@ struct psvr2_aux;
 struct psvr2_device {
 	struct kref		kref;
 	struct list_head	node;		/* entry in the device registry */
+	int			index;		/* N in psvr2-poseN, debugfs psvr2/N */
 	struct usb_device	*udev;		/* for ep0 control transfers */
 	struct mutex		ctrl_lock;	/* serialises ep0 control    */
+	struct mutex		state_lock;	/* stream pause/recovery vs. stop */
 	u8			brightness;	/* last value written (0..31) */
 
 	struct psvr2_status	*status;	/* IF7 stream context        */
@@ -132,10 +203,63 @@ struct psvr2_device {
 	struct psvr2_camera	*camera;	/* IF6 V4L2 device           */
 	struct psvr2_gaze	*gaze;		/* IF5 stream context        */
 	struct psvr2_aux	*aux[PSVR2_AUX_COUNT];	/* IF8/9/10 drains   */
+	struct psvr2_power	*power;		/* worn/removed policy       */
+	struct psvr2_watchdog	*watchdog;	/* stream stall detection    */
+	struct psvr2_stats	*stats;		/* debugfs stats/ directory  */
 
-	struct dentry		*debugfs_dir;	/* created with the device   */
+	struct dentry		*debugfs_dir;	/* psvr2/<index>/            */
+
+	/*
+	 * Suspend/resume: pm_armed is set on suspend and consumed by the first
+	 * interface to resume, which starts the time-to-first-pose clock
+	 * (debugfs psvr2/<index>/resume).
+	 */
+	bool			pm_armed;
+	unsigned int		resumes;
+	atomic64_t		resume_ns;	/* clock start, 0 once a pose lands */
+	u32			first_pose_us;	/* after the last resume     */
+	u32			first_pose_max_us;
 };
 
+/*
+ * psvr2_parse.c — pure wire-format parsers shared by the URB completions and
+ * the KUnit suite. None of them sleep, lock or look at the clock.
+ */
+struct psvr2_pose_sample;
+struct psvr2_gaze_sample;
+struct psvr2_gaze_eye;
+
+struct psvr2_status_info {
+	bool				dp_link;
+	bool				worn;
+	bool				function_button;
+	u8				ipd_mm;
+	const struct psvr2_imu_record	*imu;		/* records after the header */
+	unsigned int			num_imu;
+};
+
+struct psvr2_imu_sample {
+	u32	vts_us;
+	s16	accel[3];
+	s16	gyro[3];
+};
+
+int psvr2_parse_build_ctrl(struct sie_ctrl_pkt *pkt, u16 report_id, u16 subcmd,
+			   const void *data, u32 len);
+int psvr2_parse_status(const void *buf, size_t len,
+		       struct psvr2_status_info *info);
+bool psvr2_parse_imu(const struct psvr2_imu_record *rec,
+		     struct psvr2_imu_sample *out);
+s64 psvr2_parse_imu_timestamp(s64 rx_ns, unsigned int num, unsigned int i);
+int psvr2_parse_slam(const void *buf, size_t len,
+		     struct psvr2_pose_sample *out);
+void psvr2_parse_gaze_eye(struct psvr2_gaze_eye *out,
+			  const struct psvr2_pkt_eye_gaze *in);
+int psvr2_parse_gaze(const void *buf, size_t len,
+		     struct psvr2_gaze_sample *out);
+enum psvr2_camera_mode psvr2_parse_cam_mode(size_t len);
+const void *psvr2_parse_cam_mode1(const void *buf, size_t len);
+
 /* psvr2_usb.c — shared context lifecycle + ep0 vendor control. */
 struct psvr2_device *psvr2_device_get(struct usb_device *udev);
 void psvr2_device_put(struct psvr2_device *psvr2);
@@ -145,25 +269,106 @@ int psvr2_control_set(struct psvr2_device *psvr2, u16 report_id, u16 subcmd,
 int psvr2_control_get(struct psvr2_device *psvr2, u16 report_id, u16 subcmd,
 		      void *data, u32 len);
 
-/* psvr2_status.c — IF7 interrupt stream. */
+/*
+ * Stall recovery: kill @urb, re-select @alt on @ifnum and resubmit. Used by the
+ * per-stream *_reset() helpers, which expect state_lock to be held.
+ */
+int psvr2_reset_interface(struct psvr2_device *psvr2, struct urb *urb,
+			  u8 ifnum, u8 alt);
+
+/*
+ * Suspend/resume and pre/post_reset: each stream parks its URBs in *_suspend()
+ * and restarts them (plus any mode/enable reports) in *_resume(); @reset says
+ * the device lost its state and the alt setting has to be re-selected. Char
+ * devices, open files and the vb2 queue are untouched throughout.
+ */
+int psvr2_resume_urb(struct psvr2_device *psvr2, struct urb *urb, u8 ifnum,
+		     u8 alt, bool reset);
+void psvr2_pm_pose_arrived(struct psvr2_device *psvr2);
+
+/* sysfs: shows an attribute group only on the IF7 (status) interface. */
+umode_t psvr2_status_attr_visible(struct kobject *kobj, struct attribute *attr,
+				  int n);
+
+/* psvr2_status.c — IF7 interrupt stream (+ DP link sysfs). */
+extern const struct attribute_group psvr2_status_group;
 int psvr2_status_start(struct psvr2_device *psvr2, struct usb_interface *intf);
 void psvr2_status_stop(struct psvr2_device *psvr2);
+bool psvr2_status_headset_live(struct psvr2_device *psvr2);
+void psvr2_status_reset(struct psvr2_device *psvr2);
+void psvr2_status_suspend(struct psvr2_device *psvr2);
+int psvr2_status_resume(struct psvr2_device *psvr2, bool reset);
 
-/* psvr2_slam.c — IF3 bulk stream + /dev/psvr2-pose char device. */
+/* psvr2_slam.c — IF3 bulk stream + /dev/psvr2-pose<index> char device. */
 int psvr2_slam_start(struct psvr2_device *psvr2, struct usb_interface *intf);
 void psvr2_slam_stop(struct psvr2_device *psvr2);
+void psvr2_slam_reset(struct psvr2_device *psvr2);
+void psvr2_slam_suspend(struct psvr2_device *psvr2);
+int psvr2_slam_resume(struct psvr2_device *psvr2, bool reset);
 
 /* psvr2_camera.c — IF6 V4L2 capture device. */
 int psvr2_camera_start(struct psvr2_device *psvr2, struct usb_interface *intf);
 void psvr2_camera_stop(struct psvr2_device *psvr2);
+void psvr2_camera_set_paused(struct psvr2_device *psvr2, bool paused);
+void psvr2_camera_resend_mode(struct psvr2_device *psvr2);
+void psvr2_camera_suspend(struct psvr2_device *psvr2);
+int psvr2_camera_resume(struct psvr2_device *psvr2, bool reset);
 
-/* psvr2_gaze.c — IF5 bulk stream + /dev/psvr2-gaze char device. */
+/* psvr2_gaze.c — IF5 bulk stream + /dev/psvr2-gaze<index> char device. */
 int psvr2_gaze_start(struct psvr2_device *psvr2, struct usb_interface *intf);
 void psvr2_gaze_stop(struct psvr2_device *psvr2);
+void psvr2_gaze_set_paused(struct psvr2_device *psvr2, bool paused);
+void psvr2_gaze_resend(struct psvr2_device *psvr2);
+void psvr2_gaze_reset(struct psvr2_device *psvr2);
+void psvr2_gaze_suspend(struct psvr2_device *psvr2);
+int psvr2_gaze_resume(struct psvr2_device *psvr2, bool reset);
 
 /* psvr2_aux.c — drain the LED detector / relocalizer / VD tracking interfaces. */
 int psvr2_aux_start(struct psvr2_device *psvr2, struct usb_interface *intf);
 void psvr2_aux_stop(struct psvr2_device *psvr2, struct usb_interface *intf);
+void psvr2_aux_suspend(struct psvr2_device *psvr2, struct usb_interface *intf);
+int psvr2_aux_resume(struct psvr2_device *psvr2, struct usb_interface *intf,
+		     bool reset);
+
+/*
+ * psvr2_power.c — proximity-driven low-power policy. Lives alongside IF7 and is
+ * fed from the status header; psvr2_power_report() is atomic-safe.
+ */
+extern const struct attribute_group psvr2_power_group;
+int psvr2_power_start(struct psvr2_device *psvr2, struct usb_interface *intf);
+void psvr2_power_stop(struct psvr2_device *psvr2);
+void psvr2_power_report(struct psvr2_device *psvr2, bool worn);
+void psvr2_power_sync(struct psvr2_device *psvr2);
+
+/*
+ * psvr2_watchdog.c — per-stream stall detection and staged recovery. One per
+ * psvr2_device; feed() is called from URB completions, the recovery hooks
+ * above (*_resend*, *_reset) from its work item with state_lock held.
+ */
+int psvr2_watchdog_start(struct psvr2_device *psvr2);
+void psvr2_watchdog_stop(struct psvr2_device *psvr2);
+void psvr2_watchdog_feed(struct psvr2_device *psvr2, enum psvr2_stream stream);
+void psvr2_watchdog_enable(struct psvr2_device *psvr2, enum psvr2_stream stream,
+			   bool enable);
+
+/*
+ * psvr2_stats.c — per-stream counters and histograms. start/stop manage the
+ * psvr2/<index>/stats/ directory and its reset knob; each stream adds its embedded
+ * psvr2_stream_stats when it starts and removes it when it stops. The
+ * accounting helpers are atomic-safe.
+ */
+int psvr2_stats_start(struct psvr2_device *psvr2);
+void psvr2_stats_stop(struct psvr2_device *psvr2);
+void psvr2_stats_add(struct psvr2_device *psvr2, enum psvr2_stream stream,
+		     struct psvr2_stream_stats *stats);
+void psvr2_stats_remove(struct psvr2_device *psvr2, enum psvr2_stream stream);
+
+void psvr2_stats_urb(struct psvr2_stream_stats *stats, int status, u32 len);
+void psvr2_stats_resubmit_failed(struct psvr2_stream_stats *stats);
+void psvr2_stats_record(struct psvr2_stream_stats *stats);
+void psvr2_stats_device_ts(struct psvr2_stream_stats *stats, u32 device_ts_us);
+void psvr2_stats_overflow(struct psvr2_stream_stats *stats);
+void psvr2_stats_dequeue(struct psvr2_stream_stats *stats, u64 timestamp_ns);
 
 /*
  * psvr2_imu.c / psvr2_input.c register devm-managed IIO and input devices
@@ -172,7 +377,9 @@ void psvr2_aux_stop(struct psvr2_device *psvr2, struct usb_interface *intf);
  */
 int psvr2_imu_register(struct psvr2_device *psvr2, struct device *parent);
 void psvr2_imu_push(struct psvr2_device *psvr2,
-		    const s16 accel[3], const s16 gyro[3], s64 timestamp_ns);
+		    const s16 accel[3], const s16 gyro[3], u32 vts_us,
+		    s64 timestamp_ns);
+void psvr2_imu_set_decimation(struct psvr2_device *psvr2, unsigned int div);
 
 int psvr2_input_register(struct psvr2_device *psvr2, struct device *parent);
 void psvr2_input_report(struct psvr2_device *psvr2, bool function_button,
@@ -15,6 +15,7 @@
 #include <linux/usb.h>
 
 #include "psvr2.h"
+#include "psvr2_trace.h"
 
 struct psvr2_aux {
 	struct psvr2_device	*psvr2;
@@ -44,6 +45,8 @@ static void psvr2_aux_complete(struct urb *urb)
 	struct psvr2_aux *aux = urb->context;
 	int ret;
 
+	trace_psvr2_urb_complete(aux->ifnum, urb->status, urb->actual_length);
+
 	switch (urb->status) {
 	case 0:
 	case -EOVERFLOW:	/* short/large packet — keep draining */
@@ -141,6 +144,28 @@ err_free:
 	return ret;
 }
 
+/* PM: the drains only need their URB parked and restarted. */
+void psvr2_aux_suspend(struct psvr2_device *psvr2, struct usb_interface *intf)
+{
+	int idx = psvr2_aux_index(intf->cur_altsetting->desc.bInterfaceNumber);
+
+	if (idx >= 0 && psvr2->aux[idx])
+		usb_kill_urb(psvr2->aux[idx]->urb);
+}
+
+int psvr2_aux_resume(struct psvr2_device *psvr2, struct usb_interface *intf,
+		     bool reset)
+{
+	int idx = psvr2_aux_index(intf->cur_altsetting->desc.bInterfaceNumber);
+	struct psvr2_aux *aux;
+
+	if (idx < 0 || !psvr2->aux[idx])
+		return 0;
+	aux = psvr2->aux[idx];
+	return psvr2_resume_urb(psvr2, aux->urb, aux->ifnum, PSVR2_AUX_ALT,
+				reset);
+}
+
 void psvr2_aux_stop(struct psvr2_device *psvr2, struct usb_interface *intf)
 {
 	u8 ifnum = intf->cur_altsetting->desc.bInterfaceNumber;
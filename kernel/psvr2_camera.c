@@ -25,9 +25,9 @@
 
 #include "psvr2.h"
 #include "psvr2_protocol.h"
+#include "psvr2_trace.h"
 
 #define PSVR2_CAM_NUM_URBS	4
-#define PSVR2_CAM_FRAME_SIZE	(PSVR2_CAM_MODE1_WIDTH * PSVR2_CAM_MODE1_HEIGHT)
 
 struct psvr2_cam_buffer {
 	struct vb2_v4l2_buffer	vb;
@@ -53,6 +53,10 @@ struct psvr2_camera {
 
 	unsigned int		sequence;
 	bool			streaming;
+	bool			paused;		/* low power: sensor mode off */
+
+	/* records = frames delivered, fifo_overflows = no buffer queued. */
+	struct psvr2_stream_stats	stats;
 };
 
 static int psvr2_cam_set_mode(struct psvr2_camera *cam,
@@ -72,10 +76,15 @@ static void psvr2_cam_complete(struct urb *urb)
 {
 	struct psvr2_camera *cam = urb->context;
 	struct psvr2_cam_buffer *buf;
+	const void *frame;
 	unsigned long flags;
 	unsigned int seq;
 	int ret;
 
+	trace_psvr2_urb_complete(PSVR2_IF_CAMERA, urb->status,
+				 urb->actual_length);
+	psvr2_stats_urb(&cam->stats, urb->status, urb->actual_length);
+
 	switch (urb->status) {
 	case 0:
 		break;
@@ -88,8 +97,13 @@ static void psvr2_cam_complete(struct urb *urb)
 		goto resubmit;
 	}
 
-	if (urb->actual_length < PSVR2_CAM_MODE1_XFER_SIZE)
-		goto resubmit; /* not a mode-1 frame; ignore for now */
+	frame = psvr2_parse_cam_mode1(urb->transfer_buffer, urb->actual_length);
+	if (!frame) {
+		/* not a mode-1 frame; ignore for now */
+		trace_psvr2_cam_frame_drop(READ_ONCE(cam->sequence),
+					   urb->actual_length, false);
+		goto resubmit;
+	}
 
 	spin_lock_irqsave(&cam->buf_lock, flags);
 	buf = list_first_entry_or_null(&cam->buf_list, struct psvr2_cam_buffer,
@@ -103,22 +117,27 @@ static void psvr2_cam_complete(struct urb *urb)
 		void *vaddr = vb2_plane_vaddr(&buf->vb.vb2_buf, 0);
 
 		if (vaddr)
-			memcpy(vaddr, urb->transfer_buffer +
-				      PSVR2_CAMERA_HEADER_SIZE,
-			       PSVR2_CAM_FRAME_SIZE);
+			memcpy(vaddr, frame, PSVR2_CAM_FRAME_SIZE);
 
 		vb2_set_plane_payload(&buf->vb.vb2_buf, 0, PSVR2_CAM_FRAME_SIZE);
 		buf->vb.vb2_buf.timestamp = ktime_get_ns();
 		buf->vb.sequence = seq;
 		buf->vb.field = V4L2_FIELD_NONE;
 		vb2_buffer_done(&buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+		psvr2_stats_record(&cam->stats);
+		trace_psvr2_cam_frame_done(seq, urb->actual_length);
+	} else {
+		psvr2_stats_overflow(&cam->stats);
+		trace_psvr2_cam_frame_drop(seq, urb->actual_length, true);
 	}
 
 resubmit:
 	ret = usb_submit_urb(urb, GFP_ATOMIC);
-	if (ret && ret != -EPERM && ret != -ESHUTDOWN)
+	if (ret && ret != -EPERM && ret != -ESHUTDOWN) {
+		psvr2_stats_resubmit_failed(&cam->stats);
 		dev_err(&cam->udev->dev, "failed to resubmit camera URB: %d\n",
 			ret);
+	}
 }
 
 static void psvr2_cam_free_urbs(struct psvr2_camera *cam)
@@ -219,6 +238,15 @@ static void psvr2_cam_buf_queue(struct vb2_buffer *vb)
 	spin_unlock_irqrestore(&cam->buf_lock, flags);
 }
 
+/* Called at DQBUF: account completion-to-dequeue latency for good frames. */
+static void psvr2_cam_buf_finish(struct vb2_buffer *vb)
+{
+	struct psvr2_camera *cam = vb2_get_drv_priv(vb->vb2_queue);
+
+	if (vb2_is_streaming(vb->vb2_queue) && vb->state == VB2_BUF_STATE_DONE)
+		psvr2_stats_dequeue(&cam->stats, vb->timestamp);
+}
+
 static int psvr2_cam_start_streaming(struct vb2_queue *q, unsigned int count)
 {
 	struct psvr2_camera *cam = vb2_get_drv_priv(q);
@@ -230,7 +258,9 @@ static int psvr2_cam_start_streaming(struct vb2_queue *q, unsigned int count)
 	if (ret)
 		goto err_return;
 
-	ret = psvr2_cam_set_mode(cam, PSVR2_CAMERA_MODE_BOTTOM_SBS_CROPPED);
+	/* While paused the URBs idle until psvr2_camera_set_paused() resumes. */
+	ret = cam->paused ? 0 :
+	      psvr2_cam_set_mode(cam, PSVR2_CAMERA_MODE_BOTTOM_SBS_CROPPED);
 	if (ret) {
 		dev_err(&cam->udev->dev, "failed to set camera mode: %d\n", ret);
 		goto err_urbs;
@@ -278,10 +308,121 @@ static const struct vb2_ops psvr2_cam_qops = {
 	.queue_setup		= psvr2_cam_queue_setup,
 	.buf_prepare		= psvr2_cam_buf_prepare,
 	.buf_queue		= psvr2_cam_buf_queue,
+	.buf_finish		= psvr2_cam_buf_finish,
 	.start_streaming	= psvr2_cam_start_streaming,
 	.stop_streaming		= psvr2_cam_stop_streaming,
 };
 
+/*
+ * Low-power pause: switch the sensors off (or back to mode 1) underneath an
+ * active stream. The vb2 queue and URB pool stay as they are; frames simply
+ * stop arriving. cam->lock orders this against start/stop_streaming, and the
+ * device state_lock against psvr2_camera_stop().
+ */
+void psvr2_camera_set_paused(struct psvr2_device *psvr2, bool paused)
+{
+	struct psvr2_camera *cam;
+
+	mutex_lock(&psvr2->state_lock);
+	cam = psvr2->camera;
+	if (!cam)
+		goto out;
+
+	mutex_lock(&cam->lock);
+	if (cam->paused != paused) {
+		cam->paused = paused;
+		if (cam->streaming)
+			psvr2_cam_set_mode(cam, paused ?
+					   PSVR2_CAMERA_MODE_OFF :
+					   PSVR2_CAMERA_MODE_BOTTOM_SBS_CROPPED);
+	}
+	mutex_unlock(&cam->lock);
+out:
+	mutex_unlock(&psvr2->state_lock);
+}
+
+/*
+ * Watchdog stage 1: re-send the active sensor mode. Caller holds state_lock.
+ * The stream otherwise only sets the mode on STREAMON.
+ */
+void psvr2_camera_resend_mode(struct psvr2_device *psvr2)
+{
+	struct psvr2_camera *cam = psvr2->camera;
+
+	lockdep_assert_held(&psvr2->state_lock);
+
+	if (!cam)
+		return;
+
+	mutex_lock(&cam->lock);
+	if (cam->streaming && !cam->paused)
+		psvr2_cam_set_mode(cam, PSVR2_CAMERA_MODE_BOTTOM_SBS_CROPPED);
+	mutex_unlock(&cam->lock);
+}
+
+/*
+ * PM: kill the URB pool of an active stream but leave the vb2 queue streaming,
+ * so capture resumes into the same buffers. Queued buffers stay queued.
+ */
+void psvr2_camera_suspend(struct psvr2_device *psvr2)
+{
+	struct psvr2_camera *cam;
+	int i;
+
+	mutex_lock(&psvr2->state_lock);
+	cam = psvr2->camera;
+	if (!cam)
+		goto out;
+
+	mutex_lock(&cam->lock);
+	if (cam->streaming)
+		for (i = 0; i < PSVR2_CAM_NUM_URBS; i++)
+			usb_kill_urb(cam->urbs[i]);
+	mutex_unlock(&cam->lock);
+out:
+	mutex_unlock(&psvr2->state_lock);
+}
+
+int psvr2_camera_resume(struct psvr2_device *psvr2, bool reset)
+{
+	struct psvr2_camera *cam;
+	int i, ret = 0;
+
+	mutex_lock(&psvr2->state_lock);
+	cam = psvr2->camera;
+	if (!cam)
+		goto out;
+
+	mutex_lock(&cam->lock);
+	if (reset) {
+		ret = usb_set_interface(cam->udev, PSVR2_IF_CAMERA,
+					PSVR2_CAMERA_ALT);
+		if (ret)
+			dev_warn(&cam->udev->dev,
+				 "failed to select IF6 alt %d: %d\n",
+				 PSVR2_CAMERA_ALT, ret);
+	}
+	ret = 0;
+	if (cam->streaming) {
+		if (!cam->paused)
+			psvr2_cam_set_mode(cam,
+					   PSVR2_CAMERA_MODE_BOTTOM_SBS_CROPPED);
+		for (i = 0; i < PSVR2_CAM_NUM_URBS; i++) {
+			ret = usb_submit_urb(cam->urbs[i], GFP_NOIO);
+			if (ret) {
+				dev_err(&cam->udev->dev,
+					"failed to resubmit camera URB %d: %d\n",
+					i, ret);
+				break;
+			}
+		}
+	}
+	mutex_unlock(&cam->lock);
+out:
+	mutex_unlock(&psvr2->state_lock);
+	return ret;
+}
+
 /*
  * V4L2 ioctl operations. The format is fixed (mode 1: 1280x640 GREY).
  */
@@ -468,6 +609,7 @@ int psvr2_camera_start(struct psvr2_device *psvr2, struct usb_interface *intf)
 	}
 
 	psvr2->camera = cam;
+	psvr2_stats_add(psvr2, PSVR2_STREAM_CAMERA, &cam->stats);
 	dev_info(&intf->dev, "PSVR2 camera registered as /dev/video%d\n",
 		 cam->vdev.num);
 	return 0;
@@ -488,7 +630,10 @@ void psvr2_camera_stop(struct psvr2_device *psvr2)
 
 	if (!cam)
 		return;
+	psvr2_stats_remove(psvr2, PSVR2_STREAM_CAMERA);
+	mutex_lock(&psvr2->state_lock);
 	psvr2->camera = NULL;
+	mutex_unlock(&psvr2->state_lock);
 
 	/*
 	 * Detach from the (disappearing) USB parent, unregister the node, then
@@ -7,7 +7,7 @@
  * Unlike the other streams, the headset only keeps gaze tracking on while it
  * receives a periodic enable command, so a delayed work item re-sends it about
  * once a second. Curated samples are exposed on the character device
- * /dev/psvr2-gaze (whole-sample read() + poll()); the latest raw packet is also
+ * /dev/psvr2-gaze<N> (whole-sample read() + poll()); the latest raw packet is also
  * available via debugfs.
  *
  * Copyright (C) 2026 PSVR2 Linux project
@@ -27,6 +27,7 @@
 
 #include "psvr2.h"
 #include "psvr2_protocol.h"
+#include "psvr2_trace.h"
 #include "psvr2_uapi.h"
 
 #define PSVR2_GAZE_FIFO_DEPTH	64
@@ -42,6 +43,8 @@ struct psvr2_gaze {
 
 	struct delayed_work	keepalive;
 	bool			stopping;	/* tells keepalive not to re-arm */
+	bool			paused;		/* low power: stream disabled */
+	bool			suspended;	/* USB suspend / reset: no ep0 */
 
 	struct miscdevice	miscdev;
 	char			devname[16];
@@ -50,6 +53,8 @@ struct psvr2_gaze {
 	wait_queue_head_t	readq;
 	bool			dead;
 
+	struct psvr2_stream_stats	stats;		/* debugfs stats/ */
+
 	struct dentry		*raw_dentry;
 	struct mutex		raw_lock;
 	u8			*raw_copy;
@@ -70,7 +75,8 @@ static void psvr2_gaze_keepalive(struct work_struct *work)
 	struct psvr2_gaze *gz =
 		container_of(to_delayed_work(work), struct psvr2_gaze, keepalive);
 
-	if (READ_ONCE(gz->stopping))
+	if (READ_ONCE(gz->stopping) || READ_ONCE(gz->paused) ||
+	    READ_ONCE(gz->suspended))
 		return;
 
 	psvr2_control_set(gz->psvr2, PSVR2_REPORT_SET_GAZE_STREAM,
@@ -80,6 +86,103 @@ static void psvr2_gaze_keepalive(struct work_struct *work)
 			      msecs_to_jiffies(PSVR2_GAZE_KEEPALIVE_MS));
 }
 
+/*
+ * Low-power pause: disable the stream and let the keepalive lapse, without
+ * touching the URB or the char device so open readers simply see no data.
+ * Serialised against psvr2_gaze_stop() by the device state_lock.
+ */
+void psvr2_gaze_set_paused(struct psvr2_device *psvr2, bool paused)
+{
+	struct psvr2_gaze *gz;
+
+	mutex_lock(&psvr2->state_lock);
+	gz = psvr2->gaze;
+	if (!gz || gz->paused == paused)
+		goto out;
+
+	WRITE_ONCE(gz->paused, paused);
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_GAZE, !paused);
+	if (paused) {
+		cancel_delayed_work_sync(&gz->keepalive);
+		psvr2_control_set(psvr2, PSVR2_REPORT_SET_GAZE_STREAM,
+				  PSVR2_GAZE_STREAM_DISABLE, NULL, 0);
+	} else {
+		psvr2_control_set(psvr2, PSVR2_REPORT_SET_GAZE_STREAM,
+				  PSVR2_GAZE_STREAM_ENABLE, NULL, 0);
+		schedule_delayed_work(&gz->keepalive,
+				      msecs_to_jiffies(PSVR2_GAZE_KEEPALIVE_MS));
+	}
+out:
+	mutex_unlock(&psvr2->state_lock);
+}
+
+/* Watchdog stage 1: re-send the enable report now. Caller holds state_lock. */
+void psvr2_gaze_resend(struct psvr2_device *psvr2)
+{
+	struct psvr2_gaze *gz = psvr2->gaze;
+
+	if (gz && !READ_ONCE(gz->paused))
+		psvr2_control_set(psvr2, PSVR2_REPORT_SET_GAZE_STREAM,
+				  PSVR2_GAZE_STREAM_ENABLE, NULL, 0);
+}
+
+/* Watchdog stage 2 for IF5. Caller holds state_lock. */
+void psvr2_gaze_reset(struct psvr2_device *psvr2)
+{
+	struct psvr2_gaze *gz = psvr2->gaze;
+
+	if (gz)
+		psvr2_reset_interface(psvr2, gz->urb, PSVR2_IF_GAZE,
+				      PSVR2_GAZE_ALT);
+}
+
+/*
+ * PM: park the URB and the keepalive. On resume the stream is re-enabled
+ * straight away (unless low power has it paused) rather than waiting for the
+ * next keepalive tick.
+ */
+void psvr2_gaze_suspend(struct psvr2_device *psvr2)
+{
+	struct psvr2_gaze *gz;
+
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_GAZE, false);
+	mutex_lock(&psvr2->state_lock);
+	gz = psvr2->gaze;
+	if (gz) {
+		WRITE_ONCE(gz->suspended, true);
+		cancel_delayed_work_sync(&gz->keepalive);
+		usb_kill_urb(gz->urb);
+	}
+	mutex_unlock(&psvr2->state_lock);
+}
+
+int psvr2_gaze_resume(struct psvr2_device *psvr2, bool reset)
+{
+	struct psvr2_gaze *gz;
+	int ret = 0;
+
+	mutex_lock(&psvr2->state_lock);
+	gz = psvr2->gaze;
+	if (!gz)
+		goto out;
+
+	ret = psvr2_resume_urb(psvr2, gz->urb, PSVR2_IF_GAZE, PSVR2_GAZE_ALT,
+			       reset);
+	WRITE_ONCE(gz->suspended, false);
+	if (gz->paused)
+		goto out;
+
+	/* Re-arm even if the URB didn't go back: the watchdog resets it. */
+	psvr2_control_set(psvr2, PSVR2_REPORT_SET_GAZE_STREAM,
+			  PSVR2_GAZE_STREAM_ENABLE, NULL, 0);
+	schedule_delayed_work(&gz->keepalive,
+			      msecs_to_jiffies(PSVR2_GAZE_KEEPALIVE_MS));
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_GAZE, true);
+out:
+	mutex_unlock(&psvr2->state_lock);
+	return ret;
+}
+
 /*
  * Character device.
  */
@@ -129,9 +232,12 @@ static ssize_t psvr2_gaze_read(struct file *file, char __user *ubuf,
 			break;
 		if (copy_to_user(ubuf + total, &sample, sizeof(sample)))
 			return total ? total : -EFAULT;
+		psvr2_stats_dequeue(&gz->stats, sample.timestamp_ns);
 		total += sizeof(sample);
 	}
 
+	trace_psvr2_sample_dequeue(PSVR2_STREAM_GAZE, total / sizeof(sample),
+				   kfifo_len(&gz->fifo));
 	return total;
 }
 
@@ -186,65 +292,40 @@ static const struct file_operations psvr2_raw_gaze_fops = {
 	.llseek		= default_llseek,
 };
 
-/* Copy the float bit patterns through untouched (no FPU in kernel). */
-static void psvr2_gaze_fill_eye(struct psvr2_gaze_eye *out,
-				const struct psvr2_pkt_eye_gaze *in)
-{
-	out->gaze_point_valid = le32_to_cpu(in->gaze_point_mm_valid);
-	out->gaze_point_mm[0] = in->gaze_point_mm.x;
-	out->gaze_point_mm[1] = in->gaze_point_mm.y;
-	out->gaze_point_mm[2] = in->gaze_point_mm.z;
-	out->gaze_direction_valid = le32_to_cpu(in->gaze_direction_valid);
-	out->gaze_direction[0] = in->gaze_direction.x;
-	out->gaze_direction[1] = in->gaze_direction.y;
-	out->gaze_direction[2] = in->gaze_direction.z;
-	out->pupil_diameter_valid = le32_to_cpu(in->pupil_diameter_valid);
-	out->pupil_diameter_mm = in->pupil_diameter_mm;
-	out->blink_valid = le32_to_cpu(in->blink_valid);
-	out->blink = le32_to_cpu(in->blink);
-}
-
 static void psvr2_gaze_process(struct psvr2_gaze *gz, int len)
 {
-	struct psvr2_pkt_gaze_state *st = (void *)gz->buf;
-	struct psvr2_pkt_gaze_combined *cmb = &st->packet_data.combined;
 	struct psvr2_gaze_sample sample;
 	unsigned long flags;
+	unsigned int fill;
 
-	if (len < (int)sizeof(*st) ||
-	    memcmp(st->header, PSVR2_GAZE_HDR_MAGIC, 2) != 0)
+	if (psvr2_parse_gaze(gz->buf, len, &sample))
 		return;
 
 	mutex_lock(&gz->raw_lock);
-	memcpy(gz->raw_copy, gz->buf, sizeof(*st));
-	gz->raw_len = sizeof(*st);
+	memcpy(gz->raw_copy, gz->buf, sizeof(struct psvr2_pkt_gaze_state));
+	gz->raw_len = sizeof(struct psvr2_pkt_gaze_state);
 	mutex_unlock(&gz->raw_lock);
 
-	memset(&sample, 0, sizeof(sample));
 	sample.timestamp_ns = ktime_get_ns();
-	sample.device_timestamp_us = le32_to_cpu(cmb->timestamp);
-	sample.flags = PSVR2_GAZE_FLAG_VALID;
-
-	psvr2_gaze_fill_eye(&sample.left, &st->packet_data.left);
-	psvr2_gaze_fill_eye(&sample.right, &st->packet_data.right);
-
-	sample.combined.gaze_point_valid = le32_to_cpu(cmb->gaze_point_valid);
-	sample.combined.gaze_point_mm[0] = cmb->gaze_point_3d.x;
-	sample.combined.gaze_point_mm[1] = cmb->gaze_point_3d.y;
-	sample.combined.gaze_point_mm[2] = cmb->gaze_point_3d.z;
-	sample.combined.gaze_direction_valid =
-		le32_to_cpu(cmb->normalized_gaze_valid);
-	sample.combined.gaze_direction[0] = cmb->normalized_gaze.x;
-	sample.combined.gaze_direction[1] = cmb->normalized_gaze.y;
-	sample.combined.gaze_direction[2] = cmb->normalized_gaze.z;
 
 	spin_lock_irqsave(&gz->fifo_lock, flags);
-	if (kfifo_is_full(&gz->fifo))
+	if (kfifo_is_full(&gz->fifo)) {
 		kfifo_skip(&gz->fifo);
+		psvr2_stats_overflow(&gz->stats);
+		trace_psvr2_fifo_overflow(PSVR2_STREAM_GAZE,
+					  kfifo_size(&gz->fifo));
+	}
 	kfifo_in(&gz->fifo, &sample, 1);
+	fill = kfifo_len(&gz->fifo);
 	spin_unlock_irqrestore(&gz->fifo_lock, flags);
 
+	psvr2_stats_record(&gz->stats);
+	psvr2_stats_device_ts(&gz->stats, sample.device_timestamp_us);
+	trace_psvr2_sample_enqueue(PSVR2_STREAM_GAZE,
+				   sample.device_timestamp_us, fill);
+
 	wake_up_interruptible(&gz->readq);
+	psvr2_watchdog_feed(gz->psvr2, PSVR2_STREAM_GAZE);
 }
 
 static void psvr2_gaze_complete(struct urb *urb)
@@ -252,6 +333,9 @@ static void psvr2_gaze_complete(struct urb *urb)
 	struct psvr2_gaze *gz = urb->context;
 	int ret;
 
+	trace_psvr2_urb_complete(PSVR2_IF_GAZE, urb->status, urb->actual_length);
+	psvr2_stats_urb(&gz->stats, urb->status, urb->actual_length);
+
 	switch (urb->status) {
 	case 0:
 		break;
@@ -269,9 +353,11 @@ static void psvr2_gaze_complete(struct urb *urb)
 
 resubmit:
 	ret = usb_submit_urb(urb, GFP_ATOMIC);
-	if (ret && ret != -EPERM)
+	if (ret && ret != -EPERM) {
+		psvr2_stats_resubmit_failed(&gz->stats);
 		dev_err(&gz->udev->dev, "failed to resubmit gaze URB: %d\n",
 			ret);
+	}
 }
 
 int psvr2_gaze_start(struct psvr2_device *psvr2, struct usb_interface *intf)
@@ -330,10 +416,12 @@ int psvr2_gaze_start(struct psvr2_device *psvr2, struct usb_interface *intf)
 			  gz->buf, gz->buf_size, psvr2_gaze_complete, gz);
 	gz->urb->transfer_flags |= URB_NO_TRANSFER_DMA_MAP;
 
-	scnprintf(gz->devname, sizeof(gz->devname), "psvr2-gaze");
+	scnprintf(gz->devname, sizeof(gz->devname), "psvr2-gaze%d",
+		  psvr2->index);
 	gz->miscdev.minor = MISC_DYNAMIC_MINOR;
 	gz->miscdev.name = gz->devname;
 	gz->miscdev.fops = &psvr2_gaze_fops;
+	gz->miscdev.parent = &intf->dev;	/* USB ancestry for udev */
 	ret = misc_register(&gz->miscdev);
 	if (ret) {
 		dev_err(&intf->dev, "failed to register /dev/%s: %d\n",
@@ -359,6 +447,8 @@ int psvr2_gaze_start(struct psvr2_device *psvr2, struct usb_interface *intf)
 					     &psvr2_raw_gaze_fops);
 
 	psvr2->gaze = gz;
+	psvr2_stats_add(psvr2, PSVR2_STREAM_GAZE, &gz->stats);
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_GAZE, true);
 	return 0;
 
 err_misc:
@@ -384,7 +474,11 @@ void psvr2_gaze_stop(struct psvr2_device *psvr2)
 
 	if (!gz)
 		return;
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_GAZE, false);
+	psvr2_stats_remove(psvr2, PSVR2_STREAM_GAZE);
+	mutex_lock(&psvr2->state_lock);
 	psvr2->gaze = NULL;
+	mutex_unlock(&psvr2->state_lock);
 
 	/* Stop the keepalive (and prevent it re-arming) before anything else. */
 	WRITE_ONCE(gz->stopping, true);
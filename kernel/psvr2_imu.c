@@ -6,6 +6,9 @@
  * __s16 register values are exposed as IIO channels with an IIO_CHAN_INFO_SCALE
  * so the physical conversion stays in userspace. Axes are presented in the
  * sensor's native order; coordinate-frame remapping is left to the consumer.
+ * Each buffered sample also carries the headset's own microsecond clock, as a
+ * u32 count channel, so userspace can take the USB jitter out of the host
+ * timestamps.
  *
  * Copyright (C) 2026 PSVR2 Linux project
  */
@@ -23,11 +26,20 @@ struct psvr2_imu {
 	spinlock_t		lock;		/* protects last_* caches */
 	s16			last_accel[3];
 	s16			last_gyro[3];
+
+	/* Buffer every div-th sample (low-power throttle); 1 = all of them. */
+	unsigned int		div;
+	unsigned int		skip;
 };
 
-/* Buffer pushed per sample; timestamp must be 8-byte aligned at the end. */
+/*
+ * Buffer pushed per sample; timestamp must be 8-byte aligned at the end. The
+ * vts word sits in what would otherwise be padding, so the layout userspace
+ * sees is the same whether it enables that channel or not.
+ */
 struct psvr2_imu_scan {
 	s16	channels[6];	/* accel xyz, gyro xyz */
+	u32	vts_us;		/* device clock */
 	aligned_s64 timestamp;
 };
 
@@ -38,6 +50,7 @@ enum psvr2_imu_scan_index {
 	PSVR2_SCAN_GYRO_X,
 	PSVR2_SCAN_GYRO_Y,
 	PSVR2_SCAN_GYRO_Z,
+	PSVR2_SCAN_VTS,
 	PSVR2_SCAN_TIMESTAMP,
 };
 
@@ -76,6 +89,17 @@ static const struct iio_chan_spec psvr2_imu_channels[] = {
 	PSVR2_GYRO_CHAN(X, PSVR2_SCAN_GYRO_X),
 	PSVR2_GYRO_CHAN(Y, PSVR2_SCAN_GYRO_Y),
 	PSVR2_GYRO_CHAN(Z, PSVR2_SCAN_GYRO_Z),
+	{
+		/* Buffer only: in_count0, the record's vts_us. */
+		.type = IIO_COUNT,
+		.indexed = 1,
+		.channel = 0,
+		.scan_index = PSVR2_SCAN_VTS,
+		.scan_type = {
+			.sign = 'u', .realbits = 32, .storagebits = 32,
+			.endianness = IIO_CPU,
+		},
+	},
 	IIO_CHAN_SOFT_TIMESTAMP(PSVR2_SCAN_TIMESTAMP),
 };
 
@@ -126,7 +150,7 @@ static const struct iio_info psvr2_imu_info = {
 };
 
 void psvr2_imu_push(struct psvr2_device *psvr2, const s16 accel[3],
-		    const s16 gyro[3], s64 timestamp_ns)
+		    const s16 gyro[3], u32 vts_us, s64 timestamp_ns)
 {
 	struct psvr2_imu *imu = psvr2->imu;
 	struct iio_dev *indio_dev;
@@ -145,16 +169,30 @@ void psvr2_imu_push(struct psvr2_device *psvr2, const s16 accel[3],
 	if (!iio_buffer_enabled(indio_dev))
 		return;
 
+	/* Only the status completion pushes, so skip needs no locking. */
+	if (++imu->skip < READ_ONCE(imu->div))
+		return;
+	imu->skip = 0;
+
 	scan.channels[PSVR2_SCAN_ACCEL_X] = accel[0];
 	scan.channels[PSVR2_SCAN_ACCEL_Y] = accel[1];
 	scan.channels[PSVR2_SCAN_ACCEL_Z] = accel[2];
 	scan.channels[PSVR2_SCAN_GYRO_X] = gyro[0];
 	scan.channels[PSVR2_SCAN_GYRO_Y] = gyro[1];
 	scan.channels[PSVR2_SCAN_GYRO_Z] = gyro[2];
+	scan.vts_us = vts_us;
 
 	iio_push_to_buffers_with_timestamp(indio_dev, &scan, timestamp_ns);
 }
 
+void psvr2_imu_set_decimation(struct psvr2_device *psvr2, unsigned int div)
+{
+	struct psvr2_imu *imu = psvr2->imu;
+
+	if (imu)
+		WRITE_ONCE(imu->div, max(div, 1U));
+}
+
 int psvr2_imu_register(struct psvr2_device *psvr2, struct device *parent)
 {
 	struct iio_dev *indio_dev;
@@ -167,6 +205,7 @@ int psvr2_imu_register(struct psvr2_device *psvr2, struct device *parent)
 
 	imu = iio_priv(indio_dev);
 	imu->indio_dev = indio_dev;
+	imu->div = 1;
 	spin_lock_init(&imu->lock);
 
 	indio_dev->name = "psvr2_imu";
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PSVR2 Linux driver — wire-format parsers.
+ *
+ * Pure functions from transfer bytes to the records the streams deliver: no
+ * URBs, locks, clocks or allocation, so the same code runs in the URB
+ * completions and under KUnit (psvr2_parse_test.c, which builds this file into
+ * its own module and so needs neither USB nor a headset). Host receive times
+ * are the caller's business; floats are carried as raw bit patterns.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <linux/errno.h>
+#include <linux/string.h>
+#include <asm/byteorder.h>
+
+#include "psvr2.h"
+#include "psvr2_protocol.h"
+#include "psvr2_uapi.h"
+
+/*
+ * Fill an ep0 vendor packet header (+ payload for a SET; @data may be NULL for
+ * a GET). Returns the number of bytes to put on the wire.
+ */
+int psvr2_parse_build_ctrl(struct sie_ctrl_pkt *pkt, u16 report_id, u16 subcmd,
+			   const void *data, u32 len)
+{
+	if (len > PSVR2_CTRL_DATA_MAX)
+		return -EINVAL;
+
+	pkt->report_id = cpu_to_le16(report_id);
+	pkt->subcmd = cpu_to_le16(subcmd);
+	pkt->len = cpu_to_le32(len);
+	if (data && len)
+		memcpy(pkt->data, data, len);
+	return len + offsetof(struct sie_ctrl_pkt, data);
+}
+
+/* IF7: the status header, and where the IMU records after it start. */
+int psvr2_parse_status(const void *buf, size_t len,
+		       struct psvr2_status_info *info)
+{
+	const struct psvr2_status_record_hdr *hdr = buf;
+
+	if (len < sizeof(*hdr))
+		return -EINVAL;
+
+	info->dp_link = hdr->dprx_status != 0;
+	info->worn = hdr->prox_sensor_flag;
+	info->function_button = hdr->function_button;
+	info->ipd_mm = hdr->ipd_dial_mm;
+	info->imu = buf + sizeof(*hdr);
+	info->num_imu = (len - sizeof(*hdr)) / sizeof(struct psvr2_imu_record);
+	return 0;
+}
+
+/* One IMU record; false if the device flagged it or left the FIFO sentinel. */
+bool psvr2_parse_imu(const struct psvr2_imu_record *rec,
+		     struct psvr2_imu_sample *out)
+{
+	int a;
+
+	if (le16_to_cpu(rec->status) & PSVR2_IMU_STATUS_INVALID)
+		return false;
+
+	for (a = 0; a < 3; a++) {
+		out->accel[a] = (s16)le16_to_cpu(rec->accel[a]);
+		out->gyro[a] = (s16)le16_to_cpu(rec->gyro[a]);
+	}
+	if (out->accel[0] == PSVR2_IMU_INVALID ||
+	    out->gyro[0] == PSVR2_IMU_INVALID)
+		return false;
+
+	out->vts_us = le32_to_cpu(rec->vts_us);
+	return true;
+}
+
+/* Record @i of @num in one transfer, back-dated from the transfer's rx time. */
+s64 psvr2_parse_imu_timestamp(s64 rx_ns, unsigned int num, unsigned int i)
+{
+	return rx_ns - (s64)(num - 1 - i) * PSVR2_IMU_PERIOD_NS;
+}
+
+/*
+ * IF3: one pose record. Parsed by offset without gating on the leading magic
+ * (see psvr2_slam.c for why). timestamp_ns is left for the caller.
+ */
+int psvr2_parse_slam(const void *buf, size_t len,
+		     struct psvr2_pose_sample *out)
+{
+	const struct psvr2_slam_record *rec = buf;
+
+	if (len < PSVR2_SLAM_RECORD_SIZE)
+		return -EINVAL;
+
+	memset(out, 0, sizeof(*out));
+	out->device_vts_us = le32_to_cpu(rec->vts_ts_us);
+	out->flags = PSVR2_POSE_FLAG_VALID;
+	memcpy(out->position, rec->pos, sizeof(out->position));
+	memcpy(out->orientation, rec->orient, sizeof(out->orientation));
+	return 0;
+}
+
+/* Copy the float bit patterns through untouched (no FPU in kernel). */
+void psvr2_parse_gaze_eye(struct psvr2_gaze_eye *out,
+			  const struct psvr2_pkt_eye_gaze *in)
+{
+	out->gaze_point_valid = le32_to_cpu(in->gaze_point_mm_valid);
+	out->gaze_point_mm[0] = in->gaze_point_mm.x;
+	out->gaze_point_mm[1] = in->gaze_point_mm.y;
+	out->gaze_point_mm[2] = in->gaze_point_mm.z;
+	out->gaze_direction_valid = le32_to_cpu(in->gaze_direction_valid);
+	out->gaze_direction[0] = in->gaze_direction.x;
+	out->gaze_direction[1] = in->gaze_direction.y;
+	out->gaze_direction[2] = in->gaze_direction.z;
+	out->pupil_diameter_valid = le32_to_cpu(in->pupil_diameter_valid);
+	out->pupil_diameter_mm = in->pupil_diameter_mm;
+	out->blink_valid = le32_to_cpu(in->blink_valid);
+	out->blink = le32_to_cpu(in->blink);
+}
+
+/* IF5: one "GS" packet. timestamp_ns is left for the caller. */
+int psvr2_parse_gaze(const void *buf, size_t len,
+		     struct psvr2_gaze_sample *out)
+{
+	const struct psvr2_pkt_gaze_state *st = buf;
+	const struct psvr2_pkt_gaze_combined *cmb = &st->packet_data.combined;
+
+	if (len < sizeof(*st))
+		return -EINVAL;
+	if (memcmp(st->header, PSVR2_GAZE_HDR_MAGIC, 2) != 0)
+		return -EBADMSG;
+
+	memset(out, 0, sizeof(*out));
+	out->device_timestamp_us = le32_to_cpu(cmb->timestamp);
+	out->flags = PSVR2_GAZE_FLAG_VALID;
+
+	psvr2_parse_gaze_eye(&out->left, &st->packet_data.left);
+	psvr2_parse_gaze_eye(&out->right, &st->packet_data.right);
+
+	out->combined.gaze_point_valid = le32_to_cpu(cmb->gaze_point_valid);
+	out->combined.gaze_point_mm[0] = cmb->gaze_point_3d.x;
+	out->combined.gaze_point_mm[1] = cmb->gaze_point_3d.y;
+	out->combined.gaze_point_mm[2] = cmb->gaze_point_3d.z;
+	out->combined.gaze_direction_valid =
+		le32_to_cpu(cmb->normalized_gaze_valid);
+	out->combined.gaze_direction[0] = cmb->normalized_gaze.x;
+	out->combined.gaze_direction[1] = cmb->normalized_gaze.y;
+	out->combined.gaze_direction[2] = cmb->normalized_gaze.z;
+	return 0;
+}
+
+/*
+ * IF6: one transfer is one frame and its length identifies the mode. Returns
+ * PSVR2_CAMERA_MODE_OFF for lengths we don't recognise.
+ */
+enum psvr2_camera_mode psvr2_parse_cam_mode(size_t len)
+{
+	if (len == PSVR2_CAMERA_MAX_XFER_SIZE)
+		return PSVR2_CAMERA_MODE_TRACKING;
+	if (len == PSVR2_CAM_MODE1_XFER_SIZE)
+		return PSVR2_CAMERA_MODE_BOTTOM_SBS_CROPPED;
+	return PSVR2_CAMERA_MODE_OFF;
+}
+
+/* The PSVR2_CAM_FRAME_SIZE greyscale image of a mode-1 transfer, or NULL. */
+const void *psvr2_parse_cam_mode1(const void *buf, size_t len)
+{
+	if (psvr2_parse_cam_mode(len) != PSVR2_CAMERA_MODE_BOTTOM_SBS_CROPPED)
+		return NULL;
+	return buf + PSVR2_CAMERA_HEADER_SIZE;
+}
@@ -0,0 +1,544 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PSVR2 Linux driver — KUnit tests and microbenchmarks for the wire parsers.
+ *
+ * Golden packets are laid out by hand at the byte offsets documented in
+ * docs/protocol.md rather than through the structs, so a layout change in
+ * psvr2_protocol.h shows up here instead of as garbage poses on a headset.
+ * The *_bench cases log ns/record for each parser; compare them before and
+ * after touching a parser.
+ *
+ * The parsers are built into this module directly, so it needs neither USB nor
+ * psvr2.ko and runs on UML:
+ *   scripts/kunit.sh /path/to/linux
+ * or on a kernel with CONFIG_KUNIT:
+ *   make -C kernel tests && sudo insmod kernel/psvr2_parse_test.ko
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/vmalloc.h>
+
+#include "psvr2_parse.c"
+
+#define PSVR2_BENCH_ITERS	100000
+#define PSVR2_BENCH_CAM_ITERS	200
+
+/* IEEE-754 bit patterns used as golden float values. */
+#define F_ONE		0x3f800000U	/*  1.0   */
+#define F_HALF_NEG	0xbf000000U	/* -0.5   */
+#define F_QUARTER	0x3e800000U	/*  0.25  */
+#define F_TWO		0x40000000U	/*  2.0   */
+#define F_SQRT1_2	0x3f3504f3U	/*  0.7071 */
+
+#define EXPECT_SIZE(t, type, n)	KUNIT_EXPECT_EQ(t, sizeof(type), (size_t)(n))
+#define EXPECT_OFF(t, type, f, n) \
+	KUNIT_EXPECT_EQ(t, offsetof(type, f), (size_t)(n))
+
+static void put_le16(u8 *p, u16 v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put_le32(u8 *p, u32 v)
+{
+	put_le16(p, v);
+	put_le16(p + 2, v >> 16);
+}
+
+/* Every wire struct, at the sizes and offsets seen on hardware. */
+static void psvr2_parse_test_layout(struct kunit *test)
+{
+	EXPECT_SIZE(test, struct sie_ctrl_pkt, 512);
+	EXPECT_OFF(test, struct sie_ctrl_pkt, data, 8);
+
+	EXPECT_SIZE(test, struct psvr2_status_record_hdr, 32);
+	EXPECT_OFF(test, struct psvr2_status_record_hdr, ipd_dial_mm, 5);
+
+	EXPECT_SIZE(test, struct psvr2_imu_record, 24);
+	EXPECT_OFF(test, struct psvr2_imu_record, accel, 4);
+	EXPECT_OFF(test, struct psvr2_imu_record, gyro, 10);
+	EXPECT_OFF(test, struct psvr2_imu_record, imu_ts_us, 20);
+	EXPECT_OFF(test, struct psvr2_imu_record, status, 22);
+
+	EXPECT_SIZE(test, struct psvr2_slam_record, PSVR2_SLAM_RECORD_SIZE);
+	EXPECT_OFF(test, struct psvr2_slam_record, vts_ts_us, 8);
+	EXPECT_OFF(test, struct psvr2_slam_record, pos, 16);
+	EXPECT_OFF(test, struct psvr2_slam_record, orient, 28);
+
+	EXPECT_SIZE(test, struct psvr2_levec2, 8);
+	EXPECT_SIZE(test, struct psvr2_levec3, 12);
+	EXPECT_SIZE(test, struct psvr2_pkt_eye_gaze, 72);
+	EXPECT_OFF(test, struct psvr2_pkt_eye_gaze, pupil_diameter_mm, 36);
+	EXPECT_OFF(test, struct psvr2_pkt_eye_gaze, blink, 68);
+	EXPECT_SIZE(test, struct psvr2_pkt_gaze_combined, 88);
+	EXPECT_OFF(test, struct psvr2_pkt_gaze_combined, timestamp, 36);
+	EXPECT_SIZE(test, struct psvr2_pkt_gaze_packet_data, 320);
+	EXPECT_OFF(test, struct psvr2_pkt_gaze_packet_data, left, 88);
+	EXPECT_OFF(test, struct psvr2_pkt_gaze_packet_data, right, 160);
+	EXPECT_OFF(test, struct psvr2_pkt_gaze_packet_data, combined, 232);
+	EXPECT_SIZE(test, struct psvr2_pkt_gaze_state, 324);
+}
+
+/* Camera mode 1, as psvr2_cam_set_mode() sends it. */
+static void psvr2_parse_test_ctrl(struct kunit *test)
+{
+	static const u8 golden[] = {
+		0x0b, 0x00, 0x01, 0x00, 0x08, 0x00, 0x00, 0x00,
+		0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+	};
+	__le32 cmd[2] = { cpu_to_le32(0x1), cpu_to_le32(0x1) };
+	struct sie_ctrl_pkt *pkt;
+
+	pkt = kunit_kzalloc(test, sizeof(*pkt), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, pkt);
+
+	KUNIT_EXPECT_EQ(test, psvr2_parse_build_ctrl(pkt,
+			PSVR2_REPORT_SET_CAMERA_MODE, 0x1, cmd, sizeof(cmd)),
+			(int)sizeof(golden));
+	KUNIT_EXPECT_MEMEQ(test, pkt, golden, sizeof(golden));
+
+	/* A GET only carries the header; the length is still the reply's. */
+	memset(pkt, 0, sizeof(*pkt));
+	KUNIT_EXPECT_EQ(test, psvr2_parse_build_ctrl(pkt, 0x0c, 0x2, NULL, 4),
+			12);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(pkt->len), 4U);
+	KUNIT_EXPECT_EQ(test, pkt->data[0], 0);
+
+	KUNIT_EXPECT_EQ(test, psvr2_parse_build_ctrl(pkt, 0x0c, 0x1, NULL,
+						     PSVR2_CTRL_DATA_MAX + 1),
+			-EINVAL);
+}
+
+/*
+ * Header (link up, worn, button, IPD 64) and three IMU records: a good one,
+ * one flagged invalid and one holding the FIFO sentinel. Plus half a record.
+ */
+static const u8 psvr2_golden_status[32 + 3 * 24 + 12] = {
+	/* header */
+	0x01, 0x01, 0x01, 0x00, 0x00, 0x40, [6 ... 31] = 0x00,
+	/* IMU 0: vts 0x01020304, accel (100, -200, 300), gyro (-1, 2, -32767) */
+	0x04, 0x03, 0x02, 0x01,
+	0x64, 0x00, 0x38, 0xff, 0x2c, 0x01,
+	0xff, 0xff, 0x02, 0x00, 0x01, 0x80,
+	0x10, 0x00, 0x20, 0x00, 0x30, 0x00, 0x00, 0x00,
+	/* IMU 1: status bit0 set */
+	0x05, 0x03, 0x02, 0x01,
+	0x01, 0x00, 0x01, 0x00, 0x01, 0x00,
+	0x01, 0x00, 0x01, 0x00, 0x01, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+	/* IMU 2: accel x = 0x8000 sentinel */
+	0x06, 0x03, 0x02, 0x01,
+	0x00, 0x80, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	/* trailing partial record */
+	[104 ... 115] = 0xee,
+};
+
+static void psvr2_parse_test_status(struct kunit *test)
+{
+	struct psvr2_status_info info;
+	struct psvr2_imu_sample imu;
+
+	KUNIT_ASSERT_EQ(test, psvr2_parse_status(psvr2_golden_status,
+						 sizeof(psvr2_golden_status),
+						 &info), 0);
+	KUNIT_EXPECT_TRUE(test, info.dp_link);
+	KUNIT_EXPECT_TRUE(test, info.worn);
+	KUNIT_EXPECT_TRUE(test, info.function_button);
+	KUNIT_EXPECT_EQ(test, info.ipd_mm, 64);
+	KUNIT_EXPECT_EQ(test, info.num_imu, 3U);
+	KUNIT_EXPECT_PTR_EQ(test, (const void *)info.imu,
+			    (const void *)(psvr2_golden_status + 32));
+
+	KUNIT_ASSERT_TRUE(test, psvr2_parse_imu(&info.imu[0], &imu));
+	KUNIT_EXPECT_EQ(test, imu.vts_us, 0x01020304U);
+	KUNIT_EXPECT_EQ(test, imu.accel[0], 100);
+	KUNIT_EXPECT_EQ(test, imu.accel[1], -200);
+	KUNIT_EXPECT_EQ(test, imu.accel[2], 300);
+	KUNIT_EXPECT_EQ(test, imu.gyro[0], -1);
+	KUNIT_EXPECT_EQ(test, imu.gyro[1], 2);
+	KUNIT_EXPECT_EQ(test, imu.gyro[2], -32767);
+
+	KUNIT_EXPECT_FALSE(test, psvr2_parse_imu(&info.imu[1], &imu));
+	KUNIT_EXPECT_FALSE(test, psvr2_parse_imu(&info.imu[2], &imu));
+
+	/* Header only: no records. One byte short: nothing at all. */
+	KUNIT_ASSERT_EQ(test, psvr2_parse_status(psvr2_golden_status, 32,
+						 &info), 0);
+	KUNIT_EXPECT_EQ(test, info.num_imu, 0U);
+	KUNIT_EXPECT_FALSE(test, info.imu == NULL);
+	KUNIT_EXPECT_EQ(test, psvr2_parse_status(psvr2_golden_status, 31,
+						 &info), -EINVAL);
+
+	/* Link down, not worn. */
+	KUNIT_ASSERT_EQ(test, psvr2_parse_status((u8[32]){ 0 }, 32, &info), 0);
+	KUNIT_EXPECT_FALSE(test, info.dp_link);
+	KUNIT_EXPECT_FALSE(test, info.worn);
+}
+
+static void psvr2_parse_test_imu_timestamp(struct kunit *test)
+{
+	s64 rx = 10LL * NSEC_PER_SEC;
+
+	/* The last record of the batch is stamped with the rx time. */
+	KUNIT_EXPECT_EQ(test, psvr2_parse_imu_timestamp(rx, 41, 40), rx);
+	KUNIT_EXPECT_EQ(test, psvr2_parse_imu_timestamp(rx, 41, 39),
+			rx - (s64)PSVR2_IMU_PERIOD_NS);
+	KUNIT_EXPECT_EQ(test, psvr2_parse_imu_timestamp(rx, 41, 0),
+			rx - 40 * (s64)PSVR2_IMU_PERIOD_NS);
+}
+
+static void psvr2_golden_slam(u8 *buf, const char *magic)
+{
+	memset(buf, 0, PSVR2_SLAM_RECORD_SIZE);
+	memcpy(buf, magic, 3);
+	buf[3] = 0x01;
+	put_le32(buf + 4, PSVR2_SLAM_RECORD_SIZE);
+	put_le32(buf + 8, 0xdeadbeef);
+	put_le32(buf + 12, 3);
+	put_le32(buf + 16, F_ONE);
+	put_le32(buf + 20, F_HALF_NEG);
+	put_le32(buf + 24, F_QUARTER);
+	put_le32(buf + 28, F_SQRT1_2);
+	put_le32(buf + 32, 0);
+	put_le32(buf + 36, F_SQRT1_2);
+	put_le32(buf + 40, 0);
+}
+
+static void psvr2_parse_test_slam(struct kunit *test)
+{
+	struct psvr2_pose_sample s;
+	u8 *buf;
+
+	buf = kunit_kzalloc(test, PSVR2_SLAM_RECORD_SIZE, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buf);
+	psvr2_golden_slam(buf, PSVR2_SLAM_HDR_MAGIC);
+
+	memset(&s, 0xaa, sizeof(s));
+	KUNIT_ASSERT_EQ(test, psvr2_parse_slam(buf, PSVR2_SLAM_RECORD_SIZE,
+					       &s), 0);
+	KUNIT_EXPECT_EQ(test, s.timestamp_ns, 0ULL);
+	KUNIT_EXPECT_EQ(test, s.device_vts_us, 0xdeadbeefU);
+	KUNIT_EXPECT_EQ(test, s.flags, PSVR2_POSE_FLAG_VALID);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.position[0]), F_ONE);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.position[1]), F_HALF_NEG);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.position[2]), F_QUARTER);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.orientation[0]), F_SQRT1_2);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.orientation[1]), 0U);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.orientation[2]), F_SQRT1_2);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.orientation[3]), 0U);
+
+	/* The magic is not gated on: "SLA" (or anything) parses the same. */
+	psvr2_golden_slam(buf, "SLA");
+	KUNIT_EXPECT_EQ(test, psvr2_parse_slam(buf, PSVR2_SLAM_RECORD_SIZE,
+					       &s), 0);
+	KUNIT_EXPECT_EQ(test, s.device_vts_us, 0xdeadbeefU);
+
+	KUNIT_EXPECT_EQ(test, psvr2_parse_slam(buf, PSVR2_SLAM_RECORD_SIZE - 1,
+					       &s), -EINVAL);
+}
+
+/*
+ * A "GS" packet: left eye at +92, right at +164, combined at +236 (4-byte
+ * header + packet_data offsets). Each eye gets distinct values so a swapped
+ * or shifted field is caught.
+ */
+#define GZ_LEFT		92
+#define GZ_RIGHT	164
+#define GZ_COMBINED	236
+
+static void psvr2_golden_eye(u8 *eye, u32 tag)
+{
+	put_le32(eye + 0, 1);			/* gaze_point_mm_valid */
+	put_le32(eye + 4, F_ONE + tag);
+	put_le32(eye + 8, F_TWO + tag);
+	put_le32(eye + 12, F_QUARTER + tag);
+	put_le32(eye + 16, 1);			/* gaze_direction_valid */
+	put_le32(eye + 20, F_HALF_NEG + tag);
+	put_le32(eye + 24, tag);
+	put_le32(eye + 28, F_ONE);
+	put_le32(eye + 32, 1);			/* pupil_diameter_valid */
+	put_le32(eye + 36, F_TWO + 2 * tag);
+	put_le32(eye + 40, 0xffffffff);		/* unk_bool_2 */
+	put_le32(eye + 64, 1);			/* blink_valid */
+	put_le32(eye + 68, tag & 1);		/* blink */
+}
+
+static void psvr2_golden_gaze(u8 *buf)
+{
+	memset(buf, 0, sizeof(struct psvr2_pkt_gaze_state));
+	buf[0] = 'G';
+	buf[1] = 'S';
+	put_le16(buf + 2, 2);			/* version */
+	put_le32(buf + 4, 320);			/* packet_data.size */
+	psvr2_golden_eye(buf + GZ_LEFT, 1);
+	psvr2_golden_eye(buf + GZ_RIGHT, 2);
+	put_le32(buf + GZ_COMBINED + 0, 1);	/* gaze_point_valid */
+	put_le32(buf + GZ_COMBINED + 4, F_QUARTER);
+	put_le32(buf + GZ_COMBINED + 8, F_HALF_NEG);
+	put_le32(buf + GZ_COMBINED + 12, F_TWO);
+	put_le32(buf + GZ_COMBINED + 16, 0);	/* normalized_gaze_valid */
+	put_le32(buf + GZ_COMBINED + 20, F_SQRT1_2);
+	put_le32(buf + GZ_COMBINED + 24, 0);
+	put_le32(buf + GZ_COMBINED + 28, F_SQRT1_2);
+	put_le32(buf + GZ_COMBINED + 32, 1);	/* is_valid */
+	put_le32(buf + GZ_COMBINED + 36, 0x00c0ffee);
+}
+
+static void psvr2_expect_eye(struct kunit *test,
+			     const struct psvr2_gaze_eye *e, u32 tag)
+{
+	KUNIT_EXPECT_EQ(test, e->gaze_point_valid, 1U);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(e->gaze_point_mm[0]), F_ONE + tag);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(e->gaze_point_mm[1]), F_TWO + tag);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(e->gaze_point_mm[2]),
+			F_QUARTER + tag);
+	KUNIT_EXPECT_EQ(test, e->gaze_direction_valid, 1U);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(e->gaze_direction[0]),
+			F_HALF_NEG + tag);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(e->gaze_direction[1]), tag);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(e->gaze_direction[2]), F_ONE);
+	KUNIT_EXPECT_EQ(test, e->pupil_diameter_valid, 1U);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(e->pupil_diameter_mm),
+			F_TWO + 2 * tag);
+	KUNIT_EXPECT_EQ(test, e->blink_valid, 1U);
+	KUNIT_EXPECT_EQ(test, e->blink, tag & 1);
+}
+
+static void psvr2_parse_test_gaze(struct kunit *test)
+{
+	const size_t len = sizeof(struct psvr2_pkt_gaze_state);
+	struct psvr2_gaze_sample s;
+	u8 *buf;
+
+	buf = kunit_kzalloc(test, len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buf);
+	psvr2_golden_gaze(buf);
+
+	memset(&s, 0xaa, sizeof(s));
+	KUNIT_ASSERT_EQ(test, psvr2_parse_gaze(buf, len, &s), 0);
+	KUNIT_EXPECT_EQ(test, s.timestamp_ns, 0ULL);
+	KUNIT_EXPECT_EQ(test, s.device_timestamp_us, 0x00c0ffeeU);
+	KUNIT_EXPECT_EQ(test, s.flags, PSVR2_GAZE_FLAG_VALID);
+	psvr2_expect_eye(test, &s.left, 1);
+	psvr2_expect_eye(test, &s.right, 2);
+
+	KUNIT_EXPECT_EQ(test, s.combined.gaze_point_valid, 1U);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.combined.gaze_point_mm[0]),
+			F_QUARTER);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.combined.gaze_point_mm[1]),
+			F_HALF_NEG);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.combined.gaze_point_mm[2]), F_TWO);
+	KUNIT_EXPECT_EQ(test, s.combined.gaze_direction_valid, 0U);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.combined.gaze_direction[0]),
+			F_SQRT1_2);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(s.combined.gaze_direction[2]),
+			F_SQRT1_2);
+
+	KUNIT_EXPECT_EQ(test, psvr2_parse_gaze(buf, len - 1, &s), -EINVAL);
+	buf[1] = 'X';
+	KUNIT_EXPECT_EQ(test, psvr2_parse_gaze(buf, len, &s), -EBADMSG);
+}
+
+static void psvr2_parse_test_cam(struct kunit *test)
+{
+	u8 *buf;
+
+	KUNIT_EXPECT_EQ(test, (int)psvr2_parse_cam_mode(0),
+			(int)PSVR2_CAMERA_MODE_OFF);
+	KUNIT_EXPECT_EQ(test,
+			(int)psvr2_parse_cam_mode(PSVR2_CAM_MODE1_XFER_SIZE - 1),
+			(int)PSVR2_CAMERA_MODE_OFF);
+	KUNIT_EXPECT_EQ(test,
+			(int)psvr2_parse_cam_mode(PSVR2_CAM_MODE1_XFER_SIZE),
+			(int)PSVR2_CAMERA_MODE_BOTTOM_SBS_CROPPED);
+	/* Between the two known sizes is neither, not a long mode 1. */
+	KUNIT_EXPECT_EQ(test,
+			(int)psvr2_parse_cam_mode(PSVR2_CAM_MODE1_XFER_SIZE + 1),
+			(int)PSVR2_CAMERA_MODE_OFF);
+	KUNIT_EXPECT_EQ(test,
+			(int)psvr2_parse_cam_mode(PSVR2_CAMERA_MAX_XFER_SIZE - 1),
+			(int)PSVR2_CAMERA_MODE_OFF);
+	KUNIT_EXPECT_EQ(test,
+			(int)psvr2_parse_cam_mode(PSVR2_CAMERA_MAX_XFER_SIZE),
+			(int)PSVR2_CAMERA_MODE_TRACKING);
+
+	buf = vmalloc(PSVR2_CAMERA_MAX_XFER_SIZE);
+	if (!buf)
+		kunit_skip(test, "no memory for a transfer buffer");
+
+	/* The image starts after the header and fits in the transfer. */
+	KUNIT_EXPECT_LE(test, (size_t)(PSVR2_CAMERA_HEADER_SIZE +
+				       PSVR2_CAM_FRAME_SIZE),
+			(size_t)PSVR2_CAM_MODE1_XFER_SIZE);
+	KUNIT_EXPECT_PTR_EQ(test,
+			    psvr2_parse_cam_mode1(buf,
+						  PSVR2_CAM_MODE1_XFER_SIZE),
+			    (const void *)(buf + PSVR2_CAMERA_HEADER_SIZE));
+	KUNIT_EXPECT_NULL(test, psvr2_parse_cam_mode1(buf,
+						      PSVR2_CAMERA_MAX_XFER_SIZE));
+	KUNIT_EXPECT_NULL(test, psvr2_parse_cam_mode1(buf,
+						      PSVR2_CAM_MODE1_XFER_SIZE + 512));
+	KUNIT_EXPECT_NULL(test, psvr2_parse_cam_mode1(buf, 4096));
+	vfree(buf);
+}
+
+/*
+ * Benchmarks. Each result is folded into a checksum the test asserts on, so
+ * the compiler can't drop the parse it is timing.
+ */
+static void psvr2_bench_report(struct kunit *test, const char *what,
+			       u64 ns, u64 records)
+{
+	kunit_info(test, "%s: %llu ns/record (%llu records in %llu us)\n",
+		   what, div64_u64(ns, records), records,
+		   div_u64(ns, NSEC_PER_USEC));
+}
+
+static void psvr2_parse_test_status_bench(struct kunit *test)
+{
+	struct psvr2_status_info info;
+	struct psvr2_imu_sample imu;
+	u64 start, ns, sum = 0, records = 0;
+	unsigned int r;
+	u8 *buf;
+	int i;
+
+	/* A full interrupt transfer: header + 41 copies of the good record. */
+	buf = kunit_kzalloc(test, 1024, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buf);
+	memcpy(buf, psvr2_golden_status, 32);
+	for (r = 0; r < 41; r++)
+		memcpy(buf + 32 + r * 24, psvr2_golden_status + 32, 24);
+
+	start = ktime_get_ns();
+	for (i = 0; i < PSVR2_BENCH_ITERS / 41; i++) {
+		if (psvr2_parse_status(buf, 1024, &info))
+			continue;
+		sum += info.ipd_mm;
+		for (r = 0; r < info.num_imu; r++) {
+			if (!psvr2_parse_imu(&info.imu[r], &imu))
+				continue;
+			sum += imu.accel[0] + imu.gyro[2] +
+			       psvr2_parse_imu_timestamp(start, info.num_imu, r);
+			records++;
+		}
+	}
+	ns = ktime_get_ns() - start;
+
+	KUNIT_EXPECT_EQ(test, records, (u64)(PSVR2_BENCH_ITERS / 41) * 41);
+	KUNIT_EXPECT_NE(test, sum, 0ULL);
+	psvr2_bench_report(test, "status+imu", ns, records);
+}
+
+static void psvr2_parse_test_slam_bench(struct kunit *test)
+{
+	struct psvr2_pose_sample s;
+	u64 start, ns, sum = 0;
+	u8 *buf;
+	int i;
+
+	buf = kunit_kzalloc(test, PSVR2_SLAM_RECORD_SIZE, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buf);
+	psvr2_golden_slam(buf, PSVR2_SLAM_HDR_MAGIC);
+
+	start = ktime_get_ns();
+	for (i = 0; i < PSVR2_BENCH_ITERS; i++) {
+		if (!psvr2_parse_slam(buf, PSVR2_SLAM_RECORD_SIZE, &s))
+			sum += (u64)s.device_vts_us +
+			       le32_to_cpu(s.orientation[0]);
+	}
+	ns = ktime_get_ns() - start;
+
+	KUNIT_EXPECT_EQ(test, sum,
+			(u64)PSVR2_BENCH_ITERS * (0xdeadbeefULL + F_SQRT1_2));
+	psvr2_bench_report(test, "slam", ns, PSVR2_BENCH_ITERS);
+}
+
+static void psvr2_parse_test_gaze_bench(struct kunit *test)
+{
+	const size_t len = sizeof(struct psvr2_pkt_gaze_state);
+	struct psvr2_gaze_sample s;
+	u64 start, ns, sum = 0;
+	u8 *buf;
+	int i;
+
+	buf = kunit_kzalloc(test, len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buf);
+	psvr2_golden_gaze(buf);
+
+	start = ktime_get_ns();
+	for (i = 0; i < PSVR2_BENCH_ITERS; i++) {
+		if (!psvr2_parse_gaze(buf, len, &s))
+			sum += s.device_timestamp_us + s.right.blink;
+	}
+	ns = ktime_get_ns() - start;
+
+	KUNIT_EXPECT_EQ(test, sum, (u64)PSVR2_BENCH_ITERS * 0x00c0ffee);
+	psvr2_bench_report(test, "gaze", ns, PSVR2_BENCH_ITERS);
+}
+
+/* Classify + copy into a vb2-sized plane, as psvr2_cam_complete() does. */
+static void psvr2_parse_test_cam_bench(struct kunit *test)
+{
+	u64 start, ns, frames = 0;
+	const void *img;
+	u8 *xfer, *plane;
+	int i;
+
+	xfer = vmalloc(PSVR2_CAMERA_MAX_XFER_SIZE);
+	plane = vmalloc(PSVR2_CAM_FRAME_SIZE);
+	if (!xfer || !plane) {
+		vfree(xfer);
+		vfree(plane);
+		kunit_skip(test, "no memory for frame buffers");
+	}
+	memset(xfer, 0x5a, PSVR2_CAMERA_MAX_XFER_SIZE);
+
+	start = ktime_get_ns();
+	for (i = 0; i < PSVR2_BENCH_CAM_ITERS; i++) {
+		img = psvr2_parse_cam_mode1(xfer, PSVR2_CAM_MODE1_XFER_SIZE);
+		if (!img)
+			continue;
+		memcpy(plane, img, PSVR2_CAM_FRAME_SIZE);
+		frames++;
+	}
+	ns = ktime_get_ns() - start;
+
+	KUNIT_EXPECT_EQ(test, frames, (u64)PSVR2_BENCH_CAM_ITERS);
+	KUNIT_EXPECT_EQ(test, plane[PSVR2_CAM_FRAME_SIZE - 1], 0x5a);
+	psvr2_bench_report(test, "camera mode 1 (frame)", ns, frames);
+
+	vfree(plane);
+	vfree(xfer);
+}
+
+static struct kunit_case psvr2_parse_test_cases[] = {
+	KUNIT_CASE(psvr2_parse_test_layout),
+	KUNIT_CASE(psvr2_parse_test_ctrl),
+	KUNIT_CASE(psvr2_parse_test_status),
+	KUNIT_CASE(psvr2_parse_test_imu_timestamp),
+	KUNIT_CASE(psvr2_parse_test_slam),
+	KUNIT_CASE(psvr2_parse_test_gaze),
+	KUNIT_CASE(psvr2_parse_test_cam),
+	KUNIT_CASE(psvr2_parse_test_status_bench),
+	KUNIT_CASE(psvr2_parse_test_slam_bench),
+	KUNIT_CASE(psvr2_parse_test_gaze_bench),
+	KUNIT_CASE(psvr2_parse_test_cam_bench),
+	{}
+};
+
+static struct kunit_suite psvr2_parse_test_suite = {
+	.name = "psvr2_parse",
+	.test_cases = psvr2_parse_test_cases,
+};
+kunit_test_suite(psvr2_parse_test_suite);
+
+MODULE_AUTHOR("PSVR2 Linux project");
+MODULE_DESCRIPTION("KUnit tests for the PSVR2 wire-format parsers");
+MODULE_LICENSE("GPL");
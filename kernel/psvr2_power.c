@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PSVR2 Linux driver — proximity-driven low-power policy.
+ *
+ * The IF7 status header carries the proximity sensor ("worn") on every packet.
+ * Once the headset has read "removed" for lowpower_delay_ms, the gaze stream
+ * (and its keepalive) and the cameras are paused and IIO delivery is decimated.
+ * Putting the headset back on lifts the IMU throttle from the very packet that
+ * reports it and queues the ep0 work to re-enable gaze and cameras immediately.
+ *
+ * sysfs, on the IF7 interface:
+ *   lowpower_enable    rw  0/1, default 1
+ *   lowpower_delay_ms  rw  unworn time before entering low power
+ *   lowpower           ro  0/1, sysfs_notify()'d on every transition (poll it)
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <linux/device.h>
+#include <linux/jiffies.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/sysfs.h>
+#include <linux/usb.h>
+#include <linux/workqueue.h>
+
+#include "psvr2.h"
+
+struct psvr2_power {
+	struct psvr2_device	*psvr2;
+	struct device		*dev;		/* IF7, for sysfs_notify() */
+	struct delayed_work	work;
+
+	bool			enable;
+	unsigned int		delay_ms;
+
+	/* Proximity as last reported by the status stream (atomic context). */
+	bool			have_state;
+	bool			worn;
+
+	/* Applied state; written by the work item under @lock. */
+	struct mutex		lock;
+	bool			lowpower;
+};
+
+static void psvr2_power_work(struct work_struct *work)
+{
+	struct psvr2_power *pw =
+		container_of(to_delayed_work(work), struct psvr2_power, work);
+	struct psvr2_device *psvr2 = pw->psvr2;
+	bool low = READ_ONCE(pw->enable) && READ_ONCE(pw->have_state) &&
+		   !READ_ONCE(pw->worn);
+
+	mutex_lock(&pw->lock);
+	if (low == pw->lowpower) {
+		/*
+		 * A worn report lifts the IMU throttle straight away; if the
+		 * headset came off again before we ran, put it back.
+		 */
+		if (low)
+			psvr2_imu_set_decimation(psvr2, PSVR2_LOWPOWER_IMU_DIV);
+		mutex_unlock(&pw->lock);
+		return;
+	}
+	WRITE_ONCE(pw->lowpower, low);
+
+	psvr2_imu_set_decimation(psvr2, low ? PSVR2_LOWPOWER_IMU_DIV : 1);
+	psvr2_gaze_set_paused(psvr2, low);
+	psvr2_camera_set_paused(psvr2, low);
+	mutex_unlock(&pw->lock);
+
+	dev_dbg(pw->dev, "%s low-power mode\n", low ? "entering" : "leaving");
+	sysfs_notify(&pw->dev->kobj, NULL, "lowpower");
+}
+
+/*
+ * Gaze and camera may bind after low power was entered, when there was nothing
+ * yet for the work item to pause; their probes call this to catch up.
+ */
+void psvr2_power_sync(struct psvr2_device *psvr2)
+{
+	struct psvr2_power *pw = psvr2->power;
+
+	if (!pw)
+		return;
+	mutex_lock(&pw->lock);
+	if (pw->lowpower) {
+		psvr2_gaze_set_paused(psvr2, true);
+		psvr2_camera_set_paused(psvr2, true);
+	}
+	mutex_unlock(&pw->lock);
+}
+
+/* Re-evaluate the policy now, or after the unworn delay when entering it. */
+static void psvr2_power_kick(struct psvr2_power *pw, bool use_delay)
+{
+	unsigned long delay = 0;
+
+	if (use_delay)
+		delay = msecs_to_jiffies(READ_ONCE(pw->delay_ms));
+	mod_delayed_work(system_wq, &pw->work, delay);
+}
+
+/* Called from the status URB completion for every packet. */
+void psvr2_power_report(struct psvr2_device *psvr2, bool worn)
+{
+	struct psvr2_power *pw = psvr2->power;
+
+	if (!pw)
+		return;
+	if (pw->have_state && pw->worn == worn)
+		return;
+
+	WRITE_ONCE(pw->worn, worn);
+	WRITE_ONCE(pw->have_state, true);
+
+	if (worn) {
+		/*
+		 * IIO delivery is a plain flag and resumes with this packet; the
+		 * gaze/camera reports need ep0 and so go through the work item.
+		 */
+		psvr2_imu_set_decimation(psvr2, 1);
+		psvr2_power_kick(pw, false);
+	} else if (READ_ONCE(pw->enable)) {
+		psvr2_power_kick(pw, true);
+	}
+}
+
+static struct psvr2_power *psvr2_power_from_dev(struct device *dev)
+{
+	struct psvr2_device *psvr2 = usb_get_intfdata(to_usb_interface(dev));
+
+	return psvr2->power;
+}
+
+static ssize_t lowpower_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct psvr2_power *pw = psvr2_power_from_dev(dev);
+
+	return sysfs_emit(buf, "%d\n", READ_ONCE(pw->lowpower));
+}
+static DEVICE_ATTR_RO(lowpower);
+
+static ssize_t lowpower_enable_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct psvr2_power *pw = psvr2_power_from_dev(dev);
+
+	return sysfs_emit(buf, "%d\n", READ_ONCE(pw->enable));
+}
+
+static ssize_t lowpower_enable_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct psvr2_power *pw = psvr2_power_from_dev(dev);
+	bool enable;
+	int ret;
+
+	ret = kstrtobool(buf, &enable);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(pw->enable, enable);
+	psvr2_power_kick(pw, enable);
+	return count;
+}
+static DEVICE_ATTR_RW(lowpower_enable);
+
+static ssize_t lowpower_delay_ms_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct psvr2_power *pw = psvr2_power_from_dev(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(pw->delay_ms));
+}
+
+static ssize_t lowpower_delay_ms_store(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct psvr2_power *pw = psvr2_power_from_dev(dev);
+	unsigned int delay;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &delay);
+	if (ret)
+		return ret;
+	if (delay > PSVR2_LOWPOWER_DELAY_MAX_MS)
+		return -ERANGE;
+
+	WRITE_ONCE(pw->delay_ms, delay);
+	/*
+	 * A pending entry is re-timed against the new delay; the immediate
+	 * exit a worn report queued is left alone.
+	 */
+	if (!READ_ONCE(pw->worn) && delayed_work_pending(&pw->work))
+		psvr2_power_kick(pw, true);
+	return count;
+}
+static DEVICE_ATTR_RW(lowpower_delay_ms);
+
+static struct attribute *psvr2_power_attrs[] = {
+	&dev_attr_lowpower.attr,
+	&dev_attr_lowpower_enable.attr,
+	&dev_attr_lowpower_delay_ms.attr,
+	NULL,
+};
+
+const struct attribute_group psvr2_power_group = {
+	.attrs		= psvr2_power_attrs,
+	.is_visible	= psvr2_status_attr_visible,
+};
+
+int psvr2_power_start(struct psvr2_device *psvr2, struct usb_interface *intf)
+{
+	struct psvr2_power *pw;
+
+	pw = kzalloc(sizeof(*pw), GFP_KERNEL);
+	if (!pw)
+		return -ENOMEM;
+
+	pw->psvr2 = psvr2;
+	pw->dev = &intf->dev;
+	pw->enable = true;
+	pw->delay_ms = PSVR2_LOWPOWER_DELAY_MS;
+	mutex_init(&pw->lock);
+	INIT_DELAYED_WORK(&pw->work, psvr2_power_work);
+
+	psvr2->power = pw;
+	return 0;
+}
+
+/* Called once the status stream is stopped, so no new reports arrive. */
+void psvr2_power_stop(struct psvr2_device *psvr2)
+{
+	struct psvr2_power *pw = psvr2->power;
+
+	if (!pw)
+		return;
+	psvr2->power = NULL;
+
+	cancel_delayed_work_sync(&pw->work);
+
+	/* Don't leave the other interfaces parked if only IF7 goes away. */
+	if (pw->lowpower) {
+		psvr2_imu_set_decimation(psvr2, 1);
+		psvr2_gaze_set_paused(psvr2, false);
+		psvr2_camera_set_paused(psvr2, false);
+	}
+	kfree(pw);
+}
@@ -6,7 +6,8 @@
  * headset's onboard tracker output: 512-byte "SLP" records carrying a position
  * vector and orientation quaternion (IEEE-754 floats). Each record is turned
  * into a struct psvr2_pose_sample and queued for userspace on the character
- * device /dev/psvr2-pose (blocking read of whole samples, with poll support).
+ * device /dev/psvr2-pose<N>, N being the headset index (blocking read of whole
+ * samples, with poll support; udev links headset 0 as /dev/psvr2-pose).
  * The most recent raw record is also exposed via debugfs.
  *
  * The context is reference counted so that a reader blocked in read()/poll()
@@ -29,6 +30,7 @@
 
 #include "psvr2.h"
 #include "psvr2_protocol.h"
+#include "psvr2_trace.h"
 #include "psvr2_uapi.h"
 
 #define PSVR2_POSE_FIFO_DEPTH	256
@@ -50,6 +52,8 @@ struct psvr2_slam {
 	wait_queue_head_t	readq;
 	bool			dead;		/* device gone; readers see EOF */
 
+	struct psvr2_stream_stats	stats;		/* debugfs stats/ */
+
 	/* Snapshot of the most recent raw record, for debugfs. */
 	struct dentry		*raw_dentry;
 	struct mutex		raw_lock;
@@ -116,9 +120,12 @@ static ssize_t psvr2_pose_read(struct file *file, char __user *ubuf,
 			break;
 		if (copy_to_user(ubuf + total, &sample, sizeof(sample)))
 			return total ? total : -EFAULT;
+		psvr2_stats_dequeue(&sl->stats, sample.timestamp_ns);
 		total += sizeof(sample);
 	}
 
+	trace_psvr2_sample_dequeue(PSVR2_STREAM_SLAM, total / sizeof(sample),
+				   kfifo_len(&sl->fifo));
 	return total;
 }
 
@@ -176,11 +183,11 @@ static const struct file_operations psvr2_raw_slam_fops = {
 
 static void psvr2_slam_process(struct psvr2_slam *sl, int len)
 {
-	struct psvr2_slam_record *rec = (void *)sl->buf;
 	struct psvr2_pose_sample sample;
 	unsigned long flags;
+	unsigned int fill;
 
-	if (len < PSVR2_SLAM_RECORD_SIZE)
+	if (psvr2_parse_slam(sl->buf, len, &sample))
 		return;		/* not a full record */
 
 	/*
@@ -196,21 +203,27 @@ static void psvr2_slam_process(struct psvr2_slam *sl, int len)
 	sl->raw_len = PSVR2_SLAM_RECORD_SIZE;
 	mutex_unlock(&sl->raw_lock);
 
-	memset(&sample, 0, sizeof(sample));
 	sample.timestamp_ns = ktime_get_ns();
-	sample.device_vts_us = le32_to_cpu(rec->vts_ts_us);
-	sample.flags = PSVR2_POSE_FLAG_VALID;
-	/* Carry the float bit patterns through untouched (no FPU in kernel). */
-	memcpy(sample.position, rec->pos, sizeof(sample.position));
-	memcpy(sample.orientation, rec->orient, sizeof(sample.orientation));
 
 	spin_lock_irqsave(&sl->fifo_lock, flags);
-	if (kfifo_is_full(&sl->fifo))
+	if (kfifo_is_full(&sl->fifo)) {
 		kfifo_skip(&sl->fifo);		/* drop oldest, keep latest */
+		psvr2_stats_overflow(&sl->stats);
+		trace_psvr2_fifo_overflow(PSVR2_STREAM_SLAM,
+					  kfifo_size(&sl->fifo));
+	}
 	kfifo_in(&sl->fifo, &sample, 1);
+	fill = kfifo_len(&sl->fifo);
 	spin_unlock_irqrestore(&sl->fifo_lock, flags);
 
+	psvr2_stats_record(&sl->stats);
+	psvr2_stats_device_ts(&sl->stats, sample.device_vts_us);
+	trace_psvr2_sample_enqueue(PSVR2_STREAM_SLAM, sample.device_vts_us,
+				   fill);
+
 	wake_up_interruptible(&sl->readq);
+	psvr2_watchdog_feed(sl->psvr2, PSVR2_STREAM_SLAM);
+	psvr2_pm_pose_arrived(sl->psvr2);
 }
 
 static void psvr2_slam_complete(struct urb *urb)
@@ -218,6 +231,9 @@ static void psvr2_slam_complete(struct urb *urb)
 	struct psvr2_slam *sl = urb->context;
 	int ret;
 
+	trace_psvr2_urb_complete(PSVR2_IF_SLAM, urb->status, urb->actual_length);
+	psvr2_stats_urb(&sl->stats, urb->status, urb->actual_length);
+
 	switch (urb->status) {
 	case 0:
 		break;
@@ -235,9 +251,51 @@ static void psvr2_slam_complete(struct urb *urb)
 
 resubmit:
 	ret = usb_submit_urb(urb, GFP_ATOMIC);
-	if (ret && ret != -EPERM)
+	if (ret && ret != -EPERM) {
+		psvr2_stats_resubmit_failed(&sl->stats);
 		dev_err(&sl->udev->dev, "failed to resubmit SLAM URB: %d\n",
 			ret);
+	}
+}
+
+/* Watchdog stage 2 for IF3. Caller holds state_lock. */
+void psvr2_slam_reset(struct psvr2_device *psvr2)
+{
+	struct psvr2_slam *sl = psvr2->slam;
+
+	if (sl)
+		psvr2_reset_interface(psvr2, sl->urb, PSVR2_IF_SLAM,
+				      PSVR2_SLAM_ALT);
+}
+
+/* PM: park the URB; /dev/psvr2-poseN and its readers stay as they are. */
+void psvr2_slam_suspend(struct psvr2_device *psvr2)
+{
+	struct psvr2_slam *sl;
+
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_SLAM, false);
+	mutex_lock(&psvr2->state_lock);
+	sl = psvr2->slam;
+	if (sl)
+		usb_kill_urb(sl->urb);
+	mutex_unlock(&psvr2->state_lock);
+}
+
+int psvr2_slam_resume(struct psvr2_device *psvr2, bool reset)
+{
+	struct psvr2_slam *sl;
+	int ret = 0;
+
+	mutex_lock(&psvr2->state_lock);
+	sl = psvr2->slam;
+	if (sl) {
+		ret = psvr2_resume_urb(psvr2, sl->urb, PSVR2_IF_SLAM,
+				       PSVR2_SLAM_ALT, reset);
+		/* On failure too, so the watchdog gets to reset it. */
+		psvr2_watchdog_enable(psvr2, PSVR2_STREAM_SLAM, true);
+	}
+	mutex_unlock(&psvr2->state_lock);
+	return ret;
 }
 
 int psvr2_slam_start(struct psvr2_device *psvr2, struct usb_interface *intf)
@@ -295,11 +353,12 @@ int psvr2_slam_start(struct psvr2_device *psvr2, struct usb_interface *intf)
 			  sl->buf, sl->buf_size, psvr2_slam_complete, sl);
 	sl->urb->transfer_flags |= URB_NO_TRANSFER_DMA_MAP;
 
-	/* Unique-enough name for the single-headset case. */
-	scnprintf(sl->devname, sizeof(sl->devname), "psvr2-pose");
+	scnprintf(sl->devname, sizeof(sl->devname), "psvr2-pose%d",
+		  psvr2->index);
 	sl->miscdev.minor = MISC_DYNAMIC_MINOR;
 	sl->miscdev.name = sl->devname;
 	sl->miscdev.fops = &psvr2_pose_fops;
+	sl->miscdev.parent = &intf->dev;	/* USB ancestry for udev */
 	ret = misc_register(&sl->miscdev);
 	if (ret) {
 		dev_err(&intf->dev, "failed to register /dev/%s: %d\n",
@@ -318,6 +377,8 @@ int psvr2_slam_start(struct psvr2_device *psvr2, struct usb_interface *intf)
 					     &psvr2_raw_slam_fops);
 
 	psvr2->slam = sl;
+	psvr2_stats_add(psvr2, PSVR2_STREAM_SLAM, &sl->stats);
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_SLAM, true);
 	return 0;
 
 err_misc:
@@ -341,7 +402,11 @@ void psvr2_slam_stop(struct psvr2_device *psvr2)
 
 	if (!sl)
 		return;
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_SLAM, false);
+	psvr2_stats_remove(psvr2, PSVR2_STREAM_SLAM);
+	mutex_lock(&psvr2->state_lock);
 	psvr2->slam = NULL;
+	mutex_unlock(&psvr2->state_lock);
 
 	/* Stop USB activity and tear down all USB-tied resources now. */
 	usb_kill_urb(sl->urb);
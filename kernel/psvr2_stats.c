@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PSVR2 Linux driver — per-stream statistics.
+ *
+ * Every stream counts completed URBs, bytes, parsed records, FIFO overflows,
+ * resubmit failures and URB errors by status, and keeps two log2 histograms in
+ * microseconds: host receive to read() dequeue (pose, gaze; camera at DQBUF)
+ * and the gap between consecutive device timestamps (status/IMU, pose, gaze).
+ *
+ * debugfs, one plain-text file per bound stream plus a reset knob, under the
+ * headset's psvr2/<N>/ directory:
+ *   stats/{status,slam,gaze,camera}   "name value" lines
+ *   stats/reset                       write anything to zero all streams
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <linux/bitops.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+
+#include "psvr2.h"
+
+struct psvr2_stats {
+	struct dentry			*dir;
+	struct mutex			lock;	/* streams[] vs. reset */
+	struct psvr2_stream_stats	*streams[PSVR2_STREAM_COUNT];
+	struct dentry			*dentries[PSVR2_STREAM_COUNT];
+};
+
+static const char *const psvr2_stats_stream_names[PSVR2_STREAM_COUNT] = {
+	[PSVR2_STREAM_STATUS]	= "status",
+	[PSVR2_STREAM_SLAM]	= "slam",
+	[PSVR2_STREAM_GAZE]	= "gaze",
+	[PSVR2_STREAM_CAMERA]	= "camera",
+};
+
+static const char *const psvr2_stats_err_names[PSVR2_STATS_NUM_ERRS] = {
+	[PSVR2_STATS_ERR_EPROTO]	= "eproto",
+	[PSVR2_STATS_ERR_EILSEQ]	= "eilseq",
+	[PSVR2_STATS_ERR_ETIME]		= "etime",
+	[PSVR2_STATS_ERR_EPIPE]		= "epipe",
+	[PSVR2_STATS_ERR_EOVERFLOW]	= "eoverflow",
+	[PSVR2_STATS_ERR_EREMOTEIO]	= "eremoteio",
+	[PSVR2_STATS_ERR_UNLINK]	= "unlink",
+	[PSVR2_STATS_ERR_OTHER]		= "other",
+};
+
+static enum psvr2_stats_err psvr2_stats_err_bucket(int status)
+{
+	switch (status) {
+	case -EPROTO:
+		return PSVR2_STATS_ERR_EPROTO;
+	case -EILSEQ:
+		return PSVR2_STATS_ERR_EILSEQ;
+	case -ETIME:
+		return PSVR2_STATS_ERR_ETIME;
+	case -EPIPE:
+		return PSVR2_STATS_ERR_EPIPE;
+	case -EOVERFLOW:
+		return PSVR2_STATS_ERR_EOVERFLOW;
+	case -EREMOTEIO:
+		return PSVR2_STATS_ERR_EREMOTEIO;
+	case -ENOENT:
+	case -ECONNRESET:
+	case -ESHUTDOWN:
+		return PSVR2_STATS_ERR_UNLINK;
+	default:
+		return PSVR2_STATS_ERR_OTHER;
+	}
+}
+
+static void psvr2_stats_hist_add(atomic64_t *hist, u64 us)
+{
+	unsigned int b = min_t(unsigned int, fls64(us),
+			       PSVR2_STATS_HIST_BUCKETS - 1);
+
+	atomic64_inc(&hist[b]);
+}
+
+/* Hooks, called from URB completions (and read() for dequeue). */
+void psvr2_stats_urb(struct psvr2_stream_stats *stats, int status, u32 len)
+{
+	if (status) {
+		atomic64_inc(&stats->urb_errors[psvr2_stats_err_bucket(status)]);
+		return;
+	}
+	atomic64_inc(&stats->urbs);
+	atomic64_add(len, &stats->bytes);
+}
+
+void psvr2_stats_resubmit_failed(struct psvr2_stream_stats *stats)
+{
+	atomic64_inc(&stats->resubmit_failures);
+}
+
+void psvr2_stats_record(struct psvr2_stream_stats *stats)
+{
+	atomic64_inc(&stats->records);
+}
+
+/* Device timestamps are free-running u32 microseconds; wrap is harmless. */
+void psvr2_stats_device_ts(struct psvr2_stream_stats *stats, u32 device_ts_us)
+{
+	if (stats->have_device_ts)
+		psvr2_stats_hist_add(stats->device_gap_us,
+				     (u32)(device_ts_us -
+					   stats->last_device_ts_us));
+	stats->last_device_ts_us = device_ts_us;
+	stats->have_device_ts = true;
+}
+
+void psvr2_stats_overflow(struct psvr2_stream_stats *stats)
+{
+	atomic64_inc(&stats->fifo_overflows);
+}
+
+/* @timestamp_ns is the sample's host CLOCK_MONOTONIC receive time. */
+void psvr2_stats_dequeue(struct psvr2_stream_stats *stats, u64 timestamp_ns)
+{
+	u64 now = ktime_get_ns();
+
+	psvr2_stats_hist_add(stats->read_latency_us,
+			     now > timestamp_ns ?
+				     div_u64(now - timestamp_ns, NSEC_PER_USEC) :
+				     0);
+}
+
+static void psvr2_stats_clear(struct psvr2_stream_stats *stats)
+{
+	int i;
+
+	atomic64_set(&stats->urbs, 0);
+	atomic64_set(&stats->bytes, 0);
+	atomic64_set(&stats->records, 0);
+	atomic64_set(&stats->fifo_overflows, 0);
+	atomic64_set(&stats->resubmit_failures, 0);
+	for (i = 0; i < PSVR2_STATS_NUM_ERRS; i++)
+		atomic64_set(&stats->urb_errors[i], 0);
+	for (i = 0; i < PSVR2_STATS_HIST_BUCKETS; i++) {
+		atomic64_set(&stats->read_latency_us[i], 0);
+		atomic64_set(&stats->device_gap_us[i], 0);
+	}
+	/* The next gap is measured from the next timestamp, not across reset. */
+	WRITE_ONCE(stats->have_device_ts, false);
+}
+
+static void psvr2_stats_show_hist(struct seq_file *m, const char *name,
+				  atomic64_t *hist)
+{
+	int i;
+
+	/* One "lower-bound:count" pair per bucket; the last is open-ended. */
+	seq_printf(m, "%s", name);
+	for (i = 0; i < PSVR2_STATS_HIST_BUCKETS; i++)
+		seq_printf(m, " %llu%s:%lld", i ? 1ULL << (i - 1) : 0,
+			   i == PSVR2_STATS_HIST_BUCKETS - 1 ? "+" : "",
+			   atomic64_read(&hist[i]));
+	seq_putc(m, '\n');
+}
+
+static int psvr2_stats_show(struct seq_file *m, void *v)
+{
+	struct psvr2_stream_stats *stats = m->private;
+	int i;
+
+	seq_printf(m, "urbs %lld\n", atomic64_read(&stats->urbs));
+	seq_printf(m, "bytes %lld\n", atomic64_read(&stats->bytes));
+	seq_printf(m, "records %lld\n", atomic64_read(&stats->records));
+	seq_printf(m, "fifo_overflows %lld\n",
+		   atomic64_read(&stats->fifo_overflows));
+	seq_printf(m, "resubmit_failures %lld\n",
+		   atomic64_read(&stats->resubmit_failures));
+	seq_puts(m, "urb_errors");
+	for (i = 0; i < PSVR2_STATS_NUM_ERRS; i++)
+		seq_printf(m, " %s=%lld", psvr2_stats_err_names[i],
+			   atomic64_read(&stats->urb_errors[i]));
+	seq_putc(m, '\n');
+	psvr2_stats_show_hist(m, "read_latency_us", stats->read_latency_us);
+	psvr2_stats_show_hist(m, "device_gap_us", stats->device_gap_us);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(psvr2_stats);
+
+static ssize_t psvr2_stats_reset_write(struct file *file,
+				       const char __user *ubuf, size_t count,
+				       loff_t *ppos)
+{
+	struct psvr2_stats *ps = file->private_data;
+	int i;
+
+	mutex_lock(&ps->lock);
+	for (i = 0; i < PSVR2_STREAM_COUNT; i++)
+		if (ps->streams[i])
+			psvr2_stats_clear(ps->streams[i]);
+	mutex_unlock(&ps->lock);
+	return count;
+}
+
+static const struct file_operations psvr2_stats_reset_fops = {
+	.owner		= THIS_MODULE,
+	.open		= simple_open,
+	.write		= psvr2_stats_reset_write,
+	.llseek		= noop_llseek,
+};
+
+void psvr2_stats_add(struct psvr2_device *psvr2, enum psvr2_stream stream,
+		     struct psvr2_stream_stats *stats)
+{
+	struct psvr2_stats *ps = psvr2->stats;
+
+	if (!ps)
+		return;
+
+	mutex_lock(&ps->lock);
+	ps->streams[stream] = stats;
+	ps->dentries[stream] =
+		debugfs_create_file(psvr2_stats_stream_names[stream], 0400,
+				    ps->dir, stats, &psvr2_stats_fops);
+	mutex_unlock(&ps->lock);
+}
+
+void psvr2_stats_remove(struct psvr2_device *psvr2, enum psvr2_stream stream)
+{
+	struct psvr2_stats *ps = psvr2->stats;
+
+	if (!ps)
+		return;
+
+	/* debugfs_remove() waits for in-flight reads of the file. */
+	mutex_lock(&ps->lock);
+	debugfs_remove(ps->dentries[stream]);
+	ps->dentries[stream] = NULL;
+	ps->streams[stream] = NULL;
+	mutex_unlock(&ps->lock);
+}
+
+int psvr2_stats_start(struct psvr2_device *psvr2)
+{
+	struct psvr2_stats *ps;
+
+	ps = kzalloc(sizeof(*ps), GFP_KERNEL);
+	if (!ps)
+		return -ENOMEM;
+
+	mutex_init(&ps->lock);
+	ps->dir = debugfs_create_dir("stats", psvr2->debugfs_dir);
+	debugfs_create_file("reset", 0200, ps->dir, ps,
+			    &psvr2_stats_reset_fops);
+
+	psvr2->stats = ps;
+	return 0;
+}
+
+/* Called once every stream has removed itself. */
+void psvr2_stats_stop(struct psvr2_device *psvr2)
+{
+	struct psvr2_stats *ps = psvr2->stats;
+
+	if (!ps)
+		return;
+
+	debugfs_remove_recursive(ps->dir);
+	psvr2->stats = NULL;
+	mutex_destroy(&ps->lock);
+	kfree(ps);
+}
@@ -8,69 +8,99 @@
  * feeds the input device; the IMU records feed the IIO device. The most recent
  * raw frame is also exposed via debugfs for protocol validation.
  *
+ * The header's dprx_status byte tracks the headset's DisplayPort receiver and
+ * changes within a packet of the link dropping or training. It is surfaced as
+ * the pollable sysfs attribute dp_link (sysfs_notify()'d on change) plus a
+ * dp_link_flaps counter of up->down transitions, so a compositor can react
+ * long before DRM notices.
+ *
  * Copyright (C) 2026 PSVR2 Linux project
  */
 #include <linux/debugfs.h>
 #include <linux/ktime.h>
 #include <linux/slab.h>
+#include <linux/sysfs.h>
 #include <linux/usb.h>
+#include <linux/workqueue.h>
 
 #include "psvr2.h"
 #include "psvr2_protocol.h"
-
-#define PSVR2_IMU_PERIOD_NS	(NSEC_PER_SEC / PSVR2_IMU_FREQ_HZ)
+#include "psvr2_trace.h"
 
 struct psvr2_status {
 	struct psvr2_device	*psvr2;
 	struct usb_device	*udev;
+	struct device		*dev;		/* IF7, for sysfs_notify() */
 	struct urb		*urb;
 	u8			*buf;
 	size_t			buf_size;
 
+	/*
+	 * DP link state from the header. sysfs_notify() may sleep, so the
+	 * completion hands the notification to link_work.
+	 */
+	bool			have_link;
+	bool			dp_link;
+	unsigned long		dp_link_flaps;
+	struct work_struct	link_work;
+	bool			worn;		/* proximity, for the watchdog */
+
+	/* records = IMU samples pushed, gaps from their vts_us. */
+	struct psvr2_stream_stats	stats;
+
 	/* Snapshot of the most recent raw frame, for debugfs. */
 	struct mutex		raw_lock;
 	u8			*raw_copy;
 	size_t			raw_len;
 };
 
-static void psvr2_status_process(struct psvr2_status *st, int len, s64 now_ns)
+static void psvr2_status_link_work(struct work_struct *work)
 {
-	struct psvr2_device *psvr2 = st->psvr2;
-	struct psvr2_status_record_hdr *hdr;
-	unsigned int num_imu, i;
-	u8 *cur;
+	struct psvr2_status *st =
+		container_of(work, struct psvr2_status, link_work);
+
+	sysfs_notify(&st->dev->kobj, NULL, "dp_link");
+}
 
-	if (len < (int)sizeof(*hdr))
+static void psvr2_status_update_link(struct psvr2_status *st, bool up)
+{
+	if (st->have_link && st->dp_link == up)
 		return;
 
-	hdr = (struct psvr2_status_record_hdr *)st->buf;
-	psvr2_input_report(psvr2, hdr->function_button, hdr->prox_sensor_flag,
-			   hdr->ipd_dial_mm);
+	if (st->have_link && !up)
+		WRITE_ONCE(st->dp_link_flaps, st->dp_link_flaps + 1);
+	WRITE_ONCE(st->dp_link, up);
+	st->have_link = true;
 
-	cur = st->buf + sizeof(*hdr);
-	num_imu = (len - sizeof(*hdr)) / sizeof(struct psvr2_imu_record);
+	dev_dbg(st->dev, "DP link %s\n", up ? "up" : "down");
+	schedule_work(&st->link_work);
+}
 
-	for (i = 0; i < num_imu; i++) {
-		struct psvr2_imu_record *rec = (void *)cur;
-		s16 accel[3], gyro[3];
-		s64 ts;
-		int a;
+static void psvr2_status_process(struct psvr2_status *st, int len, s64 now_ns)
+{
+	struct psvr2_device *psvr2 = st->psvr2;
+	struct psvr2_status_info info;
+	struct psvr2_imu_sample imu;
+	unsigned int i;
 
-		cur += sizeof(*rec);
+	if (psvr2_parse_status(st->buf, len, &info))
+		return;
 
-		if (le16_to_cpu(rec->status) & PSVR2_IMU_STATUS_INVALID)
-			continue;
+	psvr2_status_update_link(st, info.dp_link);
+	WRITE_ONCE(st->worn, info.worn);
+	psvr2_input_report(psvr2, info.function_button, info.worn, info.ipd_mm);
+	psvr2_power_report(psvr2, info.worn);
 
-		for (a = 0; a < 3; a++) {
-			accel[a] = (s16)le16_to_cpu(rec->accel[a]);
-			gyro[a] = (s16)le16_to_cpu(rec->gyro[a]);
-		}
-		if (accel[0] == PSVR2_IMU_INVALID || gyro[0] == PSVR2_IMU_INVALID)
+	for (i = 0; i < info.num_imu; i++) {
+		if (!psvr2_parse_imu(&info.imu[i], &imu))
 			continue;
 
 		/* Back-date earlier samples in the batch from the rx time. */
-		ts = now_ns - (s64)(num_imu - 1 - i) * PSVR2_IMU_PERIOD_NS;
-		psvr2_imu_push(psvr2, accel, gyro, ts);
+		psvr2_imu_push(psvr2, imu.accel, imu.gyro, imu.vts_us,
+			       psvr2_parse_imu_timestamp(now_ns, info.num_imu,
+							 i));
+		psvr2_stats_record(&st->stats);
+		psvr2_stats_device_ts(&st->stats, imu.vts_us);
 	}
 }
 
@@ -80,6 +110,10 @@ static void psvr2_status_complete(struct urb *urb)
 	s64 now_ns = ktime_get_ns();
 	int ret;
 
+	trace_psvr2_urb_complete(PSVR2_IF_STATUS, urb->status,
+				 urb->actual_length);
+	psvr2_stats_urb(&st->stats, urb->status, urb->actual_length);
+
 	switch (urb->status) {
 	case 0:
 		break;
@@ -99,13 +133,70 @@ static void psvr2_status_complete(struct urb *urb)
 		mutex_unlock(&st->raw_lock);
 
 		psvr2_status_process(st, urb->actual_length, now_ns);
+		psvr2_watchdog_feed(st->psvr2, PSVR2_STREAM_STATUS);
 	}
 
 resubmit:
 	ret = usb_submit_urb(urb, GFP_ATOMIC);
-	if (ret && ret != -EPERM)
+	if (ret && ret != -EPERM) {
+		psvr2_stats_resubmit_failed(&st->stats);
 		dev_err(&st->udev->dev, "failed to resubmit status URB: %d\n",
 			ret);
+	}
+}
+
+/*
+ * True while the headset is worn with a trained DP link, i.e. while the tracker
+ * and eye cameras are expected to be producing data. Caller holds state_lock.
+ */
+bool psvr2_status_headset_live(struct psvr2_device *psvr2)
+{
+	struct psvr2_status *st = psvr2->status;
+
+	lockdep_assert_held(&psvr2->state_lock);
+
+	return st && READ_ONCE(st->have_link) && READ_ONCE(st->dp_link) &&
+	       READ_ONCE(st->worn);
+}
+
+/* Watchdog stage 2 for IF7. Caller holds state_lock. */
+void psvr2_status_reset(struct psvr2_device *psvr2)
+{
+	struct psvr2_status *st = psvr2->status;
+
+	if (st)
+		psvr2_reset_interface(psvr2, st->urb, PSVR2_IF_STATUS,
+				      PSVR2_STATUS_ALT);
+}
+
+/* PM: park the status URB; the IIO/input devices stay registered. */
+void psvr2_status_suspend(struct psvr2_device *psvr2)
+{
+	struct psvr2_status *st;
+
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_STATUS, false);
+	mutex_lock(&psvr2->state_lock);
+	st = psvr2->status;
+	if (st)
+		usb_kill_urb(st->urb);
+	mutex_unlock(&psvr2->state_lock);
+}
+
+int psvr2_status_resume(struct psvr2_device *psvr2, bool reset)
+{
+	struct psvr2_status *st;
+	int ret = 0;
+
+	mutex_lock(&psvr2->state_lock);
+	st = psvr2->status;
+	if (st) {
+		ret = psvr2_resume_urb(psvr2, st->urb, PSVR2_IF_STATUS,
+				       PSVR2_STATUS_ALT, reset);
+		/* On failure too, so the watchdog gets to reset it. */
+		psvr2_watchdog_enable(psvr2, PSVR2_STREAM_STATUS, true);
+	}
+	mutex_unlock(&psvr2->state_lock);
+	return ret;
 }
 
 static ssize_t psvr2_raw_status_read(struct file *file, char __user *user_buf,
@@ -137,6 +228,40 @@ static const struct file_operations psvr2_raw_status_fops = {
 	.llseek		= default_llseek,
 };
 
+/* sysfs (IF7 only): DP link state, pollable, and its flap counter. */
+static ssize_t dp_link_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct psvr2_device *psvr2 = usb_get_intfdata(to_usb_interface(dev));
+	struct psvr2_status *st = psvr2->status;
+
+	if (!st || !READ_ONCE(st->have_link))
+		return sysfs_emit(buf, "unknown\n");
+	return sysfs_emit(buf, "%d\n", READ_ONCE(st->dp_link));
+}
+static DEVICE_ATTR_RO(dp_link);
+
+static ssize_t dp_link_flaps_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct psvr2_device *psvr2 = usb_get_intfdata(to_usb_interface(dev));
+	struct psvr2_status *st = psvr2->status;
+
+	return sysfs_emit(buf, "%lu\n", st ? READ_ONCE(st->dp_link_flaps) : 0);
+}
+static DEVICE_ATTR_RO(dp_link_flaps);
+
+static struct attribute *psvr2_status_attrs[] = {
+	&dev_attr_dp_link.attr,
+	&dev_attr_dp_link_flaps.attr,
+	NULL,
+};
+
+const struct attribute_group psvr2_status_group = {
+	.attrs		= psvr2_status_attrs,
+	.is_visible	= psvr2_status_attr_visible,
+};
+
 int psvr2_status_start(struct psvr2_device *psvr2, struct usb_interface *intf)
 {
 	struct usb_device *udev = interface_to_usbdev(intf);
@@ -150,8 +275,10 @@ int psvr2_status_start(struct psvr2_device *psvr2, struct usb_interface *intf)
 
 	st->psvr2 = psvr2;
 	st->udev = udev;
+	st->dev = &intf->dev;
 	st->buf_size = PSVR2_STATUS_XFER_SIZE;
 	mutex_init(&st->raw_lock);
+	INIT_WORK(&st->link_work, psvr2_status_link_work);
 
 	ret = usb_set_interface(udev, PSVR2_IF_STATUS, PSVR2_STATUS_ALT);
 	if (ret) {
@@ -197,6 +324,8 @@ int psvr2_status_start(struct psvr2_device *psvr2, struct usb_interface *intf)
 			    &psvr2_raw_status_fops);
 
 	psvr2->status = st;
+	psvr2_stats_add(psvr2, PSVR2_STREAM_STATUS, &st->stats);
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_STATUS, true);
 	return 0;
 
 err_buffers:
@@ -217,9 +346,14 @@ void psvr2_status_stop(struct psvr2_device *psvr2)
 
 	if (!st)
 		return;
+	psvr2_watchdog_enable(psvr2, PSVR2_STREAM_STATUS, false);
+	psvr2_stats_remove(psvr2, PSVR2_STREAM_STATUS);
+	mutex_lock(&psvr2->state_lock);
 	psvr2->status = NULL;
+	mutex_unlock(&psvr2->state_lock);
 
 	usb_kill_urb(st->urb);
+	cancel_work_sync(&st->link_work);
 	usb_free_coherent(st->udev, st->buf_size, st->buf,
 			  st->urb->transfer_dma);
 	usb_free_urb(st->urb);
@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * PSVR2 Linux driver — tracepoints along the USB-to-reader data path.
+ *
+ *   psvr2_urb_complete     URB completion: interface, status, length
+ *   psvr2_sample_enqueue   pose/gaze sample queued: device timestamp, fifo fill
+ *   psvr2_fifo_overflow    oldest sample dropped because the reader fell behind
+ *   psvr2_sample_dequeue   read() drained samples: count, fill left behind
+ *   psvr2_control          ep0 vendor control transfer and its duration
+ *   psvr2_cam_frame_done   camera frame handed to vb2
+ *   psvr2_cam_frame_drop   camera transfer dropped (no buffer / wrong size)
+ *
+ * Enable with e.g. `perf trace -e 'psvr2:*'` or via tracefs events/psvr2/.
+ * The instances are created in psvr2_usb.c (CREATE_TRACE_POINTS).
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM psvr2
+
+#if !defined(_PSVR2_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _PSVR2_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+#include "psvr2.h"
+
+TRACE_DEFINE_ENUM(PSVR2_STREAM_STATUS);
+TRACE_DEFINE_ENUM(PSVR2_STREAM_SLAM);
+TRACE_DEFINE_ENUM(PSVR2_STREAM_GAZE);
+TRACE_DEFINE_ENUM(PSVR2_STREAM_CAMERA);
+
+#define psvr2_show_stream(s)					\
+	__print_symbolic(s,					\
+			 { PSVR2_STREAM_STATUS,	"status" },	\
+			 { PSVR2_STREAM_SLAM,	"slam" },	\
+			 { PSVR2_STREAM_GAZE,	"gaze" },	\
+			 { PSVR2_STREAM_CAMERA,	"camera" })
+
+TRACE_EVENT(psvr2_urb_complete,
+	TP_PROTO(u8 ifnum, int status, u32 length),
+	TP_ARGS(ifnum, status, length),
+	TP_STRUCT__entry(
+		__field(u8,	ifnum)
+		__field(int,	status)
+		__field(u32,	length)
+	),
+	TP_fast_assign(
+		__entry->ifnum = ifnum;
+		__entry->status = status;
+		__entry->length = length;
+	),
+	TP_printk("if=%u status=%d len=%u",
+		  __entry->ifnum, __entry->status, __entry->length)
+);
+
+TRACE_EVENT(psvr2_sample_enqueue,
+	TP_PROTO(enum psvr2_stream stream, u32 device_ts_us, unsigned int fill),
+	TP_ARGS(stream, device_ts_us, fill),
+	TP_STRUCT__entry(
+		__field(int,		stream)
+		__field(u32,		device_ts_us)
+		__field(unsigned int,	fill)
+	),
+	TP_fast_assign(
+		__entry->stream = stream;
+		__entry->device_ts_us = device_ts_us;
+		__entry->fill = fill;
+	),
+	TP_printk("stream=%s device_ts_us=%u fill=%u",
+		  psvr2_show_stream(__entry->stream), __entry->device_ts_us,
+		  __entry->fill)
+);
+
+TRACE_EVENT(psvr2_fifo_overflow,
+	TP_PROTO(enum psvr2_stream stream, unsigned int depth),
+	TP_ARGS(stream, depth),
+	TP_STRUCT__entry(
+		__field(int,		stream)
+		__field(unsigned int,	depth)
+	),
+	TP_fast_assign(
+		__entry->stream = stream;
+		__entry->depth = depth;
+	),
+	TP_printk("stream=%s depth=%u (oldest sample dropped)",
+		  psvr2_show_stream(__entry->stream), __entry->depth)
+);
+
+TRACE_EVENT(psvr2_sample_dequeue,
+	TP_PROTO(enum psvr2_stream stream, unsigned int count,
+		 unsigned int fill),
+	TP_ARGS(stream, count, fill),
+	TP_STRUCT__entry(
+		__field(int,		stream)
+		__field(unsigned int,	count)
+		__field(unsigned int,	fill)
+	),
+	TP_fast_assign(
+		__entry->stream = stream;
+		__entry->count = count;
+		__entry->fill = fill;
+	),
+	TP_printk("stream=%s count=%u fill=%u",
+		  psvr2_show_stream(__entry->stream), __entry->count,
+		  __entry->fill)
+);
+
+TRACE_EVENT(psvr2_control,
+	TP_PROTO(bool in, u16 report_id, u16 subcmd, u32 len, int ret,
+		 s64 duration_ns),
+	TP_ARGS(in, report_id, subcmd, len, ret, duration_ns),
+	TP_STRUCT__entry(
+		__field(bool,	in)
+		__field(u16,	report_id)
+		__field(u16,	subcmd)
+		__field(u32,	len)
+		__field(int,	ret)
+		__field(s64,	duration_ns)
+	),
+	TP_fast_assign(
+		__entry->in = in;
+		__entry->report_id = report_id;
+		__entry->subcmd = subcmd;
+		__entry->len = len;
+		__entry->ret = ret;
+		__entry->duration_ns = duration_ns;
+	),
+	TP_printk("%s report=0x%02x subcmd=0x%02x len=%u ret=%d duration_ns=%lld",
+		  __entry->in ? "get" : "set", __entry->report_id,
+		  __entry->subcmd, __entry->len, __entry->ret,
+		  __entry->duration_ns)
+);
+
+TRACE_EVENT(psvr2_cam_frame_done,
+	TP_PROTO(unsigned int sequence, u32 length),
+	TP_ARGS(sequence, length),
+	TP_STRUCT__entry(
+		__field(unsigned int,	sequence)
+		__field(u32,		length)
+	),
+	TP_fast_assign(
+		__entry->sequence = sequence;
+		__entry->length = length;
+	),
+	TP_printk("seq=%u len=%u", __entry->sequence, __entry->length)
+);
+
+TRACE_EVENT(psvr2_cam_frame_drop,
+	TP_PROTO(unsigned int sequence, u32 length, bool no_buffer),
+	TP_ARGS(sequence, length, no_buffer),
+	TP_STRUCT__entry(
+		__field(unsigned int,	sequence)
+		__field(u32,		length)
+		__field(bool,		no_buffer)
+	),
+	TP_fast_assign(
+		__entry->sequence = sequence;
+		__entry->length = length;
+		__entry->no_buffer = no_buffer;
+	),
+	TP_printk("seq=%u len=%u reason=%s", __entry->sequence,
+		  __entry->length,
+		  __entry->no_buffer ? "no-buffer" : "unsupported-mode")
+);
+
+#endif /* _PSVR2_TRACE_H_ */
+
+/* This part must be outside the include guard. */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE psvr2_trace
+#include <trace/define_trace.h>
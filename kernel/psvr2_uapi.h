@@ -2,7 +2,7 @@
 /*
  * PSVR2 userspace ABI.
  *
- * The character device /dev/psvr2-pose delivers a stream of fixed-size
+ * The character device /dev/psvr2-pose<N> (N = headset index) delivers a stream of fixed-size
  * struct psvr2_pose_sample records (read() returns whole samples; poll()
  * signals POLLIN when samples are available). These come from the headset's
  * onboard 6DoF tracker (USB interface 3, "SLA" packets).
@@ -45,7 +45,7 @@ struct psvr2_pose_sample {
 #define PSVR2_POSE_FLAG_VALID	(1u << 0)	/* well-formed SLP record */
 
 /*
- * Eye / gaze tracking. The character device /dev/psvr2-gaze delivers a stream
+ * Eye / gaze tracking. The character device /dev/psvr2-gaze<N> delivers a stream
  * of struct psvr2_gaze_sample records (read() returns whole samples; poll()
  * signals POLLIN). Only the well-understood fields are surfaced.
  *
@@ -10,20 +10,34 @@
  * Copyright (C) 2026 PSVR2 Linux project
  */
 #include <linux/debugfs.h>
+#include <linux/idr.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/usb.h>
 
 #include "psvr2.h"
 #include "psvr2_protocol.h"
 
+#define CREATE_TRACE_POINTS
+#include "psvr2_trace.h"
+
 /* Registry of live per-headset contexts, keyed by struct usb_device. */
 static LIST_HEAD(psvr2_devices);
 static DEFINE_MUTEX(psvr2_registry_lock);
 
+/*
+ * Headset indices name the per-device nodes (psvr2-pose<N>, psvr2-gaze<N>) and
+ * debugfs directories (psvr2/<N>/). The lowest free index is reused, so a lone
+ * headset is always 0.
+ */
+static DEFINE_IDA(psvr2_ida);
+static struct dentry *psvr2_debugfs_root;
+
 static void psvr2_device_release(struct kref *kref)
 	__releases(&psvr2_registry_lock)
 {
@@ -32,15 +46,35 @@ static void psvr2_device_release(struct kref *kref)
 	list_del(&psvr2->node);
 	mutex_unlock(&psvr2_registry_lock);
 
+	psvr2_watchdog_stop(psvr2);
+	psvr2_stats_stop(psvr2);
 	debugfs_remove_recursive(psvr2->debugfs_dir);
+	ida_free(&psvr2_ida, psvr2->index);
 	usb_put_dev(psvr2->udev);
+	mutex_destroy(&psvr2->state_lock);
 	mutex_destroy(&psvr2->ctrl_lock);
 	kfree(psvr2);
 }
 
+/* debugfs: resume count and time from resume to the first pose. */
+static int psvr2_resume_show(struct seq_file *m, void *v)
+{
+	struct psvr2_device *psvr2 = m->private;
+
+	seq_printf(m, "resumes %u\n", READ_ONCE(psvr2->resumes));
+	seq_printf(m, "waiting_for_pose %d\n",
+		   atomic64_read(&psvr2->resume_ns) != 0);
+	seq_printf(m, "first_pose_us %u\n", READ_ONCE(psvr2->first_pose_us));
+	seq_printf(m, "first_pose_max_us %u\n",
+		   READ_ONCE(psvr2->first_pose_max_us));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(psvr2_resume);
+
 struct psvr2_device *psvr2_device_get(struct usb_device *udev)
 {
 	struct psvr2_device *psvr2;
+	char name[12];
 
 	mutex_lock(&psvr2_registry_lock);
 	list_for_each_entry(psvr2, &psvr2_devices, node) {
@@ -56,15 +90,44 @@ struct psvr2_device *psvr2_device_get(struct usb_device *udev)
 		return NULL;
 	}
 
+	psvr2->index = ida_alloc(&psvr2_ida, GFP_KERNEL);
+	if (psvr2->index < 0) {
+		mutex_unlock(&psvr2_registry_lock);
+		kfree(psvr2);
+		return NULL;
+	}
+
 	kref_init(&psvr2->kref);
 	mutex_init(&psvr2->ctrl_lock);
+	mutex_init(&psvr2->state_lock);
 	psvr2->udev = usb_get_dev(udev);
 	psvr2->brightness = 31;
-	psvr2->debugfs_dir = debugfs_create_dir("psvr2", NULL);
+	snprintf(name, sizeof(name), "%d", psvr2->index);
+	psvr2->debugfs_dir = debugfs_create_dir(name, psvr2_debugfs_root);
+	debugfs_create_file("resume", 0400, psvr2->debugfs_dir, psvr2,
+			    &psvr2_resume_fops);
+
+	if (psvr2_stats_start(psvr2))
+		goto err_free;
+	if (psvr2_watchdog_start(psvr2))
+		goto err_stats;
+
 	list_add(&psvr2->node, &psvr2_devices);
 	mutex_unlock(&psvr2_registry_lock);
 
 	return psvr2;
+
+err_stats:
+	psvr2_stats_stop(psvr2);
+err_free:
+	mutex_unlock(&psvr2_registry_lock);
+	debugfs_remove_recursive(psvr2->debugfs_dir);
+	ida_free(&psvr2_ida, psvr2->index);
+	usb_put_dev(psvr2->udev);
+	mutex_destroy(&psvr2->state_lock);
+	mutex_destroy(&psvr2->ctrl_lock);
+	kfree(psvr2);
+	return NULL;
 }
 
 void psvr2_device_put(struct psvr2_device *psvr2)
@@ -82,37 +145,42 @@ static int psvr2_control(struct psvr2_device *psvr2, bool in, u16 report_id,
 			 u16 subcmd, void *data, u32 len)
 {
 	struct sie_ctrl_pkt *pkt;
-	int ret;
-
-	if (len > PSVR2_CTRL_DATA_MAX)
-		return -EINVAL;
+	ktime_t start = 0;
+	int size, ret;
 
 	pkt = kzalloc(sizeof(*pkt), GFP_KERNEL);
 	if (!pkt)
 		return -ENOMEM;
 
-	pkt->report_id = cpu_to_le16(report_id);
-	pkt->subcmd = cpu_to_le16(subcmd);
-	pkt->len = cpu_to_le32(len);
+	size = psvr2_parse_build_ctrl(pkt, report_id, subcmd, in ? NULL : data,
+				      len);
+	if (size < 0) {
+		kfree(pkt);
+		return size;
+	}
 
 	mutex_lock(&psvr2->ctrl_lock);
+	/* Only pay for the clock reads while someone is tracing. */
+	if (trace_psvr2_control_enabled())
+		start = ktime_get();
 	if (in) {
 		ret = usb_control_msg_recv(psvr2->udev, 0, 0x01,
 					   USB_DIR_IN | USB_TYPE_VENDOR |
 						   USB_RECIP_ENDPOINT,
-					   report_id, 0, pkt, len + 8, 100,
+					   report_id, 0, pkt, size, 100,
 					   GFP_KERNEL);
 		if (!ret && len)
 			memcpy(data, pkt->data, len);
 	} else {
-		if (len)
-			memcpy(pkt->data, data, len);
 		ret = usb_control_msg_send(psvr2->udev, 0, 0x09,
 					   USB_DIR_OUT | USB_TYPE_VENDOR |
 						   USB_RECIP_ENDPOINT,
-					   report_id, 0, pkt, len + 8, 100,
+					   report_id, 0, pkt, size, 100,
 					   GFP_KERNEL);
 	}
+	if (start)
+		trace_psvr2_control(in, report_id, subcmd, len, ret,
+				    ktime_to_ns(ktime_get() - start));
 	mutex_unlock(&psvr2->ctrl_lock);
 
 	kfree(pkt);
@@ -131,6 +199,75 @@ int psvr2_control_get(struct psvr2_device *psvr2, u16 report_id, u16 subcmd,
 	return psvr2_control(psvr2, true, report_id, subcmd, data, len);
 }
 
+/*
+ * Stall recovery for a single-URB stream: stop it, put the interface back
+ * through SET_INTERFACE (which also resets the endpoint's data toggle) and
+ * start receiving again. Called from the watchdog work with state_lock held.
+ */
+int psvr2_reset_interface(struct psvr2_device *psvr2, struct urb *urb,
+			  u8 ifnum, u8 alt)
+{
+	int ret;
+
+	lockdep_assert_held(&psvr2->state_lock);
+
+	usb_kill_urb(urb);
+
+	ret = usb_set_interface(psvr2->udev, ifnum, alt);
+	if (ret)
+		dev_warn(&psvr2->udev->dev,
+			 "IF%u: SET_INTERFACE alt %u failed: %d\n", ifnum, alt,
+			 ret);
+
+	ret = usb_submit_urb(urb, GFP_KERNEL);
+	if (ret)
+		dev_err(&psvr2->udev->dev, "IF%u: failed to resubmit URB: %d\n",
+			ifnum, ret);
+	return ret;
+}
+
+/*
+ * Resume a single-URB stream. After a reset-resume the device has lost its
+ * interface state, so the alt setting is put back first (as at probe).
+ */
+int psvr2_resume_urb(struct psvr2_device *psvr2, struct urb *urb, u8 ifnum,
+		     u8 alt, bool reset)
+{
+	int ret;
+
+	if (reset) {
+		ret = usb_set_interface(psvr2->udev, ifnum, alt);
+		if (ret)
+			dev_warn(&psvr2->udev->dev,
+				 "IF%u: SET_INTERFACE alt %u failed: %d\n",
+				 ifnum, alt, ret);
+	}
+
+	ret = usb_submit_urb(urb, GFP_NOIO);
+	if (ret)
+		dev_err(&psvr2->udev->dev, "IF%u: failed to resubmit URB: %d\n",
+			ifnum, ret);
+	return ret;
+}
+
+/* Called for every pose record; stops the time-to-first-pose clock. */
+void psvr2_pm_pose_arrived(struct psvr2_device *psvr2)
+{
+	s64 start;
+	u32 us;
+
+	if (likely(!atomic64_read(&psvr2->resume_ns)))
+		return;
+	start = atomic64_xchg(&psvr2->resume_ns, 0);
+	if (!start)
+		return;
+
+	us = div_u64(ktime_get_ns() - start, NSEC_PER_USEC);
+	WRITE_ONCE(psvr2->first_pose_us, us);
+	if (us > psvr2->first_pose_max_us)
+		WRITE_ONCE(psvr2->first_pose_max_us, us);
+}
+
 /* sysfs: panel brightness, a single byte 0..31 (report 0x12, subcmd 1). */
 static ssize_t brightness_show(struct device *dev,
 			       struct device_attribute *attr, char *buf)
@@ -163,16 +300,52 @@ static ssize_t brightness_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(brightness);
 
+/* sysfs: the headset index, so userspace can group interfaces and nodes. */
+static ssize_t index_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct psvr2_device *psvr2 = usb_get_intfdata(to_usb_interface(dev));
+
+	return sysfs_emit(buf, "%d\n", psvr2->index);
+}
+static DEVICE_ATTR_RO(index);
+
 static struct attribute *psvr2_attrs[] = {
 	&dev_attr_brightness.attr,
+	&dev_attr_index.attr,
+	NULL,
+};
+
+static const struct attribute_group psvr2_group = {
+	.attrs = psvr2_attrs,
+};
+
+/*
+ * dev_groups are created on every interface we bind; groups whose state lives
+ * with the status stream use this to appear on IF7 only.
+ */
+umode_t psvr2_status_attr_visible(struct kobject *kobj, struct attribute *attr,
+				  int n)
+{
+	struct usb_interface *intf = to_usb_interface(kobj_to_dev(kobj));
+
+	if (intf->cur_altsetting->desc.bInterfaceNumber != PSVR2_IF_STATUS)
+		return 0;
+	return attr->mode;
+}
+
+static const struct attribute_group *psvr2_groups[] = {
+	&psvr2_group,
+	&psvr2_status_group,
+	&psvr2_power_group,
 	NULL,
 };
-ATTRIBUTE_GROUPS(psvr2);
 
 /*
  * Bring up the status/IMU interface (IF7): the IIO and input devices are
  * devm-managed against &intf->dev, so they unwind automatically on probe
- * failure or disconnect; only the status URBs need explicit teardown.
+ * failure or disconnect; the low-power policy and the status URBs need
+ * explicit teardown.
  */
 static int psvr2_probe_status(struct psvr2_device *psvr2,
 			      struct usb_interface *intf)
@@ -187,7 +360,14 @@ static int psvr2_probe_status(struct psvr2_device *psvr2,
 	if (ret)
 		return ret;
 
-	return psvr2_status_start(psvr2, intf);
+	ret = psvr2_power_start(psvr2, intf);
+	if (ret)
+		return ret;
+
+	ret = psvr2_status_start(psvr2, intf);
+	if (ret)
+		psvr2_power_stop(psvr2);
+	return ret;
 }
 
 static int psvr2_probe(struct usb_interface *intf,
@@ -213,9 +393,13 @@ static int psvr2_probe(struct usb_interface *intf,
 		break;
 	case PSVR2_IF_CAMERA:
 		ret = psvr2_camera_start(psvr2, intf);
+		if (!ret)
+			psvr2_power_sync(psvr2);
 		break;
 	case PSVR2_IF_GAZE:
 		ret = psvr2_gaze_start(psvr2, intf);
+		if (!ret)
+			psvr2_power_sync(psvr2);
 		break;
 	case PSVR2_IF_LD:
 	case PSVR2_IF_RP:
@@ -249,6 +433,7 @@ static void psvr2_disconnect(struct usb_interface *intf)
 	switch (ifnum) {
 	case PSVR2_IF_STATUS:
 		psvr2_status_stop(psvr2);
+		psvr2_power_stop(psvr2);
 		break;
 	case PSVR2_IF_SLAM:
 		psvr2_slam_stop(psvr2);
@@ -272,6 +457,111 @@ static void psvr2_disconnect(struct usb_interface *intf)
 	dev_info(&intf->dev, "PSVR2 interface %u removed\n", ifnum);
 }
 
+/*
+ * Power management. usbcore runs these per interface, so like probe/disconnect
+ * they dispatch on the interface number. Suspend and pre_reset only park the
+ * URBs; everything userspace holds (char devices, open files, the V4L2 queue,
+ * IIO/input) stays registered, and resume restarts the streams in place.
+ */
+static void psvr2_quiesce(struct usb_interface *intf)
+{
+	struct psvr2_device *psvr2 = usb_get_intfdata(intf);
+	u8 ifnum = intf->cur_altsetting->desc.bInterfaceNumber;
+
+	if (!psvr2)
+		return;
+
+	psvr2->pm_armed = true;
+
+	switch (ifnum) {
+	case PSVR2_IF_STATUS:
+		psvr2_status_suspend(psvr2);
+		break;
+	case PSVR2_IF_SLAM:
+		psvr2_slam_suspend(psvr2);
+		break;
+	case PSVR2_IF_CAMERA:
+		psvr2_camera_suspend(psvr2);
+		break;
+	case PSVR2_IF_GAZE:
+		psvr2_gaze_suspend(psvr2);
+		break;
+	case PSVR2_IF_LD:
+	case PSVR2_IF_RP:
+	case PSVR2_IF_VD:
+		psvr2_aux_suspend(psvr2, intf);
+		break;
+	}
+}
+
+static int psvr2_restart(struct usb_interface *intf, bool reset)
+{
+	struct psvr2_device *psvr2 = usb_get_intfdata(intf);
+	u8 ifnum = intf->cur_altsetting->desc.bInterfaceNumber;
+	int ret = 0;
+
+	if (!psvr2)
+		return 0;
+
+	/* The first interface back starts the time-to-first-pose clock. */
+	if (psvr2->pm_armed) {
+		psvr2->pm_armed = false;
+		WRITE_ONCE(psvr2->resumes, psvr2->resumes + 1);
+		atomic64_set(&psvr2->resume_ns, ktime_get_ns());
+	}
+
+	switch (ifnum) {
+	case PSVR2_IF_STATUS:
+		ret = psvr2_status_resume(psvr2, reset);
+		/* The panel comes back at its default brightness. */
+		psvr2_control_set(psvr2, PSVR2_REPORT_SET_BRIGHTNESS, 1,
+				  &psvr2->brightness, sizeof(psvr2->brightness));
+		break;
+	case PSVR2_IF_SLAM:
+		ret = psvr2_slam_resume(psvr2, reset);
+		break;
+	case PSVR2_IF_CAMERA:
+		ret = psvr2_camera_resume(psvr2, reset);
+		break;
+	case PSVR2_IF_GAZE:
+		ret = psvr2_gaze_resume(psvr2, reset);
+		break;
+	case PSVR2_IF_LD:
+	case PSVR2_IF_RP:
+	case PSVR2_IF_VD:
+		ret = psvr2_aux_resume(psvr2, intf, reset);
+		break;
+	}
+	return ret;
+}
+
+static int psvr2_suspend(struct usb_interface *intf, pm_message_t message)
+{
+	psvr2_quiesce(intf);
+	return 0;
+}
+
+static int psvr2_resume(struct usb_interface *intf)
+{
+	return psvr2_restart(intf, false);
+}
+
+static int psvr2_reset_resume(struct usb_interface *intf)
+{
+	return psvr2_restart(intf, true);
+}
+
+static int psvr2_pre_reset(struct usb_interface *intf)
+{
+	psvr2_quiesce(intf);
+	return 0;
+}
+
+static int psvr2_post_reset(struct usb_interface *intf)
+{
+	return psvr2_restart(intf, true);
+}
+
 static const struct usb_device_id psvr2_id_table[] = {
 	{ USB_DEVICE_INTERFACE_NUMBER(PSVR2_VENDOR_ID, PSVR2_PRODUCT_ID,
 				      PSVR2_IF_STATUS) },
@@ -296,9 +586,35 @@ static struct usb_driver psvr2_driver = {
 	.id_table	= psvr2_id_table,
 	.probe		= psvr2_probe,
 	.disconnect	= psvr2_disconnect,
+	.suspend	= psvr2_suspend,
+	.resume		= psvr2_resume,
+	.reset_resume	= psvr2_reset_resume,
+	.pre_reset	= psvr2_pre_reset,
+	.post_reset	= psvr2_post_reset,
 	.dev_groups	= psvr2_groups,
 };
-module_usb_driver(psvr2_driver);
+
+static int __init psvr2_init(void)
+{
+	int ret;
+
+	psvr2_debugfs_root = debugfs_create_dir("psvr2", NULL);
+
+	ret = usb_register(&psvr2_driver);
+	if (ret)
+		debugfs_remove_recursive(psvr2_debugfs_root);
+	return ret;
+}
+
+static void __exit psvr2_exit(void)
+{
+	usb_deregister(&psvr2_driver);
+	debugfs_remove_recursive(psvr2_debugfs_root);
+	ida_destroy(&psvr2_ida);
+}
+
+module_init(psvr2_init);
+module_exit(psvr2_exit);
 
 MODULE_AUTHOR("PSVR2 Linux project");
 MODULE_DESCRIPTION("Sony PlayStation VR2 headset driver (IMU, buttons, control)");
@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PSVR2 Linux driver — stream stall watchdog.
+ *
+ * The URB completions just resubmit forever, so a tracker that stops emitting
+ * SLAM records or a gaze stream that lapses despite the keepalive would go
+ * unnoticed and userspace would see a frozen pose. Each watched stream feeds
+ * the watchdog on every record; a delayed work item checks for silence longer
+ * than stall_ms and walks a staged recovery, one stage per stall period:
+ *
+ *   1. re-send the camera-mode and gaze-enable reports (cheap, ep0 only);
+ *   2. kill the stream's URB, re-select its alt setting and resubmit.
+ *
+ * The stages then repeat until data flows again. A stream is only judged while
+ * it is enabled (bound and not deliberately paused) and has delivered at least
+ * once; SLAM and gaze are additionally only expected while the headset is worn
+ * with a live DP link, since the tracker legitimately idles otherwise.
+ *
+ * The work only runs while some stream is enabled: enabling one schedules it
+ * and it stops re-arming once none is.
+ *
+ * Stall counts and outage durations are in debugfs (psvr2/<N>/watchdog); the
+ * stall threshold is psvr2/<N>/watchdog_stall_ms.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <linux/debugfs.h>
+#include <linux/jiffies.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+#include "psvr2.h"
+
+enum psvr2_wd_stage {
+	PSVR2_WD_IDLE,
+	PSVR2_WD_RESEND,	/* camera-mode + gaze-enable reports */
+	PSVR2_WD_RESET,		/* kill URB, SET_INTERFACE, resubmit */
+	PSVR2_WD_NUM_STAGES = PSVR2_WD_RESET,
+};
+
+struct psvr2_wd_stream {
+	bool		enabled;	/* stream bound and not paused */
+	bool		armed;		/* has delivered since enabled */
+	bool		stalled;
+	unsigned int	stage;
+	unsigned long	last_rx;	/* jiffies, written lock-free */
+	unsigned long	last_action;	/* arm time or last recovery step */
+	unsigned long	stall_start;	/* last_rx when the stall began */
+
+	u64		stalls;
+	u64		recoveries;
+	u64		attempts;
+	unsigned int	last_outage_ms;
+	unsigned int	max_outage_ms;
+};
+
+struct psvr2_watchdog {
+	struct psvr2_device	*psvr2;
+	struct delayed_work	work;
+	spinlock_t		lock;		/* protects streams[] slow path */
+	u32			stall_ms;
+	struct psvr2_wd_stream	streams[PSVR2_STREAM_COUNT];
+	struct dentry		*dentry;
+	struct dentry		*stall_dentry;
+};
+
+static const char *const psvr2_wd_stream_names[PSVR2_STREAM_COUNT] = {
+	[PSVR2_STREAM_STATUS]	= "status",
+	[PSVR2_STREAM_SLAM]	= "slam",
+	[PSVR2_STREAM_GAZE]	= "gaze",
+	[PSVR2_STREAM_CAMERA]	= "camera",
+};
+
+static void psvr2_watchdog_schedule(struct psvr2_watchdog *wd)
+{
+	schedule_delayed_work(&wd->work,
+			      msecs_to_jiffies(PSVR2_WATCHDOG_PERIOD_MS));
+}
+
+/* Called from URB completions for every record delivered. */
+void psvr2_watchdog_feed(struct psvr2_device *psvr2, enum psvr2_stream stream)
+{
+	struct psvr2_watchdog *wd = psvr2->watchdog;
+	struct psvr2_wd_stream *ws;
+	unsigned long now = jiffies, flags;
+
+	if (!wd)
+		return;
+	ws = &wd->streams[stream];
+
+	WRITE_ONCE(ws->last_rx, now);
+	if (likely(READ_ONCE(ws->armed) && !READ_ONCE(ws->stalled)))
+		return;
+
+	spin_lock_irqsave(&wd->lock, flags);
+	if (ws->stalled) {
+		unsigned int ms = jiffies_to_msecs(now - ws->stall_start);
+
+		ws->stalled = false;
+		ws->stage = PSVR2_WD_IDLE;
+		ws->recoveries++;
+		ws->last_outage_ms = ms;
+		ws->max_outage_ms = max(ws->max_outage_ms, ms);
+		dev_info(&psvr2->udev->dev, "%s stream recovered after %u ms\n",
+			 psvr2_wd_stream_names[stream], ms);
+	}
+	if (ws->enabled && !ws->armed) {
+		ws->armed = true;
+		ws->last_action = now;
+	}
+	spin_unlock_irqrestore(&wd->lock, flags);
+}
+
+/* Streams call this when they start, stop, pause or resume. */
+void psvr2_watchdog_enable(struct psvr2_device *psvr2, enum psvr2_stream stream,
+			   bool enable)
+{
+	struct psvr2_watchdog *wd = psvr2->watchdog;
+	struct psvr2_wd_stream *ws;
+	unsigned long flags;
+
+	if (!wd)
+		return;
+	ws = &wd->streams[stream];
+
+	spin_lock_irqsave(&wd->lock, flags);
+	ws->enabled = enable;
+	ws->armed = false;
+	ws->stalled = false;
+	ws->stage = PSVR2_WD_IDLE;
+	spin_unlock_irqrestore(&wd->lock, flags);
+
+	/* A no-op while pending; a running pass that saw none enabled stops. */
+	if (enable)
+		psvr2_watchdog_schedule(wd);
+}
+
+static bool psvr2_watchdog_expected(struct psvr2_device *psvr2,
+				    enum psvr2_stream stream, bool live)
+{
+	switch (stream) {
+	case PSVR2_STREAM_SLAM:
+	case PSVR2_STREAM_GAZE:
+		return live;
+	case PSVR2_STREAM_STATUS:
+		return true;
+	default:
+		return false;	/* camera frames follow V4L2 demand */
+	}
+}
+
+/* Caller holds state_lock. */
+static void psvr2_watchdog_recover(struct psvr2_device *psvr2,
+				   enum psvr2_stream stream, unsigned int stage)
+{
+	if (stage == PSVR2_WD_RESEND) {
+		psvr2_camera_resend_mode(psvr2);
+		psvr2_gaze_resend(psvr2);
+		return;
+	}
+
+	switch (stream) {
+	case PSVR2_STREAM_STATUS:
+		psvr2_status_reset(psvr2);
+		break;
+	case PSVR2_STREAM_SLAM:
+		psvr2_slam_reset(psvr2);
+		break;
+	case PSVR2_STREAM_GAZE:
+		psvr2_gaze_reset(psvr2);
+		break;
+	default:
+		break;
+	}
+}
+
+static void psvr2_watchdog_work(struct work_struct *work)
+{
+	struct psvr2_watchdog *wd =
+		container_of(to_delayed_work(work), struct psvr2_watchdog, work);
+	struct psvr2_device *psvr2 = wd->psvr2;
+	unsigned long stall = msecs_to_jiffies(READ_ONCE(wd->stall_ms));
+	unsigned long now = jiffies;
+	enum psvr2_stream s;
+	bool live, any = false;
+
+	mutex_lock(&psvr2->state_lock);
+	live = psvr2_status_headset_live(psvr2);
+
+	for (s = 0; s < PSVR2_STREAM_COUNT; s++) {
+		struct psvr2_wd_stream *ws = &wd->streams[s];
+		unsigned int stage;
+		unsigned long flags;
+
+		spin_lock_irqsave(&wd->lock, flags);
+		any |= ws->enabled;
+		if (!ws->enabled || !psvr2_watchdog_expected(psvr2, s, live)) {
+			/* Idle by design; re-arm on the next record. */
+			ws->armed = false;
+			ws->stalled = false;
+			ws->stage = PSVR2_WD_IDLE;
+			spin_unlock_irqrestore(&wd->lock, flags);
+			continue;
+		}
+		if (!ws->armed ||
+		    time_before(now, READ_ONCE(ws->last_rx) + stall) ||
+		    time_before(now, ws->last_action + stall)) {
+			spin_unlock_irqrestore(&wd->lock, flags);
+			continue;
+		}
+
+		if (!ws->stalled) {
+			ws->stalled = true;
+			ws->stall_start = READ_ONCE(ws->last_rx);
+			ws->stalls++;
+		}
+		ws->stage = ws->stage % PSVR2_WD_NUM_STAGES + 1;
+		ws->last_action = now;
+		ws->attempts++;
+		stage = ws->stage;
+		spin_unlock_irqrestore(&wd->lock, flags);
+
+		dev_warn_ratelimited(&psvr2->udev->dev,
+				     "%s stream stalled, recovery stage %u\n",
+				     psvr2_wd_stream_names[s], stage);
+		psvr2_watchdog_recover(psvr2, s, stage);
+	}
+	mutex_unlock(&psvr2->state_lock);
+
+	/* Nothing to watch: psvr2_watchdog_enable() starts it again. */
+	if (any)
+		psvr2_watchdog_schedule(wd);
+}
+
+/* debugfs: one line per stream. */
+static int psvr2_watchdog_show(struct seq_file *m, void *v)
+{
+	struct psvr2_watchdog *wd = m->private;
+	unsigned long now = jiffies;
+	enum psvr2_stream s;
+
+	for (s = 0; s < PSVR2_STREAM_COUNT; s++) {
+		struct psvr2_wd_stream ws;
+		unsigned long flags;
+
+		spin_lock_irqsave(&wd->lock, flags);
+		ws = wd->streams[s];
+		spin_unlock_irqrestore(&wd->lock, flags);
+
+		seq_printf(m,
+			   "%-7s enabled=%d armed=%d stalled=%d stage=%u idle_ms=%u stalls=%llu attempts=%llu recoveries=%llu last_outage_ms=%u max_outage_ms=%u\n",
+			   psvr2_wd_stream_names[s], ws.enabled, ws.armed,
+			   ws.stalled, ws.stage,
+			   ws.armed ? jiffies_to_msecs(now - ws.last_rx) : 0,
+			   ws.stalls, ws.attempts, ws.recoveries,
+			   ws.last_outage_ms, ws.max_outage_ms);
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(psvr2_watchdog);
+
+int psvr2_watchdog_start(struct psvr2_device *psvr2)
+{
+	struct psvr2_watchdog *wd;
+
+	wd = kzalloc(sizeof(*wd), GFP_KERNEL);
+	if (!wd)
+		return -ENOMEM;
+
+	wd->psvr2 = psvr2;
+	wd->stall_ms = PSVR2_WATCHDOG_STALL_MS;
+	spin_lock_init(&wd->lock);
+	INIT_DELAYED_WORK(&wd->work, psvr2_watchdog_work);
+
+	wd->dentry = debugfs_create_file("watchdog", 0400, psvr2->debugfs_dir,
+					 wd, &psvr2_watchdog_fops);
+	wd->stall_dentry = debugfs_create_u32("watchdog_stall_ms", 0600,
+					      psvr2->debugfs_dir,
+					      &wd->stall_ms);
+
+	psvr2->watchdog = wd;
+	return 0;
+}
+
+void psvr2_watchdog_stop(struct psvr2_device *psvr2)
+{
+	struct psvr2_watchdog *wd = psvr2->watchdog;
+
+	if (!wd)
+		return;
+
+	/* cancel_delayed_work_sync() also stops the work re-arming itself. */
+	cancel_delayed_work_sync(&wd->work);
+	debugfs_remove(wd->stall_dentry);
+	debugfs_remove(wd->dentry);
+	psvr2->watchdog = NULL;
+	kfree(wd);
+}
@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Run the parser KUnit suite (kernel/psvr2_parse_test.c) on UML: no headset,
+# no USB, no root. Links kernel/ into the given kernel tree as
+# drivers/misc/psvr2 (once; the tree's Kconfig/Makefile get one line each),
+# then hands over to kunit.py with kernel/.kunitconfig.
+#
+# Usage:  scripts/kunit.sh /path/to/linux [kunit.py run options...]
+set -eu
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+SRC="$(cd "${SCRIPT_DIR}/../kernel" && pwd)"
+
+[ $# -ge 1 ] || { echo "usage: $0 /path/to/linux [kunit.py options...]" >&2; exit 1; }
+KSRC="$(cd "$1" && pwd)"; shift
+[ -x "${KSRC}/tools/testing/kunit/kunit.py" ] || \
+	{ echo "error: ${KSRC} is not a kernel source tree" >&2; exit 1; }
+
+LINK="${KSRC}/drivers/misc/psvr2"
+if [ ! -e "${LINK}" ]; then
+	ln -s "${SRC}" "${LINK}"
+	echo ">> linked ${LINK} -> ${SRC}"
+fi
+grep -q 'drivers/misc/psvr2/Kconfig' "${KSRC}/drivers/misc/Kconfig" || \
+	sed -i '$i source "drivers/misc/psvr2/Kconfig"' "${KSRC}/drivers/misc/Kconfig"
+grep -q 'psvr2/' "${KSRC}/drivers/misc/Makefile" || \
+	echo 'obj-y				+= psvr2/' >> "${KSRC}/drivers/misc/Makefile"
+
+cd "${KSRC}"
+exec ./tools/testing/kunit/kunit.py run --kunitconfig=drivers/misc/psvr2 "$@"
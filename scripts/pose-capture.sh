@@ -3,7 +3,8 @@
 #
 # Capture the 6DoF pose stream while performing a known motion sequence, to
 # verify the position/quaternion axis convention. Holds the 4K display (so the
-# headset is in VR mode and the tracker runs) and logs /dev/psvr2-pose.
+# headset is in VR mode and the tracker runs), records every stream with
+# psvr2-record and prints the poses from the recording as text.
 #
 # MUST run from a text console (Ctrl+Alt+F3) as root.
 #
@@ -14,12 +15,14 @@ HOLD="${1:-45}"
 SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 TOOLS="${SCRIPT_DIR}/../userspace/tools"
 KMS="${TOOLS}/psvr2-kms-modeset"
-LOGTOOL="${TOOLS}/psvr2-pose-log"
+LIB="${SCRIPT_DIR}/../userspace/lib"
+RECTOOL="${LIB}/psvr2-record"
+REC=/tmp/pose-capture.psvr2rec
 OUT=/tmp/pose-log.txt
 
 [ "$(id -u)" -eq 0 ] || { echo "run as root from a TTY"; exit 1; }
 [ -x "$KMS" ] || make -C "$TOOLS" psvr2-kms-modeset >/dev/null || exit 1
-[ -x "$LOGTOOL" ] || make -C "$TOOLS" psvr2-pose-log >/dev/null || exit 1
+[ -x "$RECTOOL" ] || make -C "$LIB" psvr2-record >/dev/null || exit 1
 
 cat <<EOF
 
@@ -46,12 +49,13 @@ if ! kill -0 "$MT" 2>/dev/null; then
 	echo "!! display didn't come up:"; cat /tmp/kms.log; exit 1
 fi
 
-echo ">> LOGGING POSE for ${HOLD}s — do the motion sequence now."
-timeout "$HOLD" "$LOGTOOL" > "$OUT" 2>/dev/null
-chmod 0644 "$OUT" 2>/dev/null
+echo ">> RECORDING for ${HOLD}s — do the motion sequence now."
+"$RECTOOL" -t "$HOLD" "$REC" 2>/dev/null
+"$RECTOOL" -d "$REC" pose > "$OUT"
+chmod 0644 "$REC" "$OUT" 2>/dev/null
 kill "$MT" 2>/dev/null
 wait "$MT" 2>/dev/null
 
-echo ">> captured $(grep -c . "$OUT") lines -> $OUT"
-echo ">> first / last sample:"; sed -n '2p;$p' "$OUT"
+echo ">> captured $(grep -c . "$OUT") poses -> $OUT (all streams: $REC)"
+echo ">> first / last sample:"; sed -n '1p;$p' "$OUT"
 echo ">> done. Ctrl+Alt+F1 back to the desktop."
@@ -1,24 +1,47 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "device_provider.h"
 
+#include <algorithm>
+
 #include "driverlog.h"
+#include "libpsvr2.h"
 
 vr::EVRInitError Psvr2DeviceProvider::Init( vr::IVRDriverContext *pDriverContext )
 {
 	VR_INIT_SERVER_DRIVER_CONTEXT( pDriverContext );
 
-	hmd_ = std::make_unique<Psvr2HmdDriver>();
+	// One HMD per bound headset. Serial numbers must be unique and stable: the
+	// first headset keeps the configured serial (so existing setups carry
+	// over), later ones append their USB serial, or their USB port if the
+	// headset reports none.
+	struct psvr2_device_info devs[PSVR2_MAX_HEADSETS];
+	const int found = psvr2_enumerate( devs, PSVR2_MAX_HEADSETS );
+	const int count = found < 0 ? 0 : std::min( found, PSVR2_MAX_HEADSETS );
+
+	if ( count == 0 )
+	{
+		// Nothing bound yet: register one HMD anyway so SteamVR reports it as
+		// not tracking rather than absent.
+		hmds_.push_back( std::make_unique<Psvr2HmdDriver>() );
+	}
+	for ( int i = 0; i < count; i++ )
+	{
+		std::string suffix;
+		if ( i > 0 )
+			suffix = devs[i].serial[0] ? devs[i].serial : devs[i].port;
+		hmds_.push_back( std::make_unique<Psvr2HmdDriver>( devs[i].index, suffix ) );
+	}
 
-	// Register the headset. The serial number must be unique and stable; we use
-	// a fixed string since the adapter exposes a single headset (see roadmap M7:
-	// multi-headset /dev naming is future work).
-	if ( !vr::VRServerDriverHost()->TrackedDeviceAdded(
-		     hmd_->GetSerialNumber().c_str(),
-		     vr::TrackedDeviceClass_HMD,
-		     hmd_.get() ) )
+	for ( auto &hmd : hmds_ )
 	{
-		DriverLog( "psvr2: failed to add HMD device" );
-		return vr::VRInitError_Driver_Unknown;
+		if ( !vr::VRServerDriverHost()->TrackedDeviceAdded(
+			     hmd->GetSerialNumber().c_str(),
+			     vr::TrackedDeviceClass_HMD,
+			     hmd.get() ) )
+		{
+			DriverLog( "psvr2: failed to add HMD device %s", hmd->GetSerialNumber().c_str() );
+			return vr::VRInitError_Driver_Unknown;
+		}
 	}
 
 	return vr::VRInitError_None;
@@ -26,7 +49,7 @@ vr::EVRInitError Psvr2DeviceProvider::Init( vr::IVRDriverContext *pDriverContext
 
 void Psvr2DeviceProvider::Cleanup()
 {
-	hmd_ = nullptr;
+	hmds_.clear();
 }
 
 const char *const *Psvr2DeviceProvider::GetInterfaceVersions()
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "hmd_device_driver.h"
 #include "openvr_driver.h"
@@ -22,5 +23,5 @@ public:
 	void LeaveStandby() override;
 
 private:
-	std::unique_ptr<Psvr2HmdDriver> hmd_;
+	std::vector<std::unique_ptr<Psvr2HmdDriver>> hmds_;
 };
@@ -15,7 +15,7 @@ static const char *kSettingsSection = "driver_psvr2";
 static constexpr int32_t kEdidVendorId = 0x4DD9;   // "SNY"
 static constexpr int32_t kEdidProductId = 0xA205;
 
-Psvr2HmdDriver::Psvr2HmdDriver()
+Psvr2HmdDriver::Psvr2HmdDriver( int index, const std::string &serial_suffix )
 {
 	// Defaults can be overridden in resources/settings/default.vrsettings.
 	// IVRSettings::GetString has no default-value arg, so read then fall back.
@@ -28,6 +28,8 @@ Psvr2HmdDriver::Psvr2HmdDriver()
 	err = vr::VRSettingsError_None;
 	vr::VRSettings()->GetString( kSettingsSection, "serial_number", buf, sizeof( buf ), &err );
 	serial_number_ = ( err == vr::VRSettingsError_None && buf[0] ) ? buf : "PSVR2-0001";
+	if ( !serial_suffix.empty() )
+		serial_number_ += "-" + serial_suffix;
 
 	const float hz = vr::VRSettings()->GetFloat( kSettingsSection, "display_frequency" );
 	if ( hz > 0.0f )
@@ -50,10 +52,10 @@ Psvr2HmdDriver::Psvr2HmdDriver()
 	direct_mode_ = cfg.direct_mode;
 
 	display_ = std::make_unique<Psvr2DisplayComponent>( cfg );
-	pose_source_ = std::make_unique<PoseSource>();
+	pose_source_ = std::make_unique<PoseSource>( index );
 
 	if ( !pose_source_->HasPose() )
-		DriverLog( "psvr2: /dev/psvr2-pose not found — HMD will not track (is the module loaded?)" );
+		DriverLog( "psvr2: no pose node for headset %d — HMD will not track (is the module loaded?)", index );
 }
 
 vr::EVRInitError Psvr2HmdDriver::Activate( uint32_t unObjectId )
@@ -85,6 +87,7 @@ vr::EVRInitError Psvr2HmdDriver::Activate( uint32_t unObjectId )
 	           direct_mode_ ? "direct (DRM lease)" : "extended desktop",
 	           kEdidVendorId, kEdidProductId );
 
+	pose_source_->ClearInterrupt();
 	active_ = true;
 	pose_thread_ = std::thread( &Psvr2HmdDriver::PoseThread, this );
 	return vr::VRInitError_None;
@@ -92,8 +95,13 @@ vr::EVRInitError Psvr2HmdDriver::Activate( uint32_t unObjectId )
 
 void Psvr2HmdDriver::Deactivate()
 {
+	// The pose thread may be parked in ReadPose(); wake it rather than wait
+	// out the read timeout.
 	if ( active_.exchange( false ) && pose_thread_.joinable() )
+	{
+		pose_source_->Interrupt();
 		pose_thread_.join();
+	}
 	device_index_ = vr::k_unTrackedDeviceIndexInvalid;
 }
 
@@ -54,7 +54,10 @@ private:
 class Psvr2HmdDriver : public vr::ITrackedDeviceServerDriver
 {
 public:
-	Psvr2HmdDriver();
+	// `index` selects the headset (psvr2_enumerate()); < 0 takes the first.
+	// `serial_suffix` is appended to the configured serial number so that
+	// every HMD on a multi-headset host registers under a unique, stable name.
+	explicit Psvr2HmdDriver( int index = -1, const std::string &serial_suffix = {} );
 
 	vr::EVRInitError Activate( uint32_t unObjectId ) override;
 	void Deactivate() override;
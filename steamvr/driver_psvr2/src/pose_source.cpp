@@ -53,7 +53,10 @@ static void RemapPose( const struct psvr2_pose &in, vr::DriverPose_t &out )
 	out.qRotation = QuatMul( kRollCorrection, remapped );
 }
 
-PoseSource::PoseSource() : dev_( psvr2_open() ) {}
+PoseSource::PoseSource( int index )
+	: dev_( index < 0 ? psvr2_open() : psvr2_open_index( index ) )
+{
+}
 
 PoseSource::~PoseSource()
 {
@@ -66,10 +69,18 @@ bool PoseSource::HasPose() const
 	return dev_ && psvr2_has_pose( dev_ );
 }
 
+// Long enough not to spin when the tracker stalls, short enough that a missing
+// node still lets the thread notice Deactivate() without an Interrupt().
+static constexpr int kReadTimeoutMs = 100;
+
 bool PoseSource::ReadPose( vr::DriverPose_t &out )
 {
+	// Only the newest pose matters to the compositor: if the thread fell
+	// behind, drain the backlog and convert just the last sample.
 	struct psvr2_pose sample{};
-	if ( !dev_ || psvr2_read_pose( dev_, &sample, /*block=*/1 ) != 1 )
+	if ( !dev_ ||
+	     psvr2_read_poses_timeout( dev_, &sample, 1, PSVR2_READ_LATEST,
+	                               kReadTimeoutMs ) != 1 )
 		return false;
 
 	out = vr::DriverPose_t{};
@@ -88,3 +99,15 @@ bool PoseSource::ReadPose( vr::DriverPose_t &out )
 
 	return true;
 }
+
+void PoseSource::Interrupt()
+{
+	if ( dev_ )
+		psvr2_interrupt( dev_ );
+}
+
+void PoseSource::ClearInterrupt()
+{
+	if ( dev_ )
+		psvr2_interrupt_clear( dev_ );
+}
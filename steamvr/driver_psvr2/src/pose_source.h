@@ -8,16 +8,24 @@
 class PoseSource
 {
 public:
-	PoseSource();
+	// Opens headset `index` (see psvr2_enumerate()), or the lowest-indexed
+	// headset when index < 0.
+	explicit PoseSource( int index = -1 );
 	~PoseSource();
 
-	// True once the /dev/psvr2-pose node was found and opened.
+	// True once the headset's /dev/psvr2-poseN node was found and opened.
 	bool HasPose() const;
 
 	// Block (up to a short timeout) for the next sample and fill `out` in the
-	// OpenVR frame. Returns true if `out` was updated, false on timeout/EOF.
+	// OpenVR frame. Returns true if `out` was updated, false on timeout/EOF or
+	// after Interrupt().
 	bool ReadPose( vr::DriverPose_t &out );
 
+	// Make ReadPose() return false at once, now and from then on, so the pose
+	// thread can be joined; ClearInterrupt() re-arms it for the next Activate.
+	void Interrupt();
+	void ClearInterrupt();
+
 private:
 	struct psvr2 *dev_;
 };
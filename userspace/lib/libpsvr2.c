@@ -8,30 +8,29 @@
 #include <endian.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
 #include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
 #include <unistd.h>
 
-#include "libpsvr2.h"
-#include "psvr2_uapi.h"		/* kernel wire structs (-I kernel/) */
+#include "libpsvr2_int.h"
+#include "libpsvr2_rec.h"
+#include "libpsvr2_shm.h"
 
-#define POSE_DEV "/dev/psvr2-pose"
-#define GAZE_DEV "/dev/psvr2-gaze"
+#define POSE_DEV "/dev/psvr2-pose%d"
+#define GAZE_DEV "/dev/psvr2-gaze%d"
 #define IIO_DIR  "/sys/bus/iio/devices"
 #define V4L_DIR  "/sys/class/video4linux"
 #define DRV_DIR  "/sys/bus/usb/drivers/psvr2"
 
-struct psvr2 {
-	int	pose_fd;
-	int	gaze_fd;
-	char	imu_dir[300];		/* IIO device dir, "" if none */
-	double	accel_scale;
-	double	gyro_scale;
-	char	cam_path[300];		/* "/dev/videoN", "" if none */
-	char	bright_path[400];	/* brightness sysfs attr, "" if none */
-};
+/* IIO buffer: two seconds of samples. */
+#define IMU_BUF_LEN		4096
+#define IMU_WATERMARK		16
 
 /* ---- small sysfs helpers ------------------------------------------------ */
 
@@ -52,6 +51,19 @@ static int read_file_str(const char *path, char *buf, size_t len)
 	return 0;
 }
 
+static int write_file_str(const char *path, const char *val)
+{
+	int fd = open(path, O_WRONLY);
+	size_t len = strlen(val);
+	ssize_t n;
+
+	if (fd < 0)
+		return -1;
+	n = write(fd, val, len);
+	close(fd);
+	return n == (ssize_t)len ? 0 : -1;
+}
+
 static int name_matches(const char *dir, const char *entry, const char *want)
 {
 	char path[512], name[128];
@@ -62,13 +74,90 @@ static int name_matches(const char *dir, const char *entry, const char *want)
 	return strcmp(name, want) == 0;
 }
 
-static float f_from_le(uint32_t le)
+/*
+ * True if @path resolves to an interface of the USB device at @usb_path, i.e.
+ * its parent directory. Every node the module creates hangs off the interface
+ * that owns it.
+ */
+int psvr2__on_usb_device(const char *path, const char *usb_path)
 {
-	uint32_t host = le32toh(le);
-	float f;
+	char real[PATH_MAX], *slash;
 
-	memcpy(&f, &host, sizeof(f));
-	return f;
+	if (!realpath(path, real))
+		return 0;
+	slash = strrchr(real, '/');
+	if (!slash)
+		return 0;
+	*slash = '\0';
+	return strcmp(real, usb_path) == 0;
+}
+
+/* ---- enumeration -------------------------------------------------------- */
+
+static int by_index(const void *a, const void *b)
+{
+	const struct psvr2_device_info *x = a, *y = b;
+
+	return (x->index > y->index) - (x->index < y->index);
+}
+
+/*
+ * Every interface the module binds carries an "index" attribute naming its
+ * headset; the interfaces of one headset share a USB device parent.
+ */
+int psvr2_enumerate(struct psvr2_device_info *out, int max)
+{
+	struct psvr2_device_info found[PSVR2_MAX_HEADSETS];
+	DIR *d = opendir(DRV_DIR);
+	struct dirent *e;
+	int n = 0;
+
+	if (!d)
+		return errno == ENOENT ? 0 : -1;	/* module not loaded */
+	while ((e = readdir(d))) {
+		char path[400], val[16], real[PATH_MAX], *slash;
+		struct psvr2_device_info *info;
+		int idx, i;
+
+		if (!strchr(e->d_name, ':'))
+			continue;	/* interfaces only, e.g. "3-2:1.7" */
+		snprintf(path, sizeof(path), "%s/%s/index", DRV_DIR, e->d_name);
+		if (read_file_str(path, val, sizeof(val)))
+			continue;
+		idx = atoi(val);
+		for (i = 0; i < n && found[i].index != idx; i++)
+			;
+		if (i < n || n == PSVR2_MAX_HEADSETS)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", DRV_DIR, e->d_name);
+		if (!realpath(path, real))
+			continue;
+		slash = strrchr(real, '/');
+		if (!slash)
+			continue;
+		*slash = '\0';
+
+		info = &found[n];
+		memset(info, 0, sizeof(*info));
+		info->index = idx;
+		slash = strrchr(real, '/');
+		if (snprintf(info->usb_path, sizeof(info->usb_path), "%s",
+			     real) >= (int)sizeof(info->usb_path) ||
+		    snprintf(info->port, sizeof(info->port), "%s",
+			     slash ? slash + 1 : real) >= (int)sizeof(info->port))
+			continue;	/* implausibly deep topology */
+		n++;
+		snprintf(path, sizeof(path), "%s/serial", info->usb_path);
+		if (read_file_str(path, info->serial, sizeof(info->serial)))
+			info->serial[0] = '\0';
+	}
+	closedir(d);
+
+	qsort(found, n, sizeof(found[0]), by_index);
+	for (int i = 0; i < n && i < max; i++)
+		out[i] = found[i];
+	return n;
 }
 
 /* ---- discovery ---------------------------------------------------------- */
@@ -87,8 +176,13 @@ static void find_imu(struct psvr2 *p)
 			continue;
 		if (!name_matches(IIO_DIR, e->d_name, "psvr2_imu"))
 			continue;
+		/* iio:deviceN sits directly below the IF7 interface. */
+		snprintf(path, sizeof(path), "%s/%s/..", IIO_DIR, e->d_name);
+		if (!psvr2__on_usb_device(path, p->usb_path))
+			continue;
 		snprintf(p->imu_dir, sizeof(p->imu_dir), "%s/%s", IIO_DIR,
 			 e->d_name);
+		snprintf(p->imu_dev, sizeof(p->imu_dev), "/dev/%s", e->d_name);
 		snprintf(path, sizeof(path), "%s/in_accel_scale", p->imu_dir);
 		if (!read_file_str(path, val, sizeof(val)))
 			p->accel_scale = strtod(val, NULL);
@@ -108,9 +202,12 @@ static void find_camera(struct psvr2 *p)
 	if (!d)
 		return;
 	while ((e = readdir(d))) {
+		char path[600];
+
 		if (strncmp(e->d_name, "video", 5))
 			continue;
-		if (!name_matches(V4L_DIR, e->d_name, "PlayStation VR2 Cameras"))
+		snprintf(path, sizeof(path), "%s/%s/device", V4L_DIR, e->d_name);
+		if (!psvr2__on_usb_device(path, p->usb_path))
 			continue;
 		snprintf(p->cam_path, sizeof(p->cam_path), "/dev/%s", e->d_name);
 		break;
@@ -130,6 +227,9 @@ static void find_brightness(struct psvr2 *p)
 
 		if (e->d_name[0] == '.' || strlen(e->d_name) > 64)
 			continue;
+		snprintf(path, sizeof(path), "%s/%s", DRV_DIR, e->d_name);
+		if (!psvr2__on_usb_device(path, p->usb_path))
+			continue;
 		snprintf(path, sizeof(path), "%s/%s/brightness", DRV_DIR,
 			 e->d_name);
 		if (access(path, W_OK | R_OK) == 0 ||
@@ -144,35 +244,107 @@ static void find_brightness(struct psvr2 *p)
 
 /* ---- lifecycle ---------------------------------------------------------- */
 
-psvr2_t *psvr2_open(void)
+/*
+ * A handle with no streams open; @info == NULL gives an empty one (no headset
+ * bound). The camera and brightness control are found here, since they don't
+ * go through psvr2d.
+ */
+psvr2_t *psvr2__alloc(const struct psvr2_device_info *info)
 {
 	struct psvr2 *p = calloc(1, sizeof(*p));
 
 	if (!p)
 		return NULL;
 
-	p->pose_fd = open(POSE_DEV, O_RDONLY | O_NONBLOCK);
-	p->gaze_fd = open(GAZE_DEV, O_RDONLY | O_NONBLOCK);
-	find_imu(p);
+	p->index = -1;
+	p->pose_fd = -1;
+	p->gaze_fd = -1;
+	p->imu_fd = -1;
+	p->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	p->orient = psvr2__orient_alloc();
+	p->clock = psvr2__clock_alloc();
+	if (!info)
+		return p;
+
+	p->index = info->index;
+	snprintf(p->usb_path, sizeof(p->usb_path), "%s", info->usb_path);
 	find_camera(p);
 	find_brightness(p);
 	return p;
 }
 
+static psvr2_t *open_device(const struct psvr2_device_info *info)
+{
+	struct psvr2 *p = psvr2__alloc(info);
+	char path[64];
+
+	if (!p || !info)
+		return p;
+
+	snprintf(path, sizeof(path), POSE_DEV, p->index);
+	p->pose_fd = open(path, O_RDONLY | O_NONBLOCK);
+	if (p->pose_fd >= 0)
+		p->history = psvr2__history_alloc();
+	snprintf(path, sizeof(path), GAZE_DEV, p->index);
+	p->gaze_fd = open(path, O_RDONLY | O_NONBLOCK);
+	find_imu(p);
+	return p;
+}
+
+psvr2_t *psvr2_open_index(int index)
+{
+	struct psvr2_device_info devs[PSVR2_MAX_HEADSETS];
+	int n = psvr2_enumerate(devs, PSVR2_MAX_HEADSETS);
+
+	for (int i = 0; i < n && i < PSVR2_MAX_HEADSETS; i++)
+		if (devs[i].index == index)
+			return open_device(&devs[i]);
+	return NULL;
+}
+
+psvr2_t *psvr2_open(void)
+{
+	struct psvr2_device_info devs[PSVR2_MAX_HEADSETS];
+
+	if (psvr2_enumerate(devs, PSVR2_MAX_HEADSETS) > 0)
+		return open_device(&devs[0]);
+	return open_device(NULL);
+}
+
 void psvr2_close(psvr2_t *p)
 {
 	if (!p)
 		return;
+	psvr2_ingest_stop(p);
+	psvr2_imu_stop(p);
+	psvr2_camera_close(p);
+	psvr2__dispatch_free(p);
+	psvr2__shared_free(p);
+	psvr2__replay_free(p);
+	psvr2__history_free(p->history);
+	psvr2__orient_free(p->orient);
+	psvr2__clock_free(p->clock);
+	psvr2__engine_free(p->fusion);
+	psvr2__engine_free(p->gaze_filter);
 	if (p->pose_fd >= 0)
 		close(p->pose_fd);
 	if (p->gaze_fd >= 0)
 		close(p->gaze_fd);
+	if (p->wake_fd >= 0)
+		close(p->wake_fd);
 	free(p);
 }
 
+int psvr2_index(const psvr2_t *p) { return p ? p->index : -1; }
+
 int psvr2_has_pose(const psvr2_t *p) { return p && p->pose_fd >= 0; }
 int psvr2_has_gaze(const psvr2_t *p) { return p && p->gaze_fd >= 0; }
-int psvr2_has_imu(const psvr2_t *p) { return p && p->imu_dir[0] != '\0'; }
+int psvr2_has_imu(const psvr2_t *p)
+{
+	if (p && (p->shared || p->replay))
+		return p->imu_fd >= 0;
+	return p && p->imu_dir[0] != '\0';
+}
 
 const char *psvr2_camera_path(const psvr2_t *p)
 {
@@ -184,92 +356,359 @@ int psvr2_gaze_fd(const psvr2_t *p) { return p ? p->gaze_fd : -1; }
 
 /* ---- streams ------------------------------------------------------------ */
 
-static int read_sample(int fd, void *buf, size_t sz, int block)
+void psvr2_interrupt(psvr2_t *p)
 {
-	ssize_t n;
+	uint64_t one = 1;
+
+	if (p && p->wake_fd >= 0)
+		(void)!write(p->wake_fd, &one, sizeof(one));
+}
+
+void psvr2_interrupt_clear(psvr2_t *p)
+{
+	uint64_t v;
+
+	if (p && p->wake_fd >= 0)
+		(void)!read(p->wake_fd, &v, sizeof(v));
+}
+
+uint64_t psvr2__now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Read up to @max whole samples of @sz bytes in one read(), waiting up to
+ * @timeout_ms (0 = don't wait, -1 = forever) for the first. The fds are
+ * nonblocking, so pending data costs no poll(). Returns the number read, 0 on
+ * timeout, -1 on error or EOF (unplug), or -1 with errno EINTR once the handle
+ * is interrupted.
+ */
+static int read_samples(const psvr2_t *p, int fd, void *buf, size_t sz,
+			int max, int timeout_ms)
+{
+	uint64_t deadline = psvr2__now_ns() +
+			    (timeout_ms > 0 ? timeout_ms * 1000000ull : 0);
+	struct pollfd pfd[2] = {
+		{ .fd = fd, .events = POLLIN },
+		{ .fd = p->wake_fd, .events = POLLIN },
+	};
 
 	if (fd < 0)
 		return -1;
-	if (block) {
-		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	/* The ingestion thread would be robbed of these samples. */
+	if (p->ingest) {
+		errno = EBUSY;
+		return -1;
+	}
+	for (;;) {
+		ssize_t n = read(fd, buf, sz * max);
+		int wait = -1;
 
-		if (poll(&pfd, 1, -1) < 0)
+		if (n > 0)
+			return n / sz;
+		if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+			return -1;
+		if (!timeout_ms)
+			return 0;
+		if (timeout_ms > 0) {
+			uint64_t now = psvr2__now_ns();
+
+			if (now >= deadline)
+				return 0;
+			wait = (deadline - now + 999999) / 1000000;
+		}
+		/* A signal or a racing reader just goes round again. */
+		if (poll(pfd, p->wake_fd >= 0 ? 2 : 1, wait) < 0 &&
+		    errno != EINTR)
+			return -1;
+		if (pfd[1].revents & POLLIN) {
+			errno = EINTR;
 			return -1;
+		}
 	}
-	n = read(fd, buf, sz);
-	if (n == (ssize_t)sz)
-		return 1;
-	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
-		return 0;
-	return -1;
 }
 
-int psvr2_read_pose(psvr2_t *p, struct psvr2_pose *out, int block)
+/*
+ * PSVR2_READ_LATEST: drain the whole backlog through @buf (@cap samples) and
+ * keep only the newest sample, in @last. Returns 1 if there was one, 0 if
+ * none, -1 on error.
+ */
+static int read_latest(const psvr2_t *p, int fd, void *buf, void *last,
+		       size_t sz, int cap, int timeout_ms)
+{
+	int got, have = 0;
+
+	while ((got = read_samples(p, fd, buf, sz, cap,
+				   have ? 0 : timeout_ms)) > 0) {
+		memcpy(last, (char *)buf + (got - 1) * sz, sz);
+		have = 1;
+		if (got < cap)
+			break;
+	}
+	return got < 0 && !have ? -1 : have;
+}
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+/*
+ * On little-endian hosts the wire samples are bit for bit the start of the
+ * host structs, but for the flags word that becomes @valid: a batch converts
+ * as one fixed-size copy per record and the flags.
+ */
+_Static_assert(offsetof(struct psvr2_pose, measured_ns) >=
+	       sizeof(struct psvr2_pose_sample) &&
+	       offsetof(struct psvr2_pose, position) ==
+	       offsetof(struct psvr2_pose_sample, position) &&
+	       offsetof(struct psvr2_pose, orientation) ==
+	       offsetof(struct psvr2_pose_sample, orientation),
+	       "struct psvr2_pose no longer mirrors the wire sample");
+_Static_assert(offsetof(struct psvr2_gaze, measured_ns) >=
+	       sizeof(struct psvr2_gaze_sample) &&
+	       offsetof(struct psvr2_gaze, left) ==
+	       offsetof(struct psvr2_gaze_sample, left) &&
+	       offsetof(struct psvr2_gaze, right) ==
+	       offsetof(struct psvr2_gaze_sample, right) &&
+	       offsetof(struct psvr2_gaze, combined) ==
+	       offsetof(struct psvr2_gaze_sample, combined) &&
+	       sizeof(struct psvr2_eye) == sizeof(struct psvr2_gaze_eye),
+	       "struct psvr2_gaze no longer mirrors the wire sample");
+
+void psvr2__convert_poses(struct psvr2_pose *out,
+			 const struct psvr2_pose_sample *in, int n)
+{
+	for (int k = 0; k < n; k++) {
+		memcpy(&out[k], &in[k], sizeof(*in));
+		out[k].valid = (in[k].flags & PSVR2_POSE_FLAG_VALID) != 0;
+	}
+}
+
+void psvr2__convert_gazes(struct psvr2_gaze *out,
+			 const struct psvr2_gaze_sample *in, int n)
+{
+	for (int k = 0; k < n; k++) {
+		memcpy(&out[k], &in[k], sizeof(*in));
+		out[k].valid = (in[k].flags & PSVR2_GAZE_FLAG_VALID) != 0;
+	}
+}
+#else
+static float f_from_le(uint32_t le)
+{
+	uint32_t host = le32toh(le);
+	float f;
+
+	memcpy(&f, &host, sizeof(f));
+	return f;
+}
+
+/* Field by field, swapping every float. */
+void psvr2__convert_poses(struct psvr2_pose *out,
+			 const struct psvr2_pose_sample *in, int n)
+{
+	for (int k = 0; k < n; k++) {
+		out[k].timestamp_ns = in[k].timestamp_ns;
+		out[k].device_vts_us = in[k].device_vts_us;
+		out[k].valid = (in[k].flags & PSVR2_POSE_FLAG_VALID) != 0;
+		for (int i = 0; i < 3; i++)
+			out[k].position[i] = f_from_le(in[k].position[i]);
+		for (int i = 0; i < 4; i++)
+			out[k].orientation[i] = f_from_le(in[k].orientation[i]);
+	}
+}
+
+static void convert_eye(struct psvr2_eye *dst, const struct psvr2_gaze_eye *src)
 {
-	struct psvr2_pose_sample s;
-	int r;
+	dst->gaze_point_valid = src->gaze_point_valid;
+	dst->gaze_direction_valid = src->gaze_direction_valid;
+	dst->pupil_diameter_valid = src->pupil_diameter_valid;
+	dst->pupil_diameter_mm = f_from_le(src->pupil_diameter_mm);
+	dst->blink_valid = src->blink_valid;
+	dst->blink = src->blink;
+	for (int i = 0; i < 3; i++) {
+		dst->gaze_point_mm[i] = f_from_le(src->gaze_point_mm[i]);
+		dst->gaze_direction[i] = f_from_le(src->gaze_direction[i]);
+	}
+}
+
+void psvr2__convert_gazes(struct psvr2_gaze *out,
+			 const struct psvr2_gaze_sample *in, int n)
+{
+	for (int k = 0; k < n; k++) {
+		const struct psvr2_gaze_sample *s = &in[k];
+		struct psvr2_gaze *o = &out[k];
+
+		o->timestamp_ns = s->timestamp_ns;
+		o->device_timestamp_us = s->device_timestamp_us;
+		o->valid = (s->flags & PSVR2_GAZE_FLAG_VALID) != 0;
+		convert_eye(&o->left, &s->left);
+		convert_eye(&o->right, &s->right);
+		o->combined.gaze_point_valid = s->combined.gaze_point_valid;
+		o->combined.gaze_direction_valid =
+			s->combined.gaze_direction_valid;
+		for (int i = 0; i < 3; i++) {
+			o->combined.gaze_point_mm[i] =
+				f_from_le(s->combined.gaze_point_mm[i]);
+			o->combined.gaze_direction[i] =
+				f_from_le(s->combined.gaze_direction[i]);
+		}
+	}
+}
+#endif
 
-	if (!p || !out)
+/*
+ * What every freshly read batch goes through before the caller sees it, on
+ * the thread that read it. psvr2d has already mapped a shared handle's
+ * samples onto the host clock, and done so from more of them.
+ */
+void psvr2__after_poses(psvr2_t *p, struct psvr2_pose *poses, int n)
+{
+	if (!p->shared)
+		psvr2__clock_poses(p->clock, poses, n);
+	psvr2__history_push(p->history, poses, n);
+	psvr2__fusion_poses(p, poses, n);
+}
+
+void psvr2__after_gazes(psvr2_t *p, struct psvr2_gaze *gazes, int n)
+{
+	if (!p->shared)
+		psvr2__clock_gazes(p->clock, gazes, n);
+	psvr2__gaze_filter(p, gazes, n);
+}
+
+void psvr2__after_imu(psvr2_t *p, struct psvr2_imu_sample *s, int n)
+{
+	if (!p->shared)
+		psvr2__clock_imu(p->clock, s, n);
+	psvr2__orient_push(p->orient, s, n);
+	psvr2__fusion_imu(p, s, n);
+}
+
+/*
+ * Up to @n samples, a buffer-full per read(), until the device has no more
+ * pending; each buffer-full is converted in one pass.
+ */
+int psvr2_read_poses_timeout(psvr2_t *p, struct psvr2_pose *out, int n,
+			     unsigned int flags, int timeout_ms)
+{
+	int got, want, total = 0;
+
+	if (!p || !out || n <= 0)
 		return -1;
-	r = read_sample(p->pose_fd, &s, sizeof(s), block);
-	if (r != 1)
-		return r;
+	if (p->shared || p->replay) {
+		got = p->shared ?
+		      psvr2__shared_read(p, PSVR2_SHM_POSE, out, n, flags,
+					 timeout_ms) :
+		      psvr2__replay_read(p, PSVR2_REC_POSE, out, n, flags,
+					 timeout_ms);
+		if (got > 0)
+			psvr2__after_poses(p, out, got);
+		return got;
+	}
+	if (flags & PSVR2_READ_LATEST) {
+		struct psvr2_pose_sample last;
+
+		got = read_latest(p, p->pose_fd, p->pose_buf, &last,
+				  sizeof(last), POSE_BATCH, timeout_ms);
+		if (got > 0) {
+			psvr2__convert_poses(out, &last, 1);
+			psvr2__after_poses(p, out, 1);
+		}
+		return got;
+	}
 
-	out->timestamp_ns = s.timestamp_ns;
-	out->device_vts_us = s.device_vts_us;
-	out->valid = (s.flags & PSVR2_POSE_FLAG_VALID) != 0;
-	for (int i = 0; i < 3; i++)
-		out->position[i] = f_from_le(s.position[i]);
-	for (int i = 0; i < 4; i++)
-		out->orientation[i] = f_from_le(s.orientation[i]);
-	return 1;
+	do {
+		want = n - total < POSE_BATCH ? n - total : POSE_BATCH;
+		got = read_samples(p, p->pose_fd, p->pose_buf,
+				   sizeof(p->pose_buf[0]), want,
+				   total ? 0 : timeout_ms);
+		if (got <= 0)
+			return total ? total : got;
+		psvr2__convert_poses(out + total, p->pose_buf, got);
+		psvr2__after_poses(p, out + total, got);
+		total += got;
+	} while (got == want && total < n);
+	return total;
 }
 
-int psvr2_read_gaze(psvr2_t *p, struct psvr2_gaze *out, int block)
+int psvr2_read_gazes_timeout(psvr2_t *p, struct psvr2_gaze *out, int n,
+			     unsigned int flags, int timeout_ms)
 {
-	struct psvr2_gaze_sample s;
-	int r;
+	int got, want, total = 0;
 
-	if (!p || !out)
+	if (!p || !out || n <= 0)
 		return -1;
-	r = read_sample(p->gaze_fd, &s, sizeof(s), block);
-	if (r != 1)
-		return r;
-
-	out->timestamp_ns = s.timestamp_ns;
-	out->device_timestamp_us = s.device_timestamp_us;
-	out->valid = (s.flags & PSVR2_GAZE_FLAG_VALID) != 0;
-
-#define COPY_EYE(dst, src)						\
-	do {								\
-		(dst).gaze_point_valid = (src).gaze_point_valid;	\
-		(dst).gaze_direction_valid = (src).gaze_direction_valid;\
-		(dst).pupil_diameter_valid = (src).pupil_diameter_valid;\
-		(dst).pupil_diameter_mm =				\
-			f_from_le((src).pupil_diameter_mm);		\
-		(dst).blink_valid = (src).blink_valid;			\
-		(dst).blink = (src).blink;				\
-		for (int i = 0; i < 3; i++) {				\
-			(dst).gaze_point_mm[i] =			\
-				f_from_le((src).gaze_point_mm[i]);	\
-			(dst).gaze_direction[i] =			\
-				f_from_le((src).gaze_direction[i]);	\
-		}							\
-	} while (0)
-
-	COPY_EYE(out->left, s.left);
-	COPY_EYE(out->right, s.right);
-#undef COPY_EYE
-
-	out->combined.gaze_point_valid = s.combined.gaze_point_valid;
-	out->combined.gaze_direction_valid = s.combined.gaze_direction_valid;
-	for (int i = 0; i < 3; i++) {
-		out->combined.gaze_point_mm[i] =
-			f_from_le(s.combined.gaze_point_mm[i]);
-		out->combined.gaze_direction[i] =
-			f_from_le(s.combined.gaze_direction[i]);
+	if (p->shared || p->replay) {
+		got = p->shared ?
+		      psvr2__shared_read(p, PSVR2_SHM_GAZE, out, n, flags,
+					 timeout_ms) :
+		      psvr2__replay_read(p, PSVR2_REC_GAZE, out, n, flags,
+					 timeout_ms);
+		if (got > 0)
+			psvr2__after_gazes(p, out, got);
+		return got;
 	}
-	return 1;
+	if (flags & PSVR2_READ_LATEST) {
+		struct psvr2_gaze_sample last;
+
+		got = read_latest(p, p->gaze_fd, p->gaze_buf, &last,
+				  sizeof(last), GAZE_BATCH, timeout_ms);
+		if (got > 0) {
+			psvr2__convert_gazes(out, &last, 1);
+			psvr2__after_gazes(p, out, 1);
+		}
+		return got;
+	}
+
+	do {
+		want = n - total < GAZE_BATCH ? n - total : GAZE_BATCH;
+		got = read_samples(p, p->gaze_fd, p->gaze_buf,
+				   sizeof(p->gaze_buf[0]), want,
+				   total ? 0 : timeout_ms);
+		if (got <= 0)
+			return total ? total : got;
+		psvr2__convert_gazes(out + total, p->gaze_buf, got);
+		psvr2__after_gazes(p, out + total, got);
+		total += got;
+	} while (got == want && total < n);
+	return total;
+}
+
+int psvr2_read_poses(psvr2_t *p, struct psvr2_pose *out, int n,
+		     unsigned int flags)
+{
+	return psvr2_read_poses_timeout(p, out, n, flags,
+					flags & PSVR2_READ_BLOCK ? -1 : 0);
+}
+
+int psvr2_read_gazes(psvr2_t *p, struct psvr2_gaze *out, int n,
+		     unsigned int flags)
+{
+	return psvr2_read_gazes_timeout(p, out, n, flags,
+					flags & PSVR2_READ_BLOCK ? -1 : 0);
+}
+
+int psvr2_read_pose(psvr2_t *p, struct psvr2_pose *out, int block)
+{
+	return psvr2_read_poses_timeout(p, out, 1, 0, block ? -1 : 0);
+}
+
+int psvr2_read_gaze(psvr2_t *p, struct psvr2_gaze *out, int block)
+{
+	return psvr2_read_gazes_timeout(p, out, 1, 0, block ? -1 : 0);
+}
+
+int psvr2_read_pose_timeout(psvr2_t *p, struct psvr2_pose *out,
+			    int timeout_ms)
+{
+	return psvr2_read_poses_timeout(p, out, 1, 0, timeout_ms);
+}
+
+int psvr2_read_gaze_timeout(psvr2_t *p, struct psvr2_gaze *out,
+			    int timeout_ms)
+{
+	return psvr2_read_gazes_timeout(p, out, 1, 0, timeout_ms);
 }
 
 int psvr2_read_imu(psvr2_t *p, struct psvr2_imu *out)
@@ -279,6 +718,16 @@ int psvr2_read_imu(psvr2_t *p, struct psvr2_imu *out)
 	static const char *gyro[3] = {
 		"in_anglvel_x_raw", "in_anglvel_y_raw", "in_anglvel_z_raw" };
 
+	if (p && out && (p->shared || p->replay)) {
+		struct psvr2_imu_sample s;
+
+		if (p->shared ? psvr2__shared_peek(p, PSVR2_SHM_IMU, &s) <= 0 :
+				psvr2__replay_imu(p, &s))
+			return -1;
+		memcpy(out->accel_m_s2, s.accel_m_s2, sizeof(s.accel_m_s2));
+		memcpy(out->gyro_rad_s, s.gyro_rad_s, sizeof(s.gyro_rad_s));
+		return 0;
+	}
 	if (!p || !out || !p->imu_dir[0])
 		return -1;
 
@@ -298,6 +747,152 @@ int psvr2_read_imu(psvr2_t *p, struct psvr2_imu *out)
 	return 0;
 }
 
+/* ---- buffered IMU ------------------------------------------------------- */
+
+static int imu_attr(const psvr2_t *p, const char *attr, const char *val)
+{
+	char path[400];
+
+	snprintf(path, sizeof(path), "%s/%s", p->imu_dir, attr);
+	return write_file_str(path, val);
+}
+
+int psvr2_imu_start(psvr2_t *p, unsigned int watermark)
+{
+	static const char *elems[] = {
+		"in_accel_x_en", "in_accel_y_en", "in_accel_z_en",
+		"in_anglvel_x_en", "in_anglvel_y_en", "in_anglvel_z_en",
+		"in_timestamp_en",
+	};
+	char val[16];
+	int err;
+
+	/* psvr2d and recordings stream the IMU whenever there is one. */
+	if (p && (p->shared || p->replay))
+		return p->imu_fd >= 0 ? 0 : -1;
+	if (!p || !p->imu_dir[0])
+		return -1;
+	if (p->imu_fd >= 0)
+		return 0;
+	/* The ingestion thread's epoll set can't change under it. */
+	if (p->ingest) {
+		errno = EBUSY;
+		return -1;
+	}
+	if (!watermark)
+		watermark = IMU_WATERMARK;
+	if (watermark > IMU_BUF_LEN)
+		watermark = IMU_BUF_LEN;
+
+	/*
+	 * Opening the chardev claims the buffer (EBUSY if someone else has
+	 * it), so do that first; the scan elements only change while it's off.
+	 */
+	p->imu_fd = open(p->imu_dev, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (p->imu_fd < 0)
+		return -1;
+	imu_attr(p, "buffer/enable", "0");
+	for (size_t i = 0; i < sizeof(elems) / sizeof(elems[0]); i++) {
+		char attr[64];
+
+		snprintf(attr, sizeof(attr), "scan_elements/%s", elems[i]);
+		if (imu_attr(p, attr, "1"))
+			goto fail;
+	}
+	/* The device clock, from modules that have it. */
+	p->imu_vts = !imu_attr(p, "scan_elements/in_count0_en", "1");
+	snprintf(val, sizeof(val), "%d", IMU_BUF_LEN);
+	if (imu_attr(p, "buffer/length", val))
+		goto fail;
+	snprintf(val, sizeof(val), "%u", watermark);
+	if (imu_attr(p, "buffer/watermark", val))
+		goto fail;
+	if (imu_attr(p, "buffer/enable", "1"))
+		goto fail;
+	psvr2__dispatch_update(p);
+	return 0;
+
+fail:
+	err = errno;
+	close(p->imu_fd);
+	p->imu_fd = -1;
+	errno = err;
+	return -1;
+}
+
+void psvr2_imu_stop(psvr2_t *p)
+{
+	int fd;
+
+	if (!p || p->imu_fd < 0 || p->ingest || p->shared || p->replay)
+		return;
+	/* Out of the dispatcher's epoll set before the fd number is reused. */
+	fd = p->imu_fd;
+	p->imu_fd = -1;
+	psvr2__dispatch_update(p);
+	imu_attr(p, "buffer/enable", "0");
+	close(fd);
+}
+
+int psvr2_imu_fd(const psvr2_t *p) { return p ? p->imu_fd : -1; }
+
+void psvr2__convert_imu(const psvr2_t *p, struct psvr2_imu_sample *out,
+			const struct imu_scan *in, int n)
+{
+	for (int k = 0; k < n; k++) {
+		out[k].timestamp_ns = in[k].timestamp;
+		out[k].device_vts_us = p->imu_vts ? in[k].vts_us : 0;
+		out[k].measured_ns = in[k].timestamp;
+		for (int a = 0; a < 3; a++) {
+			out[k].accel_m_s2[a] =
+				in[k].channels[a] * p->accel_scale;
+			out[k].gyro_rad_s[a] =
+				in[k].channels[3 + a] * p->gyro_scale;
+		}
+	}
+}
+
+int psvr2_read_imu_batch_timeout(psvr2_t *p, struct psvr2_imu_sample *out,
+				 int max, int timeout_ms)
+{
+	int got = 0;
+
+	if (!p || !out || max < 0 || p->imu_fd < 0)
+		return -1;
+	if (p->shared || p->replay) {
+		got = p->shared ?
+		      psvr2__shared_read(p, PSVR2_SHM_IMU, out, max, 0,
+					 timeout_ms) :
+		      psvr2__replay_read(p, PSVR2_REC_IMU, out, max, 0,
+					 timeout_ms);
+		if (got > 0)
+			psvr2__after_imu(p, out, got);
+		return got;
+	}
+
+	while (got < max) {
+		int want = max - got < IMU_BATCH ? max - got : IMU_BATCH;
+		int n = read_samples(p, p->imu_fd, p->imu_scan,
+				     sizeof(p->imu_scan[0]), want,
+				     got ? 0 : timeout_ms);
+
+		if (n <= 0)
+			return got ? got : n;
+		psvr2__convert_imu(p, out + got, p->imu_scan, n);
+		psvr2__after_imu(p, out + got, n);
+		got += n;
+		if (n < want)
+			break;		/* drained */
+	}
+	return got;
+}
+
+int psvr2_read_imu_batch(psvr2_t *p, struct psvr2_imu_sample *out, int max,
+			 int block)
+{
+	return psvr2_read_imu_batch_timeout(p, out, max, block ? -1 : 0);
+}
+
 int psvr2_set_brightness(psvr2_t *p, int level)
 {
 	char buf[8];
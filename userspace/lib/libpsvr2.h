@@ -2,10 +2,12 @@
 /*
  * libpsvr2 — userspace access to the PSVR2 kernel module's device nodes.
  *
- * Wraps the raw interfaces exposed by the psvr2 module (the /dev/psvr2-pose and
- * /dev/psvr2-gaze character devices, the psvr2_imu IIO device, the V4L2 camera
- * node, and the brightness sysfs attribute) behind a small C API that returns
- * host-native floats. Wire data is little-endian IEEE-754; this library does the
+ * Wraps the raw interfaces exposed by the psvr2 module (the /dev/psvr2-poseN
+ * and /dev/psvr2-gazeN character devices, the psvr2_imu IIO device, the V4L2
+ * camera node, and the brightness sysfs attribute) behind a small C API that
+ * returns host-native floats. Several headsets may be attached; each has a
+ * kernel index N and all of its nodes are found through its USB device in
+ * sysfs. Wire data is little-endian IEEE-754; this library does the
  * reinterpretation and IIO scaling for you.
  *
  * Copyright (C) 2026 PSVR2 Linux project
@@ -13,6 +15,7 @@
 #ifndef LIBPSVR2_H
 #define LIBPSVR2_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -21,13 +24,20 @@ extern "C" {
 
 typedef struct psvr2 psvr2_t;
 
-/* 6DoF pose from the headset's onboard tracker, in the device's native frame. */
+/*
+ * 6DoF pose from the headset's onboard tracker, in the device's native frame.
+ * @timestamp_ns is when the host received it; @measured_ns is the device's own
+ * timestamp mapped onto the host clock (see psvr2_clock_get()), the same as
+ * @timestamp_ns until the mapping has settled. The gaze and IMU samples carry
+ * both as well.
+ */
 struct psvr2_pose {
 	uint64_t timestamp_ns;		/* host CLOCK_MONOTONIC */
 	uint32_t device_vts_us;
 	int	 valid;
 	float	 position[3];		/* metres */
 	float	 orientation[4];	/* quaternion: w, x, y, z */
+	uint64_t measured_ns;		/* host CLOCK_MONOTONIC */
 };
 
 struct psvr2_eye {
@@ -53,6 +63,7 @@ struct psvr2_gaze {
 		int	gaze_direction_valid;
 		float	gaze_direction[3];	/* normalised */
 	} combined;
+	uint64_t measured_ns;
 };
 
 /* Latest scaled IMU sample (m/s^2 and rad/s), device-native axes. */
@@ -62,13 +73,55 @@ struct psvr2_imu {
 };
 
 /*
- * Open the headset. Discovers whichever interfaces the module has exposed;
- * missing ones simply make the corresponding calls return -1 / no data.
- * Returns NULL only on allocation failure (a headset with no nodes still opens).
+ * One buffered IMU sample (m/s^2 and rad/s, device-native axes), stamped with
+ * the host CLOCK_MONOTONIC time the module assigned it: the receive time of its
+ * transfer, back-dated by 0.5 ms per later record in the same transfer.
+ * @device_vts_us is 0 from modules that don't pass the device clock on.
+ */
+struct psvr2_imu_sample {
+	uint64_t timestamp_ns;
+	float	 accel_m_s2[3];
+	float	 gyro_rad_s[3];
+	uint32_t device_vts_us;
+	uint64_t measured_ns;
+};
+
+/* One attached headset, as found by psvr2_enumerate(). */
+struct psvr2_device_info {
+	int	index;			/* kernel index: /dev/psvr2-pose<index> */
+	char	usb_path[256];		/* sysfs dir of the USB device */
+	char	port[32];		/* USB bus-port, e.g. "3-2.1" */
+	char	serial[64];		/* USB serial number, "" if none */
+};
+
+/* The most headsets psvr2_enumerate() will find. */
+#define PSVR2_MAX_HEADSETS	16
+
+/*
+ * List the headsets bound to the psvr2 module, sorted by index. Fills up to
+ * @max entries and returns the total number found (which may exceed @max), or
+ * -1 on error.
+ */
+int psvr2_enumerate(struct psvr2_device_info *out, int max);
+
+/*
+ * Open headset @index. Discovers whichever interfaces the module has exposed for
+ * it; missing ones simply make the corresponding calls return -1 / no data.
+ * Returns NULL on allocation failure or if no headset has that index.
+ */
+psvr2_t *psvr2_open_index(int index);
+
+/*
+ * Open the lowest-indexed headset. If none is bound the handle still opens with
+ * no interfaces, so callers can report what is missing. Returns NULL only on
+ * allocation failure.
  */
 psvr2_t *psvr2_open(void);
 void psvr2_close(psvr2_t *p);
 
+/* Kernel index of an open handle, or -1 if it is not bound to a headset. */
+int psvr2_index(const psvr2_t *p);
+
 /* True (1) if the named interface was found. */
 int psvr2_has_pose(const psvr2_t *p);
 int psvr2_has_gaze(const psvr2_t *p);
@@ -89,9 +142,494 @@ int psvr2_gaze_fd(const psvr2_t *p);
 int psvr2_read_pose(psvr2_t *p, struct psvr2_pose *out, int block);
 int psvr2_read_gaze(psvr2_t *p, struct psvr2_gaze *out, int block);
 
+/*
+ * Deadline-bounded variants: wait up to @timeout_ms for data (0 = don't wait,
+ * -1 = forever). Return 0 on timeout. Once psvr2_interrupt() has been called
+ * on a handle, every read on it that would wait, these and the
+ * block/PSVR2_READ_BLOCK ones alike, returns -1 with errno EINTR instead, until
+ * psvr2_interrupt_clear(). A consumer thread can so be woken for shutdown at
+ * any point, even before it starts waiting.
+ */
+int psvr2_read_pose_timeout(psvr2_t *p, struct psvr2_pose *out,
+			    int timeout_ms);
+int psvr2_read_gaze_timeout(psvr2_t *p, struct psvr2_gaze *out,
+			    int timeout_ms);
+
+void psvr2_interrupt(psvr2_t *p);
+void psvr2_interrupt_clear(psvr2_t *p);
+
+/*
+ * Batched reads: up to @n samples, oldest first, pulled a buffer-full per
+ * read() and converted in one pass. Flags:
+ *   PSVR2_READ_BLOCK   wait for at least one sample
+ *   PSVR2_READ_LATEST  drain the whole backlog but convert and return only
+ *                      the newest sample (in out[0])
+ * Returns the number of samples stored, 0 if none is pending (nonblock), -1
+ * on error.
+ */
+#define PSVR2_READ_BLOCK	(1u << 0)
+#define PSVR2_READ_LATEST	(1u << 1)
+
+int psvr2_read_poses(psvr2_t *p, struct psvr2_pose *out, int n,
+		     unsigned int flags);
+int psvr2_read_gazes(psvr2_t *p, struct psvr2_gaze *out, int n,
+		     unsigned int flags);
+int psvr2_read_poses_timeout(psvr2_t *p, struct psvr2_pose *out, int n,
+			     unsigned int flags, int timeout_ms);
+int psvr2_read_gazes_timeout(psvr2_t *p, struct psvr2_gaze *out, int n,
+			     unsigned int flags, int timeout_ms);
+
 /* Read the latest IMU sample (scaled). Returns 0 on success, -1 on error. */
 int psvr2_read_imu(psvr2_t *p, struct psvr2_imu *out);
 
+/*
+ * Buffered IMU streaming: every 2 kHz sample, through the IIO buffer of the
+ * psvr2_imu device. psvr2_imu_start() enables the scan elements and the buffer
+ * and opens /dev/iio:deviceN; the fd becomes readable once @watermark samples
+ * are queued (0 picks 16, i.e. a wakeup every 8 ms). Only one process can own
+ * the buffer at a time. Returns 0 on success, -1 on error (errno EBUSY if
+ * another consumer has it). psvr2_imu_stop() disables it again; psvr2_close()
+ * does so implicitly. Neither does anything while ingesting (see below).
+ */
+int psvr2_imu_start(psvr2_t *p, unsigned int watermark);
+void psvr2_imu_stop(psvr2_t *p);
+
+/* The IIO buffer fd for poll()/select() while started, else -1. */
+int psvr2_imu_fd(const psvr2_t *p);
+
+/*
+ * Read up to @max buffered samples, oldest first. With block != 0 waits for at
+ * least one. Returns the number read, 0 if none is pending (nonblock), -1 on
+ * error.
+ */
+int psvr2_read_imu_batch(psvr2_t *p, struct psvr2_imu_sample *out, int max,
+			 int block);
+int psvr2_read_imu_batch_timeout(psvr2_t *p, struct psvr2_imu_sample *out,
+				 int max, int timeout_ms);
+
+/*
+ * Split a batch into one array per field, for vectorised maths: of each of @n
+ * records @stride bytes apart from @first on, the @count consecutive floats
+ * there go to out[0][k] .. out[count - 1][k]. E.g. the position and
+ * orientation of a pose batch into seven arrays of @n:
+ *
+ *	psvr2_to_soa(soa, 7, poses[0].position, sizeof(poses[0]), n);
+ *
+ * Uses SSE2, AVX2 or NEON as the CPU has them.
+ */
+void psvr2_to_soa(float *const *out, int count, const float *first,
+		  size_t stride, int n);
+
+/*
+ * Event loop. Register callbacks once, then either call psvr2_dispatch() in a
+ * loop or add psvr2_dispatch_fd() to your own poll()/epoll set and call
+ * psvr2_dispatch(p, 0) whenever it is readable. Each call drains every ready
+ * stream to empty, handing samples to the callbacks a batch at a time (oldest
+ * first, @n >= 1; the arrays are only valid during the call).
+ *
+ * Only streams with a callback are watched; the IMU also needs
+ * psvr2_imu_start() (before or after this). @input gets the function button,
+ * proximity ("worn") and IPD dial as they change; @hotplug gets @present = 1/0
+ * as any headset's nodes appear or go away (via udev), and this handle's own
+ * removal once, even without udev, when its streams hang up.
+ *
+ * Callbacks run on the dispatching thread and must not call
+ * psvr2_set_callbacks() or psvr2_close() on the handle.
+ */
+enum psvr2_input_kind {
+	PSVR2_INPUT_FUNCTION_BUTTON,	/* value: 1 = pressed */
+	PSVR2_INPUT_WORN,		/* value: 1 = proximity covered */
+	PSVR2_INPUT_IPD,		/* value: dial position, mm */
+};
+
+struct psvr2_input_event {
+	uint64_t timestamp_ns;		/* host CLOCK_MONOTONIC */
+	int	 kind;			/* enum psvr2_input_kind */
+	int	 value;
+};
+
+struct psvr2_callbacks {
+	void (*pose)(void *user, const struct psvr2_pose *poses, int n);
+	void (*gaze)(void *user, const struct psvr2_gaze *gazes, int n);
+	void (*imu)(void *user, const struct psvr2_imu_sample *samples, int n);
+	void (*input)(void *user, const struct psvr2_input_event *ev);
+	void (*hotplug)(void *user, int index, int present);
+	void *user;
+};
+
+/*
+ * Install @cb (copied), replacing any earlier set; NULL removes them all and
+ * frees the dispatcher. Returns 0 on success, -1 on error.
+ */
+int psvr2_set_callbacks(psvr2_t *p, const struct psvr2_callbacks *cb);
+
+/* The dispatcher's epoll fd, for embedding in another loop; -1 if unset. */
+int psvr2_dispatch_fd(const psvr2_t *p);
+
+/*
+ * Wait up to @timeout_ms (0 = don't wait, -1 = forever) for any watched
+ * stream, then dispatch everything that is ready. Returns the number of
+ * samples and events delivered, 0 on timeout, -1 on error. After
+ * psvr2_interrupt() it returns -1 with errno EINTR (having still dispatched
+ * whatever was ready) until psvr2_interrupt_clear().
+ */
+int psvr2_dispatch(psvr2_t *p, int timeout_ms);
+
+/*
+ * Ingestion mode: libpsvr2 runs its own reader thread (pinned to @cpu if
+ * >= 0) that drains the pose, gaze and IMU streams as they arrive, starting
+ * the buffered IMU if no one has. Meanwhile the psvr2_read_*() calls,
+ * psvr2_set_callbacks() and psvr2_dispatch() fail with errno EBUSY; the
+ * samples are had from the calls below instead. Returns 0 on success, -1 on
+ * error (EBUSY if callbacks are installed). psvr2_ingest_stop() joins the
+ * thread; psvr2_close() does so too.
+ */
+int psvr2_ingest_start(psvr2_t *p, int cpu);
+void psvr2_ingest_stop(psvr2_t *p);
+
+/*
+ * Newest sample of a stream, from any thread, without syscalls, locks or
+ * waiting on the reader. Every ingested sample gets the next sequence number
+ * of its stream, from 0; @seq (may be NULL) receives this one's. Returns 1 on
+ * a sample, 0 if none has arrived yet, -1 if not ingesting.
+ */
+int psvr2_get_latest_pose(psvr2_t *p, struct psvr2_pose *out, uint64_t *seq);
+int psvr2_get_latest_gaze(psvr2_t *p, struct psvr2_gaze *out, uint64_t *seq);
+int psvr2_get_latest_imu(psvr2_t *p, struct psvr2_imu_sample *out,
+			 uint64_t *seq);
+
+/*
+ * Up to @max ingested samples with sequence >= *@seq, oldest first, from the
+ * stream's history ring (the last second or two; 1024 poses, 512 gaze
+ * samples, 4096 IMU samples). *@seq is advanced past the last one returned,
+ * so passing it back each time yields every sample once. Samples that have
+ * already left the ring are skipped: the first returned then has sequence
+ * *@seq - n rather than the value passed in. Each consumer keeps its own
+ * cursor; none of them can hold up the reader. Returns the number copied, 0 if
+ * nothing newer, -1 if not ingesting.
+ */
+int psvr2_get_poses_since(psvr2_t *p, uint64_t *seq, struct psvr2_pose *out,
+			  int max);
+int psvr2_get_gazes_since(psvr2_t *p, uint64_t *seq, struct psvr2_gaze *out,
+			  int max);
+int psvr2_get_imu_since(psvr2_t *p, uint64_t *seq,
+			struct psvr2_imu_sample *out, int max);
+
+/*
+ * Head pose at host CLOCK_MONOTONIC time @t_ns, from the handle's history of
+ * the last 1024 valid poses it has read (~1 s): all of them under ingestion,
+ * the dispatcher or batched reads, only the returned one per
+ * PSVR2_READ_LATEST call. The poses are placed at their @measured_ns.
+ * Position is interpolated linearly and orientation by slerp between the two
+ * poses around @t_ns. Safe to call from any thread, alongside the one reading
+ * poses. Returns 1 if @t_ns lies within the history, 0 if it lies outside
+ * (@out is then the oldest or newest pose, as is), -1 if no pose has been
+ * read yet.
+ */
+int psvr2_pose_at(psvr2_t *p, uint64_t t_ns, struct psvr2_pose *out);
+
+/*
+ * Clock sync: each of the pose, gaze and IMU streams carries the headset's
+ * microsecond clock, which the handle maps onto CLOCK_MONOTONIC as it reads
+ * them: along the lower envelope of (device time, receive time) over the last
+ * 10 s, so with the USB and scheduling jitter taken out and the crystals'
+ * drift followed. That is what fills in each sample's @measured_ns, once a
+ * second or so of a stream has been read. The mapping sits at the earliest
+ * the samples could have arrived, so it still includes the smallest transfer
+ * delay; it restarts by itself if the headset's clock does.
+ *
+ * psvr2_clock_get() reports a stream's mapping; psvr2_clock_to_host() maps
+ * any device time within half an hour of its newest sample. Both are safe to
+ * call from any thread. Return 0, or -1 with errno ENODATA before the first
+ * sample (_to_host(): until the mapping has settled).
+ */
+enum psvr2_clock_stream {
+	PSVR2_CLOCK_POSE,
+	PSVR2_CLOCK_GAZE,
+	PSVR2_CLOCK_IMU,	/* needs a module with the vts scan element */
+	PSVR2_CLOCK_STREAMS,
+};
+
+struct psvr2_clock_sync {
+	int	 locked;		/* 0: @measured_ns is @timestamp_ns */
+	double	 drift_ppm;		/* host clock rate minus the device's */
+	double	 jitter_us;		/* mean delay above the envelope */
+	uint32_t device_us;		/* newest sample's device time */
+	uint64_t host_ns;		/* and the host time it maps to */
+	uint64_t resets;		/* device clock restarts seen */
+};
+
+int psvr2_clock_get(psvr2_t *p, int stream, struct psvr2_clock_sync *out);
+int psvr2_clock_to_host(psvr2_t *p, int stream, uint32_t device_us,
+			uint64_t *host_ns);
+
+/*
+ * Orientation from the IMU alone, updated with every buffered sample the
+ * handle reads (batched reads, the dispatcher or ingestion) by a
+ * complementary filter that also estimates the gyro bias: for late-latching
+ * rotation at 2 kHz between, or without, SLAM poses. The world frame has +z
+ * up (against gravity) and the heading of the first sample, which then drifts
+ * slowly; device axes are the IMU's. @angular_velocity is the latest
+ * bias-corrected rate, for extrapolating past @timestamp_ns. Safe to call from
+ * any thread. Returns 0, or -1 with errno ENODATA before the first sample.
+ */
+struct psvr2_orientation {
+	uint64_t timestamp_ns;		/* measured_ns of the newest sample */
+	float	 orientation[4];	/* w, x, y, z: device to world */
+	float	 angular_velocity[3];	/* rad/s, device axes */
+	float	 gyro_bias[3];		/* rad/s, as estimated so far */
+};
+
+int psvr2_orientation_latest(psvr2_t *p, struct psvr2_orientation *out);
+
+/*
+ * SLAM + IMU fusion: an error-state Kalman filter that propagates the last
+ * SLAM pose with every IMU sample the handle reads and corrects it with every
+ * valid pose, estimating velocity, the accel and gyro biases and the gravity
+ * direction on the way. It runs on the thread reading the handle, which has
+ * to read both the poses and the IMU (the dispatcher and ingestion do;
+ * psvr2_imu_start() must have been called). Output is in the SLAM frame, one
+ * record per IMU sample from the first valid pose on, kept in a ring of 1024
+ * that any thread may read.
+ *
+ * @imu_to_body rotates IMU axes into the SLAM pose's body axes; all zeroes
+ * means the identity (the extrinsic hasn't been measured). The noise figures
+ * are per-sample/per-pose standard deviations and bias random walks; 0 keeps
+ * the default. PSVR2_FUSION_TIMING times each step for
+ * psvr2_fusion_get_stats(). Starting again after psvr2_fusion_stop() resets
+ * the filter; pass NULL for the defaults. Returns 0, or -1 with errno EBUSY
+ * if already running.
+ */
+#define PSVR2_FUSION_TIMING	(1u << 0)
+
+struct psvr2_fusion_config {
+	unsigned int flags;
+	float	imu_to_body[4];		/* w, x, y, z */
+	float	accel_noise;		/* m/s^2 */
+	float	gyro_noise;		/* rad/s */
+	float	accel_bias_walk;	/* m/s^2 per sqrt(s) */
+	float	gyro_bias_walk;		/* rad/s per sqrt(s) */
+	float	position_noise;		/* m, of a SLAM pose */
+	float	orientation_noise;	/* rad, of a SLAM pose */
+};
+
+struct psvr2_fused_pose {
+	uint64_t timestamp_ns;		/* the IMU sample's measured_ns */
+	float	 position[3];		/* metres, SLAM frame */
+	float	 orientation[4];	/* w, x, y, z: body to SLAM */
+	float	 velocity[3];		/* m/s, SLAM frame */
+	float	 angular_velocity[3];	/* rad/s, body axes, bias removed */
+	float	 acceleration[3];	/* m/s^2, SLAM frame, gravity removed */
+	/* position (m) then orientation error (rad, body axes) */
+	float	 covariance[6][6];
+};
+
+struct psvr2_fusion_stats {
+	uint64_t predicts, updates;	/* IMU steps, poses applied */
+	uint64_t predict_ns, update_ns;	/* with PSVR2_FUSION_TIMING */
+	uint64_t rejected;		/* poses failing the outlier gate */
+};
+
+int psvr2_fusion_start(psvr2_t *p, const struct psvr2_fusion_config *cfg);
+void psvr2_fusion_stop(psvr2_t *p);
+
+/*
+ * Newest fused pose, and its sequence number in *@seq if not NULL: 1, or 0
+ * before the first. Then as psvr2_get_poses_since(), from the fusion ring.
+ */
+int psvr2_get_fused_latest(psvr2_t *p, struct psvr2_fused_pose *out,
+			   uint64_t *seq);
+int psvr2_get_fused_since(psvr2_t *p, uint64_t *seq,
+			  struct psvr2_fused_pose *out, int max);
+int psvr2_fusion_get_stats(psvr2_t *p, struct psvr2_fusion_stats *out);
+
+/*
+ * Gaze processing, for foveated rendering: every gaze sample the handle reads
+ * (batched or latest reads, the dispatcher or ingestion) is smoothed by a
+ * filter that opens up with the eye's velocity, classified as fixation or
+ * saccade by a velocity threshold (I-VT), and carried over blinks by holding
+ * the last fixation. During a saccade the landing point and time are predicted
+ * from the main sequence and, once past the peak velocity, from the distance
+ * covered so far; @predicted is where the eye will be @predict_ms after the
+ * sample, to render for. Output is one record per sample from the first valid
+ * one on, in the combined gaze's frame, kept in a ring of 1024 that any thread
+ * may read.
+ *
+ * Zero fields keep the defaults: 30 deg/s saccade threshold, 0.5 Hz cutoff at
+ * rest rising by 0.1 Hz per deg/s (a 1-euro filter), blinks of up to 300 ms
+ * bridged, 10 ms of prediction. PSVR2_GAZE_TIMING times each sample for
+ * psvr2_gaze_filter_get_stats(). Starting again after psvr2_gaze_filter_stop()
+ * resets the filter; pass NULL for the defaults. Returns 0, or -1 with errno
+ * EBUSY if already running.
+ */
+#define PSVR2_GAZE_TIMING	(1u << 0)
+
+enum psvr2_gaze_movement {
+	PSVR2_GAZE_FIXATION,
+	PSVR2_GAZE_SACCADE,
+	PSVR2_GAZE_BLINK,		/* bridged: @direction is held */
+	PSVR2_GAZE_LOST,		/* closed or untracked for too long */
+};
+
+struct psvr2_gaze_filter_config {
+	unsigned int flags;
+	float	saccade_deg_s;		/* I-VT threshold */
+	float	min_cutoff_hz;		/* smoothing at rest */
+	float	beta;			/* cutoff Hz added per deg/s */
+	float	blink_max_ms;		/* bridged up to this long */
+	float	predict_ms;		/* @predicted this far ahead */
+};
+
+struct psvr2_filtered_gaze {
+	uint64_t timestamp_ns;		/* the sample's measured_ns */
+	int	 movement;		/* PSVR2_GAZE_* */
+	float	 direction[3];		/* smoothed, normalised */
+	float	 velocity_deg_s;
+	float	 predicted[3];		/* direction @predict_ms ahead */
+	uint64_t movement_start_ns;	/* when @movement began */
+	float	 landing[3];		/* saccades: where it will end */
+	uint64_t landing_ns;		/* and when; 0 outside saccades */
+};
+
+struct psvr2_gaze_filter_stats {
+	uint64_t samples;		/* counted with PSVR2_GAZE_TIMING */
+	uint64_t sample_ns;		/* their total time */
+	uint64_t saccades, blinks;	/* blinks bridged */
+	double	 landing_error_deg;	/* total, of landings predicted */
+	uint64_t landings;		/* past a saccade's peak */
+};
+
+int psvr2_gaze_filter_start(psvr2_t *p,
+			    const struct psvr2_gaze_filter_config *cfg);
+void psvr2_gaze_filter_stop(psvr2_t *p);
+
+/*
+ * Newest processed gaze, and its sequence number in *@seq if not NULL: 1, or
+ * 0 before the first. Then as psvr2_get_poses_since(), from the gaze ring.
+ */
+int psvr2_get_filtered_gaze_latest(psvr2_t *p,
+				   struct psvr2_filtered_gaze *out,
+				   uint64_t *seq);
+int psvr2_get_filtered_gaze_since(psvr2_t *p, uint64_t *seq,
+				  struct psvr2_filtered_gaze *out, int max);
+int psvr2_gaze_filter_get_stats(psvr2_t *p,
+				struct psvr2_gaze_filter_stats *out);
+
+/*
+ * Shared access through psvr2d, for running several consumers at once: the
+ * daemon is the one reader of headset @index's pose, gaze and IMU streams and
+ * publishes every sample into shared-memory rings that all its clients map.
+ * The handle reads from those instead of the device nodes; the psvr2_read_*()
+ * calls, the *_fd() fds, the dispatcher, ingestion and psvr2_pose_at() all
+ * work on it as usual (the IMU is always streaming, so psvr2_imu_start() and
+ * _stop() do nothing). Reads fail with errno ENODEV once the headset or the
+ * daemon is gone. Returns NULL if no psvr2d serves @index.
+ */
+psvr2_t *psvr2_open_shared(int index);
+
+/*
+ * Samples a psvr2_open_shared() handle missed per stream because the daemon
+ * had overwritten them before it read them (the rings hold 1024 poses, 512
+ * gaze samples, 4096 IMU samples), totalled since open. The daemon never waits
+ * for a client; this is how a slow one finds out. Returns 0, or -1 if @p is
+ * not shared.
+ */
+struct psvr2_overruns {
+	uint64_t pose;
+	uint64_t gaze;
+	uint64_t imu;
+};
+
+int psvr2_get_overruns(const psvr2_t *p, struct psvr2_overruns *out);
+
+/*
+ * Recording: every sample of a session, losslessly, in a compact append-only
+ * .psvr2rec file (a few bytes per pose; format in libpsvr2_rec.h). Feed it
+ * whatever the read calls or callbacks return, from one thread; each stream
+ * must come in time order. psvr2_rec_close() writes the time index and
+ * returns -1 if any write failed on the way; a recording cut short without it
+ * still replays, minus its last second or so. Others return 0, or -1 on error.
+ */
+typedef struct psvr2_rec psvr2_rec_t;
+
+/* One camera image; @data only needs to live through the call. */
+struct psvr2_frame {
+	uint64_t timestamp_ns;		/* host CLOCK_MONOTONIC */
+	uint32_t width;
+	uint32_t height;
+	uint32_t fourcc;		/* V4L2 pixel format */
+	const void *data;
+	size_t	 len;
+};
+
+psvr2_rec_t *psvr2_rec_open(const char *path);
+int psvr2_rec_poses(psvr2_rec_t *r, const struct psvr2_pose *poses, int n);
+int psvr2_rec_gazes(psvr2_rec_t *r, const struct psvr2_gaze *gazes, int n);
+int psvr2_rec_imu(psvr2_rec_t *r, const struct psvr2_imu_sample *s, int n);
+int psvr2_rec_input(psvr2_rec_t *r, const struct psvr2_input_event *ev);
+int psvr2_rec_frame(psvr2_rec_t *r, const struct psvr2_frame *f);
+int psvr2_rec_close(psvr2_rec_t *r);
+
+/*
+ * Replay a recording as if it were a headset: the psvr2_read_*() calls, the
+ * fds, the dispatcher (input events included), ingestion and psvr2_pose_at()
+ * all work on the handle, and each sample becomes available once its time
+ * comes round again, at @speed times real time (0 = as fast as it is read).
+ * Timestamps are shifted onto the current CLOCK_MONOTONIC but keep their
+ * recorded spacing, so at any @speed but 1 they run ahead of or behind the
+ * clock. At the end the streams hang up as on an unplug: reads fail with
+ * errno ENODEV and the dispatcher reports the removal (as index -1).
+ * Returns NULL on error (errno EPROTO if @path is not a recording).
+ */
+psvr2_t *psvr2_open_replay(const char *path, double speed);
+
+/* Restart at @offset_ns into the recording. Returns 0, or -1 on error. */
+int psvr2_replay_seek(psvr2_t *p, uint64_t offset_ns);
+
+/* Time from the recording's first sample to its last. */
+uint64_t psvr2_replay_length_ns(const psvr2_t *p);
+
+/*
+ * The next recorded camera frame, if due. @out->data points into the mapped
+ * recording and stays valid until psvr2_close(). Returns 1 on a frame, 0 if
+ * none is due yet, -1 at the end or on error.
+ */
+int psvr2_replay_frame(psvr2_t *p, struct psvr2_frame *out);
+
+/*
+ * Camera capture without copies. psvr2_camera_open() maps @nbuf (0 picks 4) of
+ * the camera node's buffers and starts streaming, which pauses the SLAM
+ * tracker while it runs (the cameras are shared). psvr2_camera_acquire() waits
+ * up to @timeout_ms (as the reads do, interrupts included) for the next filled
+ * buffer and lends it: @frame.data points into the driver's buffer and stays
+ * valid until psvr2_camera_release() queues it back for refilling, from any
+ * thread. Hold frames briefly; with every buffer lent out the camera drops
+ * frames, which shows as gaps in @sequence. With PSVR2_CAMERA_DMABUF every
+ * buffer is also exported as a dma-buf, for a GPU or encoder to import
+ * (@dmabuf_fd, owned by the library). psvr2_camera_close() stops streaming;
+ * psvr2_close() does so implicitly. acquire returns 1 on a frame, 0 on
+ * timeout, -1 on error (errno ENODEV once the headset is gone); the others 0
+ * or -1.
+ */
+#define PSVR2_CAMERA_DMABUF	(1u << 0)
+
+struct psvr2_camera_frame {
+	struct psvr2_frame frame;
+	uint32_t sequence;		/* driver frame counter */
+	int	 dmabuf_fd;		/* with PSVR2_CAMERA_DMABUF, else -1 */
+	int	 buffer;		/* which one, for the release */
+};
+
+int psvr2_camera_open(psvr2_t *p, int nbuf, unsigned int flags);
+void psvr2_camera_close(psvr2_t *p);
+
+/* The camera node's fd for poll()/select() while open, else -1. */
+int psvr2_camera_fd(const psvr2_t *p);
+
+int psvr2_camera_acquire(psvr2_t *p, struct psvr2_camera_frame *out,
+			 int timeout_ms);
+int psvr2_camera_release(psvr2_t *p, const struct psvr2_camera_frame *f);
+
 /* Set panel brightness, 0..31. Returns 0 on success, -1 on error. */
 int psvr2_set_brightness(psvr2_t *p, int level);
 
@@ -0,0 +1,277 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — camera capture straight out of the driver's buffers.
+ *
+ * The psvr2 camera node is a vb2 queue: its buffers are mapped here once, and
+ * each filled one is lent to the caller as it comes off the queue (DQBUF) and
+ * queued back for the driver to refill on release (QBUF). Nothing is copied in
+ * user space; with PSVR2_CAMERA_DMABUF the buffers are also exported as
+ * dma-bufs, for consumers that would rather import a frame than map it.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#include "libpsvr2_int.h"
+
+#define CAMERA_BUFFERS		4
+#define CAMERA_MAX_BUFFERS	32	/* VIDEO_MAX_FRAME */
+
+struct camera_buffer {
+	void	*map;
+	size_t	len;
+	int	dmabuf_fd;
+	int	held;			/* lent out, not yet released */
+};
+
+struct psvr2_camera {
+	int	fd;
+	struct v4l2_pix_format fmt;
+	int	count;
+	struct camera_buffer buf[CAMERA_MAX_BUFFERS];
+};
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+	int ret;
+
+	do
+		ret = ioctl(fd, req, arg);
+	while (ret < 0 && errno == EINTR);
+	return ret;
+}
+
+static int camera_queue(struct psvr2_camera *c, int index)
+{
+	struct v4l2_buffer b = {
+		.type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+		.memory = V4L2_MEMORY_MMAP,
+		.index = index,
+	};
+
+	return xioctl(c->fd, VIDIOC_QBUF, &b);
+}
+
+static void camera_free(struct psvr2_camera *c)
+{
+	int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	struct v4l2_requestbuffers req = {
+		.type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+		.memory = V4L2_MEMORY_MMAP,
+	};
+
+	xioctl(c->fd, VIDIOC_STREAMOFF, &type);
+	for (int i = 0; i < c->count; i++) {
+		if (c->buf[i].map)
+			munmap(c->buf[i].map, c->buf[i].len);
+		if (c->buf[i].dmabuf_fd >= 0)
+			close(c->buf[i].dmabuf_fd);
+	}
+	/* Fails with EBUSY while an importer holds a dma-buf; close frees. */
+	xioctl(c->fd, VIDIOC_REQBUFS, &req);
+	close(c->fd);
+	free(c);
+}
+
+/* Map (and maybe export) buffer @i. */
+static int camera_map(struct psvr2_camera *c, int i, unsigned int flags)
+{
+	struct camera_buffer *cb = &c->buf[i];
+	struct v4l2_buffer b = {
+		.type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+		.memory = V4L2_MEMORY_MMAP,
+		.index = i,
+	};
+
+	if (xioctl(c->fd, VIDIOC_QUERYBUF, &b))
+		return -1;
+	cb->map = mmap(NULL, b.length, PROT_READ, MAP_SHARED, c->fd,
+		       b.m.offset);
+	if (cb->map == MAP_FAILED) {
+		cb->map = NULL;
+		return -1;
+	}
+	cb->len = b.length;
+
+	if (flags & PSVR2_CAMERA_DMABUF) {
+		struct v4l2_exportbuffer exp = {
+			.type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+			.index = i,
+			.flags = O_RDONLY | O_CLOEXEC,
+		};
+
+		if (xioctl(c->fd, VIDIOC_EXPBUF, &exp))
+			return -1;
+		cb->dmabuf_fd = exp.fd;
+	}
+	return 0;
+}
+
+int psvr2_camera_open(psvr2_t *p, int nbuf, unsigned int flags)
+{
+	struct v4l2_format fmt = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE };
+	struct v4l2_requestbuffers req = {
+		.type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+		.memory = V4L2_MEMORY_MMAP,
+	};
+	int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	struct psvr2_camera *c;
+	int err;
+
+	if (!p || !p->cam_path[0]) {
+		errno = ENODEV;
+		return -1;
+	}
+	if (p->camera) {
+		errno = EBUSY;
+		return -1;
+	}
+	if (nbuf <= 0)
+		nbuf = CAMERA_BUFFERS;
+	if (nbuf > CAMERA_MAX_BUFFERS)
+		nbuf = CAMERA_MAX_BUFFERS;
+
+	c = calloc(1, sizeof(*c));
+	if (!c)
+		return -1;
+	for (int i = 0; i < CAMERA_MAX_BUFFERS; i++)
+		c->buf[i].dmabuf_fd = -1;
+	c->fd = open(p->cam_path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (c->fd < 0) {
+		free(c);
+		return -1;
+	}
+
+	/* The node has the one format; take it as it is. */
+	req.count = nbuf;
+	if (xioctl(c->fd, VIDIOC_G_FMT, &fmt) ||
+	    xioctl(c->fd, VIDIOC_REQBUFS, &req))
+		goto fail;
+	c->fmt = fmt.fmt.pix;
+	/* The queue may have rounded the count up to its minimum. */
+	c->count = req.count < CAMERA_MAX_BUFFERS ? req.count
+						   : CAMERA_MAX_BUFFERS;
+	for (int i = 0; i < c->count; i++) {
+		if (camera_map(c, i, flags) || camera_queue(c, i))
+			goto fail;
+	}
+	if (xioctl(c->fd, VIDIOC_STREAMON, &type))
+		goto fail;
+
+	p->camera = c;
+	return 0;
+
+fail:
+	err = errno;
+	camera_free(c);
+	errno = err;
+	return -1;
+}
+
+void psvr2_camera_close(psvr2_t *p)
+{
+	if (!p || !p->camera)
+		return;
+	camera_free(p->camera);
+	p->camera = NULL;
+}
+
+int psvr2_camera_fd(const psvr2_t *p)
+{
+	return p && p->camera ? p->camera->fd : -1;
+}
+
+int psvr2_camera_acquire(psvr2_t *p, struct psvr2_camera_frame *out,
+			 int timeout_ms)
+{
+	struct psvr2_camera *c = p ? p->camera : NULL;
+	uint64_t deadline = psvr2__now_ns() +
+			    (timeout_ms > 0 ? timeout_ms * 1000000ull : 0);
+	struct pollfd pfd[2];
+
+	if (!c) {
+		errno = ENODEV;
+		return -1;
+	}
+	pfd[0] = (struct pollfd){ .fd = c->fd, .events = POLLIN };
+	pfd[1] = (struct pollfd){ .fd = p->wake_fd, .events = POLLIN };
+
+	for (;;) {
+		struct v4l2_buffer b = {
+			.type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+			.memory = V4L2_MEMORY_MMAP,
+		};
+		int wait = -1;
+
+		if (!xioctl(c->fd, VIDIOC_DQBUF, &b)) {
+			struct camera_buffer *cb;
+
+			if (b.index >= (unsigned int)c->count) {
+				errno = EPROTO;
+				return -1;
+			}
+			cb = &c->buf[b.index];
+			/* A torn frame: straight back to the driver. */
+			if (b.flags & V4L2_BUF_FLAG_ERROR) {
+				camera_queue(c, b.index);
+				continue;
+			}
+			__atomic_store_n(&cb->held, 1, __ATOMIC_RELAXED);
+			out->frame.timestamp_ns =
+				b.timestamp.tv_sec * 1000000000ull +
+				b.timestamp.tv_usec * 1000ull;
+			out->frame.width = c->fmt.width;
+			out->frame.height = c->fmt.height;
+			out->frame.fourcc = c->fmt.pixelformat;
+			out->frame.data = cb->map;
+			out->frame.len = b.bytesused;
+			out->sequence = b.sequence;
+			out->dmabuf_fd = cb->dmabuf_fd;
+			out->buffer = b.index;
+			return 1;
+		}
+		if (errno != EAGAIN)
+			return -1;
+		if (!timeout_ms)
+			return 0;
+		if (timeout_ms > 0) {
+			uint64_t now = psvr2__now_ns();
+
+			if (now >= deadline)
+				return 0;
+			wait = (deadline - now + 999999) / 1000000;
+		}
+		if (poll(pfd, 2, wait) < 0 && errno != EINTR)
+			return -1;
+		if (pfd[1].revents & POLLIN) {
+			errno = EINTR;
+			return -1;
+		}
+		/* Streaming stopped under us: the headset went away. */
+		if (pfd[0].revents & POLLERR) {
+			errno = ENODEV;
+			return -1;
+		}
+	}
+}
+
+int psvr2_camera_release(psvr2_t *p, const struct psvr2_camera_frame *f)
+{
+	struct psvr2_camera *c = p ? p->camera : NULL;
+
+	if (!c || !f || f->buffer < 0 || f->buffer >= c->count ||
+	    !__atomic_exchange_n(&c->buf[f->buffer].held, 0,
+				 __ATOMIC_RELAXED)) {
+		errno = EINVAL;
+		return -1;
+	}
+	return camera_queue(c, f->buffer);
+}
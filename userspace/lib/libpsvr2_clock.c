@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — mapping the headset's clocks onto CLOCK_MONOTONIC.
+ *
+ * Pose, gaze and IMU samples each carry a 32-bit microsecond count from the
+ * headset next to the host time they were received at. The receive time is
+ * the measurement time plus a delay that is never below some minimum and
+ * often well above it (USB scheduling, the bulk queue, interrupt latency), so
+ * the line through the lowest points of (device time, receive time) is the
+ * best estimate of when each sample was taken, give or take that constant
+ * minimum: a lower envelope.
+ *
+ * Per stream, the offset receive - device is kept at its minimum over each
+ * quarter second, a line is fitted to the last 10 s of those minima (the slope
+ * being the drift between the two crystals) and then lowered until it touches
+ * the lowest of them; a sample below the line lowers it at once. The streams
+ * come from different parts of the headset, so each has its own estimator;
+ * the camera frames carry no device time and keep their completion times.
+ *
+ * Each estimator is fed by whichever thread reads its stream, as the pose
+ * history; psvr2_clock_get() and _to_host() may run on any other, through a
+ * seqlock.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libpsvr2_int.h"
+
+#define BUCKET_US	250000		/* one minimum per quarter second */
+#define BUCKETS		40		/* fitted over the last 10 s */
+#define MIN_FIT		4		/* buckets before the fit is trusted */
+#define MAX_DRIFT	0.5		/* ns per us, i.e. 500 ppm */
+#define MAX_JUMP_US	10000000	/* clock jumps past this: restart */
+#define MAX_LATE_NS	1e8		/* this far above the envelope, too */
+#define JITTER_WEIGHT	(1.0 / 256)
+
+struct clock_pub {
+	uint32_t	last_raw;
+	uint64_t	dev, base_dev, base_host;
+	double		c, d, jitter;
+	int		locked;
+	uint64_t	resets;
+};
+
+struct bucket {
+	int64_t	idx;			/* x / BUCKET_US, -1 if empty */
+	double	x, y;			/* lowest point */
+};
+
+struct clock_est {
+	/* Reader-thread state. */
+	int		started;
+	uint32_t	last_raw;
+	uint64_t	dev;		/* unwrapped device us */
+	uint64_t	base_dev;	/* origin of x */
+	uint64_t	base_host;	/* origin of y */
+	double		c, d;		/* envelope: y = c + d x */
+	double		jitter;		/* ns above the envelope, averaged */
+	struct bucket	cur;
+	struct bucket	b[BUCKETS];
+	int		fitted;		/* full buckets behind the fit */
+	uint64_t	resets;
+
+	/* Published, under @lock. */
+	uint32_t	lock;
+	struct clock_pub pub;
+};
+
+struct psvr2_clock {
+	struct clock_est est[PSVR2_CLOCK_STREAMS];
+};
+
+struct psvr2_clock *psvr2__clock_alloc(void)
+{
+	return calloc(1, sizeof(struct psvr2_clock));
+}
+
+void psvr2__clock_free(struct psvr2_clock *c)
+{
+	free(c);
+}
+
+static void est_start(struct clock_est *e, uint32_t raw, uint64_t host)
+{
+	e->started = 1;
+	e->last_raw = raw;
+	e->dev = raw;
+	e->base_dev = raw;
+	e->base_host = host;
+	e->c = 0;
+	e->d = 0;
+	e->jitter = 0;
+	e->fitted = 0;
+	e->cur.idx = -1;
+	for (int i = 0; i < BUCKETS; i++)
+		e->b[i].idx = -1;
+}
+
+/* Fit the envelope to the minima of the last BUCKETS buckets. */
+static void est_fit(struct clock_est *e)
+{
+	double sx = 0, sy = 0, sxx = 0, sxy = 0, low = 0;
+	int64_t oldest = e->cur.idx - BUCKETS;
+	int m = 0;
+
+	for (int i = 0; i < BUCKETS; i++) {
+		const struct bucket *b = &e->b[i];
+
+		if (b->idx <= oldest)
+			continue;
+		sx += b->x;
+		sy += b->y;
+		sxx += b->x * b->x;
+		sxy += b->x * b->y;
+		m++;
+	}
+	e->fitted = m;
+	if (!m)
+		return;
+	if (m >= MIN_FIT) {
+		double den = m * sxx - sx * sx;
+
+		if (den > 0) {
+			e->d = (m * sxy - sx * sy) / den;
+			if (e->d > MAX_DRIFT)
+				e->d = MAX_DRIFT;
+			if (e->d < -MAX_DRIFT)
+				e->d = -MAX_DRIFT;
+		}
+	}
+	/* Down onto the lowest minimum: an envelope, not a mean. */
+	for (int i = 0, first = 1; i < BUCKETS; i++) {
+		const struct bucket *b = &e->b[i];
+		double r;
+
+		if (b->idx <= oldest)
+			continue;
+		r = b->y - e->d * b->x;
+		if (first || r < low)
+			low = r;
+		first = 0;
+	}
+	e->c = low;
+}
+
+static void est_publish(struct clock_est *e)
+{
+	psvr2__seq_write_begin(&e->lock);
+	e->pub.last_raw = e->last_raw;
+	e->pub.dev = e->dev;
+	e->pub.base_dev = e->base_dev;
+	e->pub.base_host = e->base_host;
+	e->pub.c = e->c;
+	e->pub.d = e->d;
+	e->pub.jitter = e->jitter;
+	e->pub.locked = e->fitted >= MIN_FIT;
+	e->pub.resets = e->resets;
+	psvr2__seq_write_end(&e->lock);
+}
+
+static uint64_t envelope(double c, double d, uint64_t base_dev,
+			 uint64_t base_host, uint64_t dev)
+{
+	double x = (double)(int64_t)(dev - base_dev);
+
+	return base_host + (int64_t)(dev - base_dev) * 1000 +
+	       (int64_t)(c + d * x);
+}
+
+/* Feed one sample; returns when it was measured, or @host if not known yet. */
+static uint64_t est_push(struct clock_est *e, uint32_t raw, uint64_t host)
+{
+	int32_t step = (int32_t)(raw - e->last_raw);
+	uint64_t at;
+	int64_t idx;
+	double x, y, r;
+
+	if (!e->started || step > MAX_JUMP_US || step < -MAX_JUMP_US) {
+		if (e->started)
+			e->resets++;
+		est_start(e, raw, host);
+		step = 0;
+	}
+	e->dev += step;
+	e->last_raw = raw;
+
+	x = (double)(int64_t)(e->dev - e->base_dev);
+	y = (double)(int64_t)(host - e->base_host) - 1000 * x;
+	r = y - (e->c + e->d * x);
+	if (e->fitted && r > MAX_LATE_NS) {
+		/* The device clock restarted somewhere near where it was. */
+		e->resets++;
+		est_start(e, raw, host);
+		x = 0;
+		y = 0;
+		r = 0;
+	}
+
+	/* Lower-envelope bookkeeping: the minimum of each bucket. */
+	idx = (int64_t)(e->dev - e->base_dev) / BUCKET_US;
+	if (idx < 0)
+		idx = 0;	/* a little before the first sample */
+	if (idx != e->cur.idx) {
+		if (e->cur.idx >= 0) {
+			e->b[e->cur.idx % BUCKETS] = e->cur;
+			e->cur.idx = idx;
+			est_fit(e);
+		}
+		e->cur = (struct bucket){ .idx = idx, .x = x, .y = y };
+	} else if (y < e->cur.y) {
+		e->cur.x = x;
+		e->cur.y = y;
+	}
+
+	/* Nothing can arrive before it was measured: a lower point wins. */
+	if (r < 0) {
+		e->c += r;
+		r = 0;
+	}
+	e->jitter += (r - e->jitter) * JITTER_WEIGHT;
+
+	if (e->fitted < MIN_FIT)
+		return host;
+	at = envelope(e->c, e->d, e->base_dev, e->base_host, e->dev);
+	return at < host ? at : host;
+}
+
+void psvr2__clock_poses(struct psvr2_clock *c, struct psvr2_pose *poses,
+			int n)
+{
+	struct clock_est *e;
+
+	if (!c || n <= 0)
+		return;
+	e = &c->est[PSVR2_CLOCK_POSE];
+	for (int k = 0; k < n; k++)
+		poses[k].measured_ns = est_push(e, poses[k].device_vts_us,
+						poses[k].timestamp_ns);
+	est_publish(e);
+}
+
+void psvr2__clock_gazes(struct psvr2_clock *c, struct psvr2_gaze *gazes,
+			int n)
+{
+	struct clock_est *e;
+
+	if (!c || n <= 0)
+		return;
+	e = &c->est[PSVR2_CLOCK_GAZE];
+	for (int k = 0; k < n; k++)
+		gazes[k].measured_ns = est_push(e, gazes[k].device_timestamp_us,
+						gazes[k].timestamp_ns);
+	est_publish(e);
+}
+
+void psvr2__clock_imu(struct psvr2_clock *c, struct psvr2_imu_sample *s,
+		      int n)
+{
+	struct clock_est *e;
+
+	if (!c || n <= 0)
+		return;
+	e = &c->est[PSVR2_CLOCK_IMU];
+	for (int k = 0; k < n; k++) {
+		/* From a module without the vts channel: nothing to map. */
+		if (!s[k].device_vts_us) {
+			s[k].measured_ns = s[k].timestamp_ns;
+			continue;
+		}
+		s[k].measured_ns = est_push(e, s[k].device_vts_us,
+					    s[k].timestamp_ns);
+	}
+	est_publish(e);
+}
+
+/* A consistent copy of @e's published state; -1 (ENODATA) before any. */
+static int est_read(struct clock_est *e, struct clock_pub *out)
+{
+	uint32_t lock;
+
+	do {
+		lock = psvr2__seq_read_begin(&e->lock);
+		if (!lock) {
+			errno = ENODATA;
+			return -1;
+		}
+		memcpy(out, &e->pub, sizeof(*out));
+	} while (psvr2__seq_read_retry(&e->lock, lock));
+	return 0;
+}
+
+int psvr2_clock_get(psvr2_t *p, int stream, struct psvr2_clock_sync *out)
+{
+	struct clock_pub s;
+
+	if (!p || !p->clock || !out || stream < 0 ||
+	    stream >= PSVR2_CLOCK_STREAMS) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (est_read(&p->clock->est[stream], &s))
+		return -1;
+	out->locked = s.locked;
+	out->drift_ppm = s.d * 1e3;
+	out->jitter_us = s.jitter * 1e-3;
+	out->device_us = s.last_raw;
+	out->host_ns = envelope(s.c, s.d, s.base_dev, s.base_host, s.dev);
+	out->resets = s.resets;
+	return 0;
+}
+
+int psvr2_clock_to_host(psvr2_t *p, int stream, uint32_t device_us,
+			uint64_t *host_ns)
+{
+	struct clock_pub s;
+
+	if (!p || !p->clock || !host_ns || stream < 0 ||
+	    stream >= PSVR2_CLOCK_STREAMS) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (est_read(&p->clock->est[stream], &s))
+		return -1;
+	if (!s.locked) {
+		errno = ENODATA;
+		return -1;
+	}
+	/* Unwrapped around the newest sample: within +-35 minutes of it. */
+	*host_ns = envelope(s.c, s.d, s.base_dev, s.base_host,
+			    s.dev + (int32_t)(device_us - s.last_raw));
+	return 0;
+}
@@ -0,0 +1,664 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — callback dispatch over one epoll set.
+ *
+ * Every watched stream fd is registered edge-triggered, so a wakeup is only
+ * reported once per burst and each one must be drained until a short read says
+ * the queue is empty. The interrupt eventfd is level-triggered: it is latched
+ * until psvr2_interrupt_clear() and must keep ending every dispatch.
+ *
+ * Hotplug comes from udev's netlink monitor (events for the misc pose nodes,
+ * sent once the rules have applied and the node is openable) plus, for the
+ * handle's own headset, the hangup its stream fds report on disconnect. On a
+ * psvr2d handle the eventfds never hang up, so the daemon socket is watched
+ * for that instead.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/input.h>
+#include <linux/netlink.h>
+
+#include "libpsvr2_int.h"
+#include "libpsvr2_rec.h"
+#include "libpsvr2_shm.h"
+
+#define INPUT_SYS_DIR	"/sys/class/input"
+#define INPUT_BATCH	64
+
+/* udev's rebroadcast group and its message header (libudev-monitor.c). */
+#define UDEV_MONITOR_GROUP	2
+#define UDEV_MONITOR_MAGIC	0xfeedcafe
+#define UEVENT_BUF		8192
+
+struct udev_monitor_hdr {
+	char		prefix[8];	/* "libudev" */
+	uint32_t	magic;		/* network order */
+	uint32_t	header_size;
+	uint32_t	properties_off;
+	uint32_t	properties_len;
+};
+
+enum dispatch_src {
+	SRC_WAKE,
+	SRC_POSE,
+	SRC_GAZE,
+	SRC_IMU,
+	SRC_INPUT,
+	SRC_UEVENT,
+	SRC_DAEMON,
+	SRC_COUNT,
+};
+
+struct psvr2_dispatch {
+	struct psvr2_callbacks cb;
+	int	epoll_fd;
+	int	input_fd;		/* evdev controls node, or -1 */
+	int	uevent_fd;		/* udev monitor socket, or -1 */
+	int	stop_fd;		/* watched instead of wake_fd, or -1 */
+	int	watched[SRC_COUNT];	/* fd in the epoll set, or -1 */
+	unsigned int hung_up;		/* 1 << SRC_* that reported EOF */
+	int	gone;			/* own removal reported */
+	int	input_dropped;		/* SYN_DROPPED, resync due */
+	union {
+		struct psvr2_pose	 poses[POSE_BATCH];
+		struct psvr2_gaze	 gazes[GAZE_BATCH];
+		struct psvr2_imu_sample	 imu[IMU_BATCH];
+		struct input_event	 input[INPUT_BATCH];
+		struct psvr2_input_event events[INPUT_BATCH];
+		char			 uevent[UEVENT_BUF];
+	} buf;
+};
+
+/* ---- sources ------------------------------------------------------------ */
+
+/* The evdev node whose input device hangs off one of this headset's intfs. */
+static int open_input(const psvr2_t *p)
+{
+	DIR *d = opendir(INPUT_SYS_DIR);
+	struct dirent *e;
+	int fd = -1;
+
+	if (!d)
+		return -1;
+	while ((e = readdir(d))) {
+		char path[512];
+		int clk = CLOCK_MONOTONIC;
+
+		if (strncmp(e->d_name, "event", 5))
+			continue;
+		/* eventN/device is inputM; its parent is the interface. */
+		snprintf(path, sizeof(path), "%s/%s/device/..", INPUT_SYS_DIR,
+			 e->d_name);
+		if (!psvr2__on_usb_device(path, p->usb_path))
+			continue;
+		snprintf(path, sizeof(path), "/dev/input/%s", e->d_name);
+		fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		/* Same clock as every other stream's timestamps. */
+		if (fd >= 0)
+			ioctl(fd, EVIOCSCLOCKID, &clk);
+		break;
+	}
+	closedir(d);
+	return fd;
+}
+
+static int open_uevent(void)
+{
+	struct sockaddr_nl sa = {
+		.nl_family = AF_NETLINK,
+		.nl_groups = UDEV_MONITOR_GROUP,
+	};
+	int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			NETLINK_KOBJECT_UEVENT);
+
+	if (fd < 0)
+		return -1;
+	if (bind(fd, (struct sockaddr *)&sa, sizeof(sa))) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int source_fd(const psvr2_t *p, const struct psvr2_dispatch *d,
+		     enum dispatch_src src)
+{
+	if (d->hung_up & (1u << src))
+		return -1;
+
+	switch (src) {
+	case SRC_WAKE:
+		return d->stop_fd >= 0 ? d->stop_fd : p->wake_fd;
+	case SRC_POSE:
+		return d->cb.pose ? p->pose_fd : -1;
+	case SRC_GAZE:
+		return d->cb.gaze ? p->gaze_fd : -1;
+	case SRC_IMU:
+		return d->cb.imu ? p->imu_fd : -1;
+	case SRC_INPUT:
+		return d->cb.input ? d->input_fd : -1;
+	case SRC_UEVENT:
+		return d->cb.hotplug ? d->uevent_fd : -1;
+	case SRC_DAEMON:
+		return psvr2__shared_sock(p);
+	default:
+		return -1;
+	}
+}
+
+void psvr2__dispatch_update(psvr2_t *p)
+{
+	struct psvr2_dispatch *d = p->disp;
+
+	if (!d)
+		return;
+
+	for (int src = 0; src < SRC_COUNT; src++) {
+		struct epoll_event ev = {
+			.events = src == SRC_WAKE ? EPOLLIN :
+				  src == SRC_DAEMON ? EPOLLRDHUP :
+						      EPOLLIN | EPOLLET,
+			.data.u32 = src,
+		};
+		int fd = source_fd(p, d, src);
+
+		if (fd == d->watched[src])
+			continue;
+		if (d->watched[src] >= 0)
+			epoll_ctl(d->epoll_fd, EPOLL_CTL_DEL, d->watched[src],
+				  NULL);
+		d->watched[src] = -1;
+		/* Anything already queued is reported by the ADD itself. */
+		if (fd >= 0 && !epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, fd, &ev))
+			d->watched[src] = fd;
+	}
+}
+
+/* EOF or a dead device on one of our streams: the headset went away. */
+static void hang_up(psvr2_t *p, struct psvr2_dispatch *d,
+		    enum dispatch_src src)
+{
+	d->hung_up |= 1u << src;
+	psvr2__dispatch_update(p);
+	if (d->gone)
+		return;
+	/* A recording's streams run out one by one; it ends with the last. */
+	if (p->replay) {
+		for (int s = SRC_POSE; s <= SRC_INPUT; s++)
+			if (d->watched[s] >= 0)
+				return;
+	}
+	d->gone = 1;
+	if (d->cb.hotplug)
+		d->cb.hotplug(d->cb.user, p->index, 0);
+}
+
+/* ---- draining ----------------------------------------------------------- */
+
+/*
+ * read() until a short one: the queue was empty at that instant, and anything
+ * queued later raises a fresh edge. Returns the number of whole records read,
+ * 0 if none are pending, -1 on EOF or a fatal error.
+ */
+static int read_batch(int fd, void *buf, size_t sz, int max)
+{
+	for (;;) {
+		ssize_t n = read(fd, buf, sz * max);
+
+		if (n > 0)
+			return n / sz;
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return 0;
+		return -1;
+	}
+}
+
+static int drain_pose(psvr2_t *p, struct psvr2_dispatch *d)
+{
+	int n, total = 0;
+
+	do {
+		if (p->shared)
+			n = psvr2__shared_drain(p, PSVR2_SHM_POSE, d->buf.poses,
+						POSE_BATCH);
+		else if (p->replay)
+			n = psvr2__replay_drain(p, PSVR2_REC_POSE, d->buf.poses,
+						POSE_BATCH);
+		else
+			n = read_batch(p->pose_fd, p->pose_buf,
+				       sizeof(p->pose_buf[0]), POSE_BATCH);
+		if (n < 0) {
+			hang_up(p, d, SRC_POSE);
+			break;
+		}
+		if (!n)
+			break;
+		if (!p->shared && !p->replay)
+			psvr2__convert_poses(d->buf.poses, p->pose_buf, n);
+		psvr2__after_poses(p, d->buf.poses, n);
+		d->cb.pose(d->cb.user, d->buf.poses, n);
+		total += n;
+	} while (n == POSE_BATCH);
+	return total;
+}
+
+static int drain_gaze(psvr2_t *p, struct psvr2_dispatch *d)
+{
+	int n, total = 0;
+
+	do {
+		if (p->shared)
+			n = psvr2__shared_drain(p, PSVR2_SHM_GAZE, d->buf.gazes,
+						GAZE_BATCH);
+		else if (p->replay)
+			n = psvr2__replay_drain(p, PSVR2_REC_GAZE, d->buf.gazes,
+						GAZE_BATCH);
+		else
+			n = read_batch(p->gaze_fd, p->gaze_buf,
+				       sizeof(p->gaze_buf[0]), GAZE_BATCH);
+		if (n < 0) {
+			hang_up(p, d, SRC_GAZE);
+			break;
+		}
+		if (!n)
+			break;
+		if (!p->shared && !p->replay)
+			psvr2__convert_gazes(d->buf.gazes, p->gaze_buf, n);
+		psvr2__after_gazes(p, d->buf.gazes, n);
+		d->cb.gaze(d->cb.user, d->buf.gazes, n);
+		total += n;
+	} while (n == GAZE_BATCH);
+	return total;
+}
+
+static int drain_imu(psvr2_t *p, struct psvr2_dispatch *d)
+{
+	int n, total = 0;
+
+	do {
+		if (p->shared)
+			n = psvr2__shared_drain(p, PSVR2_SHM_IMU, d->buf.imu,
+						IMU_BATCH);
+		else if (p->replay)
+			n = psvr2__replay_drain(p, PSVR2_REC_IMU, d->buf.imu,
+						IMU_BATCH);
+		else
+			n = read_batch(p->imu_fd, p->imu_scan,
+				       sizeof(p->imu_scan[0]), IMU_BATCH);
+		if (n < 0) {
+			hang_up(p, d, SRC_IMU);
+			break;
+		}
+		if (!n)
+			break;
+		if (!p->shared && !p->replay)
+			psvr2__convert_imu(p, d->buf.imu, p->imu_scan, n);
+		psvr2__after_imu(p, d->buf.imu, n);
+		d->cb.imu(d->cb.user, d->buf.imu, n);
+		total += n;
+	} while (n == IMU_BATCH);
+	return total;
+}
+
+static void input_emit(struct psvr2_dispatch *d, uint64_t ts, int kind,
+		       int value)
+{
+	struct psvr2_input_event ev = {
+		.timestamp_ns = ts,
+		.kind = kind,
+		.value = value,
+	};
+
+	d->cb.input(d->cb.user, &ev);
+}
+
+/* After SYN_DROPPED: report the device's current state, as evdev says to. */
+static int input_resync(struct psvr2_dispatch *d, uint64_t ts)
+{
+	unsigned long keys[KEY_CNT / (8 * sizeof(long)) + 1] = { 0 };
+	unsigned long sw[SW_CNT / (8 * sizeof(long)) + 1] = { 0 };
+	const int bits = 8 * sizeof(long);
+	struct input_absinfo abs;
+	int n = 0;
+
+	if (ioctl(d->input_fd, EVIOCGKEY(sizeof(keys)), keys) >= 0) {
+		input_emit(d, ts, PSVR2_INPUT_FUNCTION_BUTTON,
+			   !!(keys[BTN_MODE / bits] &
+			      (1ul << BTN_MODE % bits)));
+		n++;
+	}
+	if (ioctl(d->input_fd, EVIOCGSW(sizeof(sw)), sw) >= 0) {
+		input_emit(d, ts, PSVR2_INPUT_WORN,
+			   !!(sw[SW_FRONT_PROXIMITY / bits] &
+			      (1ul << SW_FRONT_PROXIMITY % bits)));
+		n++;
+	}
+	if (ioctl(d->input_fd, EVIOCGABS(ABS_MISC), &abs) >= 0) {
+		input_emit(d, ts, PSVR2_INPUT_IPD, abs.value);
+		n++;
+	}
+	return n;
+}
+
+/* A recording's events come as they were reported, resyncs and all. */
+static int drain_replay_input(psvr2_t *p, struct psvr2_dispatch *d)
+{
+	int n, total = 0;
+
+	do {
+		n = psvr2__replay_drain(p, PSVR2_REC_INPUT, d->buf.events,
+					INPUT_BATCH);
+		if (n < 0) {
+			hang_up(p, d, SRC_INPUT);
+			break;
+		}
+		for (int i = 0; i < n; i++)
+			d->cb.input(d->cb.user, &d->buf.events[i]);
+		total += n;
+	} while (n == INPUT_BATCH);
+	return total;
+}
+
+static int drain_input(psvr2_t *p, struct psvr2_dispatch *d)
+{
+	int n, total = 0;
+
+	if (p->replay)
+		return drain_replay_input(p, d);
+	do {
+		n = read_batch(d->input_fd, d->buf.input,
+			       sizeof(d->buf.input[0]), INPUT_BATCH);
+		if (n < 0) {
+			hang_up(p, d, SRC_INPUT);
+			break;
+		}
+		for (int i = 0; i < n; i++) {
+			const struct input_event *ev = &d->buf.input[i];
+			uint64_t ts = ev->input_event_sec * 1000000000ull +
+				      ev->input_event_usec * 1000ull;
+
+			if (ev->type == EV_SYN && ev->code == SYN_DROPPED) {
+				d->input_dropped = 1;
+			} else if (d->input_dropped) {
+				/* Skip to the end of the torn report. */
+				if (ev->type == EV_SYN &&
+				    ev->code == SYN_REPORT) {
+					d->input_dropped = 0;
+					total += input_resync(d, ts);
+				}
+			} else if (ev->type == EV_KEY && ev->code == BTN_MODE) {
+				input_emit(d, ts, PSVR2_INPUT_FUNCTION_BUTTON,
+					   ev->value != 0);
+				total++;
+			} else if (ev->type == EV_SW &&
+				   ev->code == SW_FRONT_PROXIMITY) {
+				input_emit(d, ts, PSVR2_INPUT_WORN,
+					   ev->value != 0);
+				total++;
+			} else if (ev->type == EV_ABS && ev->code == ABS_MISC) {
+				input_emit(d, ts, PSVR2_INPUT_IPD, ev->value);
+				total++;
+			}
+		}
+	} while (n == INPUT_BATCH);
+	return total;
+}
+
+/* One udev message: report add/remove of any headset's pose node. */
+static int handle_uevent(psvr2_t *p, struct psvr2_dispatch *d, size_t len)
+{
+	const struct udev_monitor_hdr *hdr = (const void *)d->buf.uevent;
+	const char *action = NULL, *subsystem = NULL, *devname = NULL;
+	const char *prop, *end, *base;
+	int index, pos = 0, present;
+
+	if (len < sizeof(*hdr) || memcmp(hdr->prefix, "libudev", 8) ||
+	    ntohl(hdr->magic) != UDEV_MONITOR_MAGIC ||
+	    hdr->properties_off > len ||
+	    hdr->properties_len > len - hdr->properties_off)
+		return 0;
+
+	prop = d->buf.uevent + hdr->properties_off;
+	end = prop + hdr->properties_len;
+	while (prop < end) {
+		size_t plen = strnlen(prop, end - prop);
+
+		if (!strncmp(prop, "ACTION=", 7))
+			action = prop + 7;
+		else if (!strncmp(prop, "SUBSYSTEM=", 10))
+			subsystem = prop + 10;
+		else if (!strncmp(prop, "DEVNAME=", 8))
+			devname = prop + 8;
+		prop += plen + 1;
+	}
+	if (!action || !subsystem || !devname || strcmp(subsystem, "misc"))
+		return 0;
+
+	/* udev has "/dev/psvr2-poseN"; the gaze node would just repeat it. */
+	base = strrchr(devname, '/');
+	base = base ? base + 1 : devname;
+	if (sscanf(base, "psvr2-pose%d%n", &index, &pos) != 1 ||
+	    base[pos] != '\0')
+		return 0;
+
+	if (!strcmp(action, "add"))
+		present = 1;
+	else if (!strcmp(action, "remove"))
+		present = 0;
+	else
+		return 0;
+
+	if (index == p->index && !present) {
+		if (d->gone)
+			return 0;
+		d->gone = 1;
+	}
+	d->cb.hotplug(d->cb.user, index, present);
+	return 1;
+}
+
+static int drain_uevent(psvr2_t *p, struct psvr2_dispatch *d)
+{
+	int total = 0;
+
+	for (;;) {
+		/* Leave room to NUL-terminate a truncated last property. */
+		ssize_t n = recv(d->uevent_fd, d->buf.uevent,
+				 sizeof(d->buf.uevent) - 1, MSG_DONTWAIT);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno == ENOBUFS)
+			continue;	/* overran; newer messages follow */
+		if (n <= 0)
+			break;
+		d->buf.uevent[n] = '\0';
+		total += handle_uevent(p, d, n);
+	}
+	return total;
+}
+
+/*
+ * psvr2d hung up: hand over what it published before it went, then report
+ * the headset gone, as its nodes would on unplug.
+ */
+static int drain_daemon(psvr2_t *p, struct psvr2_dispatch *d)
+{
+	int total = 0;
+
+	if (d->watched[SRC_POSE] >= 0)
+		total += drain_pose(p, d);
+	if (d->watched[SRC_GAZE] >= 0)
+		total += drain_gaze(p, d);
+	if (d->watched[SRC_IMU] >= 0)
+		total += drain_imu(p, d);
+	hang_up(p, d, SRC_DAEMON);
+	return total;
+}
+
+/* ---- API ---------------------------------------------------------------- */
+
+void psvr2__dispatch_free(psvr2_t *p)
+{
+	struct psvr2_dispatch *d = p->disp;
+
+	if (!d)
+		return;
+	close(d->epoll_fd);
+	if (d->input_fd >= 0)
+		close(d->input_fd);
+	if (d->uevent_fd >= 0)
+		close(d->uevent_fd);
+	free(d);
+	p->disp = NULL;
+}
+
+int psvr2__set_callbacks(psvr2_t *p, const struct psvr2_callbacks *cb,
+			 int stop_fd)
+{
+	struct psvr2_dispatch *d;
+
+	if (!cb) {
+		psvr2__dispatch_free(p);
+		return 0;
+	}
+
+	d = p->disp;
+	if (!d) {
+		d = calloc(1, sizeof(*d));
+		if (!d)
+			return -1;
+		d->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (d->epoll_fd < 0) {
+			free(d);
+			return -1;
+		}
+		d->input_fd = -1;
+		d->uevent_fd = -1;
+		for (int src = 0; src < SRC_COUNT; src++)
+			d->watched[src] = -1;
+		p->disp = d;
+	}
+
+	d->cb = *cb;
+	d->stop_fd = stop_fd;
+	/* A missing node just means that callback never fires. */
+	if (cb->input && d->input_fd < 0 && p->index >= 0)
+		d->input_fd = open_input(p);
+	/* Its own fd, closed with the dispatcher's like the evdev one. */
+	if (cb->input && d->input_fd < 0 && p->replay)
+		d->input_fd = fcntl(psvr2__replay_input_fd(p), F_DUPFD_CLOEXEC,
+				    0);
+	if (cb->hotplug && d->uevent_fd < 0)
+		d->uevent_fd = open_uevent();
+	psvr2__dispatch_update(p);
+	return 0;
+}
+
+/* While ingesting, the dispatcher belongs to the ingestion thread. */
+int psvr2_set_callbacks(psvr2_t *p, const struct psvr2_callbacks *cb)
+{
+	if (!p)
+		return -1;
+	if (p->ingest) {
+		errno = EBUSY;
+		return -1;
+	}
+	return psvr2__set_callbacks(p, cb, -1);
+}
+
+int psvr2_dispatch_fd(const psvr2_t *p)
+{
+	return p && p->disp ? p->disp->epoll_fd : -1;
+}
+
+int psvr2__dispatch(psvr2_t *p, int timeout_ms)
+{
+	uint64_t deadline = psvr2__now_ns() +
+			    (timeout_ms > 0 ? timeout_ms * 1000000ull : 0);
+	struct epoll_event ev[SRC_COUNT];
+	struct psvr2_dispatch *d;
+	int n, total = 0, woken = 0;
+
+	if (!p || !p->disp) {
+		errno = EINVAL;
+		return -1;
+	}
+	d = p->disp;
+
+	while ((n = epoll_wait(d->epoll_fd, ev, SRC_COUNT, timeout_ms)) < 0) {
+		uint64_t now;
+
+		if (errno != EINTR)
+			return -1;
+		if (timeout_ms <= 0)
+			continue;
+		/* A signal: wait out the rest of the deadline. */
+		now = psvr2__now_ns();
+		if (now >= deadline)
+			return 0;
+		timeout_ms = (deadline - now + 999999) / 1000000;
+	}
+
+	/* A source a callback stopped (psvr2_imu_stop) reads as fd -1: skip. */
+	for (int i = 0; i < n; i++) {
+		switch (ev[i].data.u32) {
+		case SRC_WAKE:
+			woken = 1;
+			break;
+		case SRC_POSE:
+			if (d->watched[SRC_POSE] >= 0)
+				total += drain_pose(p, d);
+			break;
+		case SRC_GAZE:
+			if (d->watched[SRC_GAZE] >= 0)
+				total += drain_gaze(p, d);
+			break;
+		case SRC_IMU:
+			if (d->watched[SRC_IMU] >= 0)
+				total += drain_imu(p, d);
+			break;
+		case SRC_INPUT:
+			if (d->watched[SRC_INPUT] >= 0)
+				total += drain_input(p, d);
+			break;
+		case SRC_UEVENT:
+			if (d->watched[SRC_UEVENT] >= 0)
+				total += drain_uevent(p, d);
+			break;
+		case SRC_DAEMON:
+			if (d->watched[SRC_DAEMON] >= 0)
+				total += drain_daemon(p, d);
+			break;
+		}
+	}
+
+	if (woken) {
+		errno = EINTR;
+		return -1;
+	}
+	return total;
+}
+
+int psvr2_dispatch(psvr2_t *p, int timeout_ms)
+{
+	if (p && p->ingest) {
+		errno = EBUSY;
+		return -1;
+	}
+	return psvr2__dispatch(p, timeout_ms);
+}
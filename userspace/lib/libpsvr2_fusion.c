@@ -0,0 +1,696 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — SLAM + IMU fusion: an error-state Kalman filter.
+ *
+ * The nominal state is position, velocity and orientation in the SLAM frame,
+ * accel and gyro biases, and gravity as seen in that frame (which the tracker
+ * doesn't tell us). Every IMU sample propagates it and the 18x18 covariance
+ * of its error; every valid SLAM pose corrects it. F is the identity but for
+ * a few 3x3 blocks, so F P F^T is done as two passes of row operations rather
+ * than dense products, and the correction needs a 6x6 solve.
+ *
+ * A SLAM pose usually arrives after IMU samples from later on have been
+ * applied (or, with the IIO watermark, before the ones from its own time):
+ * poses wait until the IMU has caught up with them, and are then compared
+ * against the state kept for their time, with the correction applied to the
+ * current one. One reading thread feeds both streams, as for the pose history;
+ * the output ring can be read from anywhere.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libpsvr2_int.h"
+
+#define N		18		/* error state */
+#define EP		0		/* position */
+#define EV		3		/* velocity */
+#define ETH		6		/* orientation, local */
+#define EBA		9		/* accel bias */
+#define EBG		12		/* gyro bias */
+#define EG		15		/* gravity */
+
+#define GRAVITY		9.80665
+#define OUT_RING	1024		/* power of two; half a second */
+#define STATE_HIST	256		/* power of two; 128 ms of IMU steps */
+#define PENDING		16		/* poses waiting for the IMU */
+#define PENDING_MAX_NS	50000000ull	/* then apply them regardless */
+#define MAX_DT		0.02
+#define CHI2_6DOF	22.46		/* 99.9 % */
+#define MAX_REJECTS	20		/* in a row: start over from SLAM */
+
+/* Per-sample/-pose standard deviations; the config overrides them. */
+static const struct psvr2_fusion_config defaults = {
+	.imu_to_body = { 1, 0, 0, 0 },
+	.accel_noise = 0.2f,		/* m/s^2 */
+	.gyro_noise = 0.01f,		/* rad/s */
+	.accel_bias_walk = 1e-3f,	/* m/s^2 per sqrt(s) */
+	.gyro_bias_walk = 1e-4f,	/* rad/s per sqrt(s) */
+	.position_noise = 0.002f,	/* m */
+	.orientation_noise = 0.002f,	/* rad */
+};
+
+struct nominal {
+	double	p[3], v[3], q[4], ba[3], bg[3], g[3];
+};
+
+struct past_state {
+	uint64_t t;
+	double	p[3], q[4];
+};
+
+struct psvr2_fusion {
+	struct psvr2_engine e;		/* first; fused poses out */
+
+	/* Reader thread. */
+	struct psvr2_fusion_config cfg;
+	struct psvr2_fusion_stats acc;	/* published per batch */
+	double		r_bi[3][3];	/* IMU to body */
+	struct nominal	x;
+	double		P[N][N], T[N][N];
+	int		started;
+	int		rejects;
+	uint64_t	t;		/* of the last IMU step */
+	double		accel[3];	/* last sample, body frame */
+	double		omega[3];	/* last rate, bias-corrected */
+	struct past_state hist[STATE_HIST];
+	uint64_t	hist_head;
+	struct psvr2_pose pending[PENDING];
+	int		n_pending;
+	struct psvr2_fused_pose out[IMU_BATCH];
+};
+
+/* ---- small 3-vector / quaternion helpers (double) ----------------------- */
+
+static void qmul(double o[4], const double a[4], const double b[4])
+{
+	double r[4] = {
+		a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3],
+		a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+		a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1],
+		a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0],
+	};
+
+	memcpy(o, r, sizeof(r));
+}
+
+static void qnormalise(double q[4])
+{
+	double n = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+
+	for (int i = 0; i < 4; i++)
+		q[i] /= n;
+}
+
+/* Rotation vector to quaternion. */
+static void qexp(double q[4], const double v[3])
+{
+	double th = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	double s = th < 1e-9 ? 0.5 : sin(th / 2) / th;
+
+	q[0] = th < 1e-9 ? 1 : cos(th / 2);
+	for (int i = 0; i < 3; i++)
+		q[i + 1] = v[i] * s;
+	qnormalise(q);
+}
+
+/* Quaternion to rotation vector, the short way round. */
+static void qlog(double v[3], const double q[4])
+{
+	double sgn = q[0] < 0 ? -1 : 1;
+	double n = sqrt(q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	double k = n < 1e-9 ? 2 * sgn : 2 * atan2(n, sgn * q[0]) / n;
+
+	for (int i = 0; i < 3; i++)
+		v[i] = k * q[i + 1];
+}
+
+/* Body-to-world matrix of @q. */
+static void qmat(double R[3][3], const double q[4])
+{
+	double w = q[0], x = q[1], y = q[2], z = q[3];
+
+	R[0][0] = 1 - 2 * (y * y + z * z);
+	R[0][1] = 2 * (x * y - w * z);
+	R[0][2] = 2 * (x * z + w * y);
+	R[1][0] = 2 * (x * y + w * z);
+	R[1][1] = 1 - 2 * (x * x + z * z);
+	R[1][2] = 2 * (y * z - w * x);
+	R[2][0] = 2 * (x * z - w * y);
+	R[2][1] = 2 * (y * z + w * x);
+	R[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+static void mat3_vec(double o[3], const double M[3][3], const double v[3])
+{
+	for (int i = 0; i < 3; i++)
+		o[i] = M[i][0] * v[0] + M[i][1] * v[1] + M[i][2] * v[2];
+}
+
+/* ---- filter ------------------------------------------------------------- */
+
+static void fusion_init(struct psvr2_fusion *f, const struct psvr2_pose *pose)
+{
+	static const double var[N] = {
+		1e-6, 1e-6, 1e-6,	/* position, m^2 */
+		1e-2, 1e-2, 1e-2,	/* velocity */
+		1e-4, 1e-4, 1e-4,	/* orientation, rad^2 */
+		1e-2, 1e-2, 1e-2,	/* accel bias */
+		1e-4, 1e-4, 1e-4,	/* gyro bias */
+		0.25, 0.25, 0.25,	/* gravity */
+	};
+	struct nominal *x = &f->x;
+	double R[3][3], a[3];
+
+	memset(x, 0, sizeof(*x));
+	for (int i = 0; i < 3; i++)
+		x->p[i] = pose->position[i];
+	for (int i = 0; i < 4; i++)
+		x->q[i] = pose->orientation[i];
+	qnormalise(x->q);
+
+	/* Taking the headset to be still: gravity opposes the accel. */
+	qmat(R, x->q);
+	mat3_vec(a, R, f->accel);
+	for (int i = 0; i < 3; i++)
+		x->g[i] = -a[i];
+
+	memset(f->P, 0, sizeof(f->P));
+	for (int i = 0; i < N; i++)
+		f->P[i][i] = var[i];
+	f->hist_head = 0;
+	f->n_pending = 0;
+	f->rejects = 0;
+	f->started = 1;
+}
+
+/*
+ * M = F M, F being I plus the blocks of one IMU step: p += v dt;
+ * v += A th + B ba + g dt; th = C th - bg dt.
+ */
+static void apply_f(double M[N][N], double dt, const double A[3][3],
+		    const double B[3][3], const double C[3][3])
+{
+	double th[3][N];
+
+	for (int i = 0; i < 3; i++)
+		for (int c = 0; c < N; c++)
+			M[EP + i][c] += dt * M[EV + i][c];
+	for (int i = 0; i < 3; i++)
+		for (int c = 0; c < N; c++) {
+			double s = dt * M[EG + i][c];
+
+			for (int j = 0; j < 3; j++)
+				s += A[i][j] * M[ETH + j][c] +
+				     B[i][j] * M[EBA + j][c];
+			M[EV + i][c] += s;
+		}
+	for (int i = 0; i < 3; i++)
+		for (int c = 0; c < N; c++)
+			th[i][c] = C[i][0] * M[ETH][c] +
+				   C[i][1] * M[ETH + 1][c] +
+				   C[i][2] * M[ETH + 2][c] -
+				   dt * M[EBG + i][c];
+	memcpy(M[ETH], th, sizeof(th));
+}
+
+static void predict(struct psvr2_fusion *f, const struct psvr2_imu_sample *s,
+		    double dt)
+{
+	const struct psvr2_fusion_config *c = &f->cfg;
+	struct nominal *x = &f->x;
+	double R[3][3], A[3][3], B[3][3], C[3][3], dq[4], aw[3], th[3];
+	double m[3], qa, qg, qba, qbg;
+
+	for (int i = 0; i < 3; i++)
+		m[i] = s->accel_m_s2[i];
+	mat3_vec(f->accel, f->r_bi, m);
+	for (int i = 0; i < 3; i++)
+		m[i] = s->gyro_rad_s[i];
+	mat3_vec(f->omega, f->r_bi, m);
+	for (int i = 0; i < 3; i++) {
+		f->accel[i] -= x->ba[i];
+		f->omega[i] -= x->bg[i];
+		th[i] = f->omega[i] * dt;
+	}
+
+	/* Nominal state. */
+	qmat(R, x->q);
+	mat3_vec(aw, R, f->accel);
+	for (int i = 0; i < 3; i++) {
+		aw[i] += x->g[i];
+		x->p[i] += x->v[i] * dt + 0.5 * aw[i] * dt * dt;
+		x->v[i] += aw[i] * dt;
+	}
+	qexp(dq, th);
+	qmul(x->q, x->q, dq);
+	qnormalise(x->q);
+
+	/* A = -R [a]x dt, B = -R dt, C = Exp(w dt)^T */
+	for (int i = 0; i < 3; i++) {
+		const double *a = f->accel;
+
+		A[i][0] = -(R[i][1] * a[2] - R[i][2] * a[1]) * dt;
+		A[i][1] = -(R[i][2] * a[0] - R[i][0] * a[2]) * dt;
+		A[i][2] = -(R[i][0] * a[1] - R[i][1] * a[0]) * dt;
+		for (int j = 0; j < 3; j++)
+			B[i][j] = -R[i][j] * dt;
+	}
+	qmat(C, dq);
+	for (int i = 0; i < 3; i++)
+		for (int j = i + 1; j < 3; j++) {
+			double t = C[i][j];
+
+			C[i][j] = C[j][i];
+			C[j][i] = t;
+		}
+
+	/* P = F P F^T + Q, as F (F P)^T with P symmetric. */
+	apply_f(f->P, dt, A, B, C);
+	for (int i = 0; i < N; i++)
+		for (int j = 0; j < N; j++)
+			f->T[j][i] = f->P[i][j];
+	apply_f(f->T, dt, A, B, C);
+	qa = c->accel_noise * dt;
+	qg = c->gyro_noise * dt;
+	qba = c->accel_bias_walk * c->accel_bias_walk * dt;
+	qbg = c->gyro_bias_walk * c->gyro_bias_walk * dt;
+	for (int i = 0; i < N; i++)
+		for (int j = i; j < N; j++)
+			f->P[i][j] = f->P[j][i] =
+				0.5 * (f->T[i][j] + f->T[j][i]);
+	for (int i = 0; i < 3; i++) {
+		f->P[EV + i][EV + i] += qa * qa;
+		f->P[ETH + i][ETH + i] += qg * qg;
+		f->P[EBA + i][EBA + i] += qba;
+		f->P[EBG + i][EBG + i] += qbg;
+	}
+}
+
+enum { STAT_PREDICT, STAT_UPDATE, STAT_REJECT };
+
+static void stats_add(struct psvr2_fusion *f, int what, uint64_t ns)
+{
+	switch (what) {
+	case STAT_PREDICT:
+		f->acc.predicts++;
+		f->acc.predict_ns += ns;
+		break;
+	case STAT_UPDATE:
+		f->acc.updates++;
+		f->acc.update_ns += ns;
+		break;
+	default:
+		f->acc.rejected++;
+	}
+}
+
+/* In-place Cholesky solve of S X = Y for the 6x6 S, @cols columns of Y. */
+static int solve6(double S[6][6], double *Y, int cols)
+{
+	for (int j = 0; j < 6; j++) {
+		double d = S[j][j];
+
+		for (int k = 0; k < j; k++)
+			d -= S[j][k] * S[j][k];
+		if (d <= 0)
+			return -1;
+		S[j][j] = sqrt(d);
+		for (int i = j + 1; i < 6; i++) {
+			double v = S[i][j];
+
+			for (int k = 0; k < j; k++)
+				v -= S[i][k] * S[j][k];
+			S[i][j] = v / S[j][j];
+		}
+	}
+	for (int c = 0; c < cols; c++) {
+		double *y = Y + c * 6;
+
+		for (int i = 0; i < 6; i++) {
+			for (int k = 0; k < i; k++)
+				y[i] -= S[i][k] * y[k];
+			y[i] /= S[i][i];
+		}
+		for (int i = 5; i >= 0; i--) {
+			for (int k = i + 1; k < 6; k++)
+				y[i] -= S[k][i] * y[k];
+			y[i] /= S[i][i];
+		}
+	}
+	return 0;
+}
+
+/* The kept step at or just before @t; NULL if @t is past the newest. */
+static struct past_state *state_at(struct psvr2_fusion *f, uint64_t t)
+{
+	uint64_t lo = f->hist_head > STATE_HIST ? f->hist_head - STATE_HIST : 0;
+	struct past_state *h = NULL;
+
+	for (uint64_t i = f->hist_head; i-- > lo;) {
+		h = &f->hist[i & (STATE_HIST - 1)];
+		if (h->t <= t)
+			return i + 1 == f->hist_head ? NULL : h;
+	}
+	return h;		/* older than all of them: the oldest */
+}
+
+static void correct(struct psvr2_fusion *f, const struct psvr2_pose *pose)
+{
+	const int idx[6] = { EP, EP + 1, EP + 2, ETH, ETH + 1, ETH + 2 };
+	struct past_state *then = state_at(f, pose->measured_ns);
+	const double *p = then ? then->p : f->x.p, *q = then ? then->q : f->x.q;
+	double qm[4], qi[4], dq[4], r[6], S[6][6], K[6][N];
+	double dx[N], rs[6], d2 = 0, pv, rv;
+	struct nominal *x = &f->x;
+
+	for (int i = 0; i < 3; i++)
+		r[i] = pose->position[i] - p[i];
+	for (int i = 0; i < 4; i++)
+		qm[i] = pose->orientation[i];
+	qnormalise(qm);
+	qi[0] = q[0];
+	for (int i = 1; i < 4; i++)
+		qi[i] = -q[i];
+	qmul(dq, qi, qm);
+	qlog(r + 3, dq);
+
+	/* S = H P H^T + R; K^T = S^-1 H P, H picking rows @idx. */
+	pv = f->cfg.position_noise * f->cfg.position_noise;
+	rv = f->cfg.orientation_noise * f->cfg.orientation_noise;
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j < 6; j++)
+			S[i][j] = f->P[idx[i]][idx[j]];
+		S[i][i] += i < 3 ? pv : rv;
+	}
+	for (int c = 0; c < N; c++)
+		for (int i = 0; i < 6; i++)
+			K[i][c] = f->P[idx[i]][c];
+
+	/* Mahalanobis gate on a copy of S (the solve factors it in place). */
+	{
+		double S2[6][6];
+
+		memcpy(S2, S, sizeof(S));
+		memcpy(rs, r, sizeof(r));
+		if (solve6(S2, rs, 1))
+			return;
+		for (int i = 0; i < 6; i++)
+			d2 += r[i] * rs[i];
+	}
+	if (d2 > CHI2_6DOF) {
+		stats_add(f, STAT_REJECT, 0);
+		if (++f->rejects >= MAX_REJECTS)
+			fusion_init(f, pose);
+		return;
+	}
+	f->rejects = 0;
+
+	/* Rows of K^T are the columns of P H^T: solve for all 18 at once. */
+	{
+		double Y[N][6];
+
+		for (int c = 0; c < N; c++)
+			for (int i = 0; i < 6; i++)
+				Y[c][i] = K[i][c];
+		if (solve6(S, &Y[0][0], N))
+			return;
+		for (int c = 0; c < N; c++)
+			for (int i = 0; i < 6; i++)
+				K[i][c] = Y[c][i];
+	}
+
+	/* dx = K r; P -= K (H P) */
+	for (int c = 0; c < N; c++) {
+		dx[c] = 0;
+		for (int i = 0; i < 6; i++)
+			dx[c] += K[i][c] * r[i];
+	}
+	for (int a = 0; a < N; a++)
+		for (int b = a; b < N; b++) {
+			double s = 0;
+
+			for (int i = 0; i < 6; i++)
+				s += K[i][a] * f->P[idx[i]][b];
+			f->T[a][b] = s;
+		}
+	for (int a = 0; a < N; a++)
+		for (int b = a; b < N; b++) {
+			f->P[a][b] -= f->T[a][b];
+			f->P[b][a] = f->P[a][b];
+		}
+
+	/*
+	 * Inject into the current state, and into the kept steps from the
+	 * pose's time on so the next pose isn't measured against the
+	 * uncorrected past.
+	 */
+	qexp(dq, dx + ETH);
+	if (then) {
+		uint64_t lo = f->hist_head > STATE_HIST ?
+			      f->hist_head - STATE_HIST : 0;
+
+		for (uint64_t i = f->hist_head; i-- > lo;) {
+			struct past_state *h = &f->hist[i & (STATE_HIST - 1)];
+
+			for (int j = 0; j < 3; j++)
+				h->p[j] += dx[EP + j];
+			qmul(h->q, h->q, dq);
+			if (h == then)
+				break;
+		}
+	}
+	for (int i = 0; i < 3; i++) {
+		x->p[i] += dx[EP + i];
+		x->v[i] += dx[EV + i];
+		x->ba[i] += dx[EBA + i];
+		x->bg[i] += dx[EBG + i];
+		x->g[i] += dx[EG + i];
+	}
+	qmul(x->q, x->q, dq);
+	qnormalise(x->q);
+	{
+		double n = sqrt(x->g[0] * x->g[0] + x->g[1] * x->g[1] +
+				x->g[2] * x->g[2]);
+
+		for (int i = 0; i < 3; i++)
+			x->g[i] *= GRAVITY / n;
+	}
+}
+
+/* Apply the waiting poses the IMU has caught up with (or all, @flush). */
+static void drain_pending(struct psvr2_fusion *f, int flush)
+{
+	int timing = f->cfg.flags & PSVR2_FUSION_TIMING, k = 0;
+
+	for (; k < f->n_pending; k++) {
+		const struct psvr2_pose *pose = &f->pending[k];
+		uint64_t t0 = 0;
+
+		if (!flush && pose->measured_ns > f->t)
+			break;
+		if (!f->started) {
+			fusion_init(f, pose);
+			continue;
+		}
+		if (timing)
+			t0 = psvr2__now_ns();
+		correct(f, pose);
+		stats_add(f, STAT_UPDATE, timing ? psvr2__now_ns() - t0 : 0);
+	}
+	f->n_pending -= k;
+	memmove(f->pending, f->pending + k,
+		f->n_pending * sizeof(f->pending[0]));
+}
+
+static void output(struct psvr2_fusion *f, struct psvr2_fused_pose *o)
+{
+	const struct nominal *x = &f->x;
+	double R[3][3], a[3];
+
+	qmat(R, x->q);
+	mat3_vec(a, R, f->accel);
+	o->timestamp_ns = f->t;
+	for (int i = 0; i < 3; i++) {
+		o->position[i] = x->p[i];
+		o->velocity[i] = x->v[i];
+		o->angular_velocity[i] = f->omega[i];
+		o->acceleration[i] = a[i] + x->g[i];
+	}
+	for (int i = 0; i < 4; i++)
+		o->orientation[i] = x->q[i];
+	for (int i = 0; i < 6; i++)
+		for (int j = 0; j < 6; j++)
+			o->covariance[i][j] =
+				f->P[i < 3 ? EP + i : ETH + i - 3]
+				    [j < 3 ? EP + j : ETH + j - 3];
+}
+
+static struct psvr2_fusion *fusion_of(psvr2_t *p)
+{
+	struct psvr2_fusion *f = __atomic_load_n(&p->fusion, __ATOMIC_ACQUIRE);
+	int fresh = f ? psvr2__engine_enter(&f->e, &f->cfg) : -1;
+
+	if (fresh < 0)
+		return NULL;
+	if (fresh) {
+		double q[4];
+
+		for (int i = 0; i < 4; i++)
+			q[i] = f->cfg.imu_to_body[i];
+		qnormalise(q);
+		qmat(f->r_bi, q);
+		f->started = 0;
+		f->t = 0;
+		f->n_pending = 0;
+	}
+	return f;
+}
+
+void psvr2__fusion_poses(psvr2_t *p, const struct psvr2_pose *poses, int n)
+{
+	struct psvr2_fusion *f = fusion_of(p);
+
+	/* Nothing to propagate a pose with before the IMU runs. */
+	if (!f || !f->t)
+		return;
+	for (int k = 0; k < n; k++) {
+		if (!poses[k].valid)
+			continue;
+		if (f->n_pending == PENDING)
+			drain_pending(f, 1);
+		f->pending[f->n_pending++] = poses[k];
+	}
+	/* The IMU stalled or isn't running: don't hold poses forever. */
+	if (f->n_pending &&
+	    f->pending[f->n_pending - 1].measured_ns > f->t + PENDING_MAX_NS)
+		drain_pending(f, 1);
+	psvr2__engine_put_stats(&f->e, &f->acc);
+}
+
+void psvr2__fusion_imu(psvr2_t *p, const struct psvr2_imu_sample *s, int n)
+{
+	struct psvr2_fusion *f = fusion_of(p);
+	int timing, m = 0;
+
+	if (!f)
+		return;
+	timing = f->cfg.flags & PSVR2_FUSION_TIMING;
+
+	for (int k = 0; k < n; k++) {
+		uint64_t t0 = 0;
+		double dt;
+
+		if (f->t && s[k].measured_ns <= f->t)
+			continue;
+		if (!f->started) {
+			double a[3];
+
+			/* Until the first pose: just what gravity reads. */
+			for (int i = 0; i < 3; i++)
+				a[i] = s[k].accel_m_s2[i];
+			mat3_vec(f->accel, f->r_bi, a);
+			f->t = s[k].measured_ns;
+			drain_pending(f, 0);
+			continue;
+		}
+		dt = (s[k].measured_ns - f->t) * 1e-9;
+		f->t = s[k].measured_ns;
+		if (timing)
+			t0 = psvr2__now_ns();
+		predict(f, &s[k], dt < MAX_DT ? dt : MAX_DT);
+		stats_add(f, STAT_PREDICT, timing ? psvr2__now_ns() - t0 : 0);
+
+		{
+			struct past_state *h =
+				&f->hist[f->hist_head++ & (STATE_HIST - 1)];
+
+			h->t = f->t;
+			memcpy(h->p, f->x.p, sizeof(h->p));
+			memcpy(h->q, f->x.q, sizeof(h->q));
+		}
+		drain_pending(f, 0);
+		output(f, &f->out[m++]);
+		if (m == IMU_BATCH) {
+			psvr2__ring_publish(&f->e.ring, f->out, m);
+			m = 0;
+		}
+	}
+	if (m)
+		psvr2__ring_publish(&f->e.ring, f->out, m);
+	psvr2__engine_put_stats(&f->e, &f->acc);
+}
+
+/* ---- API ---------------------------------------------------------------- */
+
+int psvr2_fusion_start(psvr2_t *p, const struct psvr2_fusion_config *cfg)
+{
+	struct psvr2_fusion *f;
+	struct psvr2_fusion_config c = defaults;
+
+	if (!p) {
+		errno = EINVAL;
+		return -1;
+	}
+	f = p->fusion;
+	if (f && psvr2__engine_running(&f->e)) {
+		errno = EBUSY;
+		return -1;
+	}
+	if (cfg) {
+		c.flags = cfg->flags;
+		if (cfg->imu_to_body[0] || cfg->imu_to_body[1] ||
+		    cfg->imu_to_body[2] || cfg->imu_to_body[3])
+			memcpy(c.imu_to_body, cfg->imu_to_body,
+			       sizeof(c.imu_to_body));
+#define TAKE(field) if (cfg->field > 0) c.field = cfg->field
+		TAKE(accel_noise);
+		TAKE(gyro_noise);
+		TAKE(accel_bias_walk);
+		TAKE(gyro_bias_walk);
+		TAKE(position_noise);
+		TAKE(orientation_noise);
+#undef TAKE
+	}
+
+	if (!f) {
+		f = psvr2__engine_alloc(sizeof(*f),
+					sizeof(struct psvr2_fused_pose),
+					OUT_RING, sizeof(c), sizeof(f->acc));
+		if (!f)
+			return -1;
+	}
+	psvr2__engine_start(&f->e, &c);
+	__atomic_store_n(&p->fusion, f, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static struct psvr2_engine *engine(psvr2_t *p)
+{
+	return p && p->fusion ? &p->fusion->e : NULL;
+}
+
+void psvr2_fusion_stop(psvr2_t *p)
+{
+	psvr2__engine_stop(engine(p));
+}
+
+int psvr2_get_fused_latest(psvr2_t *p, struct psvr2_fused_pose *out,
+			   uint64_t *seq)
+{
+	return psvr2__engine_latest(engine(p), out, seq);
+}
+
+int psvr2_get_fused_since(psvr2_t *p, uint64_t *seq,
+			  struct psvr2_fused_pose *out, int max)
+{
+	return psvr2__engine_since(engine(p), seq, out, max);
+}
+
+int psvr2_fusion_get_stats(psvr2_t *p, struct psvr2_fusion_stats *out)
+{
+	return psvr2__engine_get_stats(engine(p), out);
+}
@@ -0,0 +1,560 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — gaze processing: smoothing, I-VT classification, blink bridging
+ * and saccade landing prediction.
+ *
+ * Each sample's direction (the combined one, else the mean of the open eyes')
+ * is classified by its velocity over the last 20 ms, as Tobii's I-VT filter
+ * does: above the threshold it is a saccade and passes unfiltered, below it a
+ * fixation (which includes smooth pursuit) and goes through a one-pole
+ * low-pass whose cutoff rises with the velocity, as a 1-euro filter: still at
+ * rest, without lag when the eye starts to move.
+ *
+ * A saccade's landing is guessed from the main sequence (peak velocity rising
+ * with amplitude to a plateau) while the velocity still climbs. Once it has
+ * fallen past the peak, the velocity profile being close to symmetric, there
+ * is as far left to go as the eye had covered at the mirror image of the
+ * current time about the peak. The duration comes from the main sequence or,
+ * past the peak, twice the time to it. @predicted follows a minimum-jerk-like
+ * profile from the current sample towards the landing.
+ *
+ * Closed or untracked eyes hold the last direction as a blink for up to
+ * blink_max_ms, then report the gaze lost; either way the filter restarts at
+ * the next open sample. One reading thread feeds it, as the pose history; the
+ * output ring can be read from anywhere.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libpsvr2_int.h"
+
+#define OUT_RING	1024		/* power of two */
+#define DEG		0.017453292f	/* rad */
+#define VMAX		(500 * DEG)	/* main sequence: plateau, rad/s */
+#define VC		(14 * DEG)	/* and amplitude constant, rad */
+#define MS_PER_RAD	(2.2f / DEG)	/* saccade duration per amplitude */
+#define MS_BASE		21.0f		/* and at zero amplitude */
+#define PAST_PEAK	0.85f		/* of the peak velocity: falling */
+#define HIST		32		/* power of two: raw samples kept */
+#define VEL_WINDOW_NS	20000000ull	/* the I-VT velocity's span */
+
+static const struct psvr2_gaze_filter_config defaults = {
+	.saccade_deg_s = 30,
+	.min_cutoff_hz = 0.5f,
+	.beta = 0.1f,
+	.blink_max_ms = 300,
+	.predict_ms = 10,
+};
+
+struct raw {
+	uint64_t t;
+	float	d[3];
+};
+
+struct saccade {
+	float	start[3];		/* the fixation it left */
+	float	peak_v;			/* rad/s */
+	float	before_v, after_v;	/* either side of it, -1 if none */
+	float	last_v;
+	float	peak[3];		/* where the eye was at peak_v */
+	uint64_t peak_t;
+	uint64_t interval;		/* between samples there */
+	int	past_peak;
+	float	first_landing[3];	/* guessed once past the peak */
+};
+
+struct psvr2_gaze_filter {
+	struct psvr2_engine e;		/* first; filtered samples out */
+
+	/* Reader thread. */
+	struct psvr2_gaze_filter_config cfg;
+	float		threshold;	/* rad/s */
+	float		beta;		/* Hz per rad/s */
+	uint64_t	blink_max_ns;
+	uint64_t	predict_ns;
+	struct psvr2_gaze_filter_stats acc;
+
+	int		started;
+	uint64_t	t;		/* of the last sample */
+	uint64_t	closed_ns;	/* eyes closed since, or 0 */
+	struct raw	hist[HIST];	/* the last raw directions */
+	uint64_t	n_hist;		/* pushed since the restart */
+	struct psvr2_filtered_gaze cur;	/* the last output */
+	struct saccade	sac;
+	struct psvr2_filtered_gaze out[GAZE_BATCH];
+};
+
+/* ---- small 3-vector helpers ---------------------------------------------- */
+
+static float dot3(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static int normalise3(float v[3])
+{
+	float n = dot3(v, v);
+
+	if (!(n > 1e-12f))
+		return -1;
+	n = 1 / sqrtf(n);
+	for (int i = 0; i < 3; i++)
+		v[i] *= n;
+	return 0;
+}
+
+/* Angle between unit vectors, from the chord: accurate at small angles. */
+static float angle3(const float a[3], const float b[3])
+{
+	float d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+	float c = sqrtf(dot3(d, d)) / 2;
+
+	return 2 * asinf(c < 1 ? c : 1);
+}
+
+/* The sample's direction: combined, else the open eyes'. -1 if closed. */
+static int direction_of(const struct psvr2_gaze *g, float d[3])
+{
+	int n = 0;
+
+	if (!g->valid)
+		return -1;
+	if (g->combined.gaze_direction_valid) {
+		memcpy(d, g->combined.gaze_direction, 3 * sizeof(float));
+		return normalise3(d);
+	}
+	d[0] = d[1] = d[2] = 0;
+	for (int e = 0; e < 2; e++) {
+		const struct psvr2_eye *eye = e ? &g->right : &g->left;
+		float v[3];
+
+		if (!eye->gaze_direction_valid ||
+		    (eye->blink_valid && eye->blink))
+			continue;
+		memcpy(v, eye->gaze_direction, sizeof(v));
+		if (normalise3(v))
+			continue;
+		for (int i = 0; i < 3; i++)
+			d[i] += v[i];
+		n++;
+	}
+	return n ? normalise3(d) : -1;
+}
+
+/* ---- saccades ------------------------------------------------------------ */
+
+/* @from rotated by @angle towards @to, on the sphere. */
+static void rotate_towards(float o[3], const float from[3], const float to[3],
+			   float angle)
+{
+	float u[3], k = dot3(from, to), s = sinf(angle), c = cosf(angle);
+
+	for (int i = 0; i < 3; i++)
+		u[i] = to[i] - k * from[i];
+	if (normalise3(u)) {
+		memcpy(o, from, 3 * sizeof(float));
+		return;
+	}
+	for (int i = 0; i < 3; i++)
+		o[i] = c * from[i] + s * u[i];
+}
+
+/* Where the eye was at @m, between the raw samples kept and @d at @t. */
+static int raw_at(const struct psvr2_gaze_filter *f, const float d[3],
+		  uint64_t t, uint64_t m, float o[3])
+{
+	uint64_t kept = f->n_hist < HIST ? f->n_hist : HIST;
+	const float *b = d;
+	uint64_t tb = t;
+
+	for (uint64_t k = 1; k <= kept; k++) {
+		const struct raw *a = &f->hist[(f->n_hist - k) & (HIST - 1)];
+
+		if (a->t <= m) {
+			float x = (float)(m - a->t) / (float)(tb - a->t);
+
+			for (int i = 0; i < 3; i++)
+				o[i] = a->d[i] + x * (b[i] - a->d[i]);
+			return normalise3(o);
+		}
+		b = a->d;
+		tb = a->t;
+	}
+	return -1;
+}
+
+/*
+ * Where and when the saccade under way lands, given the sample @d at @t. Past
+ * the peak, a symmetric profile leaves as far to go as the eye had covered
+ * at the mirror time, 2 peak_t - t.
+ */
+static void landing(struct psvr2_gaze_filter *f, const float d[3], uint64_t t)
+{
+	struct saccade *s = &f->sac;
+	uint64_t t0 = f->cur.movement_start_ns, end;
+	float covered = angle3(s->start, d), amp, at[3];
+
+	if (s->past_peak) {
+		uint64_t m = 2 * s->peak_t - t;
+
+		if (2 * s->peak_t <= t + t0)
+			amp = covered;
+		else if (!raw_at(f, d, t, m, at))
+			amp = covered + angle3(s->start, at);
+		else
+			amp = 2 * angle3(s->start, s->peak);
+		end = t0 + 2 * (s->peak_t - t0);
+	} else {
+		float r = s->peak_v / VMAX;
+
+		amp = -VC * logf(1 - (r < 0.98f ? r : 0.98f));
+		end = t0 + (uint64_t)((MS_BASE + MS_PER_RAD * amp) * 1e6f);
+	}
+	if (amp < covered)
+		amp = covered;
+	rotate_towards(f->cur.landing, s->start, d, amp);
+	f->cur.landing_ns = end > t ? end : t;
+}
+
+/* Minimum-jerk-like progress through a saccade, 0..1, its peak speed midway. */
+static float progress(float tau)
+{
+	if (tau <= 0)
+		return 0;
+	if (tau >= 1)
+		return 1;
+	return tau - sinf(2 * (float)M_PI * tau) / (2 * (float)M_PI);
+}
+
+static void predict(struct psvr2_gaze_filter *f, const float d[3], uint64_t t)
+{
+	struct psvr2_filtered_gaze *o = &f->cur;
+	float span, now, ahead, g;
+
+	if (o->movement != PSVR2_GAZE_SACCADE) {
+		memcpy(o->predicted, o->direction, sizeof(o->predicted));
+		return;
+	}
+	span = (float)(o->landing_ns - o->movement_start_ns);
+	now = progress((t - o->movement_start_ns) / span);
+	ahead = progress((t + f->predict_ns - o->movement_start_ns) / span);
+	g = now < 1 ? (ahead - now) / (1 - now) : 1;
+	for (int i = 0; i < 3; i++)
+		o->predicted[i] = d[i] + g * (o->landing[i] - d[i]);
+	normalise3(o->predicted);
+}
+
+/* Velocity over the last VEL_WINDOW_NS, or as much as is kept. */
+static float velocity(const struct psvr2_gaze_filter *f, const float d[3],
+		      uint64_t t)
+{
+	uint64_t kept = f->n_hist < HIST ? f->n_hist : HIST, k;
+	const struct raw *r = NULL;
+
+	if (!kept)
+		return 0;
+	for (k = 1; k <= kept; k++) {
+		r = &f->hist[(f->n_hist - k) & (HIST - 1)];
+		if (t - r->t >= VEL_WINDOW_NS)
+			break;
+	}
+	return angle3(d, r->d) / ((t - r->t) * 1e-9f);
+}
+
+/*
+ * The peak sits between samples: place it by a parabola through the
+ * velocities either side, then step the position there from the sample.
+ */
+static void peak_refine(struct saccade *s, const float d[3])
+{
+	float den = s->before_v - 2 * s->peak_v + s->after_v, x, p[3];
+
+	if (!(den < 0))
+		return;
+	x = 0.5f * (s->before_v - s->after_v) / den;
+	if (x < -0.5f || x > 0.5f)
+		return;
+	memcpy(p, s->peak, sizeof(p));
+	rotate_towards(s->peak, p, x > 0 ? d : s->start,
+		       fabsf(x) * s->peak_v * s->interval * 1e-9f);
+	s->peak_t += (int64_t)(x * s->interval);
+}
+
+/*
+ * Track the peak on the velocity over the last two intervals alone: the I-VT
+ * window would find it 10 ms late, and at saccadic speeds the noise matters
+ * little. It was reached at the sample between.
+ */
+static void saccade_step(struct psvr2_gaze_filter *f, const float d[3],
+			 uint64_t t)
+{
+	struct saccade *s = &f->sac;
+	const struct raw *mid = &f->hist[(f->n_hist - 1) & (HIST - 1)];
+	const struct raw *r = f->n_hist > 1 ?
+		&f->hist[(f->n_hist - 2) & (HIST - 1)] : mid;
+	float v = t > r->t ? angle3(d, r->d) / ((t - r->t) * 1e-9f) : 0;
+
+	if (v > s->peak_v) {
+		s->before_v = s->last_v;
+		s->after_v = -1;
+		s->peak_v = v;
+		memcpy(s->peak, mid->d, sizeof(s->peak));
+		s->peak_t = mid->t;
+		s->interval = (t - r->t) / 2;
+		s->past_peak = 0;
+	} else if (s->after_v < 0) {
+		s->after_v = v;
+	}
+	s->last_v = v;
+	if (!s->past_peak && v < PAST_PEAK * s->peak_v) {
+		s->past_peak = 1;
+		peak_refine(s, d);
+		landing(f, d, t);
+		memcpy(s->first_landing, f->cur.landing,
+		       sizeof(s->first_landing));
+		return;
+	}
+	landing(f, d, t);
+}
+
+static void saccade_begin(struct psvr2_gaze_filter *f, const float d[3],
+			  uint64_t t)
+{
+	struct saccade *s = &f->sac;
+
+	/* From the fixation as filtered, which has hardly followed yet. */
+	memcpy(s->start, f->cur.direction, sizeof(s->start));
+	s->peak_v = 0;
+	s->last_v = 0;
+	s->past_peak = 0;
+	f->cur.movement = PSVR2_GAZE_SACCADE;
+	f->cur.movement_start_ns = f->t;
+	f->acc.saccades++;
+	saccade_step(f, d, t);
+}
+
+static void saccade_end(struct psvr2_gaze_filter *f, const float d[3],
+			uint64_t t)
+{
+	if (f->sac.past_peak) {
+		f->acc.landings++;
+		f->acc.landing_error_deg +=
+			angle3(f->sac.first_landing, d) / DEG;
+	}
+	f->cur.movement = PSVR2_GAZE_FIXATION;
+	f->cur.movement_start_ns = t;
+	f->cur.landing_ns = 0;
+	memcpy(f->cur.direction, d, sizeof(f->cur.direction));
+}
+
+/* ---- per sample ---------------------------------------------------------- */
+
+static void restart(struct psvr2_gaze_filter *f, const float d[3], uint64_t t)
+{
+	f->started = 1;
+	f->closed_ns = 0;
+	f->n_hist = 0;
+	f->cur.movement = PSVR2_GAZE_FIXATION;
+	f->cur.movement_start_ns = t;
+	f->cur.landing_ns = 0;
+	f->cur.velocity_deg_s = 0;
+	memcpy(f->cur.direction, d, sizeof(f->cur.direction));
+}
+
+static void closed(struct psvr2_gaze_filter *f, uint64_t t)
+{
+	struct psvr2_filtered_gaze *o = &f->cur;
+
+	if (!f->closed_ns) {
+		f->closed_ns = t;
+		o->movement = PSVR2_GAZE_BLINK;
+		o->movement_start_ns = t;
+		o->landing_ns = 0;
+		o->velocity_deg_s = 0;
+		memcpy(o->predicted, o->direction, sizeof(o->predicted));
+	}
+	if (o->movement == PSVR2_GAZE_BLINK &&
+	    t - f->closed_ns > f->blink_max_ns) {
+		o->movement = PSVR2_GAZE_LOST;
+		o->movement_start_ns = t;
+	}
+}
+
+/* Returns 0 with f->cur updated, or -1 if there's nothing to output. */
+static int step(struct psvr2_gaze_filter *f, const struct psvr2_gaze *g)
+{
+	struct psvr2_filtered_gaze *o = &f->cur;
+	uint64_t t = g->measured_ns;
+	float d[3], v = 0, dt, fc, a;
+
+	if (f->t && t <= f->t)
+		return -1;
+	if (direction_of(g, d)) {
+		if (!f->started)
+			return -1;
+		closed(f, t);
+		f->t = t;
+		o->timestamp_ns = t;
+		return 0;
+	}
+	if (!f->started || f->closed_ns) {
+		if (f->closed_ns && o->movement == PSVR2_GAZE_BLINK)
+			f->acc.blinks++;
+		restart(f, d, t);
+	} else {
+		v = velocity(f, d, t);
+		if (o->movement == PSVR2_GAZE_SACCADE) {
+			if (v > f->threshold)
+				saccade_step(f, d, t);
+			else
+				saccade_end(f, d, t);
+		} else if (v > f->threshold) {
+			saccade_begin(f, d, t);
+		}
+
+		if (o->movement == PSVR2_GAZE_SACCADE) {
+			memcpy(o->direction, d, sizeof(o->direction));
+		} else {
+			dt = (t - f->t) * 1e-9f;
+			fc = f->cfg.min_cutoff_hz + f->beta * v;
+			a = 1 / (1 + 1 / (2 * (float)M_PI * fc * dt));
+			for (int i = 0; i < 3; i++)
+				o->direction[i] += a * (d[i] - o->direction[i]);
+			normalise3(o->direction);
+		}
+	}
+	o->velocity_deg_s = v / DEG;
+
+	{
+		struct raw *r = &f->hist[f->n_hist++ & (HIST - 1)];
+
+		r->t = t;
+		memcpy(r->d, d, sizeof(r->d));
+	}
+
+	f->t = t;
+	o->timestamp_ns = t;
+	predict(f, d, t);
+	return 0;
+}
+
+/* The rates the config's units derive, after a start. */
+static void derive(struct psvr2_gaze_filter *f)
+{
+	const struct psvr2_gaze_filter_config *c = &f->cfg;
+
+	f->threshold = c->saccade_deg_s * DEG;
+	f->beta = c->beta / DEG;
+	f->blink_max_ns = (uint64_t)(c->blink_max_ms * 1e6f);
+	f->predict_ns = (uint64_t)(c->predict_ms * 1e6f);
+}
+
+void psvr2__gaze_filter(psvr2_t *p, const struct psvr2_gaze *g, int n)
+{
+	struct psvr2_gaze_filter *f =
+		__atomic_load_n(&p->gaze_filter, __ATOMIC_ACQUIRE);
+	int fresh = f ? psvr2__engine_enter(&f->e, &f->cfg) : -1;
+	int timing, m = 0;
+
+	if (fresh < 0)
+		return;
+	if (fresh) {
+		derive(f);
+		f->started = 0;
+		f->t = 0;
+		memset(&f->acc, 0, sizeof(f->acc));
+	}
+	timing = f->cfg.flags & PSVR2_GAZE_TIMING;
+
+	for (int k = 0; k < n; k++) {
+		uint64_t t0 = timing ? psvr2__now_ns() : 0;
+
+		if (step(f, &g[k]))
+			continue;
+		f->out[m++] = f->cur;
+		if (timing) {
+			f->acc.samples++;
+			f->acc.sample_ns += psvr2__now_ns() - t0;
+		}
+		if (m == GAZE_BATCH) {
+			psvr2__ring_publish(&f->e.ring, f->out, m);
+			m = 0;
+		}
+	}
+	if (m)
+		psvr2__ring_publish(&f->e.ring, f->out, m);
+	psvr2__engine_put_stats(&f->e, &f->acc);
+}
+
+/* ---- API ---------------------------------------------------------------- */
+
+int psvr2_gaze_filter_start(psvr2_t *p,
+			    const struct psvr2_gaze_filter_config *cfg)
+{
+	struct psvr2_gaze_filter *f;
+	struct psvr2_gaze_filter_config c = defaults;
+
+	if (!p) {
+		errno = EINVAL;
+		return -1;
+	}
+	f = p->gaze_filter;
+	if (f && psvr2__engine_running(&f->e)) {
+		errno = EBUSY;
+		return -1;
+	}
+	if (cfg) {
+		c.flags = cfg->flags;
+#define TAKE(field) if (cfg->field > 0) c.field = cfg->field
+		TAKE(saccade_deg_s);
+		TAKE(min_cutoff_hz);
+		TAKE(beta);
+		TAKE(blink_max_ms);
+		TAKE(predict_ms);
+#undef TAKE
+	}
+
+	if (!f) {
+		f = psvr2__engine_alloc(sizeof(*f),
+					sizeof(struct psvr2_filtered_gaze),
+					OUT_RING, sizeof(c), sizeof(f->acc));
+		if (!f)
+			return -1;
+	}
+	psvr2__engine_start(&f->e, &c);
+	__atomic_store_n(&p->gaze_filter, f, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static struct psvr2_engine *engine(psvr2_t *p)
+{
+	return p && p->gaze_filter ? &p->gaze_filter->e : NULL;
+}
+
+void psvr2_gaze_filter_stop(psvr2_t *p)
+{
+	psvr2__engine_stop(engine(p));
+}
+
+int psvr2_get_filtered_gaze_latest(psvr2_t *p,
+				   struct psvr2_filtered_gaze *out,
+				   uint64_t *seq)
+{
+	return psvr2__engine_latest(engine(p), out, seq);
+}
+
+int psvr2_get_filtered_gaze_since(psvr2_t *p, uint64_t *seq,
+				  struct psvr2_filtered_gaze *out, int max)
+{
+	return psvr2__engine_since(engine(p), seq, out, max);
+}
+
+int psvr2_gaze_filter_get_stats(psvr2_t *p,
+				struct psvr2_gaze_filter_stats *out)
+{
+	return psvr2__engine_get_stats(engine(p), out);
+}
@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — pose history and time-indexed lookup.
+ *
+ * A fixed ring of the last HISTORY_LEN valid poses, kept as one array per
+ * component so a binary search over the timestamps touches nothing else.
+ * Poses are placed at their measured time, which is their receive time until
+ * the clock sync has settled.
+ * Whichever thread reads poses for the handle appends to it (the ingestion
+ * thread, the dispatcher, or a caller's batched reads); psvr2_pose_at() may
+ * run on any other thread at the same time. It uses the same claim/head
+ * scheme as the ingestion rings: the writer announces the slots it is about to
+ * overwrite, and a lookup that read one of those retries.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libpsvr2_int.h"
+
+#define HISTORY_LEN	1024		/* power of two; ~1 s of poses */
+#define HISTORY_MASK	(HISTORY_LEN - 1)
+
+struct psvr2_pose_history {
+	uint64_t	claim;		/* may be overwriting below this */
+	uint64_t	head;		/* poses published */
+	uint64_t	t[HISTORY_LEN];	/* measured_ns */
+	uint64_t	rx[HISTORY_LEN];	/* timestamp_ns */
+	uint32_t	vts[HISTORY_LEN];
+	float		pos[3][HISTORY_LEN];
+	float		rot[4][HISTORY_LEN];	/* w, x, y, z */
+};
+
+struct psvr2_pose_history *psvr2__history_alloc(void)
+{
+	return calloc(1, sizeof(struct psvr2_pose_history));
+}
+
+void psvr2__history_free(struct psvr2_pose_history *h)
+{
+	free(h);
+}
+
+/* Writer side; invalid poses are not kept, so lookups never blend them in. */
+void psvr2__history_push(struct psvr2_pose_history *h,
+			 const struct psvr2_pose *poses, int n)
+{
+	uint64_t head;
+	int valid = 0;
+
+	if (!h)
+		return;
+	for (int k = 0; k < n; k++)
+		valid += poses[k].valid != 0;
+	if (!valid)
+		return;
+
+	head = h->head;
+	__atomic_store_n(&h->claim, head + valid, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	for (int k = 0; k < n; k++) {
+		unsigned int i = head & HISTORY_MASK;
+
+		if (!poses[k].valid)
+			continue;
+		h->t[i] = poses[k].measured_ns;
+		h->rx[i] = poses[k].timestamp_ns;
+		h->vts[i] = poses[k].device_vts_us;
+		for (int a = 0; a < 3; a++)
+			h->pos[a][i] = poses[k].position[a];
+		for (int a = 0; a < 4; a++)
+			h->rot[a][i] = poses[k].orientation[a];
+		head++;
+	}
+	__atomic_store_n(&h->head, head, __ATOMIC_RELEASE);
+}
+
+static void history_get(const struct psvr2_pose_history *h, uint64_t seq,
+			struct psvr2_pose *out)
+{
+	unsigned int i = seq & HISTORY_MASK;
+
+	out->timestamp_ns = h->rx[i];
+	out->measured_ns = h->t[i];
+	out->device_vts_us = h->vts[i];
+	out->valid = 1;
+	for (int a = 0; a < 3; a++)
+		out->position[a] = h->pos[a][i];
+	for (int a = 0; a < 4; a++)
+		out->orientation[a] = h->rot[a][i];
+}
+
+/* Shortest-arc slerp, falling back to normalised lerp when nearly equal. */
+static void slerp(float out[4], const float a[4], const float b[4], double u)
+{
+	double dot = 0, wa, wb, len = 0;
+	double bb[4];
+
+	for (int i = 0; i < 4; i++)
+		dot += (double)a[i] * b[i];
+	for (int i = 0; i < 4; i++)
+		bb[i] = dot < 0 ? -b[i] : b[i];
+	dot = fabs(dot);
+
+	if (dot > 0.9995) {
+		wa = 1 - u;
+		wb = u;
+	} else {
+		double theta = acos(dot), s = sin(theta);
+
+		wa = sin((1 - u) * theta) / s;
+		wb = sin(u * theta) / s;
+	}
+	for (int i = 0; i < 4; i++) {
+		double v = wa * a[i] + wb * bb[i];
+
+		len += v * v;
+		out[i] = v;
+	}
+	len = sqrt(len);
+	if (len > 0)
+		for (int i = 0; i < 4; i++)
+			out[i] /= len;
+}
+
+int psvr2_pose_at(psvr2_t *p, uint64_t t_ns, struct psvr2_pose *out)
+{
+	const struct psvr2_pose_history *h = p ? p->history : NULL;
+	struct psvr2_pose a, b;
+	uint64_t head, claim, oldest, lo, hi;
+	double u;
+
+	if (!h || !out) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (;;) {
+		head = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE);
+		if (!head) {
+			errno = ENODATA;
+			return -1;
+		}
+		oldest = head > HISTORY_LEN ? head - HISTORY_LEN : 0;
+
+		/* Last slot with t <= t_ns, clamped to the ends. */
+		lo = oldest;
+		hi = head - 1;
+		while (lo < hi) {
+			uint64_t mid = lo + (hi - lo + 1) / 2;
+
+			if (h->t[mid & HISTORY_MASK] <= t_ns)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+		history_get(h, lo, &a);
+		if (lo + 1 < head)
+			history_get(h, lo + 1, &b);
+		else
+			b = a;
+
+		/* Retry if the writer got to either slot while we looked. */
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		claim = __atomic_load_n(&h->claim, __ATOMIC_RELAXED);
+		if (claim <= HISTORY_LEN || lo >= claim - HISTORY_LEN)
+			break;
+	}
+
+	/* Before the oldest or after the newest: the nearer end. */
+	if (t_ns < a.measured_ns || lo + 1 >= head ||
+	    b.measured_ns <= t_ns) {
+		*out = a;
+		return t_ns == a.measured_ns;
+	}
+
+	/* a.measured_ns <= t_ns < b.measured_ns */
+	u = (double)(t_ns - a.measured_ns) /
+	    (double)(b.measured_ns - a.measured_ns);
+	out->measured_ns = t_ns;
+	out->timestamp_ns = a.timestamp_ns +
+			    (uint64_t)(u * (b.timestamp_ns - a.timestamp_ns));
+	out->device_vts_us = a.device_vts_us +
+			     (uint32_t)(u * (uint32_t)(b.device_vts_us -
+						      a.device_vts_us));
+	out->valid = 1;
+	for (int i = 0; i < 3; i++)
+		out->position[i] = a.position[i] +
+				   u * (b.position[i] - a.position[i]);
+	slerp(out->orientation, a.orientation, b.orientation, u);
+	return 1;
+}
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — background ingestion.
+ *
+ * One reader thread runs the dispatcher and publishes every converted sample
+ * into a per-stream broadcast ring (libpsvr2_ring.c), and the newest one into
+ * a seqlock slot: the writer bumps the count to odd, copies, bumps it to even;
+ * a reader retries if it saw an odd count or a change across its copy (i.e. it
+ * overlapped one sample's memcpy). Only that thread ever writes; consumers
+ * only read, so they can't stall it and need no lock.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#define _GNU_SOURCE		/* pthread_attr_setaffinity_np */
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "libpsvr2_int.h"
+
+#define CACHELINE	64
+
+/* History per stream: about a second of poses/gaze, two of IMU. */
+#define POSE_RING	1024
+#define GAZE_RING	512
+#define IMU_RING	4096
+
+struct ingest_ring {
+	/* Reader-thread writes, consumers read: one line. */
+	struct psvr2_ring_pos pos __attribute__((aligned(CACHELINE)));
+	uint32_t	latest_lock;	/* seqlock: latest, latest_seq */
+	uint64_t	latest_seq;
+
+	/* Fixed at start. */
+	struct psvr2_ring ring __attribute__((aligned(CACHELINE)));
+	char		*latest;
+};
+
+struct psvr2_ingest {
+	struct ingest_ring pose;
+	struct ingest_ring gaze;
+	struct ingest_ring imu;
+	pthread_t	thread;
+	int		stop_fd;	/* eventfd: ends the dispatch loop */
+	int		started_imu;	/* psvr2_imu_stop() it on stop */
+};
+
+static int ring_init(struct ingest_ring *r, size_t sz, uint64_t cap)
+{
+	r->ring.pos = &r->pos;
+	r->ring.sz = sz;
+	r->ring.cap = cap;
+	r->ring.slots = calloc(cap, sz);
+	r->latest = calloc(1, sz);
+	return r->ring.slots && r->latest ? 0 : -1;
+}
+
+static void ring_free(struct ingest_ring *r)
+{
+	free(r->ring.slots);
+	free(r->latest);
+}
+
+/* Reader thread only. */
+static void ring_publish(struct ingest_ring *r, const void *src, int n)
+{
+	size_t sz = r->ring.sz;
+
+	psvr2__ring_publish(&r->ring, src, n);
+
+	psvr2__seq_write_begin(&r->latest_lock);
+	memcpy(r->latest, (const char *)src + (n - 1) * sz, sz);
+	r->latest_seq = r->pos.head - 1;
+	psvr2__seq_write_end(&r->latest_lock);
+}
+
+static int ring_latest(struct ingest_ring *r, void *out, uint64_t *seq)
+{
+	uint32_t lock;
+	uint64_t s;
+
+	if (!__atomic_load_n(&r->pos.head, __ATOMIC_ACQUIRE))
+		return 0;
+	do {
+		lock = psvr2__seq_read_begin(&r->latest_lock);
+		memcpy(out, r->latest, r->ring.sz);
+		s = r->latest_seq;
+	} while (psvr2__seq_read_retry(&r->latest_lock, lock));
+
+	if (seq)
+		*seq = s;
+	return 1;
+}
+
+/* ---- reader thread ------------------------------------------------------ */
+
+static void ingest_pose(void *user, const struct psvr2_pose *poses, int n)
+{
+	struct psvr2_ingest *in = user;
+
+	ring_publish(&in->pose, poses, n);
+}
+
+static void ingest_gaze(void *user, const struct psvr2_gaze *gazes, int n)
+{
+	struct psvr2_ingest *in = user;
+
+	ring_publish(&in->gaze, gazes, n);
+}
+
+static void ingest_imu(void *user, const struct psvr2_imu_sample *s, int n)
+{
+	struct psvr2_ingest *in = user;
+
+	ring_publish(&in->imu, s, n);
+}
+
+/* Until stop_fd fires (EINTR) or the epoll set itself fails. */
+static void *ingest_thread(void *arg)
+{
+	psvr2_t *p = arg;
+
+	while (psvr2__dispatch(p, -1) >= 0)
+		;
+	return NULL;
+}
+
+/* ---- API ---------------------------------------------------------------- */
+
+static void ingest_free(struct psvr2_ingest *in)
+{
+	ring_free(&in->pose);
+	ring_free(&in->gaze);
+	ring_free(&in->imu);
+	if (in->stop_fd >= 0)
+		close(in->stop_fd);
+	free(in);
+}
+
+int psvr2_ingest_start(psvr2_t *p, int cpu)
+{
+	struct psvr2_callbacks cb = {
+		.pose = ingest_pose,
+		.gaze = ingest_gaze,
+		.imu = ingest_imu,
+	};
+	struct psvr2_ingest *in;
+	pthread_attr_t attr;
+	int err;
+
+	if (!p)
+		return -1;
+	if (p->ingest)
+		return 0;
+	/* The dispatcher is the thread's; don't take it from under a caller. */
+	if (p->disp) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	if (posix_memalign((void **)&in, CACHELINE, sizeof(*in))) {
+		errno = ENOMEM;
+		return -1;
+	}
+	memset(in, 0, sizeof(*in));
+	in->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (in->stop_fd < 0 ||
+	    ring_init(&in->pose, sizeof(struct psvr2_pose), POSE_RING) ||
+	    ring_init(&in->gaze, sizeof(struct psvr2_gaze), GAZE_RING) ||
+	    ring_init(&in->imu, sizeof(struct psvr2_imu_sample), IMU_RING))
+		goto fail;
+
+	/* Best effort: the buffer may belong to someone else (EBUSY). */
+	if (p->imu_dir[0] && p->imu_fd < 0 && !psvr2_imu_start(p, 0))
+		in->started_imu = 1;
+
+	cb.user = in;
+	if (psvr2__set_callbacks(p, &cb, in->stop_fd))
+		goto fail_imu;
+
+	pthread_attr_init(&attr);
+	if (cpu >= 0) {
+		cpu_set_t set;
+
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+	}
+	/* Reads start failing with EBUSY from here on. */
+	p->ingest = in;
+	err = pthread_create(&in->thread, &attr, ingest_thread, p);
+	pthread_attr_destroy(&attr);
+	if (err) {
+		p->ingest = NULL;
+		psvr2__set_callbacks(p, NULL, -1);
+		errno = err;
+		goto fail_imu;
+	}
+	pthread_setname_np(in->thread, "psvr2-ingest");
+	return 0;
+
+fail_imu:
+	err = errno;
+	if (in->started_imu)
+		psvr2_imu_stop(p);
+	errno = err;
+fail:
+	err = errno;
+	ingest_free(in);
+	errno = err;
+	return -1;
+}
+
+void psvr2_ingest_stop(psvr2_t *p)
+{
+	struct psvr2_ingest *in = p ? p->ingest : NULL;
+	uint64_t one = 1;
+
+	if (!in)
+		return;
+	(void)!write(in->stop_fd, &one, sizeof(one));
+	pthread_join(in->thread, NULL);
+
+	p->ingest = NULL;
+	psvr2__set_callbacks(p, NULL, -1);
+	if (in->started_imu)
+		psvr2_imu_stop(p);
+	ingest_free(in);
+}
+
+int psvr2_get_latest_pose(psvr2_t *p, struct psvr2_pose *out, uint64_t *seq)
+{
+	if (!p || !p->ingest || !out)
+		return -1;
+	return ring_latest(&p->ingest->pose, out, seq);
+}
+
+int psvr2_get_latest_gaze(psvr2_t *p, struct psvr2_gaze *out, uint64_t *seq)
+{
+	if (!p || !p->ingest || !out)
+		return -1;
+	return ring_latest(&p->ingest->gaze, out, seq);
+}
+
+int psvr2_get_latest_imu(psvr2_t *p, struct psvr2_imu_sample *out,
+			 uint64_t *seq)
+{
+	if (!p || !p->ingest || !out)
+		return -1;
+	return ring_latest(&p->ingest->imu, out, seq);
+}
+
+int psvr2_get_poses_since(psvr2_t *p, uint64_t *seq, struct psvr2_pose *out,
+			  int max)
+{
+	if (!p || !p->ingest || !seq || !out)
+		return -1;
+	return psvr2__ring_read(&p->ingest->pose.ring, seq, out, max);
+}
+
+int psvr2_get_gazes_since(psvr2_t *p, uint64_t *seq, struct psvr2_gaze *out,
+			  int max)
+{
+	if (!p || !p->ingest || !seq || !out)
+		return -1;
+	return psvr2__ring_read(&p->ingest->gaze.ring, seq, out, max);
+}
+
+int psvr2_get_imu_since(psvr2_t *p, uint64_t *seq,
+			struct psvr2_imu_sample *out, int max)
+{
+	if (!p || !p->ingest || !seq || !out)
+		return -1;
+	return psvr2__ring_read(&p->ingest->imu.ring, seq, out, max);
+}
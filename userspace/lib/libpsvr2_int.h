@@ -0,0 +1,268 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * libpsvr2 — state and helpers shared between the library's source files.
+ * Not installed; applications only ever see libpsvr2.h.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#ifndef LIBPSVR2_INT_H
+#define LIBPSVR2_INT_H
+
+#include <stdint.h>
+
+#include "libpsvr2.h"
+#include "psvr2_uapi.h"		/* kernel wire structs (-I kernel/) */
+
+/* Library-internal symbols: kept out of libpsvr2.so's dynamic table. */
+#define PSVR2_HIDDEN	__attribute__((visibility("hidden")))
+
+/* Samples pulled per read() by the batched pose/gaze/IMU readers. */
+#define POSE_BATCH		64
+#define GAZE_BATCH		32
+#define IMU_BATCH		256
+
+/*
+ * One IIO scan with every element enabled, as the module's psvr2_imu_scan:
+ * accel xyz, gyro xyz (native-endian s16), the device's u32 vts (padding from
+ * modules without it), then the s64 timestamp.
+ */
+struct imu_scan {
+	int16_t	channels[6];
+	uint32_t vts_us;
+	int64_t	timestamp;
+};
+
+/*
+ * Single-writer broadcast ring (libpsvr2_ring.c). @pos may sit in process
+ * memory or in a shared mapping; @cap is a power of two.
+ */
+struct psvr2_ring_pos {
+	uint64_t	claim;		/* may be overwriting below this */
+	uint64_t	head;		/* records published */
+};
+
+struct psvr2_ring {
+	struct psvr2_ring_pos *pos;
+	char		*slots;
+	size_t		sz;
+	uint64_t	cap;
+};
+
+struct psvr2_dispatch;
+struct psvr2_ingest;
+struct psvr2_pose_history;
+struct psvr2_orient;
+struct psvr2_fusion;
+struct psvr2_gaze_filter;
+struct psvr2_clock;
+struct psvr2_shared;
+struct psvr2_replay;
+struct psvr2_camera;
+
+struct psvr2 {
+	int	index;			/* kernel headset index, -1 if none */
+	char	usb_path[256];		/* sysfs dir of the USB device */
+	int	pose_fd;
+	int	gaze_fd;
+	int	wake_fd;		/* eventfd, set by psvr2_interrupt() */
+	struct psvr2_pose_sample pose_buf[POSE_BATCH];
+	struct psvr2_gaze_sample gaze_buf[GAZE_BATCH];
+	char	imu_dir[300];		/* IIO device dir, "" if none */
+	char	imu_dev[300];		/* "/dev/iio:deviceN" */
+	double	accel_scale;
+	double	gyro_scale;
+	int	imu_fd;			/* IIO buffer while streaming */
+	int	imu_vts;		/* the vts scan element is enabled */
+	struct imu_scan imu_scan[IMU_BATCH];
+	char	cam_path[300];		/* "/dev/videoN", "" if none */
+	char	bright_path[400];	/* brightness sysfs attr, "" if none */
+	struct psvr2_dispatch *disp;	/* psvr2_set_callbacks(), else NULL */
+	struct psvr2_ingest *ingest;	/* psvr2_ingest_start(), else NULL */
+	struct psvr2_pose_history *history;	/* with pose_fd, else NULL */
+	struct psvr2_orient *orient;	/* IMU orientation filter */
+	struct psvr2_fusion *fusion;	/* psvr2_fusion_start(), else NULL */
+	struct psvr2_gaze_filter *gaze_filter;	/* psvr2_gaze_filter_start() */
+	struct psvr2_clock *clock;	/* device-to-host clock mapping */
+	struct psvr2_shared *shared;	/* psvr2_open_shared(), else NULL */
+	struct psvr2_replay *replay;	/* psvr2_open_replay(), else NULL */
+	struct psvr2_camera *camera;	/* psvr2_camera_open(), else NULL */
+};
+
+/* libpsvr2.c */
+PSVR2_HIDDEN psvr2_t *psvr2__alloc(const struct psvr2_device_info *info);
+PSVR2_HIDDEN uint64_t psvr2__now_ns(void);	/* CLOCK_MONOTONIC */
+PSVR2_HIDDEN int psvr2__on_usb_device(const char *path, const char *usb_path);
+PSVR2_HIDDEN void psvr2__convert_poses(struct psvr2_pose *out,
+				       const struct psvr2_pose_sample *in,
+				       int n);
+PSVR2_HIDDEN void psvr2__convert_gazes(struct psvr2_gaze *out,
+				       const struct psvr2_gaze_sample *in,
+				       int n);
+PSVR2_HIDDEN void psvr2__convert_imu(const psvr2_t *p,
+				     struct psvr2_imu_sample *out,
+				     const struct imu_scan *in, int n);
+
+/*
+ * libpsvr2_dispatch.c: re-register the handle's fds after one of them opened
+ * or is about to close (psvr2_imu_start/stop), and tear down on close.
+ */
+PSVR2_HIDDEN void psvr2__dispatch_update(psvr2_t *p);
+PSVR2_HIDDEN void psvr2__dispatch_free(psvr2_t *p);
+
+/*
+ * The unchecked psvr2_set_callbacks()/psvr2_dispatch() the ingestion thread
+ * drives; @stop_fd (or -1) is watched in place of the interrupt eventfd, so a
+ * caller's psvr2_interrupt() doesn't concern it.
+ */
+PSVR2_HIDDEN int psvr2__set_callbacks(psvr2_t *p,
+				      const struct psvr2_callbacks *cb,
+				      int stop_fd);
+PSVR2_HIDDEN int psvr2__dispatch(psvr2_t *p, int timeout_ms);
+
+/*
+ * libpsvr2.c: the clock mapping (but on a psvr2d handle), then the history,
+ * orientation and filters, for a batch just read; from the thread reading it.
+ */
+PSVR2_HIDDEN void psvr2__after_poses(psvr2_t *p, struct psvr2_pose *poses,
+				     int n);
+PSVR2_HIDDEN void psvr2__after_gazes(psvr2_t *p, struct psvr2_gaze *gazes,
+				     int n);
+PSVR2_HIDDEN void psvr2__after_imu(psvr2_t *p, struct psvr2_imu_sample *s,
+				   int n);
+
+/* libpsvr2_history.c: push from whichever thread reads the poses. */
+PSVR2_HIDDEN struct psvr2_pose_history *psvr2__history_alloc(void);
+PSVR2_HIDDEN void psvr2__history_free(struct psvr2_pose_history *h);
+PSVR2_HIDDEN void psvr2__history_push(struct psvr2_pose_history *h,
+				      const struct psvr2_pose *poses, int n);
+
+/* libpsvr2_orient.c: push from whichever thread reads the IMU batches. */
+PSVR2_HIDDEN struct psvr2_orient *psvr2__orient_alloc(void);
+PSVR2_HIDDEN void psvr2__orient_free(struct psvr2_orient *o);
+PSVR2_HIDDEN void psvr2__orient_push(struct psvr2_orient *o,
+				     const struct psvr2_imu_sample *s, int n);
+
+/*
+ * libpsvr2_clock.c: fill in @measured_ns, from whichever thread reads each
+ * stream; before anything else sees the samples.
+ */
+PSVR2_HIDDEN struct psvr2_clock *psvr2__clock_alloc(void);
+PSVR2_HIDDEN void psvr2__clock_free(struct psvr2_clock *c);
+PSVR2_HIDDEN void psvr2__clock_poses(struct psvr2_clock *c,
+				     struct psvr2_pose *poses, int n);
+PSVR2_HIDDEN void psvr2__clock_gazes(struct psvr2_clock *c,
+				     struct psvr2_gaze *gazes, int n);
+PSVR2_HIDDEN void psvr2__clock_imu(struct psvr2_clock *c,
+				   struct psvr2_imu_sample *s, int n);
+
+/*
+ * libpsvr2_fusion.c: push from the one thread that reads both the poses and
+ * the IMU batches; no-ops unless fusion is running.
+ */
+PSVR2_HIDDEN void psvr2__fusion_poses(psvr2_t *p,
+				      const struct psvr2_pose *poses, int n);
+PSVR2_HIDDEN void psvr2__fusion_imu(psvr2_t *p,
+				    const struct psvr2_imu_sample *s, int n);
+
+/*
+ * libpsvr2_gaze.c: push from whichever thread reads the gaze, after the clock
+ * mapping; a no-op unless the filter is running.
+ */
+PSVR2_HIDDEN void psvr2__gaze_filter(psvr2_t *p, const struct psvr2_gaze *g,
+				     int n);
+
+/*
+ * libpsvr2_ring.c. publish: writer only. read: up to @max records from *@seq
+ * on, skipping any already overwritten, and advance *@seq past them. peek: the
+ * newest record; 0 if none yet.
+ */
+PSVR2_HIDDEN void psvr2__ring_publish(const struct psvr2_ring *r,
+				      const void *src, int n);
+PSVR2_HIDDEN int psvr2__ring_read(const struct psvr2_ring *r, uint64_t *seq,
+				  void *out, int max);
+PSVR2_HIDDEN int psvr2__ring_peek(const struct psvr2_ring *r, void *out,
+				  uint64_t *seq);
+
+/*
+ * libpsvr2_ring.c: seqlock. The one writer brackets its stores with
+ * write_begin/end; a reader copies after read_begin and again while
+ * read_retry returns nonzero. read_begin returns 0 until the first write.
+ */
+PSVR2_HIDDEN void psvr2__seq_write_begin(uint32_t *lock);
+PSVR2_HIDDEN void psvr2__seq_write_end(uint32_t *lock);
+PSVR2_HIDDEN uint32_t psvr2__seq_read_begin(const uint32_t *lock);
+PSVR2_HIDDEN int psvr2__seq_read_retry(const uint32_t *lock, uint32_t begin);
+
+/*
+ * libpsvr2_ring.c: the part of a filter on the reading thread that other
+ * threads see. It is the first member of the filter's struct, which
+ * engine_alloc() allocates (zeroed, cache-aligned) at @size and engine_free()
+ * frees. start()/stop() from the API; the reader calls enter() before each
+ * batch, which returns -1 if stopped, 1 once with the new config copied to
+ * *@cfg after a start (reset the filter), else 0; and put_stats() after it.
+ * get_stats(), latest() and since() are for any thread, as the ring's peek
+ * and read, and take NULL for a filter never started (EINVAL).
+ */
+struct psvr2_engine {
+	struct psvr2_ring_pos pos __attribute__((aligned(64)));
+	struct psvr2_ring ring;
+	uint32_t	enabled;
+	uint32_t	reset;		/* a config is waiting in @next */
+	uint32_t	next_lock;	/* seqlock over @next */
+	uint32_t	stats_lock;	/* seqlock over @stats */
+	void		*next;		/* @cfg_sz bytes */
+	void		*stats;		/* @stats_sz bytes */
+	size_t		cfg_sz, stats_sz;
+};
+
+PSVR2_HIDDEN void *psvr2__engine_alloc(size_t size, size_t rec_sz,
+				       uint64_t cap, size_t cfg_sz,
+				       size_t stats_sz);
+PSVR2_HIDDEN void psvr2__engine_free(void *filter);
+PSVR2_HIDDEN int psvr2__engine_running(const struct psvr2_engine *e);
+PSVR2_HIDDEN void psvr2__engine_start(struct psvr2_engine *e,
+				      const void *cfg);
+PSVR2_HIDDEN void psvr2__engine_stop(struct psvr2_engine *e);
+PSVR2_HIDDEN int psvr2__engine_enter(struct psvr2_engine *e, void *cfg);
+PSVR2_HIDDEN void psvr2__engine_put_stats(struct psvr2_engine *e,
+					  const void *stats);
+PSVR2_HIDDEN int psvr2__engine_get_stats(const struct psvr2_engine *e,
+					 void *out);
+PSVR2_HIDDEN int psvr2__engine_latest(const struct psvr2_engine *e, void *out,
+				      uint64_t *seq);
+PSVR2_HIDDEN int psvr2__engine_since(const struct psvr2_engine *e,
+				     uint64_t *seq, void *out, int max);
+
+/*
+ * libpsvr2_shared.c: reads on a psvr2_open_shared() handle. @stream is a
+ * PSVR2_SHM_* (libpsvr2_shm.h). read: for the psvr2_read_*() calls; @flags
+ * takes PSVR2_READ_LATEST; returns as read_samples() does, but -1 with errno
+ * ENODEV once psvr2d has lost the headset or gone. drain: the same without
+ * waiting, for the dispatcher (also under ingestion). peek: the newest sample.
+ * sock: the socket to psvr2d, which hangs up when the daemon dies, or -1.
+ */
+PSVR2_HIDDEN int psvr2__shared_read(psvr2_t *p, int stream, void *out,
+				    int max, unsigned int flags,
+				    int timeout_ms);
+PSVR2_HIDDEN int psvr2__shared_drain(psvr2_t *p, int stream, void *out,
+				     int max);
+PSVR2_HIDDEN int psvr2__shared_peek(psvr2_t *p, int stream, void *out);
+PSVR2_HIDDEN int psvr2__shared_sock(const psvr2_t *p);
+PSVR2_HIDDEN void psvr2__shared_free(psvr2_t *p);
+
+/*
+ * libpsvr2_replay.c: the same for a psvr2_open_replay() handle, with @stream a
+ * PSVR2_REC_*; ENODEV means the recording is over. imu: the newest IMU sample
+ * due, for psvr2_read_imu(). input_fd: the input stream's timerfd, for the
+ * dispatcher (which dups it), or -1.
+ */
+PSVR2_HIDDEN int psvr2__replay_read(psvr2_t *p, int stream, void *out,
+				    int max, unsigned int flags,
+				    int timeout_ms);
+PSVR2_HIDDEN int psvr2__replay_drain(psvr2_t *p, int stream, void *out,
+				     int max);
+PSVR2_HIDDEN int psvr2__replay_imu(psvr2_t *p, struct psvr2_imu_sample *out);
+PSVR2_HIDDEN int psvr2__replay_input_fd(const psvr2_t *p);
+PSVR2_HIDDEN void psvr2__replay_free(psvr2_t *p);
+
+#endif /* LIBPSVR2_INT_H */
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — 2 kHz orientation from the IMU alone.
+ *
+ * A Mahony complementary filter: the gyro is integrated, and the tilt error
+ * between the measured and the predicted gravity direction is fed back as a
+ * proportional correction and, integrated, as the gyro bias. Gravity says
+ * nothing about rotation around itself, so while the headset sits still the
+ * bias is also pulled towards the raw rate on all three axes; the heading
+ * otherwise starts at 0 and drifts only with what bias remains.
+ *
+ * Whichever thread reads the IMU batches feeds them in (batched reads, the
+ * dispatcher or the ingestion thread); psvr2_orientation_latest() may run on
+ * any other, through a seqlock as the ingestion thread's latest slots.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libpsvr2_int.h"
+
+#define GRAVITY		9.80665f
+#define KP		0.5f	/* tilt correction, rad/s per unit error */
+#define KI		0.02f	/* bias learning from the tilt error */
+#define ACCEL_GATE	0.15f	/* only trust |a| within g * (1 +- this) */
+#define MAX_DT		0.02f	/* longer gaps are not integrated across */
+
+/* Still: rate under STILL_RATE and |a| within STILL_ACCEL of g, STILL_TIME. */
+#define STILL_RATE	0.03f	/* rad/s, after bias */
+#define STILL_ACCEL	0.05f
+#define STILL_TIME	0.25f	/* s */
+#define STILL_TAU	2.0f	/* s, bias time constant while still */
+
+struct psvr2_orient {
+	/* Reader-thread state. */
+	float		q[4];		/* w, x, y, z: device to world */
+	float		bias[3];
+	float		still;		/* seconds still so far */
+	uint64_t	last_t;
+	int		started;
+
+	/* Published, under @lock. */
+	uint32_t	lock;
+	struct psvr2_orientation out;
+};
+
+struct psvr2_orient *psvr2__orient_alloc(void)
+{
+	return calloc(1, sizeof(struct psvr2_orient));
+}
+
+void psvr2__orient_free(struct psvr2_orient *o)
+{
+	free(o);
+}
+
+static void normalise(float q[4])
+{
+	float n = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+
+	for (int i = 0; i < 4; i++)
+		q[i] /= n;
+}
+
+/* Level from the first sample: the shortest arc taking @a (unit) to +z. */
+static void orient_start(struct psvr2_orient *o, const float a[3])
+{
+	if (a[2] < -0.9999f) {
+		/* Upside down: half a turn about x. */
+		o->q[0] = 0;
+		o->q[1] = 1;
+		o->q[2] = 0;
+		o->q[3] = 0;
+		return;
+	}
+	/* q = (1 + a.z, a x z), normalised */
+	o->q[0] = 1 + a[2];
+	o->q[1] = a[1];
+	o->q[2] = -a[0];
+	o->q[3] = 0;
+	normalise(o->q);
+}
+
+void psvr2__orient_push(struct psvr2_orient *o,
+			const struct psvr2_imu_sample *s, int n)
+{
+	float ax[IMU_BATCH], ay[IMU_BATCH], az[IMU_BATCH], gate[IMU_BATCH];
+	float *q = o ? o->q : NULL, *b = o ? o->bias : NULL;
+	float w[3] = { 0, 0, 0 };
+	int k0 = 0;
+
+	if (!o || n <= 0)
+		return;
+
+	while (k0 < n) {
+		int m = n - k0 < IMU_BATCH ? n - k0 : IMU_BATCH;
+		const struct psvr2_imu_sample *in = s + k0;
+
+		/*
+		 * Everything that doesn't depend on the previous sample first,
+		 * in one pass the compiler can vectorise: unit accel and
+		 * whether its magnitude is plausible for gravity.
+		 */
+		for (int k = 0; k < m; k++) {
+			float x = in[k].accel_m_s2[0];
+			float y = in[k].accel_m_s2[1];
+			float z = in[k].accel_m_s2[2];
+			float norm = sqrtf(x * x + y * y + z * z);
+			float dev = fabsf(norm - GRAVITY) / GRAVITY;
+			float inv = norm > 0 ? 1 / norm : 0;
+
+			ax[k] = x * inv;
+			ay[k] = y * inv;
+			az[k] = z * inv;
+			gate[k] = dev < ACCEL_GATE ? (dev < STILL_ACCEL ? 2 : 1)
+						   : 0;
+		}
+
+		/* Then the recursion, one sample at a time. */
+		for (int k = 0; k < m; k++) {
+			float vx, vy, vz, ex, ey, ez, dt, rate, h[4];
+
+			if (!o->started) {
+				if (!gate[k])
+					continue;
+				orient_start(o, (float[3]){ ax[k], ay[k],
+							    az[k] });
+				o->last_t = in[k].measured_ns;
+				o->started = 1;
+				continue;
+			}
+			if (in[k].measured_ns <= o->last_t)
+				continue;
+			dt = (in[k].measured_ns - o->last_t) * 1e-9f;
+			o->last_t = in[k].measured_ns;
+			if (dt > MAX_DT)
+				dt = MAX_DT;
+
+			for (int a = 0; a < 3; a++)
+				w[a] = in[k].gyro_rad_s[a] - b[a];
+
+			/* Still long enough: the raw rate is all bias. */
+			rate = sqrtf(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+			if (gate[k] == 2 && rate < STILL_RATE)
+				o->still += dt;
+			else
+				o->still = 0;
+			if (o->still >= STILL_TIME)
+				for (int a = 0; a < 3; a++)
+					b[a] += w[a] * (dt / STILL_TAU);
+
+			/* Gravity (+z) seen from the device: R^T z. */
+			vx = 2 * (q[1] * q[3] - q[0] * q[2]);
+			vy = 2 * (q[0] * q[1] + q[2] * q[3]);
+			vz = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] +
+			     q[3] * q[3];
+			if (gate[k]) {
+				ex = ay[k] * vz - az[k] * vy;
+				ey = az[k] * vx - ax[k] * vz;
+				ez = ax[k] * vy - ay[k] * vx;
+				b[0] -= KI * ex * dt;
+				b[1] -= KI * ey * dt;
+				b[2] -= KI * ez * dt;
+			} else {
+				ex = ey = ez = 0;
+			}
+
+			/* q += q * (0, w + KP e) * dt / 2 */
+			vx = (w[0] + KP * ex) * 0.5f * dt;
+			vy = (w[1] + KP * ey) * 0.5f * dt;
+			vz = (w[2] + KP * ez) * 0.5f * dt;
+			h[0] = q[0] - q[1] * vx - q[2] * vy - q[3] * vz;
+			h[1] = q[1] + q[0] * vx + q[2] * vz - q[3] * vy;
+			h[2] = q[2] + q[0] * vy - q[1] * vz + q[3] * vx;
+			h[3] = q[3] + q[0] * vz + q[1] * vy - q[2] * vx;
+			memcpy(q, h, sizeof(h));
+			normalise(q);
+		}
+		k0 += m;
+	}
+	if (!o->started)
+		return;
+
+	/* One publish per batch. */
+	psvr2__seq_write_begin(&o->lock);
+	o->out.timestamp_ns = o->last_t;
+	memcpy(o->out.orientation, q, sizeof(o->out.orientation));
+	memcpy(o->out.angular_velocity, w, sizeof(w));
+	memcpy(o->out.gyro_bias, b, sizeof(o->out.gyro_bias));
+	psvr2__seq_write_end(&o->lock);
+}
+
+int psvr2_orientation_latest(psvr2_t *p, struct psvr2_orientation *out)
+{
+	struct psvr2_orient *o = p ? p->orient : NULL;
+	uint32_t lock;
+
+	if (!o || !out) {
+		errno = EINVAL;
+		return -1;
+	}
+	do {
+		lock = psvr2__seq_read_begin(&o->lock);
+		if (!lock) {
+			errno = ENODATA;
+			return -1;
+		}
+		memcpy(out, &o->out, sizeof(*out));
+	} while (psvr2__seq_read_retry(&o->lock, lock));
+	return 0;
+}
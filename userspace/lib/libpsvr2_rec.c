@@ -0,0 +1,524 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — recording writer (format in libpsvr2_rec.h).
+ *
+ * Each stream encodes into its own buffer, which goes to the file as a chunk
+ * once it spans CHUNK_SPAN_NS or CHUNK_BYTES: at most a second of a stream is
+ * lost if the recorder dies, and replay can start anywhere within a second of
+ * the moment asked for. A camera frame is a chunk of its own, written straight
+ * from the caller's buffer.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "libpsvr2_rec.h"
+
+#define CHUNK_SPAN_NS	1000000000ull	/* 1 s */
+#define CHUNK_BYTES	(64 * 1024)
+/* A record's worst case: the timestamp and every word at 10 bytes. */
+#define RECORD_MAX	((1 + PSVR2_REC_MAX_WORDS) * 10)
+
+struct rec_stream {
+	uint8_t		*buf;		/* CHUNK_BYTES + RECORD_MAX */
+	size_t		len;
+	uint32_t	count;
+	uint64_t	t_first;
+	uint64_t	t_prev;
+	uint32_t	prev[PSVR2_REC_MAX_WORDS];
+};
+
+struct psvr2_rec {
+	int		fd;
+	uint64_t	offset;		/* where the next chunk goes */
+	int		error;		/* first write error, sticky */
+	struct rec_stream s[PSVR2_REC_FRAME];	/* all but frames */
+	struct rec_index_entry *index;
+	size_t		nindex;
+	size_t		index_cap;
+};
+
+/* ---- records ------------------------------------------------------------ */
+
+static const int words[PSVR2_REC_STREAMS] = {
+	[PSVR2_REC_POSE] = PSVR2_REC_POSE_WORDS,
+	[PSVR2_REC_GAZE] = PSVR2_REC_GAZE_WORDS,
+	[PSVR2_REC_IMU] = PSVR2_REC_IMU_WORDS,
+	[PSVR2_REC_INPUT] = PSVR2_REC_INPUT_WORDS,
+	[PSVR2_REC_FRAME] = PSVR2_REC_FRAME_WORDS,
+};
+
+int psvr2__rec_words(int stream, uint32_t version)
+{
+	if (stream < 0 || stream >= PSVR2_REC_STREAMS)
+		return 0;
+	/* Version 1 had no device clock for the IMU. */
+	if (version < 2 && stream == PSVR2_REC_IMU)
+		return words[stream] - 1;
+	return words[stream];
+}
+
+static uint32_t fbits(float f)
+{
+	uint32_t w;
+
+	memcpy(&w, &f, sizeof(w));
+	return w;
+}
+
+static float bitsf(uint32_t w)
+{
+	float f;
+
+	memcpy(&f, &w, sizeof(f));
+	return f;
+}
+
+/* Field order is part of the format: append only, bump the version. */
+static uint32_t *pack_eye(uint32_t *w, const struct psvr2_eye *e)
+{
+	*w++ = e->gaze_point_valid;
+	for (int i = 0; i < 3; i++)
+		*w++ = fbits(e->gaze_point_mm[i]);
+	*w++ = e->gaze_direction_valid;
+	for (int i = 0; i < 3; i++)
+		*w++ = fbits(e->gaze_direction[i]);
+	*w++ = e->pupil_diameter_valid;
+	*w++ = fbits(e->pupil_diameter_mm);
+	*w++ = e->blink_valid;
+	*w++ = e->blink;
+	return w;
+}
+
+static const uint32_t *unpack_eye(const uint32_t *w, struct psvr2_eye *e)
+{
+	e->gaze_point_valid = *w++;
+	for (int i = 0; i < 3; i++)
+		e->gaze_point_mm[i] = bitsf(*w++);
+	e->gaze_direction_valid = *w++;
+	for (int i = 0; i < 3; i++)
+		e->gaze_direction[i] = bitsf(*w++);
+	e->pupil_diameter_valid = *w++;
+	e->pupil_diameter_mm = bitsf(*w++);
+	e->blink_valid = *w++;
+	e->blink = *w++;
+	return w;
+}
+
+uint64_t psvr2__rec_pack(int stream, const void *rec, uint32_t *w)
+{
+	switch (stream) {
+	case PSVR2_REC_POSE: {
+		const struct psvr2_pose *p = rec;
+
+		*w++ = p->device_vts_us;
+		*w++ = p->valid;
+		for (int i = 0; i < 3; i++)
+			*w++ = fbits(p->position[i]);
+		for (int i = 0; i < 4; i++)
+			*w++ = fbits(p->orientation[i]);
+		return p->timestamp_ns;
+	}
+	case PSVR2_REC_GAZE: {
+		const struct psvr2_gaze *g = rec;
+
+		*w++ = g->device_timestamp_us;
+		*w++ = g->valid;
+		w = pack_eye(w, &g->left);
+		w = pack_eye(w, &g->right);
+		*w++ = g->combined.gaze_point_valid;
+		for (int i = 0; i < 3; i++)
+			*w++ = fbits(g->combined.gaze_point_mm[i]);
+		*w++ = g->combined.gaze_direction_valid;
+		for (int i = 0; i < 3; i++)
+			*w++ = fbits(g->combined.gaze_direction[i]);
+		return g->timestamp_ns;
+	}
+	case PSVR2_REC_IMU: {
+		const struct psvr2_imu_sample *s = rec;
+
+		for (int i = 0; i < 3; i++)
+			*w++ = fbits(s->accel_m_s2[i]);
+		for (int i = 0; i < 3; i++)
+			*w++ = fbits(s->gyro_rad_s[i]);
+		*w++ = s->device_vts_us;
+		return s->timestamp_ns;
+	}
+	case PSVR2_REC_INPUT: {
+		const struct psvr2_input_event *ev = rec;
+
+		*w++ = ev->kind;
+		*w++ = ev->value;
+		return ev->timestamp_ns;
+	}
+	case PSVR2_REC_FRAME: {
+		const struct psvr2_frame *f = rec;
+
+		*w++ = f->width;
+		*w++ = f->height;
+		*w++ = f->fourcc;
+		return f->timestamp_ns;
+	}
+	}
+	return 0;
+}
+
+void psvr2__rec_unpack(int stream, uint64_t ts, const uint32_t *w, void *rec)
+{
+	switch (stream) {
+	case PSVR2_REC_POSE: {
+		struct psvr2_pose *p = rec;
+
+		p->timestamp_ns = ts;
+		p->device_vts_us = *w++;
+		p->valid = *w++;
+		for (int i = 0; i < 3; i++)
+			p->position[i] = bitsf(*w++);
+		for (int i = 0; i < 4; i++)
+			p->orientation[i] = bitsf(*w++);
+		p->measured_ns = ts;
+		break;
+	}
+	case PSVR2_REC_GAZE: {
+		struct psvr2_gaze *g = rec;
+
+		g->timestamp_ns = ts;
+		g->device_timestamp_us = *w++;
+		g->valid = *w++;
+		w = unpack_eye(w, &g->left);
+		w = unpack_eye(w, &g->right);
+		g->combined.gaze_point_valid = *w++;
+		for (int i = 0; i < 3; i++)
+			g->combined.gaze_point_mm[i] = bitsf(*w++);
+		g->combined.gaze_direction_valid = *w++;
+		for (int i = 0; i < 3; i++)
+			g->combined.gaze_direction[i] = bitsf(*w++);
+		g->measured_ns = ts;
+		break;
+	}
+	case PSVR2_REC_IMU: {
+		struct psvr2_imu_sample *s = rec;
+
+		s->timestamp_ns = ts;
+		for (int i = 0; i < 3; i++)
+			s->accel_m_s2[i] = bitsf(*w++);
+		for (int i = 0; i < 3; i++)
+			s->gyro_rad_s[i] = bitsf(*w++);
+		s->device_vts_us = *w++;
+		s->measured_ns = ts;
+		break;
+	}
+	case PSVR2_REC_INPUT: {
+		struct psvr2_input_event *ev = rec;
+
+		ev->timestamp_ns = ts;
+		ev->kind = *w++;
+		ev->value = *w++;
+		break;
+	}
+	case PSVR2_REC_FRAME: {
+		struct psvr2_frame *f = rec;
+
+		f->timestamp_ns = ts;
+		f->width = *w++;
+		f->height = *w++;
+		f->fourcc = *w++;
+		break;
+	}
+	}
+}
+
+/* ---- varints ------------------------------------------------------------ */
+
+static uint8_t *put_varint(uint8_t *p, uint64_t v)
+{
+	while (v >= 0x80) {
+		*p++ = v | 0x80;
+		v >>= 7;
+	}
+	*p++ = v;
+	return p;
+}
+
+int psvr2__rec_get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v)
+{
+	uint64_t x = 0;
+
+	for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+		uint8_t b = *(*p)++;
+
+		x |= (uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80)) {
+			*v = x;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static uint64_t zigzag64(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static uint32_t zigzag32(int32_t v)
+{
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+/* The timestamp, then each word, against the previous record in the chunk. */
+static uint8_t *encode(uint8_t *p, int n, uint64_t ts, const uint32_t *w,
+		       uint64_t *t_prev, uint32_t *prev)
+{
+	p = put_varint(p, zigzag64((int64_t)(ts - *t_prev)));
+	*t_prev = ts;
+	for (int i = 0; i < n; i++) {
+		p = put_varint(p, zigzag32((int32_t)(w[i] - prev[i])));
+		prev[i] = w[i];
+	}
+	return p;
+}
+
+/* ---- chunks ------------------------------------------------------------- */
+
+static int write_all(struct psvr2_rec *r, struct iovec *iov, int n)
+{
+	size_t total = 0;
+
+	for (int i = 0; i < n; i++)
+		total += iov[i].iov_len;
+	while (n) {
+		ssize_t w = writev(r->fd, iov, n);
+
+		if (w < 0 && errno == EINTR)
+			continue;
+		if (w < 0) {
+			r->error = errno;
+			return -1;
+		}
+		while (n && (size_t)w >= iov->iov_len) {
+			w -= iov->iov_len;
+			iov++;
+			n--;
+		}
+		if (n) {
+			iov->iov_base = (char *)iov->iov_base + w;
+			iov->iov_len -= w;
+		}
+	}
+	r->offset += total;
+	return 0;
+}
+
+static int write_chunk(struct psvr2_rec *r, int stream, uint32_t count,
+		       uint64_t t_first, uint64_t t_last, struct iovec *payload,
+		       int npayload)
+{
+	struct rec_chunk_hdr h = {
+		.magic = htole32(PSVR2_REC_CHUNK_MAGIC),
+		.stream = stream,
+		.count = htole32(count),
+		.t_first = htole64(t_first),
+		.t_last = htole64(t_last),
+	};
+	struct iovec iov[4] = { { &h, sizeof(h) } };
+	uint64_t offset = r->offset;
+	size_t len = 0;
+
+	if (r->error) {
+		errno = r->error;
+		return -1;
+	}
+	for (int i = 0; i < npayload; i++) {
+		iov[1 + i] = payload[i];
+		len += payload[i].iov_len;
+	}
+	h.len = htole32(len);
+
+	if (stream != PSVR2_REC_INDEX) {
+		struct rec_index_entry *e;
+
+		if (r->nindex == r->index_cap) {
+			size_t cap = r->index_cap ? 2 * r->index_cap : 256;
+
+			e = realloc(r->index, cap * sizeof(*e));
+			if (!e)
+				return -1;
+			r->index = e;
+			r->index_cap = cap;
+		}
+		e = &r->index[r->nindex];
+		e->offset = htole64(offset);
+		e->t_first = htole64(t_first);
+		e->t_last = htole64(t_last);
+		e->count = htole32(count);
+		e->stream = htole32(stream);
+	}
+	if (write_all(r, iov, 1 + npayload))
+		return -1;
+	if (stream != PSVR2_REC_INDEX)
+		r->nindex++;
+	return 0;
+}
+
+static int flush_stream(struct psvr2_rec *r, int stream)
+{
+	struct rec_stream *s = &r->s[stream];
+	struct iovec iov = { s->buf, s->len };
+	int err;
+
+	if (!s->count)
+		return 0;
+	err = write_chunk(r, stream, s->count, s->t_first, s->t_prev, &iov, 1);
+	s->len = 0;
+	s->count = 0;
+	memset(s->prev, 0, sizeof(s->prev));
+	return err;
+}
+
+static int append(struct psvr2_rec *r, int stream, const void *recs,
+		  size_t sz, int n)
+{
+	struct rec_stream *s;
+
+	if (!r || (!recs && n) || n < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	s = &r->s[stream];
+	for (int k = 0; k < n; k++) {
+		uint32_t w[PSVR2_REC_MAX_WORDS];
+		uint64_t ts = psvr2__rec_pack(stream,
+					      (const char *)recs + k * sz, w);
+
+		if (!s->count) {
+			s->t_first = ts;
+			s->t_prev = ts;
+		}
+		s->len = encode(s->buf + s->len, words[stream], ts, w,
+				&s->t_prev, s->prev) - s->buf;
+		s->count++;
+		if ((s->len >= CHUNK_BYTES ||
+		     ts - s->t_first >= CHUNK_SPAN_NS) &&
+		    flush_stream(r, stream))
+			return -1;
+	}
+	return 0;
+}
+
+/* ---- API ---------------------------------------------------------------- */
+
+psvr2_rec_t *psvr2_rec_open(const char *path)
+{
+	struct rec_file_hdr h = {
+		.version = htole32(PSVR2_REC_VERSION),
+		.hdr_size = htole32(sizeof(h)),
+	};
+	struct iovec iov = { &h, sizeof(h) };
+	struct psvr2_rec *r = calloc(1, sizeof(*r));
+	int err;
+
+	if (!r)
+		return NULL;
+	memcpy(h.magic, PSVR2_REC_MAGIC, sizeof(h.magic));
+	for (int i = 0; i < PSVR2_REC_FRAME; i++) {
+		r->s[i].buf = malloc(CHUNK_BYTES + RECORD_MAX);
+		if (!r->s[i].buf)
+			goto fail;
+	}
+	r->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (r->fd < 0)
+		goto fail;
+	if (write_all(r, &iov, 1)) {
+		close(r->fd);
+		goto fail;
+	}
+	return r;
+
+fail:
+	err = errno;
+	for (int i = 0; i < PSVR2_REC_FRAME; i++)
+		free(r->s[i].buf);
+	free(r);
+	errno = err;
+	return NULL;
+}
+
+int psvr2_rec_poses(psvr2_rec_t *r, const struct psvr2_pose *poses, int n)
+{
+	return append(r, PSVR2_REC_POSE, poses, sizeof(*poses), n);
+}
+
+int psvr2_rec_gazes(psvr2_rec_t *r, const struct psvr2_gaze *gazes, int n)
+{
+	return append(r, PSVR2_REC_GAZE, gazes, sizeof(*gazes), n);
+}
+
+int psvr2_rec_imu(psvr2_rec_t *r, const struct psvr2_imu_sample *s, int n)
+{
+	return append(r, PSVR2_REC_IMU, s, sizeof(*s), n);
+}
+
+int psvr2_rec_input(psvr2_rec_t *r, const struct psvr2_input_event *ev)
+{
+	return append(r, PSVR2_REC_INPUT, ev, sizeof(*ev), 1);
+}
+
+int psvr2_rec_frame(psvr2_rec_t *r, const struct psvr2_frame *f)
+{
+	uint32_t w[PSVR2_REC_FRAME_WORDS], prev[PSVR2_REC_FRAME_WORDS] = { 0 };
+	uint8_t head[RECORD_MAX + 10], *end;
+	uint64_t ts, t_prev;
+	struct iovec iov[2];
+
+	if (!r || !f || (!f->data && f->len)) {
+		errno = EINVAL;
+		return -1;
+	}
+	ts = psvr2__rec_pack(PSVR2_REC_FRAME, f, w);
+	t_prev = ts;
+	end = encode(head, PSVR2_REC_FRAME_WORDS, ts, w, &t_prev, prev);
+	end = put_varint(end, f->len);
+	iov[0] = (struct iovec){ head, end - head };
+	iov[1] = (struct iovec){ (void *)f->data, f->len };
+	return write_chunk(r, PSVR2_REC_FRAME, 1, ts, ts, iov, 2);
+}
+
+int psvr2_rec_close(psvr2_rec_t *r)
+{
+	struct rec_trailer t;
+	struct iovec iov;
+	int err = 0;
+
+	if (!r)
+		return 0;
+	memcpy(t.magic, PSVR2_REC_END_MAGIC, sizeof(t.magic));
+	for (int i = 0; i < PSVR2_REC_FRAME; i++)
+		if (flush_stream(r, i))
+			err = -1;
+
+	if (!err) {
+		t.index_offset = htole64(r->offset);
+		iov = (struct iovec){ r->index,
+				      r->nindex * sizeof(*r->index) };
+		err = write_chunk(r, PSVR2_REC_INDEX, r->nindex, 0, 0, &iov, 1);
+	}
+	if (!err) {
+		iov = (struct iovec){ &t, sizeof(t) };
+		err = write_all(r, &iov, 1);
+	}
+	if (close(r->fd) && !err)
+		err = -1;
+
+	for (int i = 0; i < PSVR2_REC_FRAME; i++)
+		free(r->s[i].buf);
+	free(r->index);
+	free(r);
+	return err;
+}
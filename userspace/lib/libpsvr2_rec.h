@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * libpsvr2 — the .psvr2rec recording format, written by psvr2_rec_*() and
+ * served back by psvr2_open_replay(). Not installed.
+ *
+ * A file is a header, then chunks appended as they fill, then (once the
+ * recording is closed cleanly) an index chunk and a trailer pointing at it:
+ *
+ *	struct rec_file_hdr
+ *	struct rec_chunk_hdr, payload	(any stream, any number)
+ *	struct rec_chunk_hdr, struct rec_index_entry[count]	(the index)
+ *	struct rec_trailer
+ *
+ * Each chunk holds one stream's records in time order, with its first and
+ * last timestamp in the header; so a reader can find any moment from the
+ * index alone, or by walking the chunk headers if the recorder died before
+ * writing one. A chunk decodes on its own: every record is its timestamp,
+ * then the stream's fields as 32-bit words (floats as their bit patterns),
+ * each stored as the zigzag varint of its difference from the same field of
+ * the previous record in the chunk (or from 0). Slowly changing fields and
+ * flags so shrink to a byte or two. Camera frames add a varint length and the
+ * raw image after their words. Headers are little-endian.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#ifndef LIBPSVR2_REC_H
+#define LIBPSVR2_REC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libpsvr2_int.h"
+
+#define PSVR2_REC_MAGIC		"PSVR2REC"
+#define PSVR2_REC_END_MAGIC	"PSVR2END"
+#define PSVR2_REC_CHUNK_MAGIC	0x4b4e4843	/* "CHNK" */
+#define PSVR2_REC_VERSION	2	/* 2: IMU device clock; reads 1 too */
+
+/*
+ * Streams; pose, gaze and IMU are numbered as PSVR2_SHM_*, so the library's
+ * read paths can pass either kind of stream id through.
+ */
+enum psvr2_rec_stream {
+	PSVR2_REC_POSE,
+	PSVR2_REC_GAZE,
+	PSVR2_REC_IMU,
+	PSVR2_REC_INPUT,
+	PSVR2_REC_FRAME,
+	PSVR2_REC_STREAMS,
+	PSVR2_REC_INDEX = 0xff,
+};
+
+/* 32-bit fields per record, after the timestamp. */
+#define PSVR2_REC_POSE_WORDS	9
+#define PSVR2_REC_GAZE_WORDS	34
+#define PSVR2_REC_IMU_WORDS	7	/* 6 in version 1 */
+#define PSVR2_REC_INPUT_WORDS	2
+#define PSVR2_REC_FRAME_WORDS	3
+#define PSVR2_REC_MAX_WORDS	PSVR2_REC_GAZE_WORDS
+
+struct rec_file_hdr {
+	char		magic[8];	/* PSVR2_REC_MAGIC */
+	uint32_t	version;
+	uint32_t	hdr_size;	/* sizeof(struct rec_file_hdr) */
+};
+
+struct rec_chunk_hdr {
+	uint32_t	magic;		/* PSVR2_REC_CHUNK_MAGIC */
+	uint8_t		stream;		/* enum psvr2_rec_stream */
+	uint8_t		pad[3];
+	uint32_t	count;		/* records */
+	uint32_t	len;		/* payload bytes */
+	uint64_t	t_first;	/* timestamp of the first record */
+	uint64_t	t_last;		/* and the last */
+};
+
+struct rec_index_entry {
+	uint64_t	offset;		/* of the chunk header */
+	uint64_t	t_first;
+	uint64_t	t_last;
+	uint32_t	count;
+	uint32_t	stream;
+};
+
+struct rec_trailer {
+	uint64_t	index_offset;	/* of the index chunk's header */
+	char		magic[8];	/* PSVR2_REC_END_MAGIC */
+};
+
+/* libpsvr2_rec.c: one record <-> its timestamp and words, and the varints. */
+PSVR2_HIDDEN int psvr2__rec_words(int stream, uint32_t version);
+PSVR2_HIDDEN uint64_t psvr2__rec_pack(int stream, const void *rec,
+				      uint32_t *w);
+PSVR2_HIDDEN void psvr2__rec_unpack(int stream, uint64_t ts,
+				    const uint32_t *w, void *rec);
+PSVR2_HIDDEN int psvr2__rec_get_varint(const uint8_t **p, const uint8_t *end,
+				       uint64_t *v);
+
+#endif /* LIBPSVR2_REC_H */
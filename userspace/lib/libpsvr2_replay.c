@@ -0,0 +1,575 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — replay backend: a handle whose streams come from a recording
+ * (format in libpsvr2_rec.h) instead of the device nodes.
+ *
+ * The file is mapped and decoded a record at a time, each stream from its own
+ * position. A record is released once the replay clock passes its time, so
+ * pacing needs no thread: each stream has a timerfd armed for its next record,
+ * standing in for the node's fd in poll(), the dispatcher and the blocking
+ * reads. When the recording runs out the streams end as on an unplug.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "libpsvr2_rec.h"
+
+union replay_record {
+	struct psvr2_pose	 pose;
+	struct psvr2_gaze	 gaze;
+	struct psvr2_imu_sample	 imu;
+	struct psvr2_input_event input;
+	struct psvr2_frame	 frame;
+};
+
+struct replay_chunk {
+	uint64_t	offset;		/* of the header */
+	uint64_t	t_first;
+	uint64_t	t_last;
+	uint32_t	count;
+	uint32_t	stream;
+};
+
+struct replay_stream {
+	int		*chunks;	/* this stream's, in file order */
+	int		nchunks;
+	int		next_chunk;
+	const uint8_t	*pos;		/* in the current chunk's payload */
+	const uint8_t	*end;
+	uint32_t	left;		/* records not yet decoded */
+	uint64_t	t_prev;
+	uint32_t	prev[PSVR2_REC_MAX_WORDS];
+	int		pending;	/* @next holds the next record */
+	uint64_t	next_ts;	/* as recorded */
+	union replay_record next;
+	int		tfd;		/* timerfd, -1 for frames/absent */
+};
+
+struct psvr2_replay {
+	const uint8_t	*map;
+	size_t		len;
+	uint32_t	version;	/* of the file's format */
+	struct replay_chunk *chunks;
+	int		nchunks;
+	struct replay_stream s[PSVR2_REC_STREAMS];
+	double		speed;		/* 0: as fast as read */
+	uint64_t	t_begin;	/* recording's first and last stamp */
+	uint64_t	t_end;
+	uint64_t	t0;		/* recorded time played at @start */
+	uint64_t	start;		/* CLOCK_MONOTONIC */
+	struct psvr2_imu_sample last_imu;
+	int		have_imu;
+};
+
+static const size_t record_sz[PSVR2_REC_STREAMS] = {
+	[PSVR2_REC_POSE] = sizeof(struct psvr2_pose),
+	[PSVR2_REC_GAZE] = sizeof(struct psvr2_gaze),
+	[PSVR2_REC_IMU] = sizeof(struct psvr2_imu_sample),
+	[PSVR2_REC_INPUT] = sizeof(struct psvr2_input_event),
+	[PSVR2_REC_FRAME] = sizeof(struct psvr2_frame),
+};
+
+/* ---- opening ------------------------------------------------------------ */
+
+static int add_chunk(struct psvr2_replay *rp, int *cap,
+		     const struct replay_chunk *c)
+{
+	if (rp->nchunks == *cap) {
+		struct replay_chunk *n;
+
+		*cap = *cap ? 2 * *cap : 256;
+		n = realloc(rp->chunks, *cap * sizeof(*n));
+		if (!n)
+			return -1;
+		rp->chunks = n;
+	}
+	rp->chunks[rp->nchunks++] = *c;
+	return 0;
+}
+
+/* A chunk header at @off, if it and its payload lie within the file. */
+static int chunk_at(const struct psvr2_replay *rp, uint64_t off,
+		    struct rec_chunk_hdr *h)
+{
+	if (off > rp->len || rp->len - off < sizeof(*h))
+		return -1;
+	memcpy(h, rp->map + off, sizeof(*h));
+	h->magic = le32toh(h->magic);
+	h->count = le32toh(h->count);
+	h->len = le32toh(h->len);
+	h->t_first = le64toh(h->t_first);
+	h->t_last = le64toh(h->t_last);
+	if (h->magic != PSVR2_REC_CHUNK_MAGIC ||
+	    h->len > rp->len - off - sizeof(*h))
+		return -1;
+	return 0;
+}
+
+/* From the trailer's index: the fast path for a cleanly closed recording. */
+static int load_index(struct psvr2_replay *rp)
+{
+	struct rec_trailer t;
+	struct rec_chunk_hdr h;
+	const uint8_t *e;
+	int cap = 0;
+
+	if (rp->len < sizeof(struct rec_file_hdr) + sizeof(t))
+		return -1;
+	memcpy(&t, rp->map + rp->len - sizeof(t), sizeof(t));
+	if (memcmp(t.magic, PSVR2_REC_END_MAGIC, sizeof(t.magic)) ||
+	    chunk_at(rp, le64toh(t.index_offset), &h) ||
+	    h.stream != PSVR2_REC_INDEX ||
+	    h.len != (uint64_t)h.count * sizeof(struct rec_index_entry))
+		return -1;
+
+	e = rp->map + le64toh(t.index_offset) + sizeof(h);
+	for (uint32_t i = 0; i < h.count; i++) {
+		struct rec_index_entry ie;
+		struct replay_chunk c;
+
+		memcpy(&ie, e + i * sizeof(ie), sizeof(ie));
+		c.offset = le64toh(ie.offset);
+		c.t_first = le64toh(ie.t_first);
+		c.t_last = le64toh(ie.t_last);
+		c.count = le32toh(ie.count);
+		c.stream = le32toh(ie.stream);
+		if (add_chunk(rp, &cap, &c))
+			return -1;
+	}
+	return 0;
+}
+
+/* No index (the recorder died): walk the chunks up to the first torn one. */
+static int scan_chunks(struct psvr2_replay *rp)
+{
+	uint64_t off = sizeof(struct rec_file_hdr);
+	struct rec_chunk_hdr h;
+	int cap = 0;
+
+	rp->nchunks = 0;
+	while (!chunk_at(rp, off, &h)) {
+		struct replay_chunk c = {
+			.offset = off,
+			.t_first = h.t_first,
+			.t_last = h.t_last,
+			.count = h.count,
+			.stream = h.stream,
+		};
+
+		if (h.stream != PSVR2_REC_INDEX && add_chunk(rp, &cap, &c))
+			return -1;
+		off += sizeof(h) + h.len;
+	}
+	return 0;
+}
+
+/* Give each stream its chunk list and the recording its time span. */
+static int index_streams(struct psvr2_replay *rp)
+{
+	rp->t_begin = UINT64_MAX;
+	for (int i = 0; i < rp->nchunks; i++) {
+		const struct replay_chunk *c = &rp->chunks[i];
+		struct replay_stream *s;
+		int *n;
+
+		if (c->stream >= PSVR2_REC_STREAMS || !c->count)
+			continue;
+		s = &rp->s[c->stream];
+		n = realloc(s->chunks, (s->nchunks + 1) * sizeof(*n));
+		if (!n)
+			return -1;
+		s->chunks = n;
+		s->chunks[s->nchunks++] = i;
+		if (c->t_first < rp->t_begin)
+			rp->t_begin = c->t_first;
+		if (c->t_last > rp->t_end)
+			rp->t_end = c->t_last;
+	}
+	if (rp->t_begin == UINT64_MAX)
+		rp->t_begin = 0;
+	return 0;
+}
+
+/* ---- decoding ----------------------------------------------------------- */
+
+static int load_chunk(struct psvr2_replay *rp, struct replay_stream *s)
+{
+	const struct replay_chunk *c = &rp->chunks[s->chunks[s->next_chunk++]];
+	struct rec_chunk_hdr h;
+
+	if (chunk_at(rp, c->offset, &h))
+		return -1;
+	s->pos = rp->map + c->offset + sizeof(h);
+	s->end = s->pos + h.len;
+	s->left = h.count;
+	s->t_prev = h.t_first;
+	memset(s->prev, 0, sizeof(s->prev));
+	return 0;
+}
+
+/* Decode the stream's next record into s->next, if there is one. */
+static int peek(struct psvr2_replay *rp, int stream)
+{
+	struct replay_stream *s = &rp->s[stream];
+	int nw = psvr2__rec_words(stream, rp->version);
+	uint64_t v;
+
+	if (s->pending)
+		return 1;
+	while (!s->left) {
+		if (s->next_chunk >= s->nchunks || load_chunk(rp, s))
+			return 0;
+	}
+
+	if (psvr2__rec_get_varint(&s->pos, s->end, &v))
+		goto corrupt;
+	s->t_prev += (v >> 1) ^ -(v & 1);	/* un-zigzag */
+	for (int i = 0; i < nw; i++) {
+		if (psvr2__rec_get_varint(&s->pos, s->end, &v))
+			goto corrupt;
+		s->prev[i] += (uint32_t)((v >> 1) ^ -(v & 1));
+	}
+	psvr2__rec_unpack(stream, s->t_prev, s->prev, &s->next);
+	if (stream == PSVR2_REC_FRAME) {
+		if (psvr2__rec_get_varint(&s->pos, s->end, &v) ||
+		    v > (uint64_t)(s->end - s->pos))
+			goto corrupt;
+		s->next.frame.data = s->pos;
+		s->next.frame.len = v;
+		s->pos += v;
+	}
+	s->next_ts = s->t_prev;
+	s->left--;
+	s->pending = 1;
+	return 1;
+
+corrupt:
+	/* Treat the rest of the stream as missing, not as garbage. */
+	s->left = 0;
+	s->next_chunk = s->nchunks;
+	return 0;
+}
+
+/* ---- pacing ------------------------------------------------------------- */
+
+/* CLOCK_MONOTONIC time at which recorded time @ts is due; 0 if already. */
+static uint64_t due(const struct psvr2_replay *rp, uint64_t ts)
+{
+	if (rp->speed <= 0 || ts <= rp->t0)
+		return 0;
+	return rp->start + (uint64_t)((ts - rp->t0) / rp->speed);
+}
+
+/* Wake pollers when the next record is due, or the recording ends. */
+static void rearm(struct psvr2_replay *rp, int stream)
+{
+	struct replay_stream *s = &rp->s[stream];
+	struct itimerspec its = { 0 };
+	uint64_t t;
+
+	if (s->tfd < 0)
+		return;
+	t = due(rp, peek(rp, stream) ? s->next_ts : rp->t_end);
+	if (!t)
+		t = 1;		/* in the past: fire now */
+	its.it_value.tv_sec = t / 1000000000ull;
+	its.it_value.tv_nsec = t % 1000000000ull;
+	timerfd_settime(s->tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void set_timestamp(int stream, union replay_record *r, uint64_t ts)
+{
+	switch (stream) {
+	case PSVR2_REC_POSE:
+		r->pose.timestamp_ns = ts;
+		break;
+	case PSVR2_REC_GAZE:
+		r->gaze.timestamp_ns = ts;
+		break;
+	case PSVR2_REC_IMU:
+		r->imu.timestamp_ns = ts;
+		break;
+	case PSVR2_REC_INPUT:
+		r->input.timestamp_ns = ts;
+		break;
+	case PSVR2_REC_FRAME:
+		r->frame.timestamp_ns = ts;
+		break;
+	}
+}
+
+/*
+ * Every record that is due, up to @max (or just the newest, with
+ * PSVR2_READ_LATEST), restamped onto the replay clock. -1 with errno ENODEV
+ * once the stream is drained and the recording is over.
+ */
+static int take(struct psvr2_replay *rp, int stream, void *out, int max,
+		unsigned int flags)
+{
+	struct replay_stream *s = &rp->s[stream];
+	uint64_t now = psvr2__now_ns(), v;
+	size_t sz = record_sz[stream];
+	int n = 0;
+
+	if (s->tfd >= 0)
+		(void)!read(s->tfd, &v, sizeof(v));
+
+	while ((n < max || (flags & PSVR2_READ_LATEST)) &&
+	       peek(rp, stream) && due(rp, s->next_ts) <= now) {
+		int k = flags & PSVR2_READ_LATEST ? 0 : n;
+
+		/* Recorded spacing is kept; the clock is only shifted. */
+		set_timestamp(stream, &s->next,
+			      rp->start + (s->next_ts - rp->t0));
+		memcpy((char *)out + k * sz, &s->next, sz);
+		s->pending = 0;
+		n = k + 1;
+	}
+	if (stream == PSVR2_REC_IMU && n) {
+		memcpy(&rp->last_imu, (char *)out + (n - 1) * sz, sz);
+		rp->have_imu = 1;
+	}
+
+	rearm(rp, stream);
+	if (!n && !peek(rp, stream) && due(rp, rp->t_end) <= now) {
+		errno = ENODEV;
+		return -1;
+	}
+	return n;
+}
+
+/* ---- API ---------------------------------------------------------------- */
+
+void psvr2__replay_free(psvr2_t *p)
+{
+	struct psvr2_replay *rp = p->replay;
+
+	if (!rp)
+		return;
+	for (int i = 0; i < PSVR2_REC_STREAMS; i++) {
+		if (rp->s[i].tfd >= 0)
+			close(rp->s[i].tfd);
+		free(rp->s[i].chunks);
+	}
+	/* They were the timerfds just closed. */
+	p->pose_fd = -1;
+	p->gaze_fd = -1;
+	p->imu_fd = -1;
+	if (rp->map)
+		munmap((void *)rp->map, rp->len);
+	free(rp->chunks);
+	free(rp);
+	p->replay = NULL;
+}
+
+psvr2_t *psvr2_open_replay(const char *path, double speed)
+{
+	struct psvr2_replay *rp;
+	struct rec_file_hdr h;
+	struct stat st;
+	psvr2_t *p;
+	int fd, err;
+
+	if (!path || speed < 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+	p = psvr2__alloc(NULL);
+	rp = calloc(1, sizeof(*rp));
+	if (!p || !rp) {
+		free(rp);
+		psvr2_close(p);
+		errno = ENOMEM;
+		return NULL;
+	}
+	p->replay = rp;
+	rp->speed = speed;
+	for (int i = 0; i < PSVR2_REC_STREAMS; i++)
+		rp->s[i].tfd = -1;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		goto fail;
+	if (fstat(fd, &st)) {
+		close(fd);
+		goto fail;
+	}
+	if (st.st_size < (off_t)sizeof(h)) {
+		close(fd);
+		errno = EPROTO;
+		goto fail;
+	}
+	rp->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (rp->map == MAP_FAILED) {
+		rp->map = NULL;
+		goto fail;
+	}
+	rp->len = st.st_size;
+	madvise((void *)rp->map, rp->len, MADV_SEQUENTIAL);
+
+	memcpy(&h, rp->map, sizeof(h));
+	rp->version = le32toh(h.version);
+	if (memcmp(h.magic, PSVR2_REC_MAGIC, sizeof(h.magic)) ||
+	    rp->version < 1 || rp->version > PSVR2_REC_VERSION) {
+		errno = EPROTO;
+		goto fail;
+	}
+	if ((load_index(rp) && scan_chunks(rp)) || index_streams(rp))
+		goto fail;
+
+	for (int i = 0; i < PSVR2_REC_FRAME; i++) {
+		if (!rp->s[i].nchunks)
+			continue;
+		rp->s[i].tfd = timerfd_create(CLOCK_MONOTONIC,
+					      TFD_NONBLOCK | TFD_CLOEXEC);
+		if (rp->s[i].tfd < 0)
+			goto fail;
+	}
+	p->pose_fd = rp->s[PSVR2_REC_POSE].tfd;
+	p->gaze_fd = rp->s[PSVR2_REC_GAZE].tfd;
+	p->imu_fd = rp->s[PSVR2_REC_IMU].tfd;
+	if (p->pose_fd >= 0)
+		p->history = psvr2__history_alloc();
+
+	psvr2_replay_seek(p, 0);
+	return p;
+
+fail:
+	err = errno;
+	psvr2_close(p);
+	errno = err;
+	return NULL;
+}
+
+int psvr2_replay_seek(psvr2_t *p, uint64_t offset_ns)
+{
+	struct psvr2_replay *rp = p ? p->replay : NULL;
+	uint64_t target;
+
+	if (!rp) {
+		errno = EINVAL;
+		return -1;
+	}
+	target = rp->t_begin + offset_ns;
+
+	for (int i = 0; i < PSVR2_REC_STREAMS; i++) {
+		struct replay_stream *s = &rp->s[i];
+		int lo = 0, hi = s->nchunks;
+
+		/* First chunk that reaches @target; its stamps are in order. */
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+
+			if (rp->chunks[s->chunks[mid]].t_last < target)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		s->next_chunk = lo;
+		s->left = 0;
+		s->pending = 0;
+		while (peek(rp, i) && s->next_ts < target)
+			s->pending = 0;
+	}
+
+	rp->t0 = target;
+	rp->start = psvr2__now_ns();
+	for (int i = 0; i < PSVR2_REC_STREAMS; i++)
+		rearm(rp, i);
+	return 0;
+}
+
+uint64_t psvr2_replay_length_ns(const psvr2_t *p)
+{
+	const struct psvr2_replay *rp = p ? p->replay : NULL;
+
+	return rp ? rp->t_end - rp->t_begin : 0;
+}
+
+int psvr2_replay_frame(psvr2_t *p, struct psvr2_frame *out)
+{
+	if (!p || !p->replay || !out) {
+		errno = EINVAL;
+		return -1;
+	}
+	return take(p->replay, PSVR2_REC_FRAME, out, 1, 0);
+}
+
+int psvr2__replay_read(psvr2_t *p, int stream, void *out, int max,
+		       unsigned int flags, int timeout_ms)
+{
+	struct psvr2_replay *rp = p->replay;
+	uint64_t deadline = psvr2__now_ns() +
+			    (timeout_ms > 0 ? timeout_ms * 1000000ull : 0);
+	struct pollfd pfd[2] = {
+		{ .fd = rp->s[stream].tfd, .events = POLLIN },
+		{ .fd = p->wake_fd, .events = POLLIN },
+	};
+
+	if (rp->s[stream].tfd < 0)
+		return -1;
+	/* The ingestion thread would be robbed of these samples. */
+	if (p->ingest) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	for (;;) {
+		int n = take(rp, stream, out, max, flags), wait = -1;
+
+		if (n || !timeout_ms)
+			return n;
+		if (timeout_ms > 0) {
+			uint64_t now = psvr2__now_ns();
+
+			if (now >= deadline)
+				return 0;
+			wait = (deadline - now + 999999) / 1000000;
+		}
+		if (poll(pfd, 2, wait) < 0 && errno != EINTR)
+			return -1;
+		if (pfd[1].revents & POLLIN) {
+			errno = EINTR;
+			return -1;
+		}
+	}
+}
+
+int psvr2__replay_drain(psvr2_t *p, int stream, void *out, int max)
+{
+	struct psvr2_replay *rp = p->replay;
+
+	if (rp->s[stream].tfd < 0)
+		return -1;
+	return take(rp, stream, out, max, 0);
+}
+
+int psvr2__replay_imu(psvr2_t *p, struct psvr2_imu_sample *out)
+{
+	struct psvr2_replay *rp = p->replay;
+	struct psvr2_imu_sample s;
+
+	if (rp->s[PSVR2_REC_IMU].tfd < 0)
+		return -1;
+	take(rp, PSVR2_REC_IMU, &s, 1, PSVR2_READ_LATEST);
+	if (!rp->have_imu)
+		return -1;
+	*out = rp->last_imu;
+	return 0;
+}
+
+int psvr2__replay_input_fd(const psvr2_t *p)
+{
+	return p->replay ? p->replay->s[PSVR2_REC_INPUT].tfd : -1;
+}
@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — single-writer broadcast ring.
+ *
+ * One writer appends fixed-size records; any number of readers follow it, each
+ * with its own cursor, and none of them can hold the writer up. The writer
+ * first announces the slots it is about to overwrite in @claim, copies, then
+ * publishes @head. A reader copies from below @head and afterwards drops
+ * whatever @claim says may have been overwritten while it copied. The ring
+ * works the same in process memory (the ingestion thread) and in a memfd
+ * mapped by other processes (psvr2d), since it holds no pointers of its own.
+ *
+ * Also the seqlock everything else publishes a small record through: the
+ * count is odd while its one writer is mid-update, and a reader that saw it
+ * change while copying goes again.
+ *
+ * The filters the reading thread runs (fusion, the gaze filter) are built on
+ * both: an engine takes each psvr2_*_start()'s config in on the reader's side
+ * of a seqlock, and puts out records through a ring and stats through
+ * another seqlock.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libpsvr2_int.h"
+
+static char *ring_slot(const struct psvr2_ring *r, uint64_t seq)
+{
+	return r->slots + (seq & (r->cap - 1)) * r->sz;
+}
+
+void psvr2__ring_publish(const struct psvr2_ring *r, const void *src, int n)
+{
+	uint64_t h = r->pos->head;
+
+	__atomic_store_n(&r->pos->claim, h + n, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	for (int i = 0; i < n; i++)
+		memcpy(ring_slot(r, h + i), (const char *)src + i * r->sz,
+		       r->sz);
+	__atomic_store_n(&r->pos->head, h + n, __ATOMIC_RELEASE);
+}
+
+/* Oldest record not being overwritten as of the reader's last copy. */
+static uint64_t ring_oldest_intact(const struct psvr2_ring *r)
+{
+	uint64_t claim;
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	claim = __atomic_load_n(&r->pos->claim, __ATOMIC_RELAXED);
+	return claim > r->cap ? claim - r->cap : 0;
+}
+
+int psvr2__ring_read(const struct psvr2_ring *r, uint64_t *seq, void *out,
+		     int max)
+{
+	uint64_t head = __atomic_load_n(&r->pos->head, __ATOMIC_ACQUIRE);
+	uint64_t start = *seq, oldest, n;
+
+	if (max <= 0 || start >= head)
+		return 0;
+	if (head - start > r->cap)
+		start = head - r->cap;
+	n = head - start < (uint64_t)max ? head - start : (uint64_t)max;
+
+	for (uint64_t i = 0; i < n; i++)
+		memcpy((char *)out + i * r->sz, ring_slot(r, start + i), r->sz);
+
+	/* Slots the writer may have reused while we copied are torn: drop. */
+	oldest = ring_oldest_intact(r);
+	if (start < oldest) {
+		uint64_t drop = oldest - start < n ? oldest - start : n;
+
+		memmove(out, (char *)out + drop * r->sz, (n - drop) * r->sz);
+		start += drop;
+		n -= drop;
+	}
+
+	*seq = start + n;
+	return n;
+}
+
+int psvr2__ring_peek(const struct psvr2_ring *r, void *out, uint64_t *seq)
+{
+	for (;;) {
+		uint64_t head = __atomic_load_n(&r->pos->head,
+						__ATOMIC_ACQUIRE);
+
+		if (!head)
+			return 0;
+		memcpy(out, ring_slot(r, head - 1), r->sz);
+		if (head - 1 >= ring_oldest_intact(r)) {
+			if (seq)
+				*seq = head - 1;
+			return 1;
+		}
+	}
+}
+
+void psvr2__seq_write_begin(uint32_t *lock)
+{
+	__atomic_store_n(lock, *lock + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void psvr2__seq_write_end(uint32_t *lock)
+{
+	__atomic_store_n(lock, *lock + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t psvr2__seq_read_begin(const uint32_t *lock)
+{
+	uint32_t seq;
+
+	while ((seq = __atomic_load_n(lock, __ATOMIC_ACQUIRE)) & 1)
+		;
+	return seq;
+}
+
+int psvr2__seq_read_retry(const uint32_t *lock, uint32_t begin)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(lock, __ATOMIC_RELAXED) != begin;
+}
+
+/* ---- filter engines ----------------------------------------------------- */
+
+void *psvr2__engine_alloc(size_t size, size_t rec_sz, uint64_t cap,
+			  size_t cfg_sz, size_t stats_sz)
+{
+	struct psvr2_engine *e;
+
+	if (posix_memalign((void **)&e, 64, size)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	memset(e, 0, size);
+	e->ring.pos = &e->pos;
+	e->ring.sz = rec_sz;
+	e->ring.cap = cap;
+	e->ring.slots = calloc(cap, rec_sz);
+	e->next = calloc(1, cfg_sz);
+	e->stats = calloc(1, stats_sz);
+	e->cfg_sz = cfg_sz;
+	e->stats_sz = stats_sz;
+	if (!e->ring.slots || !e->next || !e->stats) {
+		psvr2__engine_free(e);
+		errno = ENOMEM;
+		return NULL;
+	}
+	return e;
+}
+
+void psvr2__engine_free(void *filter)
+{
+	struct psvr2_engine *e = filter;
+
+	if (!e)
+		return;
+	free(e->ring.slots);
+	free(e->next);
+	free(e->stats);
+	free(e);
+}
+
+int psvr2__engine_running(const struct psvr2_engine *e)
+{
+	return e && __atomic_load_n(&e->enabled, __ATOMIC_RELAXED);
+}
+
+/*
+ * A reader that hasn't seen a stop yet may still be running on the old
+ * config, so the new one waits in @next until it sees @reset.
+ */
+void psvr2__engine_start(struct psvr2_engine *e, const void *cfg)
+{
+	psvr2__seq_write_begin(&e->next_lock);
+	memcpy(e->next, cfg, e->cfg_sz);
+	psvr2__seq_write_end(&e->next_lock);
+	__atomic_store_n(&e->reset, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&e->enabled, 1, __ATOMIC_RELEASE);
+}
+
+void psvr2__engine_stop(struct psvr2_engine *e)
+{
+	if (e)
+		__atomic_store_n(&e->enabled, 0, __ATOMIC_RELEASE);
+}
+
+int psvr2__engine_enter(struct psvr2_engine *e, void *cfg)
+{
+	uint32_t lock;
+
+	if (!psvr2__engine_running(e))
+		return -1;
+	if (!__atomic_exchange_n(&e->reset, 0, __ATOMIC_ACQUIRE))
+		return 0;
+	do {
+		lock = psvr2__seq_read_begin(&e->next_lock);
+		memcpy(cfg, e->next, e->cfg_sz);
+	} while (psvr2__seq_read_retry(&e->next_lock, lock));
+	return 1;
+}
+
+void psvr2__engine_put_stats(struct psvr2_engine *e, const void *stats)
+{
+	psvr2__seq_write_begin(&e->stats_lock);
+	memcpy(e->stats, stats, e->stats_sz);
+	psvr2__seq_write_end(&e->stats_lock);
+}
+
+int psvr2__engine_get_stats(const struct psvr2_engine *e, void *out)
+{
+	uint32_t lock;
+
+	if (!e || !out) {
+		errno = EINVAL;
+		return -1;
+	}
+	do {
+		lock = psvr2__seq_read_begin(&e->stats_lock);
+		memcpy(out, e->stats, e->stats_sz);
+	} while (psvr2__seq_read_retry(&e->stats_lock, lock));
+	return 0;
+}
+
+int psvr2__engine_latest(const struct psvr2_engine *e, void *out,
+			 uint64_t *seq)
+{
+	if (!e || !out) {
+		errno = EINVAL;
+		return -1;
+	}
+	return psvr2__ring_peek(&e->ring, out, seq);
+}
+
+int psvr2__engine_since(const struct psvr2_engine *e, uint64_t *seq,
+			void *out, int max)
+{
+	if (!e || !seq || !out) {
+		errno = EINVAL;
+		return -1;
+	}
+	return psvr2__ring_read(&e->ring, seq, out, max);
+}
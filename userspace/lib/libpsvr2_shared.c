@@ -0,0 +1,363 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — psvr2d client: a handle whose streams are read from the daemon's
+ * shared rings instead of the device nodes.
+ *
+ * The eventfds psvr2d sends stand in for the pose/gaze/IMU fds, so poll(),
+ * the dispatcher and ingestion work on such a handle unchanged; only the reads
+ * come from here. Every client has its own cursor per ring and nothing it does
+ * is visible to the daemon, so a stalled client just falls behind: samples the
+ * daemon has overwritten before it got to them are skipped and counted.
+ *
+ * The socket name may sit in /tmp, where anyone can bind it first, so the
+ * daemon has to be running as the client's user (or root) before any fd it
+ * sends is trusted.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#define _GNU_SOURCE		/* struct ucred */
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "libpsvr2_int.h"
+#include "libpsvr2_shm.h"
+
+struct psvr2_shared {
+	const struct psvr2_shm *shm;
+	size_t		map_len;
+	int		sock;		/* to psvr2d; hangs up if it dies */
+	int		efd[PSVR2_SHM_STREAMS];
+	struct psvr2_ring ring[PSVR2_SHM_STREAMS];
+	uint64_t	cursor[PSVR2_SHM_STREAMS];
+	uint64_t	lost[PSVR2_SHM_STREAMS];
+};
+
+static const size_t record_sz[PSVR2_SHM_STREAMS] = {
+	[PSVR2_SHM_POSE] = sizeof(struct psvr2_pose),
+	[PSVR2_SHM_GAZE] = sizeof(struct psvr2_gaze),
+	[PSVR2_SHM_IMU] = sizeof(struct psvr2_imu_sample),
+};
+
+void psvr2__shm_sock_path(char *buf, size_t len, int index)
+{
+	const char *dir = getenv("XDG_RUNTIME_DIR");
+
+	if (dir && dir[0])
+		snprintf(buf, len, "%s/psvr2d-%d.sock", dir, index);
+	else
+		snprintf(buf, len, "/tmp/psvr2d-%d-%u.sock", index,
+			 (unsigned int)getuid());
+}
+
+/* ---- attaching ---------------------------------------------------------- */
+
+/* The other end is our own user's psvr2d, or root's. */
+static int check_peer(int sock)
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len))
+		return -1;
+	if (cred.uid != getuid() && cred.uid != 0) {
+		errno = EPERM;
+		return -1;
+	}
+	return 0;
+}
+
+/* The memfd and the three eventfds, in that order, from psvr2d's greeting. */
+static int recv_fds(int sock, int fds[1 + PSVR2_SHM_STREAMS])
+{
+	char data, cbuf[CMSG_SPACE(sizeof(int) * (1 + PSVR2_SHM_STREAMS))];
+	struct iovec iov = { .iov_base = &data, .iov_len = 1 };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf,
+		.msg_controllen = sizeof(cbuf),
+	};
+	struct cmsghdr *c;
+	ssize_t n;
+
+	do
+		n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+	while (n < 0 && errno == EINTR);
+	if (n <= 0)
+		return -1;
+
+	c = CMSG_FIRSTHDR(&msg);
+	if (!c || c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS ||
+	    c->cmsg_len != CMSG_LEN(sizeof(int) * (1 + PSVR2_SHM_STREAMS))) {
+		/* Close whatever did come along. */
+		for (; c; c = CMSG_NXTHDR(&msg, c)) {
+			int *fd = (int *)CMSG_DATA(c);
+			size_t k = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+			if (c->cmsg_type == SCM_RIGHTS)
+				while (k--)
+					close(fd[k]);
+		}
+		errno = EPROTO;
+		return -1;
+	}
+	memcpy(fds, CMSG_DATA(c), sizeof(int) * (1 + PSVR2_SHM_STREAMS));
+	return 0;
+}
+
+/* Everything the client dereferences lies within the mapping. */
+static int check_layout(const struct psvr2_shm *shm, size_t len)
+{
+	if (len < sizeof(*shm) || shm->magic != PSVR2_SHM_MAGIC ||
+	    shm->version != PSVR2_SHM_VERSION || shm->size != len)
+		return -1;
+	for (int i = 0; i < PSVR2_SHM_STREAMS; i++) {
+		const struct psvr2_shm_ring *r = &shm->ring[i];
+
+		if (!r->cap)
+			continue;
+		if (r->sz != record_sz[i] || (r->cap & (r->cap - 1)) ||
+		    r->offset < sizeof(*shm) || r->offset > len ||
+		    r->cap > (len - r->offset) / r->sz)
+			return -1;
+	}
+	return 0;
+}
+
+psvr2_t *psvr2_open_shared(int index)
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	struct psvr2_device_info info = { 0 };
+	int fds[1 + PSVR2_SHM_STREAMS], sock, err;
+	struct psvr2_shared *s;
+	struct stat st;
+	void *map;
+	psvr2_t *p;
+
+	psvr2__shm_sock_path(sa.sun_path, sizeof(sa.sun_path), index);
+	sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (sock < 0)
+		return NULL;
+	if (connect(sock, (struct sockaddr *)&sa, sizeof(sa)) ||
+	    check_peer(sock) || recv_fds(sock, fds))
+		goto fail_sock;
+
+	if (fstat(fds[0], &st))
+		goto fail_fds;
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fds[0], 0);
+	if (map == MAP_FAILED)
+		goto fail_fds;
+	/* The mapping keeps the memory; the fd itself is done with. */
+	close(fds[0]);
+	fds[0] = -1;
+	if (check_layout(map, st.st_size)) {
+		errno = EPROTO;
+		goto fail_map;
+	}
+
+	info.index = ((const struct psvr2_shm *)map)->index;
+	snprintf(info.usb_path, sizeof(info.usb_path), "%s",
+		 ((const struct psvr2_shm *)map)->usb_path);
+	p = psvr2__alloc(&info);
+	if (!p)
+		goto fail_map;
+	s = calloc(1, sizeof(*s));
+	if (!s) {
+		psvr2_close(p);
+		goto fail_map;
+	}
+	s->shm = map;
+	s->map_len = st.st_size;
+	s->sock = sock;
+
+	for (int i = 0; i < PSVR2_SHM_STREAMS; i++) {
+		const struct psvr2_shm_ring *r = &s->shm->ring[i];
+
+		s->efd[i] = fds[1 + i];
+		if (!r->cap) {
+			close(s->efd[i]);
+			s->efd[i] = -1;
+			continue;
+		}
+		s->ring[i].pos = (struct psvr2_ring_pos *)&s->shm->pos[i];
+		s->ring[i].slots = (char *)map + r->offset;
+		s->ring[i].sz = r->sz;
+		s->ring[i].cap = r->cap;
+		/* Like opening the node: samples from now on. */
+		s->cursor[i] = __atomic_load_n(&s->shm->pos[i].head,
+					       __ATOMIC_ACQUIRE);
+	}
+
+	p->shared = s;
+	p->pose_fd = s->efd[PSVR2_SHM_POSE];
+	p->gaze_fd = s->efd[PSVR2_SHM_GAZE];
+	p->imu_fd = s->efd[PSVR2_SHM_IMU];
+	if (p->pose_fd >= 0)
+		p->history = psvr2__history_alloc();
+	return p;
+
+fail_map:
+	err = errno;
+	munmap(map, st.st_size);
+	errno = err;
+fail_fds:
+	err = errno;
+	for (int i = 0; i < 1 + PSVR2_SHM_STREAMS; i++)
+		if (fds[i] >= 0)
+			close(fds[i]);
+	errno = err;
+fail_sock:
+	err = errno;
+	close(sock);
+	errno = err;
+	return NULL;
+}
+
+void psvr2__shared_free(psvr2_t *p)
+{
+	struct psvr2_shared *s = p->shared;
+
+	if (!s)
+		return;
+	for (int i = 0; i < PSVR2_SHM_STREAMS; i++)
+		if (s->efd[i] >= 0)
+			close(s->efd[i]);
+	/* They were the eventfds just closed. */
+	p->pose_fd = -1;
+	p->gaze_fd = -1;
+	p->imu_fd = -1;
+	munmap((void *)s->shm, s->map_len);
+	close(s->sock);
+	free(s);
+	p->shared = NULL;
+}
+
+/* ---- reading ------------------------------------------------------------ */
+
+/*
+ * Whatever is in the ring past the cursor, without waiting. The eventfd is
+ * reset first: the daemon bumps it after publishing, so anything that lands
+ * after this read is announced afresh.
+ */
+static int shared_take(struct psvr2_shared *s, int stream, void *out, int max,
+		       unsigned int flags)
+{
+	const struct psvr2_ring *r = &s->ring[stream];
+	uint64_t *cursor = &s->cursor[stream];
+	uint64_t before, v;
+	int n;
+
+	(void)!read(s->efd[stream], &v, sizeof(v));
+
+	if (flags & PSVR2_READ_LATEST) {
+		uint64_t head = __atomic_load_n(&r->pos->head,
+						__ATOMIC_ACQUIRE);
+
+		/* Skipping on purpose isn't an overrun. */
+		if (head > *cursor)
+			*cursor = head - 1;
+		max = 1;
+	}
+
+	before = *cursor;
+	n = psvr2__ring_read(r, cursor, out, max);
+	s->lost[stream] += *cursor - n - before;
+	if (!n && __atomic_load_n(&s->shm->gone, __ATOMIC_ACQUIRE)) {
+		errno = ENODEV;
+		return -1;
+	}
+	return n;
+}
+
+int psvr2__shared_read(psvr2_t *p, int stream, void *out, int max,
+		       unsigned int flags, int timeout_ms)
+{
+	struct psvr2_shared *s = p->shared;
+	uint64_t deadline = psvr2__now_ns() +
+			    (timeout_ms > 0 ? timeout_ms * 1000000ull : 0);
+	struct pollfd pfd[3] = {
+		{ .fd = s->efd[stream], .events = POLLIN },
+		{ .fd = p->wake_fd, .events = POLLIN },
+		{ .fd = s->sock, .events = POLLIN },
+	};
+	int hup = 0;
+
+	if (s->efd[stream] < 0)
+		return -1;
+	/* The ingestion thread would be robbed of these samples. */
+	if (p->ingest) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	for (;;) {
+		int n = shared_take(s, stream, out, max, flags), wait = -1;
+
+		if (n || !timeout_ms)
+			return n;
+		/* psvr2d died without getting to mark the headset gone. */
+		if (hup) {
+			errno = ENODEV;
+			return -1;
+		}
+		if (timeout_ms > 0) {
+			uint64_t now = psvr2__now_ns();
+
+			if (now >= deadline)
+				return 0;
+			wait = (deadline - now + 999999) / 1000000;
+		}
+		if (poll(pfd, 3, wait) < 0 && errno != EINTR)
+			return -1;
+		if (pfd[1].revents & POLLIN) {
+			errno = EINTR;
+			return -1;
+		}
+		hup = pfd[2].revents != 0;
+	}
+}
+
+int psvr2__shared_drain(psvr2_t *p, int stream, void *out, int max)
+{
+	struct psvr2_shared *s = p->shared;
+
+	if (s->efd[stream] < 0)
+		return -1;
+	return shared_take(s, stream, out, max, 0);
+}
+
+int psvr2__shared_peek(psvr2_t *p, int stream, void *out)
+{
+	struct psvr2_shared *s = p->shared;
+
+	if (s->efd[stream] < 0)
+		return -1;
+	return psvr2__ring_peek(&s->ring[stream], out, NULL);
+}
+
+int psvr2__shared_sock(const psvr2_t *p)
+{
+	return p->shared ? p->shared->sock : -1;
+}
+
+int psvr2_get_overruns(const psvr2_t *p, struct psvr2_overruns *out)
+{
+	const struct psvr2_shared *s = p ? p->shared : NULL;
+
+	if (!s || !out) {
+		errno = EINVAL;
+		return -1;
+	}
+	out->pose = s->lost[PSVR2_SHM_POSE];
+	out->gaze = s->lost[PSVR2_SHM_GAZE];
+	out->imu = s->lost[PSVR2_SHM_IMU];
+	return 0;
+}
@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * libpsvr2 — psvr2d's shared-memory layout, as mapped by psvr2_open_shared().
+ * Not installed; psvr2d and the library are built from the same tree.
+ *
+ * psvr2d owns one sealed memfd per headset: this header, then one broadcast
+ * ring (libpsvr2_ring.c) of converted samples per stream. Clients map it
+ * read-only, so they can't disturb the daemon or each other; each keeps its
+ * own cursors in process memory. A client connects to the daemon's socket and
+ * gets the memfd plus one eventfd per stream, which the daemon bumps after
+ * each publish, in one SCM_RIGHTS message.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#ifndef LIBPSVR2_SHM_H
+#define LIBPSVR2_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libpsvr2_int.h"
+
+#define PSVR2_SHM_MAGIC		0x32525350	/* "PSR2" */
+#define PSVR2_SHM_VERSION	2	/* 2: samples carry measured_ns */
+
+/* Ring lengths: about a second of poses/gaze, two of IMU. */
+#define PSVR2_SHM_POSE_RING	1024
+#define PSVR2_SHM_GAZE_RING	512
+#define PSVR2_SHM_IMU_RING	4096
+
+enum psvr2_shm_stream {
+	PSVR2_SHM_POSE,
+	PSVR2_SHM_GAZE,
+	PSVR2_SHM_IMU,
+	PSVR2_SHM_STREAMS,
+};
+
+struct psvr2_shm_ring {
+	uint64_t	offset;		/* of the slots, from the mapping */
+	uint64_t	sz;		/* record size */
+	uint64_t	cap;		/* records; power of two, 0 if absent */
+};
+
+struct psvr2_shm {
+	uint32_t	magic;
+	uint32_t	version;
+	uint64_t	size;		/* of the whole mapping */
+	int32_t		index;		/* kernel headset index */
+	uint32_t	gone;		/* set once the headset is unplugged */
+	char		usb_path[256];
+	struct psvr2_shm_ring ring[PSVR2_SHM_STREAMS];
+
+	/* All the daemon writes after setup: kept off the fixed part's line. */
+	struct psvr2_ring_pos pos[PSVR2_SHM_STREAMS]
+		__attribute__((aligned(64)));
+} __attribute__((aligned(64)));
+
+/*
+ * libpsvr2_shared.c: the daemon's socket for headset @index, in
+ * $XDG_RUNTIME_DIR if set, else in /tmp with the uid in the name so two
+ * users' daemons don't meet.
+ */
+PSVR2_HIDDEN void psvr2__shm_sock_path(char *buf, size_t len, int index);
+
+#endif /* LIBPSVR2_SHM_H */
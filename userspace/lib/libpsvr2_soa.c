@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libpsvr2 — psvr2_to_soa(): sample batches into one array per field.
+ *
+ * Four records' fields are loaded a row at a time and transposed in registers
+ * (eight at a time with AVX2), so a batch costs a load and a store per four
+ * floats instead of a scalar copy each. x86-64 always has SSE2; AVX2 is used
+ * if the CPU reports it, checked once. On arm64 the NEON path is the baseline.
+ *
+ * A row is read as four floats even when fewer are wanted, so only records
+ * whose 16 bytes stay within the batch take the vector path; the tail (and
+ * every record of a batch with @stride < 16) is copied one float at a time.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) && defined(__SSE2__)
+#include <immintrin.h>
+#define HAVE_SSE2	1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define HAVE_NEON	1
+#endif
+
+#include "libpsvr2_int.h"
+
+/* Records [k, n), one float at a time. */
+static void soa_scalar(float *const *out, int count, const char *base,
+		       size_t stride, int k, int n)
+{
+	for (; k < n; k++) {
+		const char *rec = base + k * stride;
+
+		for (int j = 0; j < count; j++)
+			memcpy(&out[j][k], rec + j * sizeof(float),
+			       sizeof(float));
+	}
+}
+
+/* Store rows r[0..3] (field j of records k..k+3) for the fields wanted. */
+#define STORE4(store, out, j, count, k, r)				\
+	do {								\
+		for (int i_ = 0; i_ < 4 && (j) + i_ < (count); i_++)	\
+			store(&(out)[(j) + i_][k], (r)[i_]);		\
+	} while (0)
+
+#ifdef HAVE_SSE2
+/* Records [k, n) in fours; returns where it stopped. */
+static int soa_sse2(float *const *out, int count, const char *base,
+		    size_t stride, int k, int n)
+{
+	for (; k + 4 <= n; k += 4) {
+		for (int j = 0; j < count; j += 4) {
+			const char *rec = base + k * stride + j * 4;
+			__m128 r[4];
+
+			r[0] = _mm_loadu_ps((const float *)rec);
+			r[1] = _mm_loadu_ps((const float *)(rec + stride));
+			r[2] = _mm_loadu_ps((const float *)(rec + 2 * stride));
+			r[3] = _mm_loadu_ps((const float *)(rec + 3 * stride));
+			_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+			STORE4(_mm_storeu_ps, out, j, count, k, r);
+		}
+	}
+	return k;
+}
+
+__attribute__((target("avx2")))
+static int soa_avx2(float *const *out, int count, const char *base,
+		    size_t stride, int k, int n)
+{
+	for (; k + 8 <= n; k += 8) {
+		for (int j = 0; j < count; j += 4) {
+			const char *rec = base + k * stride + j * 4;
+			__m256 r[4], t[4];
+
+			/* Records i and i + 4 share a row, one per lane. */
+			for (int i = 0; i < 4; i++) {
+				__m128 lo, hi;
+
+				lo = _mm_loadu_ps((const float *)
+						  (rec + i * stride));
+				hi = _mm_loadu_ps((const float *)
+						  (rec + (i + 4) * stride));
+				r[i] = _mm256_insertf128_ps(
+					_mm256_castps128_ps256(lo), hi, 1);
+			}
+			t[0] = _mm256_unpacklo_ps(r[0], r[1]);
+			t[1] = _mm256_unpackhi_ps(r[0], r[1]);
+			t[2] = _mm256_unpacklo_ps(r[2], r[3]);
+			t[3] = _mm256_unpackhi_ps(r[2], r[3]);
+			r[0] = _mm256_shuffle_ps(t[0], t[2], 0x44);
+			r[1] = _mm256_shuffle_ps(t[0], t[2], 0xee);
+			r[2] = _mm256_shuffle_ps(t[1], t[3], 0x44);
+			r[3] = _mm256_shuffle_ps(t[1], t[3], 0xee);
+			STORE4(_mm256_storeu_ps, out, j, count, k, r);
+		}
+	}
+	return soa_sse2(out, count, base, stride, k, n);
+}
+
+static int soa_avx2_sse2(float *const *out, int count, const char *base,
+			 size_t stride, int k, int n)
+{
+	static int avx2 = -1;
+
+	if (avx2 < 0)
+		avx2 = __builtin_cpu_supports("avx2");
+	return avx2 ? soa_avx2(out, count, base, stride, k, n)
+		    : soa_sse2(out, count, base, stride, k, n);
+}
+#define soa_vector	soa_avx2_sse2
+#endif
+
+#ifdef HAVE_NEON
+static int soa_neon(float *const *out, int count, const char *base,
+		    size_t stride, int k, int n)
+{
+	for (; k + 4 <= n; k += 4) {
+		for (int j = 0; j < count; j += 4) {
+			const char *rec = base + k * stride + j * 4;
+			const float *r0 = (const float *)rec;
+			const float *r1 = (const float *)(rec + stride);
+			const float *r2 = (const float *)(rec + 2 * stride);
+			const float *r3 = (const float *)(rec + 3 * stride);
+			float32x4x2_t a, b;
+			float32x4_t r[4];
+
+			a = vtrnq_f32(vld1q_f32(r0), vld1q_f32(r1));
+			b = vtrnq_f32(vld1q_f32(r2), vld1q_f32(r3));
+			r[0] = vcombine_f32(vget_low_f32(a.val[0]),
+					    vget_low_f32(b.val[0]));
+			r[1] = vcombine_f32(vget_low_f32(a.val[1]),
+					    vget_low_f32(b.val[1]));
+			r[2] = vcombine_f32(vget_high_f32(a.val[0]),
+					    vget_high_f32(b.val[0]));
+			r[3] = vcombine_f32(vget_high_f32(a.val[1]),
+					    vget_high_f32(b.val[1]));
+			STORE4(vst1q_f32, out, j, count, k, r);
+		}
+	}
+	return k;
+}
+#define soa_vector	soa_neon
+#endif
+
+void psvr2_to_soa(float *const *out, int count, const float *first,
+		  size_t stride, int n)
+{
+	const char *base = (const char *)first;
+	int k = 0;
+
+	if (!out || !first || count <= 0 || n <= 0)
+		return;
+#ifdef soa_vector
+	if (stride >= 16) {
+		/*
+		 * Record k's rows end at k * stride + row, the batch's last
+		 * wanted float at @end: the records up to @safe are in bounds.
+		 */
+		size_t row = ((count + 3) & ~3) * sizeof(float);
+		size_t end = (n - 1) * stride + count * sizeof(float);
+		int safe = end >= row ? (end - row) / stride + 1 : 0;
+
+		k = soa_vector(out, count, base, stride, 0,
+			       safe < n ? safe : n);
+	}
+#endif
+	soa_scalar(out, count, base, stride, k, n);
+}
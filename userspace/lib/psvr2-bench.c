@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * psvr2-bench — the synthesise, record and replay harness the psvr2-*-bench
+ * programs are built on; see psvr2-bench.h.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "psvr2-bench.h"
+
+double bench_gauss(void)
+{
+	double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+	return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+psvr2_t *bench_open(const char *path)
+{
+	psvr2_t *p = psvr2_open_replay(path, 0);
+
+	if (!p)
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+	return p;
+}
+
+static int synthesise(const struct bench *b, const char *path,
+		      double seconds)
+{
+	psvr2_rec_t *r = psvr2_rec_open(path);
+	int ret;
+
+	if (!r)
+		return -1;
+	ret = b->synthesise(r, seconds);
+	if (psvr2_rec_close(r))
+		ret = -1;
+	return ret;
+}
+
+int bench_main(const struct bench *b, int argc, char **argv)
+{
+	char tmp[64];
+	double seconds = b->seconds;
+	int opt, fd, ret;
+
+	while ((opt = getopt(argc, argv, "t:")) != -1) {
+		switch (opt) {
+		case 't':
+			seconds = atof(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-t seconds] [in.psvr2rec]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+	if (optind < argc)
+		return b->run(argv[optind], 0);
+
+	snprintf(tmp, sizeof(tmp), "/tmp/psvr2-%s-XXXXXX", b->name);
+	fd = mkstemp(tmp);
+	if (fd < 0) {
+		perror(tmp);
+		return 1;
+	}
+	close(fd);
+	srand(1);
+	if (synthesise(b, tmp, seconds > b->min_seconds ? seconds :
+					     b->min_seconds)) {
+		perror(tmp);
+		unlink(tmp);
+		return 1;
+	}
+	ret = b->run(tmp, 1);
+	unlink(tmp);
+	return ret;
+}
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * psvr2-bench — what the psvr2-*-bench programs share.
+ *
+ * Each synthesises a stretch of input with a known truth, records it to a
+ * temporary .psvr2rec and replays that through libpsvr2 as fast as it
+ * decodes, scoring the output against the truth; or, given a recording,
+ * replays that instead and prints what it can without one.
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#ifndef PSVR2_BENCH_H
+#define PSVR2_BENCH_H
+
+#include "libpsvr2.h"
+
+struct bench {
+	const char *name;		/* in the temporary file's name */
+	double	seconds;		/* synthesised without -t */
+	double	min_seconds;		/* and at least this, with it */
+	/* Write @seconds of input to @r; 0, or -1 with errno set. */
+	int	(*synthesise)(psvr2_rec_t *r, double seconds);
+	/* Replay @path and print; @synthetic when there is a truth to score. */
+	int	(*run)(const char *path, int synthetic);
+};
+
+/* A standard normal deviate, from rand(): seeded the same every run. */
+double bench_gauss(void);
+
+/* A replay handle on @path at full speed, or NULL having said why. */
+psvr2_t *bench_open(const char *path);
+
+/* Takes [-t seconds] [in.psvr2rec]; returns the exit status. */
+int bench_main(const struct bench *b, int argc, char **argv);
+
+#endif
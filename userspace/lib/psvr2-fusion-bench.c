@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * psvr2-fusion-bench — time libpsvr2's SLAM + IMU fusion, and check it.
+ *
+ * Without a file it synthesises a few seconds of head motion with a known
+ * truth (IMU at 2 kHz with noise and biases, SLAM poses at 250 Hz with noise,
+ * gravity along -y), records it to a temporary .psvr2rec and replays that
+ * through the fusion as fast as it decodes, then prints the time per IMU step
+ * and per pose correction and the error against the truth. Given a recording
+ * it replays that instead and prints the timings only.
+ *
+ * Poses and IMU samples are read in time order by hand: at replay speed 0 the
+ * dispatcher would hand over each stream as fast as it drains, all the poses
+ * first.
+ *
+ * Build:  make   (in userspace/lib)
+ * Run:    ./psvr2-fusion-bench [-t seconds] [in.psvr2rec]
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "psvr2-bench.h"
+
+#define T0_NS		1000000000ull	/* synthetic time base */
+#define IMU_NS		500000ull	/* 2 kHz */
+#define POSE_EVERY	8		/* IMU samples per pose: 250 Hz */
+#define SETTLE_S	2.0		/* not scored while converging */
+#define IMU_READ	8		/* IMU samples read at a time */
+
+static const double gyro_bias[3] = { 0.01, -0.02, 0.015 };
+static const double accel_bias[3] = { 0.05, -0.03, 0.02 };
+static const double gravity[3] = { 0, -9.80665, 0 };
+
+/* ---- synthetic motion ---------------------------------------------------- */
+
+static void qmul(double o[4], const double a[4], const double b[4])
+{
+	double r[4] = {
+		a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3],
+		a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+		a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1],
+		a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0],
+	};
+
+	memcpy(o, r, sizeof(r));
+}
+
+/* v rotated by q^-1: world to body. */
+static void rotate_inv(double o[3], const double q[4], const double v[3])
+{
+	double qc[4] = { q[0], -q[1], -q[2], -q[3] }, t[4], w[4];
+	double vq[4] = { 0, v[0], v[1], v[2] };
+
+	qmul(t, qc, vq);
+	qmul(w, t, q);
+	memcpy(o, w + 1, 3 * sizeof(double));
+}
+
+/* Yaw about y, pitch about x, roll about z, each a slow sine. */
+static void truth(double t, double p[3], double q[4])
+{
+	double ang[3] = {
+		0.3 * sin(2 * M_PI * 0.4 * t),
+		0.6 * sin(2 * M_PI * 0.3 * t),
+		0.1 * sin(2 * M_PI * 0.7 * t + 1),
+	};
+	double qy[4] = { cos(ang[1] / 2), 0, sin(ang[1] / 2), 0 };
+	double qx[4] = { cos(ang[0] / 2), sin(ang[0] / 2), 0, 0 };
+	double qz[4] = { cos(ang[2] / 2), 0, 0, sin(ang[2] / 2) };
+
+	p[0] = 0.10 * sin(2 * M_PI * 0.5 * t);
+	p[1] = 1.60 + 0.05 * sin(2 * M_PI * 0.7 * t);
+	p[2] = 0.08 * cos(2 * M_PI * 0.35 * t);
+	qmul(q, qy, qx);
+	qmul(q, q, qz);
+}
+
+/* What the IMU reads at @t, by central differences of the truth. */
+static void imu_at(double t, struct psvr2_imu_sample *s)
+{
+	const double h = 1e-4;
+	double p0[3], p1[3], p2[3], q0[4], q1[4], q2[4], a[3], f[3];
+	double qc[4], dq[4];
+
+	truth(t - h, p0, q0);
+	truth(t, p1, q1);
+	truth(t + h, p2, q2);
+	for (int i = 0; i < 3; i++)
+		a[i] = (p2[i] - 2 * p1[i] + p0[i]) / (h * h) - gravity[i];
+	rotate_inv(f, q1, a);
+
+	/* Body rate: 2 Im(q^-1 dq/dt) */
+	qc[0] = q1[0];
+	for (int i = 1; i < 4; i++)
+		qc[i] = -q1[i];
+	for (int i = 0; i < 4; i++)
+		dq[i] = (q2[i] - q0[i]) / (2 * h);
+	qmul(dq, qc, dq);
+
+	s->timestamp_ns = T0_NS + (uint64_t)(t * 1e9 + 0.5);
+	for (int i = 0; i < 3; i++) {
+		s->accel_m_s2[i] = f[i] + accel_bias[i] + 0.05 * bench_gauss();
+		s->gyro_rad_s[i] = 2 * dq[i + 1] + gyro_bias[i] +
+				   0.005 * bench_gauss();
+	}
+}
+
+static int synthesise(psvr2_rec_t *r, double seconds)
+{
+	int n = seconds * 1e9 / IMU_NS;
+
+	for (int k = 0; k < n; k++) {
+		struct psvr2_imu_sample s;
+		double t = k * IMU_NS * 1e-9;
+
+		imu_at(t, &s);
+		psvr2_rec_imu(r, &s, 1);
+		if (k % POSE_EVERY == 0) {
+			struct psvr2_pose pose = {
+				.timestamp_ns = s.timestamp_ns,
+				.valid = 1,
+			};
+			double p[3], q[4], e[3], dq[4], qn[4];
+
+			truth(t, p, q);
+			for (int i = 0; i < 3; i++) {
+				pose.position[i] = p[i] + 0.001 * bench_gauss();
+				e[i] = 0.001 * bench_gauss();
+			}
+			/* small-angle noise, body axes */
+			dq[0] = 1;
+			for (int i = 0; i < 3; i++)
+				dq[i + 1] = e[i] / 2;
+			qmul(qn, q, dq);
+			for (int i = 0; i < 4; i++)
+				pose.orientation[i] = qn[i];
+			psvr2_rec_poses(r, &pose, 1);
+		}
+	}
+	return 0;
+}
+
+/* ---- replay ------------------------------------------------------------- */
+
+struct score {
+	uint64_t shift;			/* replay clock - synthetic clock */
+	double	pos2, rot2, vel2;
+	unsigned long n;
+};
+
+static void score(struct score *sc, const struct psvr2_fused_pose *f, int n)
+{
+	for (int k = 0; k < n; k++) {
+		double t = (f[k].timestamp_ns - sc->shift - T0_NS) * 1e-9;
+		double p[3], q[4], pa[3], pb[3], qf[4], dq[4], dot;
+
+		if (t < SETTLE_S)
+			continue;
+		truth(t, p, q);
+		truth(t - 1e-4, pa, qf);
+		truth(t + 1e-4, pb, qf);
+		for (int i = 0; i < 3; i++) {
+			double dv = (pb[i] - pa[i]) / 2e-4 - f[k].velocity[i];
+			double dp = p[i] - f[k].position[i];
+
+			sc->pos2 += dp * dp;
+			sc->vel2 += dv * dv;
+		}
+		for (int i = 0; i < 4; i++)
+			qf[i] = f[k].orientation[i];
+		qmul(dq, (double[4]){ q[0], -q[1], -q[2], -q[3] }, qf);
+		dot = fabs(dq[0]) < 1 ? fabs(dq[0]) : 1;
+		sc->rot2 += pow(2 * acos(dot), 2);
+		sc->n++;
+	}
+}
+
+static int run(const char *path, int synthetic)
+{
+	struct psvr2_fusion_config cfg = { .flags = PSVR2_FUSION_TIMING };
+	struct psvr2_imu_sample imu[IMU_READ];
+	struct psvr2_fused_pose fused[256];
+	struct psvr2_fusion_stats st;
+	struct score sc = { 0 };
+	struct psvr2_pose pose;
+	uint64_t seq = 0;
+	int have_pose = 0, pose_done = 0, imu_done = 0;
+	psvr2_t *p = bench_open(path);
+
+	if (!p)
+		return 1;
+	if (psvr2_imu_start(p, 0) || psvr2_fusion_start(p, &cfg)) {
+		fprintf(stderr, "%s: no IMU stream\n", path);
+		psvr2_close(p);
+		return 1;
+	}
+
+	/* Poses go in once the IMU has reached them, as they would live. */
+	while (!imu_done) {
+		int n;
+
+		if (!have_pose && !pose_done) {
+			n = psvr2_read_poses_timeout(p, &pose, 1, 0, 0);
+			if (n < 0)
+				pose_done = 1;
+			have_pose = n > 0;
+		}
+		n = psvr2_read_imu_batch_timeout(p, imu, IMU_READ, 0);
+		if (n < 0)
+			imu_done = 1;
+		if (n > 0 && synthetic && !sc.shift)
+			sc.shift = imu[0].timestamp_ns - T0_NS;
+		if (have_pose && n > 0 &&
+		    imu[n - 1].timestamp_ns >= pose.timestamp_ns)
+			have_pose = 0;	/* fused at the read; take the next */
+		while ((n = psvr2_get_fused_since(p, &seq, fused, 256)) > 0)
+			if (synthetic)
+				score(&sc, fused, n);
+	}
+
+	psvr2_fusion_get_stats(p, &st);
+	printf("%lu IMU steps   %.3f us each\n", (unsigned long)st.predicts,
+	       st.predicts ? st.predict_ns * 1e-3 / st.predicts : 0);
+	printf("%lu SLAM poses  %.3f us each (%lu rejected)\n",
+	       (unsigned long)st.updates,
+	       st.updates ? st.update_ns * 1e-3 / st.updates : 0,
+	       (unsigned long)st.rejected);
+	printf("%lu fused poses\n", (unsigned long)seq);
+	if (synthetic && sc.n)
+		printf("rms error after %.0f s: position %.2f mm, "
+		       "orientation %.3f deg, velocity %.1f mm/s\n", SETTLE_S,
+		       sqrt(sc.pos2 / sc.n) * 1e3,
+		       sqrt(sc.rot2 / sc.n) * 180 / M_PI,
+		       sqrt(sc.vel2 / sc.n) * 1e3);
+	psvr2_close(p);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct bench b = {
+		.name = "fusion",
+		.seconds = 10,
+		.min_seconds = SETTLE_S + 1,
+		.synthesise = synthesise,
+		.run = run,
+	};
+
+	return bench_main(&b, argc, argv);
+}
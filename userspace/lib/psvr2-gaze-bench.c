@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * psvr2-gaze-bench — time libpsvr2's gaze processing, and check it.
+ *
+ * Without a file it synthesises a minute of eye movement with a known truth
+ * (fixations with tracker noise, saccades of 2 to 25 degrees on the main
+ * sequence with a symmetric velocity profile, blinks now and then) at 240 Hz,
+ * records it to a temporary .psvr2rec and replays that through the filter as
+ * fast as it decodes, then prints the time per sample, how well fixations and
+ * saccades were told apart, the noise left in fixations, the landing error
+ * and the error of @predicted against holding the last sample. Given a
+ * recording it replays that instead and prints the timings and counts only.
+ *
+ * Build:  make   (in userspace/lib)
+ * Run:    ./psvr2-gaze-bench [-t seconds] [in.psvr2rec]
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "psvr2-bench.h"
+
+#define T0_NS		1000000000ull	/* synthetic time base */
+#define GAZE_NS		4166667ull	/* 240 Hz */
+#define NOISE_DEG	0.1		/* tracker noise, per axis */
+#define PREDICT_MS	10		/* the filter's default */
+#define GAZE_READ	8		/* samples read at a time */
+#define MAX_SEGS	4096
+
+enum { FIX, SAC, BLINK };
+
+/* The truth: a run of segments, each from t0 to t1 in seconds. */
+struct seg {
+	double	t0, t1;
+	int	kind;
+	double	from[2], to[2];		/* yaw, pitch in degrees */
+};
+
+static struct seg segs[MAX_SEGS];
+static int n_segs;
+
+static double uniform(double lo, double hi)
+{
+	return lo + (hi - lo) * rand() / (double)RAND_MAX;
+}
+
+static void add(double *t, double len, int kind, const double from[2],
+		const double to[2])
+{
+	struct seg *s = &segs[n_segs++];
+
+	s->t0 = *t;
+	s->t1 = *t + len;
+	s->kind = kind;
+	memcpy(s->from, from, sizeof(s->from));
+	memcpy(s->to, to, sizeof(s->to));
+	*t += len;
+}
+
+static void schedule(double seconds)
+{
+	double t = 0, at[2] = { 0, 0 };
+
+	while (t < seconds && n_segs < MAX_SEGS - 3) {
+		double to[2], amp, dir;
+
+		add(&t, uniform(0.15, 0.5), FIX, at, at);
+		if (rand() % 10 == 0)
+			add(&t, uniform(0.08, 0.25), BLINK, at, at);
+		do {
+			amp = uniform(2, 25);
+			dir = uniform(0, 2 * M_PI);
+			to[0] = at[0] + amp * cos(dir);
+			to[1] = at[1] + amp * sin(dir);
+		} while (fabs(to[0]) > 25 || fabs(to[1]) > 18);
+		/* Main-sequence duration: 2.2 ms/deg + 21 ms. */
+		add(&t, (2.2 * amp + 21) * 1e-3, SAC, at, to);
+		memcpy(at, to, sizeof(at));
+	}
+}
+
+static const struct seg *seg_at(double t)
+{
+	int lo = 0, hi = n_segs - 1;
+
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+
+		if (segs[mid].t0 <= t)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return &segs[lo];
+}
+
+/* Minimum jerk: a bell-shaped velocity, its peak midway. */
+static void angles_at(double t, double a[2], int *kind)
+{
+	const struct seg *s = seg_at(t);
+	double tau = (t - s->t0) / (s->t1 - s->t0), f;
+
+	if (tau > 1)
+		tau = 1;
+	f = tau * tau * tau * (10 - 15 * tau + 6 * tau * tau);
+	for (int i = 0; i < 2; i++)
+		a[i] = s->from[i] + f * (s->to[i] - s->from[i]);
+	*kind = s->kind;
+}
+
+/* Yaw right, pitch up; looking down -z. */
+static void direction(double d[3], const double a[2])
+{
+	double y = a[0] * M_PI / 180, p = a[1] * M_PI / 180;
+
+	d[0] = sin(y) * cos(p);
+	d[1] = sin(p);
+	d[2] = -cos(y) * cos(p);
+}
+
+static double angle_deg(const double a[3], const float b[3])
+{
+	double c = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+
+	return acos(c < 1 ? c : 1) * 180 / M_PI;
+}
+
+static int synthesise(psvr2_rec_t *r, double seconds)
+{
+	int n = seconds * 1e9 / GAZE_NS;
+
+	schedule(seconds + 1);
+	for (int k = 0; k < n; k++) {
+		struct psvr2_gaze g = { 0 };
+		double a[2], d[3];
+		int kind;
+
+		angles_at(k * GAZE_NS * 1e-9, a, &kind);
+		g.timestamp_ns = T0_NS + k * GAZE_NS;
+		g.device_timestamp_us = (k * GAZE_NS) / 1000;
+		g.valid = 1;
+		g.left.blink_valid = g.right.blink_valid = 1;
+		if (kind == BLINK) {
+			g.left.blink = g.right.blink = 1;
+		} else {
+			a[0] += NOISE_DEG * bench_gauss();
+			a[1] += NOISE_DEG * bench_gauss();
+			direction(d, a);
+			g.combined.gaze_direction_valid = 1;
+			for (int i = 0; i < 3; i++)
+				g.combined.gaze_direction[i] = d[i];
+		}
+		psvr2_rec_gazes(r, &g, 1);
+	}
+	return 0;
+}
+
+/* ---- replay ------------------------------------------------------------- */
+
+struct score {
+	uint64_t shift;			/* replay clock - synthetic clock */
+	unsigned long n, agree, fix_n, sac_n;
+	double	raw2, fix2;		/* fixations: raw and filtered */
+	double	pred_err, hold_err;	/* saccades, @predict_ms ahead */
+	double	last_raw[3];
+};
+
+static void score(struct score *sc, const struct psvr2_gaze *g,
+		  const struct psvr2_filtered_gaze *f, int n)
+{
+	for (int k = 0; k < n; k++) {
+		double t = (f[k].timestamp_ns - sc->shift - T0_NS) * 1e-9;
+		double a[2], d[3], e;
+		int kind, ahead;
+
+		angles_at(t, a, &kind);
+		direction(d, a);
+		if (kind == BLINK)
+			continue;
+		sc->n++;
+		sc->agree += (kind == SAC) ==
+			     (f[k].movement == PSVR2_GAZE_SACCADE);
+		if (kind == FIX && f[k].movement == PSVR2_GAZE_FIXATION) {
+			e = angle_deg(d, f[k].direction);
+			sc->fix2 += e * e;
+			e = angle_deg(d, g[k].combined.gaze_direction);
+			sc->raw2 += e * e;
+			sc->fix_n++;
+		}
+
+		angles_at(t + PREDICT_MS * 1e-3, a, &ahead);
+		direction(d, a);
+		if (kind == SAC && ahead != BLINK &&
+		    f[k].movement == PSVR2_GAZE_SACCADE) {
+			sc->pred_err += angle_deg(d, f[k].predicted);
+			sc->hold_err += angle_deg(d,
+						  g[k].combined.gaze_direction);
+			sc->sac_n++;
+		}
+	}
+}
+
+static int run(const char *path, int synthetic)
+{
+	struct psvr2_gaze_filter_config cfg = { .flags = PSVR2_GAZE_TIMING };
+	struct psvr2_gaze gaze[GAZE_READ];
+	struct psvr2_filtered_gaze out[GAZE_READ];
+	struct psvr2_gaze_filter_stats st;
+	struct score sc = { 0 };
+	uint64_t seq = 0;
+	psvr2_t *p = bench_open(path);
+	int n;
+
+	if (!p)
+		return 1;
+	if (psvr2_gaze_filter_start(p, &cfg)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		psvr2_close(p);
+		return 1;
+	}
+
+	/* Every synthetic sample is open or a blink: one output each. */
+	while ((n = psvr2_read_gazes_timeout(p, gaze, GAZE_READ, 0, 0)) >= 0) {
+		int m = psvr2_get_filtered_gaze_since(p, &seq, out, n);
+
+		if (!synthetic || m != n || m <= 0)
+			continue;
+		if (!sc.shift)
+			sc.shift = gaze[0].measured_ns - T0_NS;
+		score(&sc, gaze, out, m);
+	}
+
+	psvr2_gaze_filter_get_stats(p, &st);
+	printf("%lu samples  %.3f us each\n", (unsigned long)st.samples,
+	       st.samples ? st.sample_ns * 1e-3 / st.samples : 0);
+	printf("%lu saccades, %lu blinks bridged, landing error %.2f deg\n",
+	       (unsigned long)st.saccades, (unsigned long)st.blinks,
+	       st.landings ? st.landing_error_deg / st.landings : 0);
+	if (synthetic && sc.n) {
+		printf("I-VT agrees with the truth on %.1f %% of samples\n",
+		       100.0 * sc.agree / sc.n);
+		printf("fixation rms error: raw %.3f deg, filtered %.3f deg\n",
+		       sqrt(sc.raw2 / sc.fix_n), sqrt(sc.fix2 / sc.fix_n));
+		printf("in saccades, %d ms ahead: predicted %.2f deg off, "
+		       "last sample %.2f deg\n", PREDICT_MS,
+		       sc.pred_err / sc.sac_n, sc.hold_err / sc.sac_n);
+	}
+	psvr2_close(p);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct bench b = {
+		.name = "gaze",
+		.seconds = 60,
+		.min_seconds = 1,
+		.synthesise = synthesise,
+		.run = run,
+	};
+
+	return bench_main(&b, argc, argv);
+}
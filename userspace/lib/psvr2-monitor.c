@@ -2,78 +2,144 @@
 /*
  * psvr2-monitor — example consumer of libpsvr2.
  *
- * Opens the headset and prints a live one-line status combining IMU, 6DoF pose
- * and combined gaze direction, draining the pose/gaze streams via poll().
+ * Lists the attached headsets, opens one and prints a live one-line status
+ * combining IMU, 6DoF pose, combined gaze direction and the worn/IPD controls,
+ * all delivered through libpsvr2's callback dispatcher.
  *
  * Build:  make   (in userspace/lib)
- * Run:    ./psvr2-monitor
+ * Run:    ./psvr2-monitor [index]      (default: the lowest-indexed headset)
+ *         ./psvr2-monitor -s index     (through a running psvr2d)
  *
  * Copyright (C) 2026 PSVR2 Linux project
  */
-#include <poll.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "libpsvr2.h"
 
-int main(void)
+struct monitor {
+	int	index;
+	struct psvr2_pose pose;
+	struct psvr2_gaze gaze;
+	struct psvr2_imu imu;
+	int	have_imu;
+	int	worn;
+	int	ipd_mm;
+	int	unplugged;
+};
+
+/* Only the newest sample of each batch is shown. */
+static void on_pose(void *user, const struct psvr2_pose *poses, int n)
+{
+	struct monitor *m = user;
+
+	m->pose = poses[n - 1];
+}
+
+static void on_gaze(void *user, const struct psvr2_gaze *gazes, int n)
+{
+	struct monitor *m = user;
+
+	m->gaze = gazes[n - 1];
+}
+
+static void on_imu(void *user, const struct psvr2_imu_sample *s, int n)
+{
+	struct monitor *m = user;
+
+	memcpy(m->imu.accel_m_s2, s[n - 1].accel_m_s2,
+	       sizeof(m->imu.accel_m_s2));
+	memcpy(m->imu.gyro_rad_s, s[n - 1].gyro_rad_s,
+	       sizeof(m->imu.gyro_rad_s));
+	m->have_imu = 1;
+}
+
+static void on_input(void *user, const struct psvr2_input_event *ev)
 {
-	psvr2_t *p = psvr2_open();
-	struct psvr2_pose pose = { 0 };
-	struct psvr2_gaze gaze = { 0 };
+	struct monitor *m = user;
 
+	if (ev->kind == PSVR2_INPUT_WORN)
+		m->worn = ev->value;
+	else if (ev->kind == PSVR2_INPUT_IPD)
+		m->ipd_mm = ev->value;
+}
+
+static void on_hotplug(void *user, int index, int present)
+{
+	struct monitor *m = user;
+
+	printf("\nheadset %d %s\n", index, present ? "attached" : "removed");
+	if (index == m->index && !present)
+		m->unplugged = 1;
+}
+
+int main(int argc, char **argv)
+{
+	struct psvr2_device_info devs[PSVR2_MAX_HEADSETS];
+	int ndev = psvr2_enumerate(devs, PSVR2_MAX_HEADSETS);
+	struct monitor m = { .worn = -1 };
+	struct psvr2_callbacks cb = {
+		.pose = on_pose,
+		.gaze = on_gaze,
+		.imu = on_imu,
+		.input = on_input,
+		.hotplug = on_hotplug,
+		.user = &m,
+	};
+	int imu_stream;
+	psvr2_t *p;
+
+	for (int i = 0; i < ndev && i < PSVR2_MAX_HEADSETS; i++)
+		printf("headset %d: port %s serial %s\n", devs[i].index,
+		       devs[i].port, devs[i].serial[0] ? devs[i].serial : "-");
+
+	if (argc > 2 && !strcmp(argv[1], "-s"))
+		p = psvr2_open_shared(atoi(argv[2]));
+	else
+		p = argc > 1 ? psvr2_open_index(atoi(argv[1])) : psvr2_open();
 	if (!p) {
 		fprintf(stderr, "psvr2_open failed\n");
 		return 1;
 	}
+	m.index = psvr2_index(p);
 
 	printf("interfaces: imu=%d pose=%d gaze=%d camera=%s\n",
 	       psvr2_has_imu(p), psvr2_has_pose(p), psvr2_has_gaze(p),
 	       psvr2_camera_path(p) ? psvr2_camera_path(p) : "(none)");
 
-	for (;;) {
-		struct pollfd pfds[2];
-		int n = 0, pose_idx = -1, gaze_idx = -1;
-		struct psvr2_imu imu;
-
-		if (psvr2_pose_fd(p) >= 0) {
-			pfds[n].fd = psvr2_pose_fd(p);
-			pfds[n].events = POLLIN;
-			pose_idx = n++;
-		}
-		if (psvr2_gaze_fd(p) >= 0) {
-			pfds[n].fd = psvr2_gaze_fd(p);
-			pfds[n].events = POLLIN;
-			gaze_idx = n++;
-		}
-
-		if (n)
-			poll(pfds, n, 100);
-		else
-			usleep(100000);
-
-		/* Drain to the most recent sample of each stream. */
-		if (pose_idx >= 0 && (pfds[pose_idx].revents & POLLIN))
-			while (psvr2_read_pose(p, &pose, 0) == 1)
-				;
-		if (gaze_idx >= 0 && (pfds[gaze_idx].revents & POLLIN))
-			while (psvr2_read_gaze(p, &gaze, 0) == 1)
-				;
+	/* Every IMU sample via the IIO buffer; else sysfs snapshots. */
+	imu_stream = psvr2_imu_start(p, 0) == 0;
+	if (psvr2_set_callbacks(p, &cb)) {
+		fprintf(stderr, "psvr2_set_callbacks failed\n");
+		psvr2_close(p);
+		return 1;
+	}
+
+	while (!m.unplugged) {
+		if (psvr2_dispatch(p, 100) < 0)
+			break;
+		if (!imu_stream)
+			m.have_imu = psvr2_read_imu(p, &m.imu) == 0;
 
 		printf("\r");
-		if (psvr2_read_imu(p, &imu) == 0)
+		if (m.have_imu)
 			printf("imu a[% .1f % .1f % .1f] g[% .2f % .2f % .2f] ",
-			       imu.accel_m_s2[0], imu.accel_m_s2[1],
-			       imu.accel_m_s2[2], imu.gyro_rad_s[0],
-			       imu.gyro_rad_s[1], imu.gyro_rad_s[2]);
-		if (pose.valid)
-			printf("| pos[% .2f % .2f % .2f] ", pose.position[0],
-			       pose.position[1], pose.position[2]);
-		if (gaze.valid && gaze.combined.gaze_direction_valid)
+			       m.imu.accel_m_s2[0], m.imu.accel_m_s2[1],
+			       m.imu.accel_m_s2[2], m.imu.gyro_rad_s[0],
+			       m.imu.gyro_rad_s[1], m.imu.gyro_rad_s[2]);
+		if (m.pose.valid)
+			printf("| pos[% .2f % .2f % .2f] ", m.pose.position[0],
+			       m.pose.position[1], m.pose.position[2]);
+		if (m.gaze.valid && m.gaze.combined.gaze_direction_valid)
 			printf("| gaze[% .2f % .2f % .2f] ",
-			       gaze.combined.gaze_direction[0],
-			       gaze.combined.gaze_direction[1],
-			       gaze.combined.gaze_direction[2]);
+			       m.gaze.combined.gaze_direction[0],
+			       m.gaze.combined.gaze_direction[1],
+			       m.gaze.combined.gaze_direction[2]);
+		if (m.worn >= 0)
+			printf("| %s ipd %d ", m.worn ? "worn" : "off",
+			       m.ipd_mm);
 		printf("        ");
 		fflush(stdout);
 	}
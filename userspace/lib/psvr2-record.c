@@ -0,0 +1,315 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * psvr2-record — record a headset session, or print one back as text.
+ *
+ * Records every pose, gaze, IMU sample and control event (and with -c the
+ * camera frames, which pauses SLAM) into a .psvr2rec file (libpsvr2's
+ * recording format) until the time runs out, Ctrl+C, or the headset goes away.
+ * With -d it replays a recording as fast as it decodes and prints one line per
+ * sample (frames aside), optionally of one stream only:
+ *
+ *   pose  <ms> px py pz  qw qx qy qz  <valid>
+ *   gaze  <ms> <valid>  dx dy dz  <pupil L> <pupil R>
+ *   imu   <ms> ax ay az  gx gy gz
+ *   input <ms> <kind> <value>
+ *
+ * <ms> counts from the start of the recording.
+ *
+ * Build:  make   (in userspace/lib)
+ * Run:    ./psvr2-record [-s] [-c] [-t seconds] [-i index] out.psvr2rec
+ *         ./psvr2-record -d in.psvr2rec [pose|gaze|imu|input]
+ *         (-s: through a running psvr2d, next to other consumers)
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libpsvr2.h"
+
+struct session {
+	psvr2_t	*p;
+	psvr2_rec_t *rec;
+	const char *only;		/* dump: stream name, or NULL */
+	uint64_t t0;
+	int	index;
+	int	failed;
+	int	unplugged;
+	unsigned long n_pose, n_gaze, n_imu, n_input, n_frame;
+};
+
+static psvr2_t *signal_handle;
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	psvr2_interrupt(signal_handle);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int wanted(const struct session *s, const char *stream)
+{
+	return !s->only || !strcmp(s->only, stream);
+}
+
+static double rel_ms(struct session *s, uint64_t t)
+{
+	if (!s->t0)
+		s->t0 = t;
+	return ((int64_t)(t - s->t0)) / 1e6;
+}
+
+/* ---- recording ---------------------------------------------------------- */
+
+static void rec_pose(void *user, const struct psvr2_pose *poses, int n)
+{
+	struct session *s = user;
+
+	s->failed |= psvr2_rec_poses(s->rec, poses, n);
+	s->n_pose += n;
+}
+
+static void rec_gaze(void *user, const struct psvr2_gaze *gazes, int n)
+{
+	struct session *s = user;
+
+	s->failed |= psvr2_rec_gazes(s->rec, gazes, n);
+	s->n_gaze += n;
+}
+
+static void rec_imu(void *user, const struct psvr2_imu_sample *smp, int n)
+{
+	struct session *s = user;
+
+	s->failed |= psvr2_rec_imu(s->rec, smp, n);
+	s->n_imu += n;
+}
+
+static void rec_input(void *user, const struct psvr2_input_event *ev)
+{
+	struct session *s = user;
+
+	s->failed |= psvr2_rec_input(s->rec, ev);
+	s->n_input++;
+}
+
+/* Every frame the camera has ready, straight from its buffers to the file. */
+static void rec_frames(struct session *s)
+{
+	struct psvr2_camera_frame f;
+
+	while (psvr2_camera_acquire(s->p, &f, 0) > 0) {
+		s->failed |= psvr2_rec_frame(s->rec, &f.frame);
+		psvr2_camera_release(s->p, &f);
+		s->n_frame++;
+	}
+}
+
+/* ---- dumping ------------------------------------------------------------ */
+
+static void dump_pose(void *user, const struct psvr2_pose *poses, int n)
+{
+	struct session *s = user;
+
+	for (int i = 0; i < n && wanted(s, "pose"); i++) {
+		const struct psvr2_pose *p = &poses[i];
+
+		printf("pose  %9.2f  % .4f % .4f % .4f  "
+		       "% .4f % .4f % .4f % .4f  %d\n",
+		       rel_ms(s, p->timestamp_ns), p->position[0],
+		       p->position[1], p->position[2], p->orientation[0],
+		       p->orientation[1], p->orientation[2], p->orientation[3],
+		       p->valid);
+	}
+}
+
+static void dump_gaze(void *user, const struct psvr2_gaze *gazes, int n)
+{
+	struct session *s = user;
+
+	for (int i = 0; i < n && wanted(s, "gaze"); i++) {
+		const struct psvr2_gaze *g = &gazes[i];
+
+		printf("gaze  %9.2f  %d  % .4f % .4f % .4f  %.2f %.2f\n",
+		       rel_ms(s, g->timestamp_ns), g->valid,
+		       g->combined.gaze_direction[0],
+		       g->combined.gaze_direction[1],
+		       g->combined.gaze_direction[2],
+		       g->left.pupil_diameter_mm, g->right.pupil_diameter_mm);
+	}
+}
+
+static void dump_imu(void *user, const struct psvr2_imu_sample *smp, int n)
+{
+	struct session *s = user;
+
+	for (int i = 0; i < n && wanted(s, "imu"); i++)
+		printf("imu   %9.2f  % .3f % .3f % .3f  % .4f % .4f % .4f\n",
+		       rel_ms(s, smp[i].timestamp_ns), smp[i].accel_m_s2[0],
+		       smp[i].accel_m_s2[1], smp[i].accel_m_s2[2],
+		       smp[i].gyro_rad_s[0], smp[i].gyro_rad_s[1],
+		       smp[i].gyro_rad_s[2]);
+}
+
+static void dump_input(void *user, const struct psvr2_input_event *ev)
+{
+	struct session *s = user;
+
+	if (wanted(s, "input"))
+		printf("input %9.2f  %d %d\n", rel_ms(s, ev->timestamp_ns),
+		       ev->kind, ev->value);
+}
+
+static void on_hotplug(void *user, int index, int present)
+{
+	struct session *s = user;
+
+	if (index == s->index && !present)
+		s->unplugged = 1;
+}
+
+/* ---- main --------------------------------------------------------------- */
+
+static int usage(void)
+{
+	fprintf(stderr,
+		"usage: psvr2-record [-s] [-c] [-t seconds] [-i index] FILE\n"
+		"       psvr2-record -d FILE [pose|gaze|imu|input]\n");
+	return 2;
+}
+
+static int dump(const char *path, const char *only)
+{
+	struct session s = { .only = only, .index = -1 };
+	struct psvr2_callbacks cb = {
+		.pose = dump_pose,
+		.gaze = dump_gaze,
+		.imu = dump_imu,
+		.input = dump_input,
+		.hotplug = on_hotplug,
+		.user = &s,
+	};
+
+	s.p = psvr2_open_replay(path, 0);
+	if (!s.p) {
+		perror(path);
+		return 1;
+	}
+	psvr2_set_callbacks(s.p, &cb);
+	while (!s.unplugged && psvr2_dispatch(s.p, -1) >= 0)
+		;
+	psvr2_close(s.p);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct session s = { 0 };
+	struct psvr2_callbacks cb = {
+		.pose = rec_pose,
+		.gaze = rec_gaze,
+		.imu = rec_imu,
+		.input = rec_input,
+		.hotplug = on_hotplug,
+		.user = &s,
+	};
+	struct sigaction sa = { .sa_handler = on_signal };
+	int opt, shared = 0, camera = 0, index = -1;
+	double seconds = 0;
+	uint64_t end = 0;
+
+	while ((opt = getopt(argc, argv, "d:sct:i:")) != -1) {
+		switch (opt) {
+		case 'd':
+			return dump(optarg,
+				    optind < argc ? argv[optind] : NULL);
+		case 's':
+			shared = 1;
+			break;
+		case 'c':
+			camera = 1;
+			break;
+		case 't':
+			seconds = atof(optarg);
+			break;
+		case 'i':
+			index = atoi(optarg);
+			break;
+		default:
+			return usage();
+		}
+	}
+	if (optind != argc - 1)
+		return usage();
+
+	if (shared)
+		s.p = psvr2_open_shared(index < 0 ? 0 : index);
+	else
+		s.p = index < 0 ? psvr2_open() : psvr2_open_index(index);
+	if (!s.p || psvr2_index(s.p) < 0) {
+		fprintf(stderr, "no headset%s\n", shared ? " (is psvr2d up?)"
+						      : "");
+		psvr2_close(s.p);
+		return 1;
+	}
+	s.index = psvr2_index(s.p);
+	s.rec = psvr2_rec_open(argv[optind]);
+	if (!s.rec) {
+		perror(argv[optind]);
+		psvr2_close(s.p);
+		return 1;
+	}
+
+	psvr2_imu_start(s.p, 0);
+	if (camera && psvr2_camera_open(s.p, 0, 0))
+		perror("camera");
+	if (psvr2_set_callbacks(s.p, &cb)) {
+		perror("psvr2_set_callbacks");
+		psvr2_rec_close(s.rec);
+		psvr2_close(s.p);
+		return 1;
+	}
+	signal_handle = s.p;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	if (seconds > 0)
+		end = now_ns() + (uint64_t)(seconds * 1e9);
+	fprintf(stderr, "recording headset %d to %s\n", s.index, argv[optind]);
+	while (!s.unplugged && !s.failed && (!end || now_ns() < end)) {
+		struct pollfd pfd[2] = {
+			{ .fd = psvr2_dispatch_fd(s.p), .events = POLLIN },
+			{ .fd = psvr2_camera_fd(s.p), .events = POLLIN },
+		};
+
+		if (poll(pfd, 2, 100) < 0 && errno != EINTR)
+			break;
+		if (psvr2_dispatch(s.p, 0) < 0)
+			break;
+		if (pfd[1].revents)
+			rec_frames(&s);
+	}
+
+	if (psvr2_rec_close(s.rec) || s.failed) {
+		perror(argv[optind]);
+		s.failed = 1;
+	}
+	fprintf(stderr, "%lu poses, %lu gaze, %lu IMU, %lu input events, "
+		"%lu frames\n", s.n_pose, s.n_gaze, s.n_imu, s.n_input,
+		s.n_frame);
+	psvr2_close(s.p);
+	return s.failed;
+}
@@ -0,0 +1,365 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * psvr2d — shares one headset's sensor streams among any number of processes.
+ *
+ * The pose/gaze nodes are single-consumer kfifos and the IMU's IIO buffer can
+ * have only one owner, so without this the SteamVR driver, a recorder and a
+ * monitor can't run side by side. psvr2d is their one reader: it drains all
+ * three through libpsvr2's dispatcher and publishes every converted sample
+ * into broadcast rings in a sealed memfd (layout in libpsvr2_shm.h). Clients
+ * attach with psvr2_open_shared(), map it read-only and follow the rings with
+ * their own cursors, so a sample is written once however many read it, and a
+ * slow or stopped client costs the daemon nothing; it only misses samples,
+ * which psvr2_get_overruns() reports to it.
+ *
+ * Build:  make   (in userspace/lib)
+ * Run:    ./psvr2d [index]      (default: the lowest-indexed headset)
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#define _GNU_SOURCE		/* memfd_create, accept4 */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "libpsvr2_int.h"
+#include "libpsvr2_shm.h"
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE	0x0010		/* Linux 5.1 */
+#endif
+
+#define MAX_CLIENTS	32
+
+struct client {
+	int	sock;			/* -1 if the slot is free */
+	int	efd[PSVR2_SHM_STREAMS];
+};
+
+struct daemon {
+	psvr2_t	*p;
+	int	memfd;
+	struct psvr2_shm *shm;
+	struct psvr2_ring ring[PSVR2_SHM_STREAMS];
+	int	listen_fd;
+	char	sock_path[108];
+	struct client clients[MAX_CLIENTS];
+	int	unplugged;
+};
+
+static psvr2_t *signal_handle;
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	psvr2_interrupt(signal_handle);
+}
+
+/* ---- shared memory ------------------------------------------------------ */
+
+static uint64_t align64(uint64_t v)
+{
+	return (v + 63) & ~63ull;
+}
+
+/* Header, then each present stream's ring on its own cache lines. */
+static int shm_create(struct daemon *d)
+{
+	static const size_t sz[PSVR2_SHM_STREAMS] = {
+		[PSVR2_SHM_POSE] = sizeof(struct psvr2_pose),
+		[PSVR2_SHM_GAZE] = sizeof(struct psvr2_gaze),
+		[PSVR2_SHM_IMU] = sizeof(struct psvr2_imu_sample),
+	};
+	uint64_t cap[PSVR2_SHM_STREAMS] = { 0 };
+	uint64_t off[PSVR2_SHM_STREAMS], size = align64(sizeof(*d->shm));
+	void *map;
+
+	if (psvr2_has_pose(d->p))
+		cap[PSVR2_SHM_POSE] = PSVR2_SHM_POSE_RING;
+	if (psvr2_has_gaze(d->p))
+		cap[PSVR2_SHM_GAZE] = PSVR2_SHM_GAZE_RING;
+	if (psvr2_imu_fd(d->p) >= 0)
+		cap[PSVR2_SHM_IMU] = PSVR2_SHM_IMU_RING;
+	for (int i = 0; i < PSVR2_SHM_STREAMS; i++) {
+		off[i] = size;
+		size = align64(size + cap[i] * sz[i]);
+	}
+
+	d->memfd = memfd_create("psvr2d", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (d->memfd < 0 || ftruncate(d->memfd, size))
+		return -1;
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, d->memfd,
+		   0);
+	if (map == MAP_FAILED)
+		return -1;
+	/*
+	 * Fixed size from here on, and with FUTURE_WRITE (where supported) no
+	 * one but this mapping can write: clients can only map it read-only.
+	 */
+	if (fcntl(d->memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW |
+		  F_SEAL_FUTURE_WRITE | F_SEAL_SEAL) &&
+	    fcntl(d->memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW |
+		  F_SEAL_SEAL))
+		return -1;
+
+	d->shm = map;
+	d->shm->magic = PSVR2_SHM_MAGIC;
+	d->shm->version = PSVR2_SHM_VERSION;
+	d->shm->size = size;
+	d->shm->index = psvr2_index(d->p);
+	snprintf(d->shm->usb_path, sizeof(d->shm->usb_path), "%s",
+		 d->p->usb_path);
+	for (int i = 0; i < PSVR2_SHM_STREAMS; i++) {
+		d->shm->ring[i].offset = off[i];
+		d->shm->ring[i].sz = sz[i];
+		d->shm->ring[i].cap = cap[i];
+		d->ring[i].pos = &d->shm->pos[i];
+		d->ring[i].slots = (char *)map + off[i];
+		d->ring[i].sz = sz[i];
+		d->ring[i].cap = cap[i];
+	}
+	return 0;
+}
+
+static void notify(struct daemon *d, int stream)
+{
+	uint64_t one = 1;
+
+	for (int i = 0; i < MAX_CLIENTS; i++)
+		if (d->clients[i].sock >= 0)
+			(void)!write(d->clients[i].efd[stream], &one,
+				     sizeof(one));
+}
+
+static void publish(struct daemon *d, int stream, const void *src, int n)
+{
+	psvr2__ring_publish(&d->ring[stream], src, n);
+	notify(d, stream);
+}
+
+/* Readers still drain what's in the rings, then get ENODEV. */
+static void mark_gone(struct daemon *d)
+{
+	__atomic_store_n(&d->shm->gone, 1, __ATOMIC_RELEASE);
+	for (int i = 0; i < PSVR2_SHM_STREAMS; i++)
+		notify(d, i);
+}
+
+/* ---- headset ------------------------------------------------------------ */
+
+static void on_pose(void *user, const struct psvr2_pose *poses, int n)
+{
+	publish(user, PSVR2_SHM_POSE, poses, n);
+}
+
+static void on_gaze(void *user, const struct psvr2_gaze *gazes, int n)
+{
+	publish(user, PSVR2_SHM_GAZE, gazes, n);
+}
+
+static void on_imu(void *user, const struct psvr2_imu_sample *s, int n)
+{
+	publish(user, PSVR2_SHM_IMU, s, n);
+}
+
+static void on_hotplug(void *user, int index, int present)
+{
+	struct daemon *d = user;
+
+	if (index == psvr2_index(d->p) && !present)
+		d->unplugged = 1;
+}
+
+/* ---- clients ------------------------------------------------------------ */
+
+static void client_drop(struct client *c)
+{
+	for (int i = 0; i < PSVR2_SHM_STREAMS; i++)
+		if (c->efd[i] >= 0)
+			close(c->efd[i]);
+	close(c->sock);
+	c->sock = -1;
+}
+
+static int listen_open(struct daemon *d)
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	int probe;
+
+	psvr2__shm_sock_path(sa.sun_path, sizeof(sa.sun_path),
+			     psvr2_index(d->p));
+	snprintf(d->sock_path, sizeof(d->sock_path), "%s", sa.sun_path);
+
+	/* Only take the path over from a daemon that is no longer there. */
+	probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (probe >= 0 &&
+	    !connect(probe, (struct sockaddr *)&sa, sizeof(sa))) {
+		close(probe);
+		errno = EADDRINUSE;
+		return -1;
+	}
+	if (probe >= 0)
+		close(probe);
+	unlink(sa.sun_path);
+
+	d->listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK |
+			      SOCK_CLOEXEC, 0);
+	if (d->listen_fd < 0 ||
+	    bind(d->listen_fd, (struct sockaddr *)&sa, sizeof(sa)) ||
+	    listen(d->listen_fd, 8))
+		return -1;
+	return 0;
+}
+
+/* New client: its eventfds, then the memfd and those in one message. */
+static void client_accept(struct daemon *d)
+{
+	int fds[1 + PSVR2_SHM_STREAMS] = { d->memfd };
+	char data = 0, cbuf[CMSG_SPACE(sizeof(fds))];
+	struct iovec iov = { .iov_base = &data, .iov_len = 1 };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf,
+		.msg_controllen = sizeof(cbuf),
+	};
+	struct cmsghdr *cm;
+	struct client *c = NULL;
+	int sock;
+
+	sock = accept4(d->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (sock < 0)
+		return;
+	for (int i = 0; i < MAX_CLIENTS && !c; i++)
+		if (d->clients[i].sock < 0)
+			c = &d->clients[i];
+	if (!c) {
+		fprintf(stderr, "psvr2d: client limit reached\n");
+		close(sock);
+		return;
+	}
+
+	c->sock = sock;
+	for (int i = 0; i < PSVR2_SHM_STREAMS; i++) {
+		c->efd[i] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		fds[1 + i] = c->efd[i];
+	}
+	for (int i = 0; i < PSVR2_SHM_STREAMS; i++)
+		if (c->efd[i] < 0)
+			goto fail;
+
+	cm = CMSG_FIRSTHDR(&msg);
+	cm->cmsg_level = SOL_SOCKET;
+	cm->cmsg_type = SCM_RIGHTS;
+	cm->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+	if (sendmsg(sock, &msg, MSG_NOSIGNAL) != 1)
+		goto fail;
+	return;
+
+fail:
+	/* EPIPE: gone already, e.g. another psvr2d checking for us. */
+	if (errno != EPIPE)
+		perror("psvr2d: client setup");
+	client_drop(c);
+}
+
+/* ---- main --------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+	struct daemon d = { .memfd = -1, .listen_fd = -1 };
+	struct psvr2_callbacks cb = {
+		.pose = on_pose,
+		.gaze = on_gaze,
+		.imu = on_imu,
+		.hotplug = on_hotplug,
+		.user = &d,
+	};
+	struct sigaction sa = { .sa_handler = on_signal };
+	int ret = 1;
+
+	for (int i = 0; i < MAX_CLIENTS; i++)
+		d.clients[i].sock = -1;
+
+	d.p = argc > 1 ? psvr2_open_index(atoi(argv[1])) : psvr2_open();
+	if (!d.p || psvr2_index(d.p) < 0) {
+		fprintf(stderr, "psvr2d: no headset\n");
+		goto out;
+	}
+	if (psvr2_imu_start(d.p, 0))
+		perror("psvr2d: IMU buffer (continuing without IMU)");
+
+	if (shm_create(&d)) {
+		perror("psvr2d: shared memory");
+		goto out;
+	}
+	if (listen_open(&d)) {
+		perror("psvr2d: socket");
+		goto out;
+	}
+	if (psvr2_set_callbacks(d.p, &cb)) {
+		perror("psvr2d: dispatcher");
+		goto out;
+	}
+
+	signal_handle = d.p;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	fprintf(stderr, "psvr2d: headset %d on %s\n", psvr2_index(d.p),
+		d.sock_path);
+
+	while (!d.unplugged) {
+		struct pollfd pfd[2 + MAX_CLIENTS];
+		int slot[MAX_CLIENTS], n = 2;
+
+		pfd[0] = (struct pollfd){ psvr2_dispatch_fd(d.p), POLLIN, 0 };
+		pfd[1] = (struct pollfd){ d.listen_fd, POLLIN, 0 };
+		for (int i = 0; i < MAX_CLIENTS; i++) {
+			if (d.clients[i].sock < 0)
+				continue;
+			slot[n - 2] = i;
+			pfd[n++] = (struct pollfd){ d.clients[i].sock, POLLIN,
+						    0 };
+		}
+		if (poll(pfd, n, -1) < 0 && errno != EINTR)
+			break;
+
+		/* Signals land here too, through the interrupt eventfd. */
+		if (pfd[0].revents && psvr2_dispatch(d.p, 0) < 0)
+			break;
+		if (pfd[1].revents & POLLIN)
+			client_accept(&d);
+		/* Clients never send; anything but silence is a hangup. */
+		for (int i = 2; i < n; i++)
+			if (pfd[i].revents)
+				client_drop(&d.clients[slot[i - 2]]);
+	}
+	ret = 0;
+	if (d.unplugged)
+		fprintf(stderr, "psvr2d: headset removed\n");
+
+out:
+	if (d.shm)
+		mark_gone(&d);
+	for (int i = 0; i < MAX_CLIENTS; i++)
+		if (d.clients[i].sock >= 0)
+			client_drop(&d.clients[i]);
+	if (d.listen_fd >= 0) {
+		close(d.listen_fd);
+		unlink(d.sock_path);
+	}
+	if (d.memfd >= 0)
+		close(d.memfd);
+	psvr2_close(d.p);
+	return ret;
+}
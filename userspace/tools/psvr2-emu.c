@@ -0,0 +1,1638 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * psvr2-emu — emulate a PSVR2 headset (USB 054c:0cde) with raw-gadget.
+ *
+ * Presents the adapter's 13-interface configuration through a UDC (normally
+ * dummy_hcd's loopback UDC), answers the ep0 vendor reports the module sends
+ * (camera mode, gaze enable/keepalive, brightness) and streams traffic on the
+ * IF3 SLAM, IF5 gaze, IF6 camera, IF7 status/IMU and IF8..IF10 aux endpoints,
+ * so the kernel module, libpsvr2 and the SteamVR driver can be exercised and
+ * profiled without a headset:
+ *
+ *   modprobe dummy_hcd raw_gadget && modprobe psvr2
+ *   ./psvr2-emu                   # synthetic traffic at nominal rates
+ *   ./psvr2-emu -r trace.p2emu    # recorded traffic at its original timing
+ *
+ * Traffic follows the device's gating: camera frames only while a decoded
+ * camera mode is selected, gaze only while the enable report is being
+ * refreshed (it lapses after PSVR2_GAZE_LAPSE_MS), status only on IF7 alt 1.
+ * Synthetic traffic is a slowly orbiting head pose, 2 kHz IMU at rest with a
+ * little gyro motion, fixating eyes with periodic blinks and a moving camera
+ * test pattern.
+ *
+ * Interfaces the module leaves to other drivers (HID, audio) and the unused
+ * vendor ones are endpoint-less vendor-class stubs, so usbhid and
+ * snd-usb-audio stay away. Endpoint addresses are the headset's where the UDC
+ * has a matching endpoint and otherwise the next free one of the right type;
+ * the module looks endpoints up by type, not address.
+ *
+ * Trace format (-r), little-endian:
+ *   file header   char magic[8] = "PSVR2EMU", u32 version = 1, u32 reserved
+ *   record        u64 t_ns (since capture start), u8 ifnum, u8 reserved[3],
+ *                 u32 length, u8 payload[length]
+ * Each record is one IN transfer on the given interface's endpoint.
+ * psvr2-pcap2emu writes these from a usbmon capture. A trace is replayed at
+ * its original timing, --speed times faster, or with --afap as fast as the
+ * host takes it (each stream then only keeps its own order); without --loop
+ * the emulator exits once the trace is done, so a capture of a misbehaving
+ * session can be rerun against the module as a regression test.
+ *
+ * Load generation, for capacity numbers: --scale multiplies synthetic rates
+ * (all streams, or one with STREAM=X), --headsets N runs N emulators on
+ * dummy_udc.0..N-1 (modprobe dummy_hcd num=N), --burst holds each stream's
+ * traffic for a while and then flushes the backlog back to back, --coalesce
+ * packs several records into one transfer where the host buffer allows, and
+ * --readers drains /dev/psvr2-{pose,gaze}N so read latency is measured.
+ * With --duration the run ends with a per-stream report from the module's
+ * debugfs stats (psvr2/<N>/stats/), diffed over the run.
+ *
+ * Build:  cc -O2 -pthread -o psvr2-emu psvr2-emu.c
+ * Run:    sudo ./psvr2-emu [-u dummy_udc.1] [-s SERIAL] [-r trace] [-v]
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <linux/usb/ch9.h>
+#include <linux/usb/raw_gadget.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "wire structs are filled in host order; little-endian hosts only"
+#endif
+
+#define PSVR2_VENDOR_ID		0x054c
+#define PSVR2_PRODUCT_ID	0x0cde
+#define NUM_INTERFACES		13
+
+#define IF_SLAM		3
+#define IF_GAZE		5
+#define IF_CAMERA	6
+#define IF_STATUS	7
+#define IF_LD		8
+#define IF_RP		9
+#define IF_VD		10
+
+#define STATUS_ALT	1
+
+/* ep0 vendor reports (see kernel/psvr2_protocol.h). */
+#define REQ_SET			0x09
+#define REQ_GET			0x01
+#define REPORT_CAMERA_MODE	0x0b
+#define REPORT_GAZE_STREAM	0x0c
+#define REPORT_BRIGHTNESS	0x12
+#define GAZE_STREAM_ENABLE	0x01
+#define GAZE_STREAM_DISABLE	0x02
+#define CAMERA_MODE_OFF		0x00
+#define CAMERA_MODE_SBS		0x01
+#define CAMERA_MODE_TRACKING	0x10
+
+#define CAM_HEADER_SIZE		256
+#define CAM_SBS_XFER_SIZE	819456
+#define CAM_SBS_WIDTH		1280
+#define CAM_SBS_HEIGHT		640
+#define CAM_TRACKING_XFER_SIZE	1040640
+
+#define STATUS_XFER_SIZE	1024
+#define STATUS_HDR_SIZE		32
+#define IMU_RECORD_SIZE		24
+#define IMU_PER_XFER		((STATUS_XFER_SIZE - STATUS_HDR_SIZE) / IMU_RECORD_SIZE)
+#define IMU_PERIOD_US		500		/* 2 kHz */
+#define SLAM_RECORD_SIZE	512
+#define AUX_XFER_SIZE		4096
+
+/* The headset stops streaming gaze a few seconds after the last enable. */
+#define PSVR2_GAZE_LAPSE_MS	3000
+
+/* Nominal rates for synthetic traffic. */
+#define DEFAULT_SLAM_HZ		250
+#define DEFAULT_GAZE_HZ		240
+#define DEFAULT_CAMERA_FPS	60
+#define DEFAULT_AUX_HZ		10
+
+/* Bulk writes are split so raw-gadget never needs one huge kernel buffer. */
+#define WRITE_CHUNK		(128 * 1024)
+#define EP0_MAX			4096
+
+#define TRACE_MAGIC		"PSVR2EMU"
+#define TRACE_VERSION		1
+
+#define PSVR2_SYSFS_DRIVER	"/sys/bus/usb/drivers/psvr2"
+#define PSVR2_DEBUGFS		"/sys/kernel/debug/psvr2"
+#define STATS_HIST_BUCKETS	24	/* PSVR2_STATS_HIST_BUCKETS */
+#define BIND_TIMEOUT_MS		10000
+#define SETTLE_MS		1000
+
+/* ---- wire structs (mirror kernel/psvr2_protocol.h) ---- */
+
+struct sie_ctrl_pkt {
+	uint16_t	report_id;
+	uint16_t	subcmd;
+	uint32_t	len;
+	uint8_t		data[512 - 8];
+} __attribute__((packed));
+
+struct status_hdr {
+	uint8_t		dprx_status;
+	uint8_t		prox_sensor_flag;
+	uint8_t		function_button;
+	uint8_t		empty0[2];
+	uint8_t		ipd_dial_mm;
+	uint8_t		remainder[26];
+} __attribute__((packed));
+
+struct imu_record {
+	uint32_t	vts_us;
+	int16_t		accel[3];
+	int16_t		gyro[3];
+	uint16_t	dp_frame_cnt;
+	uint16_t	dp_line_cnt;
+	uint16_t	imu_ts_us;
+	uint16_t	status;
+} __attribute__((packed));
+
+struct slam_record {
+	char		slp_hdr[3];
+	uint8_t		const1;
+	uint32_t	pkt_size;
+	uint32_t	vts_ts_us;
+	uint32_t	unknown1;
+	float		pos[3];
+	float		orient[4];
+	uint8_t		remainder[468];
+} __attribute__((packed));
+
+struct eye_gaze {
+	uint32_t	gaze_point_mm_valid;
+	float		gaze_point_mm[3];
+	uint32_t	gaze_direction_valid;
+	float		gaze_direction[3];
+	uint32_t	pupil_diameter_valid;
+	float		pupil_diameter_mm;
+	uint32_t	unk_bool_2;
+	float		unk_float_2[2];
+	uint32_t	unk_bool_3;
+	float		unk_float_4[2];
+	uint32_t	blink_valid;
+	uint32_t	blink;
+} __attribute__((packed));
+
+struct gaze_combined {
+	uint32_t	gaze_point_valid;
+	float		gaze_point_3d[3];
+	uint32_t	normalized_gaze_valid;
+	float		normalized_gaze[3];
+	uint32_t	is_valid;
+	uint32_t	timestamp;
+	uint32_t	unk[12];
+} __attribute__((packed));
+
+struct gaze_state {
+	char		header[2];
+	uint16_t	version;
+	uint32_t	size;
+	uint32_t	unk_1[3];
+	uint32_t	timestamp[3];
+	uint32_t	unk_2[15];
+	struct eye_gaze		left;
+	struct eye_gaze		right;
+	struct gaze_combined	combined;
+} __attribute__((packed));
+
+_Static_assert(sizeof(struct status_hdr) == STATUS_HDR_SIZE, "status header");
+_Static_assert(sizeof(struct imu_record) == IMU_RECORD_SIZE, "imu record");
+_Static_assert(sizeof(struct slam_record) == SLAM_RECORD_SIZE, "slam record");
+_Static_assert(sizeof(struct gaze_state) == 324, "gaze packet");
+
+struct trace_hdr {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	reserved;
+} __attribute__((packed));
+
+struct trace_rec {
+	uint64_t	t_ns;
+	uint8_t		ifnum;
+	uint8_t		reserved[3];
+	uint32_t	length;
+} __attribute__((packed));
+
+/* ---- emulator state ---- */
+
+struct emu;
+
+struct stream {
+	struct emu	*emu;
+	const char	*name;
+	uint8_t		ifnum;
+	uint8_t		type;		/* USB_ENDPOINT_XFER_{BULK,INT} */
+	uint8_t		want_addr;	/* the headset's address */
+	uint16_t	want_maxp;
+	uint8_t		interval;
+	double		rate_hz;	/* synthetic */
+	size_t		max_len;
+	bool		packs;		/* records may share a transfer */
+
+	/* Synthetic payload for transfer n; returns its length (0 = skip). */
+	size_t		(*fill)(struct emu *emu, struct stream *s, uint8_t *buf,
+				uint64_t n);
+
+	struct usb_endpoint_descriptor desc;
+	int		handle;
+	pthread_t	thread;
+	struct usb_raw_ep_io *io;	/* WRITE_CHUNK bytes of data */
+	uint8_t		*buf;		/* max_len, one whole transfer */
+
+	atomic_ullong	xfers;
+	atomic_ullong	bytes;
+	atomic_ullong	skipped;	/* gated off (mode / keepalive) */
+};
+
+struct emu {
+	int		fd;
+	bool		verbose;
+	const char	*serial;
+	bool		unworn;
+	bool		no_dp;
+	bool		loop;
+	double		speed;		/* replay time scale, 1 = as captured */
+	bool		afap;		/* replay without pacing */
+	pthread_t	main_thread;
+	atomic_int	replaying;	/* replay threads still running */
+
+	/* Load generation. */
+	unsigned int	coalesce;	/* records per transfer where allowed */
+	uint64_t	burst_hold_ns;
+	uint64_t	burst_every_ns;
+	double		duration_s;	/* run length for the stats report */
+	bool		readers;
+	const char	*load_desc;
+
+	/* Recorded traffic (-r), mmap'd read-only and shared by all streams. */
+	const uint8_t	*trace;
+	size_t		trace_len;
+
+	bool		configured;
+	uint64_t	t0_ns;
+
+	/* Device state driven by ep0; read lock-free by the stream threads. */
+	atomic_int	status_alt;
+	atomic_int	camera_mode;
+	atomic_ullong	gaze_deadline_ns;
+	atomic_int	brightness;
+
+	struct stream	streams[7];
+	int		num_streams;
+};
+
+static volatile sig_atomic_t stop;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t t_ns)
+{
+	struct timespec ts = {
+		.tv_sec = t_ns / 1000000000ull,
+		.tv_nsec = t_ns % 1000000000ull,
+	};
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR &&
+	       !stop)
+		;
+}
+
+/* ---- synthetic traffic ---- */
+
+static size_t fill_status(struct emu *emu, struct stream *s, uint8_t *buf,
+			  uint64_t n)
+{
+	struct status_hdr *hdr = (struct status_hdr *)buf;
+	struct imu_record *rec = (struct imu_record *)(buf + sizeof(*hdr));
+	/* Scaled rates keep 41 records per transfer and shrink the spacing. */
+	double step_us = 1e6 / (s->rate_hz * IMU_PER_XFER);
+	int i;
+
+	if (atomic_load(&emu->status_alt) != STATUS_ALT)
+		return 0;
+
+	memset(buf, 0, STATUS_XFER_SIZE);
+	hdr->dprx_status = emu->no_dp ? 0 : 1;
+	hdr->prox_sensor_flag = emu->unworn ? 0 : 1;
+	hdr->ipd_dial_mm = 63;
+
+	for (i = 0; i < IMU_PER_XFER; i++) {
+		uint64_t k = n * IMU_PER_XFER + i;
+		double t = k * step_us * 1e-6;
+
+		rec[i].vts_us = (uint32_t)(k * step_us);
+		/* 1 g on the second axis at 4 g full scale; ~10 deg/s yaw wobble. */
+		rec[i].accel[1] = 8192;
+		rec[i].gyro[1] = (int16_t)(164 * sin(2 * M_PI * 0.25 * t));
+		rec[i].dp_frame_cnt = (uint16_t)(t * 120);
+		rec[i].imu_ts_us = (uint16_t)rec[i].vts_us;
+	}
+	return STATUS_XFER_SIZE;
+}
+
+static size_t fill_slam(struct emu *emu, struct stream *s, uint8_t *buf,
+			uint64_t n)
+{
+	struct slam_record *rec = (struct slam_record *)buf;
+	double t = n / s->rate_hz;
+	double yaw = 0.3 * sin(2 * M_PI * 0.1 * t);
+
+	(void)emu;
+	memset(buf, 0, SLAM_RECORD_SIZE);
+	memcpy(rec->slp_hdr, "SLP", 3);
+	rec->const1 = 1;
+	rec->pkt_size = SLAM_RECORD_SIZE;
+	rec->vts_ts_us = (uint32_t)(t * 1e6);
+	rec->unknown1 = 3;
+	/* A 5 cm orbit at standing height while slowly looking left and right. */
+	rec->pos[0] = (float)(0.05 * cos(2 * M_PI * 0.2 * t));
+	rec->pos[1] = 1.6f;
+	rec->pos[2] = (float)(0.05 * sin(2 * M_PI * 0.2 * t));
+	rec->orient[0] = (float)cos(yaw / 2);
+	rec->orient[2] = (float)sin(yaw / 2);
+	return SLAM_RECORD_SIZE;
+}
+
+static void fill_eye(struct eye_gaze *e, double gx, double gy, bool blink)
+{
+	double norm = sqrt(gx * gx + gy * gy + 1);
+
+	e->gaze_point_mm_valid = 1;
+	e->gaze_direction_valid = !blink;
+	e->gaze_direction[0] = (float)(gx / norm);
+	e->gaze_direction[1] = (float)(gy / norm);
+	e->gaze_direction[2] = (float)(1 / norm);
+	e->pupil_diameter_valid = !blink;
+	e->pupil_diameter_mm = 3.5f;
+	e->blink_valid = 1;
+	e->blink = blink;
+}
+
+static size_t fill_gaze(struct emu *emu, struct stream *s, uint8_t *buf,
+			uint64_t n)
+{
+	struct gaze_state *gs = (struct gaze_state *)buf;
+	double t = n / s->rate_hz;
+	/* Fixations that hop every 400 ms, and a 150 ms blink every 4 s. */
+	uint64_t fix = (uint64_t)(t / 0.4);
+	double gx = 0.2 * sin(fix * 2.1), gy = 0.15 * cos(fix * 1.3);
+	bool blink = fmod(t, 4.0) < 0.15;
+	uint32_t ts = (uint32_t)(t * 1e6);
+	double norm = sqrt(gx * gx + gy * gy + 1);
+
+	if (now_ns() > atomic_load(&emu->gaze_deadline_ns))
+		return 0;
+
+	memset(buf, 0, sizeof(*gs));
+	memcpy(gs->header, "GS", 2);
+	gs->version = 1;
+	gs->size = sizeof(*gs) - 4;
+	gs->timestamp[0] = gs->timestamp[1] = gs->timestamp[2] = ts;
+	fill_eye(&gs->left, gx - 0.03, gy, blink);
+	fill_eye(&gs->right, gx + 0.03, gy, blink);
+	gs->combined.gaze_point_valid = !blink;
+	gs->combined.normalized_gaze_valid = !blink;
+	gs->combined.normalized_gaze[0] = (float)(gx / norm);
+	gs->combined.normalized_gaze[1] = (float)(gy / norm);
+	gs->combined.normalized_gaze[2] = (float)(1 / norm);
+	gs->combined.is_valid = !blink;
+	gs->combined.timestamp = ts;
+	return sizeof(*gs);
+}
+
+static size_t fill_camera(struct emu *emu, struct stream *s, uint8_t *buf,
+			  uint64_t n)
+{
+	int mode = atomic_load(&emu->camera_mode);
+	int y;
+
+	(void)s;
+	switch (mode) {
+	case CAMERA_MODE_SBS:
+		memset(buf, 0, CAM_HEADER_SIZE);
+		/* Diagonal bands that scroll one pixel per frame. */
+		for (y = 0; y < CAM_SBS_HEIGHT; y++)
+			memset(buf + CAM_HEADER_SIZE + (size_t)y * CAM_SBS_WIDTH,
+			       (uint8_t)((y + n) * 4), CAM_SBS_WIDTH);
+		return CAM_SBS_XFER_SIZE;
+	case CAMERA_MODE_TRACKING:
+		memset(buf, (uint8_t)n, CAM_TRACKING_XFER_SIZE);
+		return CAM_TRACKING_XFER_SIZE;
+	default:
+		return 0;
+	}
+}
+
+static size_t fill_aux(struct emu *emu, struct stream *s, uint8_t *buf,
+		       uint64_t n)
+{
+	(void)emu;
+	memset(buf, 0, AUX_XFER_SIZE);
+	memcpy(buf, &n, sizeof(n));
+	buf[8] = s->ifnum;
+	return AUX_XFER_SIZE;
+}
+
+/* ---- endpoint I/O ---- */
+
+static int ep_write(struct emu *emu, struct stream *s, const uint8_t *data,
+		    size_t len)
+{
+	size_t off = 0;
+
+	/*
+	 * A bulk transfer ends at the first short packet, so the chunks (all
+	 * multiples of maxp) join up into one transfer on the host; ZERO adds a
+	 * ZLP when the total is an exact multiple.
+	 */
+	do {
+		size_t n = len - off < WRITE_CHUNK ? len - off : WRITE_CHUNK;
+		bool last = off + n == len;
+		int ret;
+
+		memcpy(s->io->data, data + off, n);
+		s->io->ep = s->handle;
+		s->io->length = n;
+		s->io->flags = last && s->type == USB_ENDPOINT_XFER_BULK ?
+			       USB_RAW_IO_FLAGS_ZERO : 0;
+		ret = ioctl(emu->fd, USB_RAW_IOCTL_EP_WRITE, s->io);
+		if (ret < 0)
+			return -errno;
+		off += n;
+	} while (off < len);
+
+	atomic_fetch_add(&s->xfers, 1);
+	atomic_fetch_add(&s->bytes, len);
+	return 0;
+}
+
+/* Whether the device would currently be sending on this stream. */
+static bool stream_gated_on(struct emu *emu, struct stream *s)
+{
+	switch (s->ifnum) {
+	case IF_STATUS:
+		return atomic_load(&emu->status_alt) == STATUS_ALT;
+	case IF_GAZE:
+		return now_ns() <= atomic_load(&emu->gaze_deadline_ns);
+	case IF_CAMERA:
+		return atomic_load(&emu->camera_mode) != CAMERA_MODE_OFF;
+	default:
+		return true;
+	}
+}
+
+
+static void report_write_error(struct stream *s, int err, int *last)
+{
+	if (err != *last && !stop)
+		fprintf(stderr, "%s: endpoint write failed: %s\n", s->name,
+			strerror(-err));
+	*last = err;
+}
+
+/*
+ * Pack up to emu->coalesce consecutive records into one transfer (streams
+ * whose host buffer has room); @count returns how many periods it covers.
+ */
+static size_t fill_transfer(struct emu *emu, struct stream *s, uint64_t n,
+			    unsigned int *count)
+{
+	size_t len = s->fill(emu, s, s->buf, n), one = len;
+
+	*count = 1;
+	if (!s->packs || !len)
+		return len;
+	while (*count < emu->coalesce && len + one <= s->max_len &&
+	       s->fill(emu, s, s->buf + len, n + *count) == one) {
+		len += one;
+		(*count)++;
+	}
+	return len;
+}
+
+/* Synthetic: one transfer per period, timestamps follow wall time. */
+static void *stream_synthetic(void *arg)
+{
+	struct stream *s = arg;
+	struct emu *emu = s->emu;
+	uint64_t period = (uint64_t)(1e9 / s->rate_hz);
+	uint64_t next = emu->t0_ns, n = 0;
+	uint64_t next_burst = emu->t0_ns + emu->burst_every_ns;
+	/* Catch-up limit; a burst's backlog must not count as a stall. */
+	uint64_t lag = 100000000ull + 2 * emu->burst_hold_ns;
+	int last_err = 0;
+
+	while (!stop) {
+		unsigned int count;
+		size_t len = fill_transfer(emu, s, n, &count);
+		uint64_t now;
+
+		if (len) {
+			int ret = ep_write(emu, s, s->buf, len);
+
+			if (ret < 0)
+				report_write_error(s, ret, &last_err);
+			else
+				last_err = 0;
+		} else {
+			atomic_fetch_add(&s->skipped, 1);
+		}
+
+		n += count;
+		next += period * count;
+		now = now_ns();
+
+		/*
+		 * Burst: the device sits on its data for burst_hold, then the
+		 * schedule, now behind, sends the backlog without sleeping.
+		 */
+		if (emu->burst_hold_ns && now >= next_burst) {
+			sleep_until(now + emu->burst_hold_ns);
+			while (next_burst <= now)
+				next_burst += emu->burst_every_ns;
+			continue;
+		}
+
+		/* Keep the cadence, but don't burst to catch up a long stall. */
+		if (next + lag < now)
+			next = now;
+		sleep_until(next);
+	}
+	return NULL;
+}
+
+/*
+ * Recorded: walk the shared trace for this interface's records. Every stream
+ * uses the same time base, so cross-stream ordering is as captured.
+ */
+static void *stream_replay(void *arg)
+{
+	struct stream *s = arg;
+	struct emu *emu = s->emu;
+	uint64_t base = emu->t0_ns, span = 0;
+	int last_err = 0;
+
+	do {
+		size_t off = sizeof(struct trace_hdr);
+		struct trace_rec rec;
+
+		while (!stop && off + sizeof(rec) <= emu->trace_len) {
+			int ret;
+
+			memcpy(&rec, emu->trace + off, sizeof(rec));
+			off += sizeof(rec);
+			if (rec.length > emu->trace_len - off)
+				break;
+			off += rec.length;
+			span = rec.t_ns;
+			if (rec.ifnum != s->ifnum)
+				continue;
+
+			if (!emu->afap)
+				sleep_until(base +
+					    (uint64_t)(rec.t_ns / emu->speed));
+			if (!stream_gated_on(emu, s) || rec.length > s->max_len) {
+				atomic_fetch_add(&s->skipped, 1);
+				continue;
+			}
+			ret = ep_write(emu, s, emu->trace + off - rec.length,
+				       rec.length);
+
+			if (ret < 0)
+				report_write_error(s, ret, &last_err);
+			else
+				last_err = 0;
+		}
+		base += (uint64_t)((span + 1000000) / emu->speed);
+	} while (emu->loop && !stop);
+
+	/* The last stream to finish ends the run (and wakes the ep0 loop). */
+	if (atomic_fetch_sub(&emu->replaying, 1) == 1 && !stop) {
+		stop = 1;
+		pthread_kill(emu->main_thread, SIGINT);
+	}
+	return NULL;
+}
+
+static int load_trace(struct emu *emu, const char *path)
+{
+	const struct trace_hdr *hdr;
+	struct stat st;
+	void *p;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		perror(path);
+		return -1;
+	}
+	if ((size_t)st.st_size < sizeof(*hdr)) {
+		fprintf(stderr, "%s: too short for a trace\n", path);
+		close(fd);
+		return -1;
+	}
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		return -1;
+	}
+
+	hdr = p;
+	if (memcmp(hdr->magic, TRACE_MAGIC, sizeof(hdr->magic)) ||
+	    hdr->version != TRACE_VERSION) {
+		fprintf(stderr, "%s: not a version %d psvr2-emu trace\n", path,
+			TRACE_VERSION);
+		munmap(p, st.st_size);
+		return -1;
+	}
+	emu->trace = p;
+	emu->trace_len = st.st_size;
+	return 0;
+}
+
+/* ---- load report ---- */
+
+struct stats_snap {
+	bool		ok;
+	uint64_t	urbs, bytes, records, fifo_overflows, resubmit_failures;
+	uint64_t	urb_errors;
+	uint64_t	read_latency_us[STATS_HIST_BUCKETS];
+	uint64_t	sent;		/* emulator side: transfers written */
+};
+
+static int read_line(const char *path, char *buf, size_t len)
+{
+	FILE *f = fopen(path, "r");
+
+	if (!f)
+		return -1;
+	if (!fgets(buf, len, f)) {
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+/* The module's headset index for our serial, from a bound interface. */
+static int find_index(const char *serial)
+{
+	DIR *d = opendir(PSVR2_SYSFS_DRIVER);
+	struct dirent *e;
+	int index = -1;
+
+	if (!d)
+		return -1;
+	while (index < 0 && (e = readdir(d))) {
+		char path[512], buf[128];
+
+		if (!strchr(e->d_name, ':'))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s/../serial",
+			 PSVR2_SYSFS_DRIVER, e->d_name);
+		if (read_line(path, buf, sizeof(buf)) || strcmp(buf, serial))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s/index", PSVR2_SYSFS_DRIVER,
+			 e->d_name);
+		if (!read_line(path, buf, sizeof(buf)))
+			index = atoi(buf);
+	}
+	closedir(d);
+	return index;
+}
+
+/* Parse one psvr2/<N>/stats/<stream> file ("name value" lines). */
+static void read_stats(int index, const char *name, struct stats_snap *st)
+{
+	char path[256], line[2048];
+	FILE *f;
+
+	memset(st, 0, sizeof(*st));
+	snprintf(path, sizeof(path), "%s/%d/stats/%s", PSVR2_DEBUGFS, index,
+		 name);
+	f = fopen(path, "r");
+	if (!f)
+		return;
+
+	while (fgets(line, sizeof(line), f)) {
+		char key[64], *p;
+		unsigned long long v;
+		int i;
+
+		if (sscanf(line, "%63s", key) != 1)
+			continue;
+		p = line + strlen(key);
+		if (!strcmp(key, "urb_errors")) {
+			while ((p = strchr(p, '=')))
+				st->urb_errors += strtoull(p + 1, &p, 10);
+		} else if (!strcmp(key, "read_latency_us")) {
+			for (i = 0; i < STATS_HIST_BUCKETS &&
+				    (p = strchr(p, ':')); i++)
+				st->read_latency_us[i] = strtoull(p + 1, &p, 10);
+		} else if (sscanf(p, "%llu", &v) == 1) {
+			if (!strcmp(key, "urbs"))
+				st->urbs = v;
+			else if (!strcmp(key, "bytes"))
+				st->bytes = v;
+			else if (!strcmp(key, "records"))
+				st->records = v;
+			else if (!strcmp(key, "fifo_overflows"))
+				st->fifo_overflows = v;
+			else if (!strcmp(key, "resubmit_failures"))
+				st->resubmit_failures = v;
+		}
+	}
+	fclose(f);
+	st->ok = true;
+}
+
+/*
+ * Upper bound in us of the log2 bucket holding quantile @q (bucket i counts
+ * [2^(i-1), 2^i)), or 0 without samples.
+ */
+static uint64_t hist_quantile(const uint64_t *h, double q)
+{
+	uint64_t total = 0, target, cum = 0;
+	int i;
+
+	for (i = 0; i < STATS_HIST_BUCKETS; i++)
+		total += h[i];
+	if (!total)
+		return 0;
+	target = (uint64_t)ceil(total * q);
+	for (i = 0; i < STATS_HIST_BUCKETS; i++) {
+		cum += h[i];
+		if (cum >= target)
+			break;
+	}
+	return 1ull << (i < STATS_HIST_BUCKETS ? i : STATS_HIST_BUCKETS - 1);
+}
+
+static void *reader(void *arg)
+{
+	static char buf[64 * 1024];	/* contents are discarded */
+	int fd = open(arg, O_RDONLY);
+
+	if (fd < 0) {
+		perror(arg);
+		free(arg);
+		return NULL;
+	}
+	free(arg);
+	while (!stop && read(fd, buf, sizeof(buf)) > 0)
+		;
+	close(fd);
+	return NULL;
+}
+
+static void start_reader(const char *fmt, int index)
+{
+	char *path = malloc(64);
+	pthread_t t;
+
+	if (!path)
+		return;
+	snprintf(path, 64, fmt, index);
+	if (pthread_create(&t, NULL, reader, path))
+		free(path);
+	else
+		pthread_detach(t);
+}
+
+static void sleep_ms_unless_stopped(uint64_t ms)
+{
+	uint64_t end = now_ns() + ms * 1000000ull, now;
+
+	/* Short naps, so a stop is noticed promptly. */
+	while (!stop && (now = now_ns()) < end)
+		sleep_until(end - now > 100000000ull ? now + 100000000ull : end);
+}
+
+/*
+ * Find the headset the module made of us, optionally start readers, and with
+ * --duration diff the module's stats over the run and print them per stream.
+ */
+static void *load_report(void *arg)
+{
+	static const char *const names[] = { "status", "slam", "gaze",
+					     "camera" };
+	struct stats_snap before[4], after[4];
+	struct emu *emu = arg;
+	uint64_t t_start, waited = 0;
+	double secs;
+	int index, i, j;
+
+	while ((index = find_index(emu->serial)) < 0 && !stop &&
+	       waited < BIND_TIMEOUT_MS) {
+		sleep_ms_unless_stopped(100);
+		waited += 100;
+	}
+	if (index < 0) {
+		fprintf(stderr, "%s: module did not bind (is psvr2 loaded?)\n",
+			emu->serial);
+		goto out;
+	}
+	if (emu->readers) {
+		start_reader("/dev/psvr2-pose%d", index);
+		start_reader("/dev/psvr2-gaze%d", index);
+	}
+	if (emu->duration_s <= 0)
+		return NULL;
+
+	sleep_ms_unless_stopped(SETTLE_MS);
+	t_start = now_ns();
+	for (i = 0; i < 4; i++)
+		read_stats(index, names[i], &before[i]);
+	for (j = 0; j < emu->num_streams; j++)
+		for (i = 0; i < 4; i++)
+			if (!strcmp(emu->streams[j].name, names[i]))
+				before[i].sent = atomic_load(&emu->streams[j].xfers);
+
+	sleep_ms_unless_stopped((uint64_t)(emu->duration_s * 1000));
+	secs = (now_ns() - t_start) / 1e9;
+	for (i = 0; i < 4; i++)
+		read_stats(index, names[i], &after[i]);
+	for (j = 0; j < emu->num_streams; j++)
+		for (i = 0; i < 4; i++)
+			if (!strcmp(emu->streams[j].name, names[i]))
+				after[i].sent = atomic_load(&emu->streams[j].xfers);
+
+	printf("== %s (psvr2/%d): %.1f s, %s\n"
+	       "stream     sent/s  records/s     MB/s  overflows  resubmit  urb_err  read p50/p99/max us\n",
+	       emu->serial, index, secs, emu->load_desc);
+	for (i = 0; i < 4; i++) {
+		struct stats_snap *a = &after[i], *b = &before[i];
+		uint64_t lat[STATS_HIST_BUCKETS];
+		int k, top = -1;
+
+		if (!a->ok || !b->ok) {
+			printf("%-8s %8.1f  (no stats: debugfs mounted, running as root?)\n",
+			       names[i], (a->sent - b->sent) / secs);
+			continue;
+		}
+		for (k = 0; k < STATS_HIST_BUCKETS; k++) {
+			lat[k] = a->read_latency_us[k] - b->read_latency_us[k];
+			if (lat[k])
+				top = k;
+		}
+		printf("%-8s %8.1f %10.1f %8.2f %10llu %9llu %8llu  ",
+		       names[i], (a->sent - b->sent) / secs,
+		       (a->records - b->records) / secs,
+		       (a->bytes - b->bytes) / secs / 1e6,
+		       (unsigned long long)(a->fifo_overflows - b->fifo_overflows),
+		       (unsigned long long)(a->resubmit_failures -
+					    b->resubmit_failures),
+		       (unsigned long long)(a->urb_errors - b->urb_errors));
+		if (top < 0)
+			printf("-\n");
+		else
+			printf("%llu/%llu/%llu\n",
+			       (unsigned long long)hist_quantile(lat, 0.5),
+			       (unsigned long long)hist_quantile(lat, 0.99),
+			       1ull << top);
+	}
+	fflush(stdout);
+out:
+	if (emu->duration_s > 0 && !stop) {
+		stop = 1;
+		pthread_kill(emu->main_thread, SIGINT);
+	}
+	return NULL;
+}
+
+/* ---- descriptors ---- */
+
+static const struct usb_device_descriptor dev_desc = {
+	.bLength		= USB_DT_DEVICE_SIZE,
+	.bDescriptorType	= USB_DT_DEVICE,
+	.bcdUSB			= 0x0200,
+	.bMaxPacketSize0	= 64,
+	.idVendor		= PSVR2_VENDOR_ID,
+	.idProduct		= PSVR2_PRODUCT_ID,
+	.bcdDevice		= 0x0100,
+	.iManufacturer		= 1,
+	.iProduct		= 2,
+	.iSerialNumber		= 3,
+	.bNumConfigurations	= 1,
+};
+
+static const struct usb_qualifier_descriptor qual_desc = {
+	.bLength		= sizeof(struct usb_qualifier_descriptor),
+	.bDescriptorType	= USB_DT_DEVICE_QUALIFIER,
+	.bcdUSB			= 0x0200,
+	.bMaxPacketSize0	= 64,
+	.bNumConfigurations	= 1,
+};
+
+static size_t put_interface(uint8_t *p, uint8_t ifnum, uint8_t alt,
+			    uint8_t num_eps)
+{
+	struct usb_interface_descriptor d = {
+		.bLength		= USB_DT_INTERFACE_SIZE,
+		.bDescriptorType	= USB_DT_INTERFACE,
+		.bInterfaceNumber	= ifnum,
+		.bAlternateSetting	= alt,
+		.bNumEndpoints		= num_eps,
+		.bInterfaceClass	= USB_CLASS_VENDOR_SPEC,
+		/* IF3..IF12 are vendor subclasses 1..10 on the headset. */
+		.bInterfaceSubClass	= ifnum >= IF_SLAM ? ifnum - 2 : 0,
+	};
+
+	memcpy(p, &d, sizeof(d));
+	return sizeof(d);
+}
+
+static size_t build_config(struct emu *emu, uint8_t *buf)
+{
+	struct usb_config_descriptor cfg = {
+		.bLength		= USB_DT_CONFIG_SIZE,
+		.bDescriptorType	= USB_DT_CONFIG,
+		.bNumInterfaces		= NUM_INTERFACES,
+		.bConfigurationValue	= 1,
+		.bmAttributes		= USB_CONFIG_ATT_ONE,
+		.bMaxPower		= 250,		/* 500 mA */
+	};
+	size_t len = sizeof(cfg);
+	int ifnum, i;
+
+	for (ifnum = 0; ifnum < NUM_INTERFACES; ifnum++) {
+		int num_eps = 0;
+
+		for (i = 0; i < emu->num_streams; i++)
+			num_eps += emu->streams[i].ifnum == ifnum;
+
+		/* IF7's endpoint only exists on alt 1. */
+		if (ifnum == IF_STATUS) {
+			len += put_interface(buf + len, ifnum, 0, 0);
+			len += put_interface(buf + len, ifnum, STATUS_ALT,
+					     num_eps);
+		} else {
+			len += put_interface(buf + len, ifnum, 0, num_eps);
+		}
+		for (i = 0; i < emu->num_streams; i++) {
+			if (emu->streams[i].ifnum != ifnum)
+				continue;
+			memcpy(buf + len, &emu->streams[i].desc,
+			       USB_DT_ENDPOINT_SIZE);
+			len += USB_DT_ENDPOINT_SIZE;
+		}
+	}
+
+	cfg.wTotalLength = len;
+	memcpy(buf, &cfg, sizeof(cfg));
+	return len;
+}
+
+static size_t build_string(struct emu *emu, uint8_t index, uint8_t *buf)
+{
+	static const char *const strings[] = {
+		[1] = "Sony Interactive Entertainment",
+		[2] = "PS VR2",
+	};
+	const char *s = index == 3 ? emu->serial :
+			index < 3 ? strings[index] : NULL;
+	size_t i, n;
+
+	if (index == 0) {
+		buf[0] = 4;
+		buf[1] = USB_DT_STRING;
+		buf[2] = 0x09;		/* en-US */
+		buf[3] = 0x04;
+		return 4;
+	}
+	if (!s)
+		return 0;
+
+	n = strlen(s);
+	if (n > 126)
+		n = 126;
+	buf[0] = 2 + 2 * n;
+	buf[1] = USB_DT_STRING;
+	for (i = 0; i < n; i++) {
+		buf[2 + 2 * i] = s[i];
+		buf[3 + 2 * i] = 0;
+	}
+	return buf[0];
+}
+
+/*
+ * Place each stream on the headset's endpoint address if the UDC has one of
+ * that number and type, otherwise on the first free suitable endpoint.
+ */
+static int assign_endpoints(struct emu *emu)
+{
+	struct usb_raw_eps_info info;
+	bool used[USB_RAW_EPS_NUM_MAX] = { false };
+	uint16_t taken = 0;	/* IN endpoint numbers */
+	int num, i, j, pass;
+
+	memset(&info, 0, sizeof(info));
+	num = ioctl(emu->fd, USB_RAW_IOCTL_EPS_INFO, &info);
+	if (num < 0) {
+		perror("USB_RAW_IOCTL_EPS_INFO");
+		return -1;
+	}
+
+	for (i = 0; i < emu->num_streams; i++)
+		emu->streams[i].desc.bLength = 0;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < emu->num_streams; i++) {
+			struct stream *s = &emu->streams[i];
+			int want = s->want_addr & USB_ENDPOINT_NUMBER_MASK;
+
+			if (s->desc.bLength)
+				continue;
+			for (j = 0; j < num; j++) {
+				struct usb_raw_ep_info *ep = &info.eps[j];
+				int addr = -1, n;
+
+				if (used[j] || !ep->caps.dir_in ||
+				    (s->type == USB_ENDPOINT_XFER_BULK ?
+					     !ep->caps.type_bulk :
+					     !ep->caps.type_int))
+					continue;
+
+				if (pass == 0) {
+					if ((ep->addr == (uint32_t)want ||
+					     ep->addr == USB_RAW_EP_ADDR_ANY) &&
+					    !(taken & (1u << want)))
+						addr = want;
+				} else if (ep->addr != USB_RAW_EP_ADDR_ANY) {
+					if (!(taken & (1u << ep->addr)))
+						addr = ep->addr;
+				} else {
+					for (n = 1; n < 16; n++)
+						if (!(taken & (1u << n)))
+							break;
+					if (n < 16)
+						addr = n;
+				}
+				if (addr < 0)
+					continue;
+
+				used[j] = true;
+				taken |= 1u << addr;
+				s->desc.bLength = USB_DT_ENDPOINT_SIZE;
+				s->desc.bDescriptorType = USB_DT_ENDPOINT;
+				s->desc.bEndpointAddress = USB_DIR_IN | addr;
+				s->desc.bmAttributes = s->type;
+				s->desc.wMaxPacketSize =
+					s->want_maxp < ep->limits.maxpacket_limit ?
+						s->want_maxp :
+						ep->limits.maxpacket_limit;
+				s->desc.bInterval = s->interval;
+				break;
+			}
+		}
+	}
+
+	for (i = 0; i < emu->num_streams; i++) {
+		struct stream *s = &emu->streams[i];
+
+		if (!s->desc.bLength) {
+			fprintf(stderr, "no free %s IN endpoint for %s (IF%u)\n",
+				s->type == USB_ENDPOINT_XFER_BULK ? "bulk" :
+								    "interrupt",
+				s->name, s->ifnum);
+			return -1;
+		}
+		if (emu->verbose)
+			printf("IF%-2u %-6s ep 0x%02x maxp %u\n", s->ifnum,
+			       s->name, s->desc.bEndpointAddress,
+			       s->desc.wMaxPacketSize);
+	}
+	return 0;
+}
+
+/* ---- ep0 ---- */
+
+static int start_streams(struct emu *emu)
+{
+	int i, ret;
+
+	for (i = 0; i < emu->num_streams; i++) {
+		struct stream *s = &emu->streams[i];
+
+		s->handle = ioctl(emu->fd, USB_RAW_IOCTL_EP_ENABLE, &s->desc);
+		if (s->handle < 0) {
+			fprintf(stderr, "%s: enabling ep 0x%02x failed: %s\n",
+				s->name, s->desc.bEndpointAddress,
+				strerror(errno));
+			return -1;
+		}
+	}
+
+	ioctl(emu->fd, USB_RAW_IOCTL_VBUS_DRAW, 500);
+	if (ioctl(emu->fd, USB_RAW_IOCTL_CONFIGURE, 0) < 0) {
+		perror("USB_RAW_IOCTL_CONFIGURE");
+		return -1;
+	}
+
+	emu->t0_ns = now_ns();
+	atomic_store(&emu->replaying, emu->num_streams);
+	for (i = 0; i < emu->num_streams; i++) {
+		struct stream *s = &emu->streams[i];
+
+		ret = pthread_create(&s->thread, NULL,
+				     emu->trace ? stream_replay :
+						  stream_synthetic, s);
+		if (ret) {
+			fprintf(stderr, "pthread_create: %s\n", strerror(ret));
+			return -1;
+		}
+		pthread_detach(s->thread);
+	}
+
+	if (emu->duration_s > 0 || emu->readers) {
+		pthread_t t;
+
+		ret = pthread_create(&t, NULL, load_report, emu);
+		if (ret) {
+			fprintf(stderr, "pthread_create: %s\n", strerror(ret));
+			return -1;
+		}
+		pthread_detach(t);
+	}
+	return 0;
+}
+
+/* Vendor SET report (host to device) carrying a sie_ctrl_pkt. */
+static void handle_report(struct emu *emu, const struct usb_ctrlrequest *c,
+			  const uint8_t *data, size_t len)
+{
+	struct sie_ctrl_pkt pkt;
+	uint32_t arg[2] = { 0, 0 };
+
+	memset(&pkt, 0, sizeof(pkt));
+	memcpy(&pkt, data, len < sizeof(pkt) ? len : sizeof(pkt));
+	memcpy(arg, pkt.data, sizeof(arg));
+
+	switch (c->wValue) {
+	case REPORT_CAMERA_MODE:
+		atomic_store(&emu->camera_mode, arg[1]);
+		if (emu->verbose)
+			printf("camera mode 0x%x\n", arg[1]);
+		break;
+	case REPORT_GAZE_STREAM:
+		atomic_store(&emu->gaze_deadline_ns,
+			     pkt.subcmd == GAZE_STREAM_ENABLE ?
+				     now_ns() + PSVR2_GAZE_LAPSE_MS * 1000000ull :
+				     0);
+		if (emu->verbose && pkt.subcmd != GAZE_STREAM_ENABLE)
+			printf("gaze stream off\n");
+		break;
+	case REPORT_BRIGHTNESS:
+		atomic_store(&emu->brightness, pkt.data[0]);
+		if (emu->verbose)
+			printf("brightness %u\n", pkt.data[0]);
+		break;
+	default:
+		if (emu->verbose)
+			printf("report 0x%02x subcmd 0x%02x len %u ignored\n",
+			       c->wValue, pkt.subcmd, pkt.len);
+		break;
+	}
+}
+
+/*
+ * Answer one setup packet. IN requests fill @data and return the reply
+ * length; OUT requests return 0. -1 stalls.
+ */
+static int handle_setup(struct emu *emu, const struct usb_ctrlrequest *c,
+			uint8_t *data)
+{
+	uint8_t type = c->bRequestType & USB_TYPE_MASK;
+	uint8_t dtype = c->wValue >> 8;
+
+	if (type == USB_TYPE_VENDOR) {
+		if (c->bRequest == REQ_SET && !(c->bRequestType & USB_DIR_IN))
+			return 0;	/* data handled once it has been read */
+		if (c->bRequest == REQ_GET && (c->bRequestType & USB_DIR_IN)) {
+			struct sie_ctrl_pkt *pkt = (struct sie_ctrl_pkt *)data;
+
+			memset(pkt, 0, sizeof(*pkt));
+			pkt->report_id = c->wValue;
+			pkt->len = c->wLength > 8 ? c->wLength - 8 : 0;
+			return c->wLength < sizeof(*pkt) ? c->wLength :
+							   sizeof(*pkt);
+		}
+		return -1;
+	}
+	if (type != USB_TYPE_STANDARD)
+		return -1;
+
+	switch (c->bRequest) {
+	case USB_REQ_GET_DESCRIPTOR:
+		switch (dtype) {
+		case USB_DT_DEVICE:
+			memcpy(data, &dev_desc, sizeof(dev_desc));
+			return sizeof(dev_desc);
+		case USB_DT_DEVICE_QUALIFIER:
+			memcpy(data, &qual_desc, sizeof(qual_desc));
+			return sizeof(qual_desc);
+		case USB_DT_CONFIG:
+			return build_config(emu, data);
+		case USB_DT_STRING: {
+			size_t len = build_string(emu, c->wValue & 0xff, data);
+
+			return len ? (int)len : -1;
+		}
+		default:
+			return -1;
+		}
+	case USB_REQ_SET_CONFIGURATION:
+		if (!emu->configured && start_streams(emu) < 0) {
+			stop = 1;
+			return -1;
+		}
+		emu->configured = true;
+		return 0;
+	case USB_REQ_GET_CONFIGURATION:
+		data[0] = emu->configured;
+		return 1;
+	case USB_REQ_SET_INTERFACE:
+		if (c->wIndex == IF_STATUS && c->wValue <= STATUS_ALT) {
+			atomic_store(&emu->status_alt, c->wValue);
+			return 0;
+		}
+		return c->wIndex < NUM_INTERFACES && c->wValue == 0 ? 0 : -1;
+	case USB_REQ_GET_INTERFACE:
+		data[0] = c->wIndex == IF_STATUS ?
+				  atomic_load(&emu->status_alt) : 0;
+		return 1;
+	case USB_REQ_GET_STATUS:
+		data[0] = data[1] = 0;
+		return 2;
+	case USB_REQ_CLEAR_FEATURE:
+	case USB_REQ_SET_FEATURE:
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+struct ep0_io {
+	struct usb_raw_ep_io	inner;
+	uint8_t			data[EP0_MAX];
+};
+
+struct ep0_event {
+	struct usb_raw_event	inner;
+	struct usb_ctrlrequest	ctrl;
+};
+
+static void ep0_loop(struct emu *emu)
+{
+	struct ep0_event ev;
+	struct ep0_io io;
+
+	while (!stop) {
+		const struct usb_ctrlrequest *c = &ev.ctrl;
+		bool in;
+		int len;
+
+		ev.inner.type = 0;
+		ev.inner.length = sizeof(ev.ctrl);
+		if (ioctl(emu->fd, USB_RAW_IOCTL_EVENT_FETCH, &ev) < 0) {
+			if (errno != EINTR)
+				perror("USB_RAW_IOCTL_EVENT_FETCH");
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+
+		if (ev.inner.type == USB_RAW_EVENT_CONNECT) {
+			if (emu->verbose)
+				printf("connected\n");
+			if (!emu->configured && assign_endpoints(emu) < 0)
+				return;
+			continue;
+		}
+		if (ev.inner.type != USB_RAW_EVENT_CONTROL) {
+			/* Reset / suspend / resume on newer kernels. */
+			if (emu->verbose)
+				printf("event %u\n", ev.inner.type);
+			continue;
+		}
+
+		in = c->bRequestType & USB_DIR_IN;
+		memset(&io, 0, sizeof(io));
+		len = handle_setup(emu, c, io.data);
+		if (len < 0) {
+			if (emu->verbose)
+				printf("stall: type 0x%02x req 0x%02x value 0x%04x index %u\n",
+				       c->bRequestType, c->bRequest, c->wValue,
+				       c->wIndex);
+			ioctl(emu->fd, USB_RAW_IOCTL_EP0_STALL, 0);
+			continue;
+		}
+
+		io.inner.ep = 0;
+		io.inner.flags = 0;
+		if (in) {
+			io.inner.length = len < c->wLength ? len : c->wLength;
+			if (ioctl(emu->fd, USB_RAW_IOCTL_EP0_WRITE, &io) < 0)
+				perror("USB_RAW_IOCTL_EP0_WRITE");
+			continue;
+		}
+
+		/* OUT: read the data stage (or ack a no-data request). */
+		io.inner.length = c->wLength < EP0_MAX ? c->wLength : EP0_MAX;
+		len = ioctl(emu->fd, USB_RAW_IOCTL_EP0_READ, &io);
+		if (len < 0) {
+			perror("USB_RAW_IOCTL_EP0_READ");
+			continue;
+		}
+		if ((c->bRequestType & USB_TYPE_MASK) == USB_TYPE_VENDOR)
+			handle_report(emu, c, io.data, len);
+	}
+}
+
+/* ---- main ---- */
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stop = 1;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -d, --driver NAME    UDC driver (default dummy_udc)\n"
+		"  -u, --udc NAME       UDC instance (default dummy_udc.0)\n"
+		"  -s, --serial STR     USB serial number\n"
+		"  -r, --replay FILE    stream a recorded trace instead of synthetic data\n"
+		"  -l, --loop           repeat the trace (otherwise exit at its end)\n"
+		"      --speed X        replay X times faster than captured\n"
+		"      --afap           replay as fast as the host accepts transfers\n"
+		"      --slam-hz N      synthetic pose rate (default %d)\n"
+		"      --gaze-hz N      synthetic gaze rate (default %d)\n"
+		"      --camera-fps N   synthetic camera rate (default %d)\n"
+		"      --scale [STREAM=]X  multiply synthetic rates (all, or one of\n"
+		"                       status slam gaze camera ld rp vd); repeatable\n"
+		"      --headsets N     run N emulators on <driver>.0..N-1\n"
+		"      --burst HOLD[/EVERY]  every EVERY ms (1000) hold traffic for\n"
+		"                       HOLD ms, then flush the backlog\n"
+		"      --coalesce K     up to K records per transfer (slam, gaze, aux)\n"
+		"      --readers        drain /dev/psvr2-{pose,gaze}N\n"
+		"      --duration S     run S seconds, then report the module's stats\n"
+		"      --unworn         report the proximity sensor as not worn\n"
+		"      --no-dp          report the DisplayPort link as down\n"
+		"  -v, --verbose        log ep0 traffic\n",
+		argv0, DEFAULT_SLAM_HZ, DEFAULT_GAZE_HZ, DEFAULT_CAMERA_FPS);
+}
+
+static void add_stream(struct emu *emu, const char *name, uint8_t ifnum,
+		       uint8_t type, uint8_t addr, double rate_hz,
+		       size_t max_len, bool packs,
+		       size_t (*fill)(struct emu *, struct stream *, uint8_t *,
+				      uint64_t))
+{
+	struct stream *s = &emu->streams[emu->num_streams++];
+
+	s->emu = emu;
+	s->name = name;
+	s->ifnum = ifnum;
+	s->type = type;
+	s->want_addr = addr;
+	s->want_maxp = type == USB_ENDPOINT_XFER_INT ? 1024 : 512;
+	s->interval = type == USB_ENDPOINT_XFER_INT ? 1 : 0;
+	s->rate_hz = rate_hz;
+	s->max_len = max_len;
+	s->packs = packs;
+	s->fill = fill;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option opts[] = {
+		{ "driver", required_argument, 0, 'd' },
+		{ "udc", required_argument, 0, 'u' },
+		{ "serial", required_argument, 0, 's' },
+		{ "replay", required_argument, 0, 'r' },
+		{ "loop", no_argument, 0, 'l' },
+		{ "speed", required_argument, 0, 'X' },
+		{ "afap", no_argument, 0, 'A' },
+		{ "slam-hz", required_argument, 0, 'S' },
+		{ "gaze-hz", required_argument, 0, 'G' },
+		{ "camera-fps", required_argument, 0, 'C' },
+		{ "scale", required_argument, 0, 'x' },
+		{ "headsets", required_argument, 0, 'N' },
+		{ "burst", required_argument, 0, 'B' },
+		{ "coalesce", required_argument, 0, 'K' },
+		{ "readers", no_argument, 0, 'R' },
+		{ "duration", required_argument, 0, 'T' },
+		{ "unworn", no_argument, 0, 'W' },
+		{ "no-dp", no_argument, 0, 'D' },
+		{ "verbose", no_argument, 0, 'v' },
+		{ "help", no_argument, 0, 'h' },
+		{ 0, 0, 0, 0 },
+	};
+	static struct emu emu = {
+		.serial = "EMU0000000",
+		.speed = 1,
+		.coalesce = 1,
+	};
+	static char udc_buf[UDC_NAME_LENGTH_MAX], serial_buf[128], load_buf[256];
+	struct { const char *name; double x; } scales[16];
+	int num_scales = 0, headsets = 1;
+	double scale_all = 1, hold_ms = 0, every_ms = 1000;
+	const char *driver = "dummy_udc", *udc = "dummy_udc.0", *replay = NULL;
+	double slam_hz = DEFAULT_SLAM_HZ, gaze_hz = DEFAULT_GAZE_HZ;
+	double camera_fps = DEFAULT_CAMERA_FPS;
+	struct usb_raw_init init;
+	struct sigaction sa;
+	int o, i;
+
+	while ((o = getopt_long(argc, argv, "d:u:s:r:lvh", opts, NULL)) != -1) {
+		switch (o) {
+		case 'd': driver = optarg; break;
+		case 'u': udc = optarg; break;
+		case 's': emu.serial = optarg; break;
+		case 'r': replay = optarg; break;
+		case 'l': emu.loop = true; break;
+		case 'X': emu.speed = atof(optarg); break;
+		case 'A': emu.afap = true; break;
+		case 'S': slam_hz = atof(optarg); break;
+		case 'G': gaze_hz = atof(optarg); break;
+		case 'C': camera_fps = atof(optarg); break;
+		case 'x': {
+			char *eq = strchr(optarg, '=');
+
+			if (!eq) {
+				scale_all = atof(optarg);
+			} else if (num_scales < 16) {
+				*eq = '\0';
+				scales[num_scales].name = optarg;
+				scales[num_scales++].x = atof(eq + 1);
+			}
+			break;
+		}
+		case 'N': headsets = atoi(optarg); break;
+		case 'B':
+			if (sscanf(optarg, "%lf/%lf", &hold_ms, &every_ms) < 1) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'K': emu.coalesce = atoi(optarg); break;
+		case 'R': emu.readers = true; break;
+		case 'T': emu.duration_s = atof(optarg); break;
+		case 'W': emu.unworn = true; break;
+		case 'D': emu.no_dp = true; break;
+		case 'v': emu.verbose = true; break;
+		default:
+			usage(argv[0]);
+			return o == 'h' ? 0 : 1;
+		}
+	}
+	if (slam_hz <= 0 || gaze_hz <= 0 || camera_fps <= 0 || emu.speed <= 0 ||
+	    scale_all <= 0 || headsets < 1 || emu.coalesce < 1 ||
+	    hold_ms < 0 || every_ms <= hold_ms) {
+		fprintf(stderr, "rates, scales, counts and burst periods must be positive\n");
+		return 1;
+	}
+	emu.burst_hold_ns = (uint64_t)(hold_ms * 1e6);
+	emu.burst_every_ns = (uint64_t)(every_ms * 1e6);
+
+	add_stream(&emu, "status", IF_STATUS, USB_ENDPOINT_XFER_INT, 0x88,
+		   1e6 / (IMU_PER_XFER * IMU_PERIOD_US), STATUS_XFER_SIZE,
+		   false, fill_status);
+	add_stream(&emu, "slam", IF_SLAM, USB_ENDPOINT_XFER_BULK, 0x83,
+		   slam_hz, 1024, true, fill_slam);
+	add_stream(&emu, "gaze", IF_GAZE, USB_ENDPOINT_XFER_BULK, 0x85,
+		   gaze_hz, 32768, true, fill_gaze);
+	add_stream(&emu, "camera", IF_CAMERA, USB_ENDPOINT_XFER_BULK, 0x87,
+		   camera_fps, CAM_TRACKING_XFER_SIZE, false, fill_camera);
+	add_stream(&emu, "ld", IF_LD, USB_ENDPOINT_XFER_BULK, 0x89,
+		   DEFAULT_AUX_HZ, 1024 * 1024, true, fill_aux);
+	add_stream(&emu, "rp", IF_RP, USB_ENDPOINT_XFER_BULK, 0x8a,
+		   DEFAULT_AUX_HZ, 1024 * 1024, true, fill_aux);
+	add_stream(&emu, "vd", IF_VD, USB_ENDPOINT_XFER_BULK, 0x8b,
+		   DEFAULT_AUX_HZ, 1024 * 1024, true, fill_aux);
+
+	for (i = 0; i < emu.num_streams; i++)
+		emu.streams[i].rate_hz *= scale_all;
+	for (o = 0; o < num_scales; o++) {
+		for (i = 0; i < emu.num_streams; i++)
+			if (!strcmp(emu.streams[i].name, scales[o].name))
+				break;
+		if (i == emu.num_streams || scales[o].x <= 0) {
+			fprintf(stderr, "bad --scale %s\n", scales[o].name);
+			return 1;
+		}
+		emu.streams[i].rate_hz *= scales[o].x;
+	}
+	snprintf(load_buf, sizeof(load_buf),
+		 "%d headset(s), scale x%g, coalesce %u, burst %g/%g ms%s",
+		 headsets, scale_all, emu.coalesce, hold_ms,
+		 hold_ms ? every_ms : 0, emu.readers ? ", readers" : "");
+	emu.load_desc = load_buf;
+
+	/* One emulator process per headset, each on its own UDC. */
+	if (headsets > 1) {
+		pid_t pid = 0;
+		int h;
+
+		for (h = 0; h < headsets; h++) {
+			pid = fork();
+			if (pid <= 0)
+				break;
+		}
+		if (pid < 0)
+			perror("fork");
+		if (pid != 0) {
+			/* The children get the terminal's ^C themselves. */
+			signal(SIGINT, SIG_IGN);
+			while (wait(NULL) > 0)
+				;
+			return pid < 0;
+		}
+		snprintf(udc_buf, sizeof(udc_buf), "%s.%d", driver, h);
+		snprintf(serial_buf, sizeof(serial_buf), "%s-%d", emu.serial, h);
+		udc = udc_buf;
+		emu.serial = serial_buf;
+	}
+
+	for (i = 0; i < emu.num_streams; i++) {
+		struct stream *s = &emu.streams[i];
+
+		s->io = malloc(sizeof(*s->io) + WRITE_CHUNK);
+		s->buf = malloc(s->max_len);
+		if (!s->io || !s->buf) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+	}
+
+	if (replay && load_trace(&emu, replay) < 0)
+		return 1;
+
+	emu.fd = open("/dev/raw-gadget", O_RDWR);
+	if (emu.fd < 0) {
+		perror("/dev/raw-gadget");
+		fprintf(stderr, "modprobe raw_gadget dummy_hcd, and run as root\n");
+		return 1;
+	}
+
+	memset(&init, 0, sizeof(init));
+	snprintf((char *)init.driver_name, UDC_NAME_LENGTH_MAX, "%s", driver);
+	snprintf((char *)init.device_name, UDC_NAME_LENGTH_MAX, "%s", udc);
+	init.speed = USB_SPEED_HIGH;
+	if (ioctl(emu.fd, USB_RAW_IOCTL_INIT, &init) < 0 ||
+	    ioctl(emu.fd, USB_RAW_IOCTL_RUN, 0) < 0) {
+		perror("raw-gadget init");
+		return 1;
+	}
+
+	emu.main_thread = pthread_self();
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;	/* no SA_RESTART: interrupt the fetch */
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	printf("psvr2-emu: %04x:%04x on %s, serial %s, %s traffic\n",
+	       PSVR2_VENDOR_ID, PSVR2_PRODUCT_ID, udc, emu.serial,
+	       replay ? "recorded" : "synthetic");
+	ep0_loop(&emu);
+
+	for (i = 0; i < emu.num_streams; i++) {
+		struct stream *s = &emu.streams[i];
+
+		printf("%-6s xfers %llu bytes %llu skipped %llu\n", s->name,
+		       atomic_load(&s->xfers), atomic_load(&s->bytes),
+		       atomic_load(&s->skipped));
+	}
+	return 0;
+}
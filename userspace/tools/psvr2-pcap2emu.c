@@ -0,0 +1,472 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * psvr2-pcap2emu — turn a usbmon capture of a PSVR2 into a psvr2-emu trace.
+ *
+ * Reads a binary usbmon capture (pcap or pcapng, link types LINUX_USB and
+ * LINUX_USB_MMAPPED, as written by `tcpdump -i usbmonN -w` or Wireshark) and
+ * keeps the completed IN transfers of the headset's streaming endpoints, each
+ * tagged with its interface number and capture-relative time. Feed the result
+ * to `psvr2-emu -r` to push the same payloads through the module again.
+ *
+ * Endpoints are mapped to interfaces from the configuration descriptor in the
+ * capture (start capturing before plugging the headset in), falling back to
+ * the headset's known addresses (0x83 SLAM, 0x85 gaze, 0x87 camera, 0x88
+ * status); -m adds or overrides a mapping. The headset is found by its device
+ * descriptor, or picked with -d BUS:DEV.
+ *
+ * Build:  cc -O2 -o psvr2-pcap2emu psvr2-pcap2emu.c
+ * Run:    ./psvr2-pcap2emu [-d BUS:DEV] [-m EP=IF]... capture.pcap trace.p2emu
+ *
+ * Copyright (C) 2026 PSVR2 Linux project
+ */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PSVR2_VENDOR_ID		0x054c
+#define PSVR2_PRODUCT_ID	0x0cde
+
+#define LINKTYPE_USB_LINUX		189
+#define LINKTYPE_USB_LINUX_MMAPPED	220
+
+#define PCAP_MAGIC_US		0xa1b2c3d4
+#define PCAP_MAGIC_NS		0xa1b23c4d
+#define PCAPNG_SHB		0x0a0d0d0a
+#define PCAPNG_IDB		0x00000001
+#define PCAPNG_EPB		0x00000006
+#define PCAPNG_BOM		0x1a2b3c4d
+#define PCAPNG_MAX_IFACES	16
+
+#define USB_DT_DEVICE		1
+#define USB_DT_CONFIG		2
+#define USB_DT_INTERFACE	4
+#define USB_DT_ENDPOINT		5
+#define USB_REQ_GET_DESCRIPTOR	6
+
+#define XFER_INT	1
+#define XFER_CTRL	2
+#define XFER_BULK	3
+
+#define MAX_PACKET	(2 * 1024 * 1024)
+
+#define TRACE_MAGIC	"PSVR2EMU"
+#define TRACE_VERSION	1
+
+/* Binary usbmon header (Documentation/usb/usbmon.rst); 48 or 64 bytes. */
+struct usbmon_packet {
+	uint64_t	id;
+	uint8_t		type;		/* 'S'ubmit, 'C'omplete, 'E'rror */
+	uint8_t		xfer_type;
+	uint8_t		epnum;		/* with USB_DIR_IN (0x80) */
+	uint8_t		devnum;
+	uint16_t	busnum;
+	char		flag_setup;
+	char		flag_data;
+	int64_t		ts_sec;
+	int32_t		ts_usec;
+	int32_t		status;
+	uint32_t	length;
+	uint32_t	len_cap;
+	uint8_t		setup[8];
+	/* LINUX_USB_MMAPPED only: */
+	int32_t		interval;
+	int32_t		start_frame;
+	uint32_t	xfer_flags;
+	uint32_t	ndesc;
+} __attribute__((packed));
+
+#define USBMON_HDR_LEN		48
+#define USBMON_MMAPPED_HDR_LEN	64
+#define USBMON_ISO_DESC_LEN	16
+
+struct trace_hdr {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	reserved;
+} __attribute__((packed));
+
+struct trace_rec {
+	uint64_t	t_ns;
+	uint8_t		ifnum;
+	uint8_t		reserved[3];
+	uint32_t	length;
+} __attribute__((packed));
+
+struct conv {
+	FILE		*out;
+	int		want_bus, want_dev;	/* -1: find by descriptor */
+	int		ep_if[16];		/* IN endpoint number -> ifnum */
+	bool		ep_pinned[16];		/* set by -m, never overridden */
+	bool		have_t0;
+	uint64_t	t0_ns;
+
+	/* Last GET_DESCRIPTOR submitted, to type its completion. */
+	int		pending_bus, pending_dev, pending_type;
+
+	unsigned long	packets, written, truncated, errors;
+	unsigned long	per_if[16];
+};
+
+static void map_config(struct conv *cv, const uint8_t *d, size_t len)
+{
+	int ifnum = -1;
+	size_t off = 0;
+
+	while (off + 2 <= len && d[off] >= 2 && off + d[off] <= len) {
+		uint8_t type = d[off + 1];
+
+		if (type == USB_DT_INTERFACE && d[off] >= 3) {
+			ifnum = d[off + 2];
+		} else if (type == USB_DT_ENDPOINT && d[off] >= 3 && ifnum >= 0 &&
+			   (d[off + 2] & 0x80)) {
+			int ep = d[off + 2] & 0x0f;
+
+			if (!cv->ep_pinned[ep])
+				cv->ep_if[ep] = ifnum;
+		}
+		off += d[off];
+	}
+}
+
+static void handle_control(struct conv *cv, const struct usbmon_packet *h,
+			   const uint8_t *data)
+{
+	/* GET_DESCRIPTOR submit: remember what the completion will carry. */
+	if (h->type == 'S' && h->flag_setup == 0 &&
+	    h->setup[0] == 0x80 && h->setup[1] == USB_REQ_GET_DESCRIPTOR) {
+		cv->pending_bus = h->busnum;
+		cv->pending_dev = h->devnum;
+		cv->pending_type = h->setup[3];
+		return;
+	}
+	if (h->type != 'C' || h->status || h->busnum != cv->pending_bus ||
+	    h->devnum != cv->pending_dev)
+		return;
+
+	if (cv->pending_type == USB_DT_DEVICE && h->len_cap >= 12 &&
+	    cv->want_bus < 0 &&
+	    (data[8] | data[9] << 8) == PSVR2_VENDOR_ID &&
+	    (data[10] | data[11] << 8) == PSVR2_PRODUCT_ID) {
+		cv->want_bus = h->busnum;
+		cv->want_dev = h->devnum;
+		fprintf(stderr, "headset at %u:%u\n", h->busnum, h->devnum);
+	} else if (cv->pending_type == USB_DT_CONFIG &&
+		   h->busnum == cv->want_bus && h->devnum == cv->want_dev) {
+		map_config(cv, data, h->len_cap);
+	}
+	cv->pending_type = -1;
+}
+
+static int handle_packet(struct conv *cv, uint64_t ts_ns, int linktype,
+			 const uint8_t *pkt, size_t caplen)
+{
+	size_t hdr_len = linktype == LINKTYPE_USB_LINUX_MMAPPED ?
+				 USBMON_MMAPPED_HDR_LEN : USBMON_HDR_LEN;
+	struct usbmon_packet h;
+	struct trace_rec rec;
+	const uint8_t *data;
+	int ep, ifnum;
+
+	if (linktype != LINKTYPE_USB_LINUX &&
+	    linktype != LINKTYPE_USB_LINUX_MMAPPED)
+		return 0;
+	if (caplen < hdr_len)
+		return 0;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(&h, pkt, hdr_len);
+	if (linktype == LINKTYPE_USB_LINUX_MMAPPED)
+		hdr_len += (size_t)h.ndesc * USBMON_ISO_DESC_LEN;
+	if (caplen < hdr_len)
+		return 0;
+	data = pkt + hdr_len;
+	if (h.len_cap > caplen - hdr_len)
+		h.len_cap = caplen - hdr_len;
+
+	cv->packets++;
+	if (!cv->have_t0) {
+		cv->t0_ns = ts_ns;
+		cv->have_t0 = true;
+	}
+
+	if (h.xfer_type == XFER_CTRL) {
+		handle_control(cv, &h, data);
+		return 0;
+	}
+	if (h.type != 'C' || !(h.epnum & 0x80) ||
+	    (h.xfer_type != XFER_BULK && h.xfer_type != XFER_INT))
+		return 0;
+	if (cv->want_bus >= 0 &&
+	    (h.busnum != cv->want_bus || h.devnum != cv->want_dev))
+		return 0;
+	if (h.status) {
+		cv->errors++;
+		return 0;
+	}
+	if (!h.length)
+		return 0;
+	if (h.len_cap < h.length) {
+		/* Snap length too short; a partial transfer would mislead. */
+		cv->truncated++;
+		return 0;
+	}
+
+	ep = h.epnum & 0x0f;
+	ifnum = cv->ep_if[ep];
+	if (ifnum < 0)
+		return 0;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.t_ns = ts_ns - cv->t0_ns;
+	rec.ifnum = ifnum;
+	rec.length = h.length;
+	if (fwrite(&rec, sizeof(rec), 1, cv->out) != 1 ||
+	    fwrite(data, h.length, 1, cv->out) != 1)
+		return -errno;
+	cv->written++;
+	cv->per_if[ifnum & 0x0f]++;
+	return 0;
+}
+
+/* ---- pcap ---- */
+
+static uint32_t swap32(uint32_t v, bool swap)
+{
+	return swap ? __builtin_bswap32(v) : v;
+}
+
+static int read_pcap(struct conv *cv, FILE *f, uint32_t magic, uint8_t *buf)
+{
+	uint32_t hdr[6], rec[4];
+	bool swap = magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS;
+	bool ns;
+	int linktype, ret;
+
+	hdr[0] = magic;
+	if (fread(hdr + 1, sizeof(uint32_t), 5, f) != 5)
+		return -EINVAL;
+	ns = swap32(magic, swap) == PCAP_MAGIC_NS;
+	linktype = swap32(hdr[5], swap) & 0xffff;
+
+	while (fread(rec, sizeof(rec), 1, f) == 1) {
+		uint32_t caplen = swap32(rec[2], swap);
+		uint64_t ts = (uint64_t)swap32(rec[0], swap) * 1000000000ull +
+			      (uint64_t)swap32(rec[1], swap) * (ns ? 1 : 1000);
+
+		if (caplen > MAX_PACKET ||
+		    (caplen && fread(buf, caplen, 1, f) != 1))
+			return -EINVAL;
+		ret = handle_packet(cv, ts, linktype, buf, caplen);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+/* ---- pcapng ---- */
+
+struct ng_iface {
+	int		linktype;
+	uint64_t	units_per_sec;
+};
+
+static uint64_t ng_tsresol(const uint8_t *opt, size_t len)
+{
+	size_t off = 0;
+
+	while (off + 4 <= len) {
+		uint16_t code, olen;
+
+		memcpy(&code, opt + off, 2);
+		memcpy(&olen, opt + off + 2, 2);
+		if (code == 0)
+			break;
+		if (code == 9 && olen == 1 && off + 5 <= len) {
+			uint8_t r = opt[off + 4];
+			uint64_t u = 1;
+			int i;
+
+			for (i = 0; i < (r & 0x7f); i++)
+				u *= r & 0x80 ? 2 : 10;
+			return u;
+		}
+		off += 4 + ((olen + 3) & ~3u);
+	}
+	return 1000000;	/* default: microseconds */
+}
+
+static int read_pcapng(struct conv *cv, FILE *f, uint8_t *buf)
+{
+	struct ng_iface ifaces[PCAPNG_MAX_IFACES];
+	int num_ifaces = 0, ret;
+	uint32_t bh[2];
+	bool first = true;
+
+	while (fread(bh, sizeof(bh), 1, f) == 1) {
+		uint32_t type = bh[0], len = bh[1];
+		uint8_t *body = buf;
+		size_t body_len;
+
+		if (first && type != PCAPNG_SHB)
+			return -EINVAL;
+		first = false;
+		if (len < 12 || len > MAX_PACKET || len % 4)
+			return -EINVAL;
+		body_len = len - 12;
+		if ((body_len && fread(body, body_len, 1, f) != 1) ||
+		    fread(bh, sizeof(uint32_t), 1, f) != 1)
+			return -EINVAL;
+
+		if (type == PCAPNG_SHB) {
+			uint32_t bom;
+
+			memcpy(&bom, body, 4);
+			if (bom != PCAPNG_BOM) {
+				fprintf(stderr, "big-endian pcapng is not supported\n");
+				return -EINVAL;
+			}
+			num_ifaces = 0;	/* a new section restarts interface ids */
+		} else if (type == PCAPNG_IDB && body_len >= 8) {
+			uint16_t lt;
+
+			if (num_ifaces == PCAPNG_MAX_IFACES)
+				continue;
+			memcpy(&lt, body, 2);
+			ifaces[num_ifaces].linktype = lt;
+			ifaces[num_ifaces].units_per_sec =
+				ng_tsresol(body + 8, body_len - 8);
+			num_ifaces++;
+		} else if (type == PCAPNG_EPB && body_len >= 20) {
+			uint32_t id, hi, lo, caplen;
+			uint64_t units, ts;
+
+			memcpy(&id, body, 4);
+			memcpy(&hi, body + 4, 4);
+			memcpy(&lo, body + 8, 4);
+			memcpy(&caplen, body + 12, 4);
+			if (id >= (uint32_t)num_ifaces || caplen > body_len - 20)
+				continue;
+			units = (uint64_t)hi << 32 | lo;
+			ts = units / ifaces[id].units_per_sec * 1000000000ull +
+			     units % ifaces[id].units_per_sec * 1000000000ull /
+				     ifaces[id].units_per_sec;
+			ret = handle_packet(cv, ts, ifaces[id].linktype,
+					    body + 20, caplen);
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [-d BUS:DEV] [-m EP=IF]... capture.pcap[ng] out.p2emu\n"
+		"  -d BUS:DEV   take transfers of this device (default: the one\n"
+		"               whose device descriptor is 054c:0cde, else all)\n"
+		"  -m EP=IF     map IN endpoint EP (e.g. 0x89) to interface IF\n",
+		argv0);
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t buf[MAX_PACKET];
+	struct trace_hdr th = { .version = TRACE_VERSION };
+	struct conv cv;
+	uint32_t magic;
+	FILE *in;
+	int o, i, ret;
+
+	memset(&cv, 0, sizeof(cv));
+	cv.want_bus = cv.want_dev = -1;
+	cv.pending_type = -1;
+	for (i = 0; i < 16; i++)
+		cv.ep_if[i] = -1;
+	cv.ep_if[3] = 3;	/* SLAM */
+	cv.ep_if[5] = 5;	/* gaze */
+	cv.ep_if[7] = 6;	/* camera */
+	cv.ep_if[8] = 7;	/* status / IMU */
+
+	while ((o = getopt(argc, argv, "d:m:h")) != -1) {
+		unsigned int a, b;
+		int ep;
+
+		switch (o) {
+		case 'd':
+			if (sscanf(optarg, "%u:%u", &a, &b) != 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			cv.want_bus = a;
+			cv.want_dev = b;
+			break;
+		case 'm':
+			if (sscanf(optarg, "%i=%u", &ep, &b) != 2 || b > 15) {
+				usage(argv[0]);
+				return 1;
+			}
+			cv.ep_if[ep & 0x0f] = b;
+			cv.ep_pinned[ep & 0x0f] = true;
+			break;
+		default:
+			usage(argv[0]);
+			return o == 'h' ? 0 : 1;
+		}
+	}
+	if (argc - optind != 2) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	in = fopen(argv[optind], "rb");
+	if (!in) {
+		perror(argv[optind]);
+		return 1;
+	}
+	cv.out = fopen(argv[optind + 1], "wb");
+	if (!cv.out) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+	memcpy(th.magic, TRACE_MAGIC, sizeof(th.magic));
+	fwrite(&th, sizeof(th), 1, cv.out);
+
+	if (fread(&magic, sizeof(magic), 1, in) != 1) {
+		fprintf(stderr, "%s: empty file\n", argv[optind]);
+		return 1;
+	}
+	if (magic == PCAPNG_SHB) {
+		fseek(in, 0, SEEK_SET);
+		ret = read_pcapng(&cv, in, buf);
+	} else if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS ||
+		   magic == __builtin_bswap32(PCAP_MAGIC_US) ||
+		   magic == __builtin_bswap32(PCAP_MAGIC_NS)) {
+		ret = read_pcap(&cv, in, magic, buf);
+	} else {
+		fprintf(stderr, "%s: not a pcap or pcapng file\n", argv[optind]);
+		return 1;
+	}
+	fclose(in);
+	if (fclose(cv.out) || ret) {
+		fprintf(stderr, "conversion failed: %s\n",
+			ret == -EINVAL ? "malformed capture" :
+					 strerror(ret ? -ret : errno));
+		return 1;
+	}
+
+	fprintf(stderr, "%lu packets, %lu transfers written", cv.packets,
+		cv.written);
+	for (i = 0; i < 16; i++)
+		if (cv.per_if[i])
+			fprintf(stderr, " IF%d=%lu", i, cv.per_if[i]);
+	fprintf(stderr, ", %lu truncated, %lu errored\n", cv.truncated,
+		cv.errors);
+	if (cv.truncated)
+		fprintf(stderr, "recapture with a larger snap length (tcpdump -s 0)\n");
+	return 0;
+}